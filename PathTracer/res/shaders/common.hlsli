@@ -1,5 +1,4 @@
 //constants
-#define MAX_LIGHTS                  16
 
 #define TEX_FILTER_NEAREST			0
 #define TEX_FILTER_BILINEAR			1
@@ -9,6 +8,7 @@
 #define LIGHT_TYPE_DIRECTIONAL		0
 #define LIGHT_TYPE_SPOTLIGHT		1
 #define LIGHT_TYPE_POINTLIGHT		2
+#define LIGHT_TYPE_TRIANGLE			3
 
 #define HEIGHT_SCALE                0.05
 #define POM_MIN_LAYERS              8
@@ -20,7 +20,7 @@ struct VertexIn
     float3 pos: POSITION0;
     float3 normal: NORMAL;
     float2 uvs: TEXCOORD;
-    float3 tangent: TANGENT;
+    float4 tangent: TANGENT;
 };
 
 struct MVVertexOut
@@ -109,7 +109,16 @@ cbuffer cbPass: register(b0)
     float2 jitter;
     float gFov;
     float gAspectRatio;
-    Light gLights[MAX_LIGHTS];
+    uint gLightTreeNodes;
+    uint gDirectionalLights;
+    uint gLightSampling;
+    float gLightsPad;
+    float4 gClusterDepth;
+    float2 gClusterScale;
+    uint gEmissiveLights;
+    uint gEnvironmentSize;
+    float4 gAmbientSH[9];
+    uint gPrefilteredMips;
 }
 
 Texture2DArray gTextures: register(t0);
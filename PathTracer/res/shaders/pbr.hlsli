@@ -179,6 +179,31 @@ float3 ComputeSpotLight(Light L, MaterialPBR mat, float3 pos, float3 vndfNormal,
     return lightStrength * ndotl;
 }
 
+//lambertian emitter at the centroid, Strength is radiance times area
+float3 ComputeTriangleLight(Light L, MaterialPBR mat, float3 pos, float3 vndfNormal, float3 cosWNormal, float3 normal, float3 toEye, out float3 Ls)
+{
+    float3 lightVec = L.Position - pos;
+    float d = length(lightVec);
+    
+    if(d > L.FalloffEnd)
+        return 0.0;
+    
+    lightVec /= d;
+    
+    float ndotl = max(dot(lightVec, cosWNormal), 0.0);
+    float3 lightStrength = L.Strength * max(dot(-lightVec, L.Direction), 0.0);
+    lightStrength *= CalcInverseSquare(d, L.FalloffStart);
+    
+    if(mat.specular > 0.0)
+    {
+        if(mat.divideByPdf)
+            Ls = lightStrength * GGX_PDF(mat, vndfNormal, normal, toEye);
+        else
+            Ls = lightStrength * GGX(mat, lightVec, vndfNormal, toEye);
+    }
+    return lightStrength * ndotl;
+}
+
 float3 ComputeLighting(Light light, MaterialPBR mat, float3 pos, float3 vndfNormal, float3 cosWNormal, float3 normal, float3 toEye, out float3 specAlbedo)
 {
     float3 Ld = 0.0;
@@ -190,6 +215,8 @@ float3 ComputeLighting(Light light, MaterialPBR mat, float3 pos, float3 vndfNorm
         Ld = ComputePointLight(light, mat, pos, vndfNormal, cosWNormal, normal, toEye, Ls);
     else if(light.type == LIGHT_TYPE_SPOTLIGHT)
         Ld = ComputeSpotLight(light, mat, pos, vndfNormal, cosWNormal, normal, toEye, Ls);
+    else if(light.type == LIGHT_TYPE_TRIANGLE)
+        Ld = ComputeTriangleLight(light, mat, pos, vndfNormal, cosWNormal, normal, toEye, Ls);
     
     float s = mat.specular;
     
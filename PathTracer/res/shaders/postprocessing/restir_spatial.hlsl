@@ -25,6 +25,7 @@ StructuredBuffer<Reservoir> gInput: register(t0);
 Texture2D gDepthBuffer: register(t1);
 Texture2D gNormals: register(t2);
 Texture2D gRF0: register(t3);
+StructuredBuffer<Light> gLights: register(t4);
 
 RWStructuredBuffer<Reservoir> gOutput: register(u0);
 
@@ -40,7 +41,6 @@ cbuffer cbData: register(b0)
     uint gLightCount;
     uint gWidth;
     uint gHeight;
-    Light gLights[128];
 }
 
 groupshared Reservoir reservoirCache[10][10];
@@ -50,6 +50,7 @@ groupshared float depthCache[10][10];
 #define LIGHT_TYPE_DIRECTIONAL		0
 #define LIGHT_TYPE_SPOTLIGHT		1
 #define LIGHT_TYPE_POINTLIGHT		2
+#define LIGHT_TYPE_TRIANGLE			3
 #define NRD_EPS                     1e-6
 #define COMMON_ONLY
 #include "../utils.hlsli"
@@ -59,7 +60,7 @@ groupshared float depthCache[10][10];
 void main(uint3 threadID: SV_DispatchThreadID, uint3 groupThreadID: SV_GroupThreadID)
 {
     int2 localCoord = int2(groupThreadID.xy);
-    uint seed = initRand(threadID.x * gFrameIndex, threadID.y * gFrameIndex, 16);
+    uint seed = initRand(threadID.x + threadID.y * gWidth, gFrameIndex);
     
     if(threadID.x < gWidth && threadID.y < gHeight)
     {
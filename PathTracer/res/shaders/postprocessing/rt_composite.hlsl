@@ -5,6 +5,7 @@
 #include "../raytracing/path_tracing_utils.hlsli"
 
 RWTexture2D<float4> gOutput: register(u0);
+RWTexture2D<float4> gAccumulation: register(u1);
 
 Texture2D gDiffuse: register(t0);
 Texture2D gSpecular: register(t1);
@@ -17,6 +18,15 @@ Texture2D gSpecSH1: register(t7);
 Texture2D gNormals: register(t8);
 Texture2D gView: register(t9);
 Texture2D gZ: register(t10);
+Texture2D gNoisySpecular: register(t11);
+Texture2D gNoisyDiffSH1: register(t12);
+Texture2D gNoisySpecSH1: register(t13);
+
+cbuffer cbAccumulation: register(b0)
+{
+    uint gAccumulatedFrames; //0 when the view changes every frame
+    uint gAccumulate;
+};
 
 //#define NRD_VALIDATION
 
@@ -24,10 +34,12 @@ Texture2D gZ: register(t10);
 void main(uint3 threadID: SV_DispatchThreadID)
 {
     //extract
+    //a static view averages the noisy signals, the denoiser would only add its bias
+    bool progressive = gAccumulatedFrames > 0;
     float4 packedDiffuse = gDiffuse[threadID.xy];
-    float4 packedSpecular = gSpecular[threadID.xy];
-    float4 diffSH1 = gDiffSH1[threadID.xy];
-    float4 specSH1 = gSpecSH1[threadID.xy];
+    float4 packedSpecular = progressive ? gNoisySpecular[threadID.xy] : gSpecular[threadID.xy];
+    float4 diffSH1 = progressive ? gNoisyDiffSH1[threadID.xy] : gDiffSH1[threadID.xy];
+    float4 specSH1 = progressive ? gNoisySpecSH1[threadID.xy] : gSpecSH1[threadID.xy];
     float3 view = gView[threadID.xy].xyz;
     float4 skyColor = gSky[threadID.xy];
     float4 albedo = gAlbedo[threadID.xy];
@@ -69,6 +81,17 @@ void main(uint3 threadID: SV_DispatchThreadID)
             
     float3 result = skyColor.a > 0 ? skyColor.rgb : (diffuseColor.rgb * diffFactor + specularColor * specFactor) * darkness;
     
+    if(progressive)
+    {
+        float3 sum = gAccumulatedFrames > 1 ? gAccumulation[threadID.xy].rgb : 0.0;
+        if(gAccumulate)
+        {
+            sum += result;
+            gAccumulation[threadID.xy] = float4(sum, 1.0);
+        }
+        result = sum / gAccumulatedFrames;
+    }
+    
 #ifdef NRD_VALIDATION
     if(threadID.x < 320 || threadID.x > 960 || threadID.y < 180)
         gOutput[threadID.xy] = packedDiffuse;
@@ -1,7 +1,5 @@
 #define RT_RAYTRACING
 
-#define MAX_LIGHTS                  128
-
 #define TEX_FILTER_NEAREST			0
 #define TEX_FILTER_BILINEAR			1
 #define TEX_FILTER_TRILINEAR		2
@@ -9,6 +7,12 @@
 #define LIGHT_TYPE_DIRECTIONAL		0
 #define LIGHT_TYPE_SPOTLIGHT		1
 #define LIGHT_TYPE_POINTLIGHT		2
+#define LIGHT_TYPE_TRIANGLE			3
+
+#define LIGHT_SAMPLING_UNIFORM		0
+#define LIGHT_SAMPLING_ALIAS		1
+#define LIGHT_SAMPLING_TREE			2
+#define LIGHT_SAMPLING_CLUSTERED	3
 
 #define HEIGHT_SCALE                0.05
 #define POM_MIN_LAYERS              8
@@ -25,7 +29,7 @@ struct Vertex
     float3 pos;
     float3 norm;
     float2 uvs;
-    float3 tangent;
+    float4 tangent;
 };
 
 struct Light
@@ -41,6 +45,34 @@ struct Light
     float2 pad;
 };
 
+struct LightTreeNode
+{
+    float3 boundsMin;
+    uint offset;
+    float3 boundsMax;
+    uint count;
+    float3 axis;
+    float power;
+    float cosThetaO;
+    float cosThetaE;
+    float range;
+    float pad;
+};
+
+struct LightAliasEntry
+{
+    float probability;
+    uint alias;
+    float pdf;
+    float pad;
+};
+
+struct LightCluster
+{
+    uint offset;
+    uint count;
+};
+
 struct Material
 {
     float4 diffuseAlbedo;
@@ -136,5 +168,16 @@ cbuffer cbPass: register(b0)
     float2 jitter;
     float gFov;
     float gAspectRatio;
-    Light gLights[MAX_LIGHTS];
-}
\ No newline at end of file
+    uint gLightTreeNodes;
+    uint gDirectionalLights;
+    uint gLightSampling;
+    float gLightsPad;
+    float4 gClusterDepth;
+    float2 gClusterScale;
+    uint gEmissiveLights;
+    uint gEnvironmentSize;
+    float4 gAmbientSH[9];
+    uint gPrefilteredMips;
+}
+
+StructuredBuffer<Light> gLights: register(t0, space3);
\ No newline at end of file
@@ -0,0 +1,103 @@
+//cubemap importance sampling tables built by EnvironmentMap, rows are face major and both CDFs are inclusive
+float3 environmentFaceDirection(uint face, float2 uv)
+{
+    float s = 2.0 * uv.x - 1.0;
+    float t = 2.0 * uv.y - 1.0;
+    switch(face)
+    {
+        case 0: return float3(1.0, -t, -s);
+        case 1: return float3(-1.0, -t, s);
+        case 2: return float3(s, 1.0, t);
+        case 3: return float3(s, -1.0, -t);
+        case 4: return float3(s, -t, 1.0);
+        default: return float3(-s, -t, -1.0);
+    }
+}
+
+//texels are picked uniformly on the face, dw = dA / (1 + s^2 + t^2)^1.5
+float environmentJacobian(float2 uv)
+{
+    float2 st = 2.0 * uv - 1.0;
+    float r2 = 1.0 + dot(st, st);
+    return r2 * sqrt(r2) * gEnvironmentSize * gEnvironmentSize * 0.25;
+}
+
+//first entry of cdf[first, first + count) above u
+uint environmentSearch(StructuredBuffer<float> cdf, uint first, uint count, float u)
+{
+    uint low = 0;
+    uint high = count;
+    while(low < high)
+    {
+        uint mid = (low + high) / 2;
+        if(cdf[first + mid] <= u)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return min(low, count - 1);
+}
+
+float3 sampleEnvironment(float u0, float u1, out float pdf)
+{
+    uint size = gEnvironmentSize;
+    uint row = environmentSearch(gEnvMarginal, 0, 6 * size, u0);
+    float rowLow = row > 0 ? gEnvMarginal[row - 1] : 0.0;
+    float rowP = gEnvMarginal[row] - rowLow;
+
+    uint column = environmentSearch(gEnvConditional, row * size, size, u1);
+    float columnLow = column > 0 ? gEnvConditional[row * size + column - 1] : 0.0;
+    float columnP = gEnvConditional[row * size + column] - columnLow;
+
+    pdf = 0.0;
+    if(rowP <= 0.0 || columnP <= 0.0)
+        return float3(0.0, 1.0, 0.0);
+
+    //the leftovers of both searches place the point inside the texel
+    float2 t = clamp(float2((u1 - columnLow) / columnP, (u0 - rowLow) / rowP), 0.0, 0.999);
+    float2 uv = (float2(column, row % size) + t) / size;
+
+    pdf = rowP * columnP * environmentJacobian(uv);
+    return normalize(environmentFaceDirection(row / size, uv));
+}
+
+float environmentPdf(float3 dir)
+{
+    float3 a = abs(dir);
+    uint face;
+    float2 st;
+    if(a.x >= a.y && a.x >= a.z)
+    {
+        face = dir.x > 0.0 ? 0 : 1;
+        st = float2(dir.x > 0.0 ? -dir.z : dir.z, -dir.y) / a.x;
+    }
+    else if(a.y >= a.z)
+    {
+        face = dir.y > 0.0 ? 2 : 3;
+        st = float2(dir.x, dir.y > 0.0 ? dir.z : -dir.z) / a.y;
+    }
+    else
+    {
+        face = dir.z > 0.0 ? 4 : 5;
+        st = float2(dir.z > 0.0 ? dir.x : -dir.x, -dir.y) / a.z;
+    }
+
+    uint size = gEnvironmentSize;
+    float2 uv = 0.5 * (st + 1.0);
+    uint2 texel = min(uint2(max(uv * size, 0.0)), size - 1);
+    uint row = face * size + texel.y;
+
+    float rowP = gEnvMarginal[row] - (row > 0 ? gEnvMarginal[row - 1] : 0.0);
+    float columnP = gEnvConditional[row * size + texel.x] - (texel.x > 0 ? gEnvConditional[row * size + texel.x - 1] : 0.0);
+    return rowP * columnP * environmentJacobian(uv);
+}
+
+//irradiance over pi from the L2 projection of the cubemap, same polynomial as SphericalHarmonics::evaluate
+float3 evaluateAmbient(float3 n)
+{
+    float3 result = gAmbientSH[0].rgb;
+    result += gAmbientSH[1].rgb * n.y + gAmbientSH[2].rgb * n.z + gAmbientSH[3].rgb * n.x;
+    result += gAmbientSH[4].rgb * (n.x * n.y) + gAmbientSH[5].rgb * (n.y * n.z) + gAmbientSH[6].rgb * (3.0 * n.z * n.z - 1.0);
+    result += gAmbientSH[7].rgb * (n.x * n.z) + gAmbientSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(result, 0.0);
+}
\ No newline at end of file
@@ -9,6 +9,12 @@ StructuredBuffer<Vertex> vertices: register(t0);
 StructuredBuffer<int> indices: register(t1);
 StructuredBuffer<Material> gMaterials: register(t0, space1);
 StructuredBuffer<ObjectData> gData: register(t1, space1);
+StructuredBuffer<LightTreeNode> gLightTree: register(t2, space1);
+StructuredBuffer<LightAliasEntry> gLightAlias: register(t3, space1);
+StructuredBuffer<LightCluster> gLightClusters: register(t4, space1);
+StructuredBuffer<uint> gClusterLights: register(t5, space1);
+StructuredBuffer<float> gEnvMarginal: register(t6, space1);
+StructuredBuffer<float> gEnvConditional: register(t7, space1);
 
 Texture2DArray gTextures: register(t0, space2);
 Texture2DArray gNormalMaps: register(t1, space2);
@@ -17,6 +23,9 @@ Texture2DArray gHeightMaps: register(t3, space2);
 Texture2DArray gAOMaps: register(t4, space2);
 Texture2DArray gEmissiveMaps: register(t5, space2);
 Texture2DArray gMetallicMaps: register(t6, space2);
+TextureCube gCubemap: register(t7, space2);
+TextureCube gPrefiltered: register(t8, space2);
+Texture2D gBrdfLut: register(t9, space2);
 
 RaytracingAccelerationStructure SceneBVH: register(t2);
 
@@ -37,6 +46,10 @@ SamplerState gTrilinearWrap: register(s2);
 #include "../utils.hlsli"
 #include "../pbr.hlsli"
 #include "restir_utils.hlsli"
+#include "light_tree.hlsli"
+#include "light_alias.hlsli"
+#include "light_cluster.hlsli"
+#include "environment.hlsli"
 
 [shader("closesthit")]
 void ClosestHit(inout HitInfo payload, Attributes attrib)
@@ -52,14 +65,21 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     //vertex data
     float2 uvs = vertices[indices[vertId]].uvs * bary.x + vertices[indices[vertId + 1]].uvs * bary.y + vertices[indices[vertId + 2]].uvs * bary.z;
     float3 norm = vertices[indices[vertId]].norm * bary.x + vertices[indices[vertId + 1]].norm * bary.y + vertices[indices[vertId + 2]].norm * bary.z;
-    float3 tangent = vertices[indices[vertId]].tangent * bary.x + vertices[indices[vertId + 1]].tangent * bary.y + vertices[indices[vertId + 2]].tangent * bary.z;
-    
-    uint seed = initRand(DispatchRaysIndex().x * gFrameIndex, DispatchRaysIndex().y * gFrameIndex, 16);
-    
-    uint2 posStatic = uint2(DispatchRaysIndex().x % 128, DispatchRaysIndex().y % 128);
-    uint posX = floor(nextRand(seed) * 128);
-    uint posY = floor(nextRand(seed) * 128);
-    uint2 pos = uint2(posX, posY);
+    float4 tangent = vertices[indices[vertId]].tangent * bary.x + vertices[indices[vertId + 1]].tangent * bary.y + vertices[indices[vertId + 2]].tangent * bary.z;
+    
+    uint seed = initRand(DispatchRaysIndex().x + DispatchRaysIndex().y * DispatchRaysDimensions().x, gFrameIndex);
+    
+    //every decision of this bounce draws its own padded Sobol pair in a fixed order, so a branch not taken does not shift
+    //the ones after it and reflection and refraction bounces continue past them. The ReSTIR candidates stay on PCG
+    SobolSampler sobol = initSampler(DispatchRaysIndex().x, DispatchRaysIndex().y, gFrameIndex, payload.recursionDepth - 1);
+    float2 shadowSample = sampleNext2D(sobol);
+    float indirectRoulette = sampleNext1D(sobol);
+    float2 indirectSample = sampleNext2D(sobol);
+    float2 cosWSample = sampleNext2D(sobol);
+    float2 vndfSample = sampleNext2D(sobol);
+    float2 environmentSample = sampleNext2D(sobol);
+    float reflectionRoulette = sampleNext1D(sobol);
+    float refractionRoulette = sampleNext1D(sobol);
     
     float totDistanceMipmaps = RayTCurrent() + max(payload.colorAndDistance.a, 0.0);
     float totDistance = totDistanceMipmaps / objectData.world[0][0];
@@ -70,7 +90,8 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     
     //world normalization
     norm = normalize(mul(norm, (float3x3) objectData.world).xyz);
-    tangent = normalize(mul(tangent, (float3x3) objectData.world).xyz);
+    tangent.xyz = normalize(mul(tangent.xyz, (float3x3) objectData.world));
+    tangent.w = tangent.w < 0.0 ? -1.0 : 1.0;
     
     //height mapping
     if(gHeightMapping && payload.recursionDepth == 1 && objectData.heightIndex >= 0 && payload.colorAndDistance.a >= 0.0 && totDistance < HEIGHT_CLIP)
@@ -89,8 +110,8 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
         }
                 
         float3 N = norm;
-        float3 T = normalize(tangent - dot(tangent, N) * N);
-        float3 B = normalize(cross(N, T));
+        float3 T = normalize(tangent.xyz - dot(tangent.xyz, N) * N);
+        float3 B = normalize(cross(N, T)) * tangent.w;
         float3x3 TBN = float3x3(T, B, N);
         
         float3 viewDir = normalize(mul(TBN, -normRayDir));
@@ -245,8 +266,20 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     {
         for(int i = 0; i < 8; ++i)
         {
-            int chosenLight = min(uint(nextRand(seed) * gLightCount), gLightCount - 1);
-            computeLightSample(reservoir, gLights[chosenLight], worldOrigin, norm, chosenLight, material.fresnelR0, roughness, -normRayDir, seed);
+            //candidates come from the light tree or the alias table, proportional to their estimated contribution
+            float sourcePdf = 1.0 / gLightCount;
+            int chosenLight;
+            if(gLightSampling == LIGHT_SAMPLING_TREE)
+                chosenLight = sampleLightTree(worldOrigin, norm, seed, sourcePdf);
+            else if(gLightSampling == LIGHT_SAMPLING_ALIAS)
+                chosenLight = sampleLightAlias(seed, sourcePdf);
+            else if(gLightSampling == LIGHT_SAMPLING_CLUSTERED)
+                chosenLight = sampleLightCluster(worldOrigin, norm, seed, sourcePdf);
+            else
+                chosenLight = min(uint(nextRand(seed) * gLightCount), gLightCount - 1);
+            if(sourcePdf <= 0.0)
+                continue;
+            computeLightSample(reservoir, gLights[chosenLight], worldOrigin, norm, chosenLight, material.fresnelR0, roughness, -normRayDir, seed, sourcePdf);
         }
     }
     
@@ -256,8 +289,6 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     float sampleWeight = reservoir.W;
 
     //color calculation
-    const float4 gAmbientLight = float4(0.2, 0.2, 0.2, 1.0);
-    
     //diffuse albedo
     float4 diffuseAlbedo = material.diffuseAlbedo * float4(mapColor.rgb, 1.0);
     
@@ -269,7 +300,7 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     {
         float w = 0.0;
         float occlusion = 1.0;
-        float shadowDistance = calcShadow(gLights[shadowReservoir.sampleIndex], worldOrigin, norm, occlusion, pos, w);
+        float shadowDistance = calcShadow(gLights[shadowReservoir.sampleIndex], worldOrigin, norm, occlusion, shadowSample, w);
             
         if(payload.recursionDepth == 1)
         {
@@ -306,12 +337,12 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     //indirect + rtao
     float3 indirectLight = float3(0, 0, 0);
     bool occluded = false;
-    if((gIndirect || gRTAO) && objectData.emissiveIndex < 0 && payload.recursionDepth == 1 && totDistance < INDIRECT_CLIP && nextRand(seed) < chance)
+    if((gIndirect || gRTAO) && objectData.emissiveIndex < 0 && payload.recursionDepth == 1 && totDistance < INDIRECT_CLIP && indirectRoulette < chance)
     {
         IndirectInfo indirectPayload;
         indirectPayload.colorAndDistance = float4(0, 0, 0, RayTCurrent());
         
-        float3 rv = cosWeight(gBlueNoise, pos, norm, 1.0);
+        float3 rv = cosWeight(indirectSample, norm, 1.0);
         
         RayDesc indirectRay;
         indirectRay.Origin = worldOrigin;
@@ -344,7 +375,7 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     }
     
     //ambient
-    float4 ambient = gAmbientLight * diffuseAlbedo;
+    float4 ambient = float4(evaluateAmbient(norm), 1.0) * diffuseAlbedo;
     hitColor.rgb = ambient.rgb * !occluded;
     
     //diffuse
@@ -357,8 +388,8 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     
     if(payload.recursionDepth == 1)
     {
-        cosWNormal = cosWeight(gBlueNoise, pos, norm, saturate((roughness + gLights[reservoir.sampleIndex].radius) * 0.5));
-        vndfNormal = VNDF(-normRayDir, norm, roughness, gBlueNoise, pos);
+        cosWNormal = cosWeight(cosWSample, norm, saturate((roughness + gLights[reservoir.sampleIndex].radius) * 0.5));
+        vndfNormal = VNDF(-normRayDir, norm, roughness, vndfSample);
     }
         
     MaterialPBR matPBR = { roughness, material.fresnelR0, material.specular, true };
@@ -376,6 +407,32 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     if(gLightCount > 0)
         specular /= gLightCount;
     
+    //environment, one direction drawn from the cubemap's luminance
+    if(gEnvironmentSize > 0 && payload.recursionDepth == 1)
+    {
+        float envPdf;
+        float3 envDir = sampleEnvironment(environmentSample.x, environmentSample.y, envPdf);
+        float ndotl = dot(envDir, norm);
+        if(envPdf > 0.0 && ndotl > 0.0)
+        {
+            RayDesc envRay;
+            envRay.Origin = worldOrigin;
+            envRay.Direction = envDir;
+            envRay.TMin = 0.01;
+            envRay.TMax = DIRECTIONAL_LIGHT_DISTANCE;
+            
+            ShadowInfo shadowPayload;
+            shadowPayload.occlusion = 1.0;
+            shadowPayload.distance = 0.01;
+            TraceRay(SceneBVH, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, 0xFE, 1, 0, 1, envRay, shadowPayload);
+            if(shadowPayload.distance < 0.0)
+            {
+                float3 envRadiance = gCubemap.SampleLevel(gBilinearWrap, envDir, 0.0).rgb;
+                hitColor.rgb += envRadiance * diffuseAlbedo.rgb * ndotl / (PI * envPdf);
+            }
+        }
+    }
+    
     if(gIndirect)
         hitColor.rgb += indirectLight * diffuseAlbedo.rgb;
     hitColor.rgb += emissive;
@@ -386,7 +443,7 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
     //reflections
     float metallic = 0.0;
     float specDist = 0.0;
-    if(gReflectionsRT && payload.recursionDepth < maxBounces && matMetallic > 0.0 && totDistance < REFLECTIONS_CLIP * matMetallic && nextRand(seed) < chance)
+    if(gReflectionsRT && payload.recursionDepth < maxBounces && matMetallic > 0.0 && totDistance < REFLECTIONS_CLIP * matMetallic && reflectionRoulette < chance)
     {
         HitInfo reflPayload;
         reflPayload.colorAndDistance = float4(0, 0, 0, RayTCurrent());
@@ -410,10 +467,23 @@ void ClosestHit(inout HitInfo payload, Attributes attrib)
             metallic = luma(ggx) * matMetallic;
         }
     }
+    else if(gReflectionsRT && gPrefilteredMips > 0 && payload.recursionDepth < maxBounces && matMetallic > 0.0)
+    {
+        //past the clip or skipped by chance, the split sum of the cubemap instead of a ray
+        uint lutWidth, lutHeight;
+        gBrdfLut.GetDimensions(lutWidth, lutHeight);
+        float2 lutUV = clamp(float2(saturate(dot(norm, -normRayDir)), roughness), 0.5 / lutWidth, 1.0 - 0.5 / lutWidth);
+        float2 brdf = gBrdfLut.SampleLevel(gBilinearWrap, lutUV, 0.0).rg;
+        
+        float3 ggx = material.fresnelR0 * brdf.x + brdf.y;
+        float3 prefiltered = gPrefiltered.SampleLevel(gTrilinearWrap, reflect(normRayDir, norm), roughness * (gPrefilteredMips - 1)).rgb;
+        specular += prefiltered * ggx * matMetallic;
+        metallic = luma(ggx) * matMetallic;
+    }
     
     //refractions
     float visibility = 1.0 - material.diffuseAlbedo.a;
-    if(payload.recursionDepth < maxBounces && material.diffuseAlbedo.a < 1.0 && nextRand(seed) < chance)
+    if(payload.recursionDepth < maxBounces && material.diffuseAlbedo.a < 1.0 && refractionRoulette < chance)
     {
         float f = Fggx(material.fresnelR0, -normRayDir, vndfNormal);
         
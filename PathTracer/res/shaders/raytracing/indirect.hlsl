@@ -5,6 +5,8 @@
 #define NRD_ROUGHNESS_ENCODING 1
 #include "include/NRD.hlsli"
 
+#define INDIRECT_CANDIDATES 16
+
 StructuredBuffer<Vertex> vertices: register(t0);
 StructuredBuffer<int> indices: register(t1);
 StructuredBuffer<Material> gMaterials: register(t0, space1);
@@ -20,7 +22,6 @@ SamplerState gPointWrap: register(s0);
 SamplerState gBilinearWrap: register(s1);
 SamplerState gTrilinearWrap: register(s2);
 
-#define NO_BLUE_NOISE
 #include "../utils.hlsli"
 #include "restir_utils.hlsli"
 
@@ -38,9 +39,9 @@ void IndirectHit(inout IndirectInfo payload, Attributes attrib)
     //vertex data
     float2 uvs = vertices[indices[vertId]].uvs * bary.x + vertices[indices[vertId + 1]].uvs * bary.y + vertices[indices[vertId + 2]].uvs * bary.z;
     float3 norm = vertices[indices[vertId]].norm * bary.x + vertices[indices[vertId + 1]].norm * bary.y + vertices[indices[vertId + 2]].norm * bary.z;
-    float3 tangent = vertices[indices[vertId]].tangent * bary.x + vertices[indices[vertId + 1]].tangent * bary.y + vertices[indices[vertId + 2]].tangent * bary.z;
+    float4 tangent = vertices[indices[vertId]].tangent * bary.x + vertices[indices[vertId + 1]].tangent * bary.y + vertices[indices[vertId + 2]].tangent * bary.z;
     
-    uint seed = initRand(DispatchRaysIndex().x * gFrameIndex, DispatchRaysIndex().y * gFrameIndex, 16);
+    uint seed = initRand(DispatchRaysIndex().x + DispatchRaysIndex().y * DispatchRaysDimensions().x, gFrameIndex);
         
     //uvs transformation
     float4 transUvs = mul(float4(uvs, 0.0, 1.0), objectData.texTransform);
@@ -48,7 +49,8 @@ void IndirectHit(inout IndirectInfo payload, Attributes attrib)
     
     //world normalization
     norm = normalize(mul(norm, (float3x3) objectData.world).xyz);
-    tangent = normalize(mul(tangent, (float3x3) objectData.world).xyz);
+    tangent.xyz = normalize(mul(tangent.xyz, (float3x3) objectData.world));
+    tangent.w = tangent.w < 0.0 ? -1.0 : 1.0;
     
     //texturing
     float4 mapColor = float4(1, 1, 1, 1);
@@ -71,12 +73,20 @@ void IndirectHit(inout IndirectInfo payload, Attributes attrib)
     reservoirs[1] = (Reservoir) 0.0;
     if(gLightCount > 0)
     {
+        //every light is a candidate in small scenes, larger ones draw a fixed number uniformly
+        int candidates = min(gLightCount, INDIRECT_CANDIDATES);
         int i;
-        for(i = 0; i < gLightCount; ++i)
-            computeLightSample(reservoirs[0], gLights[i], worldOrigin, norm, i, material.fresnelR0, material.roughness, -normRayDir, seed);
-        for(i = 0; i < gLightCount; ++i)
-            if(i != reservoirs[0].sampleIndex)
-                computeLightSample(reservoirs[1], gLights[i], worldOrigin, norm, i, material.fresnelR0, material.roughness, -normRayDir,seed);
+        for(i = 0; i < candidates; ++i)
+        {
+            int light = gLightCount > INDIRECT_CANDIDATES ? min(uint(nextRand(seed) * gLightCount), gLightCount - 1) : i;
+            computeLightSample(reservoirs[0], gLights[light], worldOrigin, norm, light, material.fresnelR0, material.roughness, -normRayDir, seed);
+        }
+        for(i = 0; i < candidates; ++i)
+        {
+            int light = gLightCount > INDIRECT_CANDIDATES ? min(uint(nextRand(seed) * gLightCount), gLightCount - 1) : i;
+            if(light != reservoirs[0].sampleIndex)
+                computeLightSample(reservoirs[1], gLights[light], worldOrigin, norm, light, material.fresnelR0, material.roughness, -normRayDir, seed);
+        }
     }
     if(gLightCount == 1)
         reservoirs[0].W = 1.0;
@@ -85,7 +95,9 @@ void IndirectHit(inout IndirectInfo payload, Attributes attrib)
     float4 diffuseAlbedo = material.diffuseAlbedo * mapColor; 
     for(int i = 0; i < min(gLightCount, 2); ++i)
         payload.colorAndDistance.rgb += calcIndirectLight(reservoirs[i], diffuseAlbedo, norm, worldOrigin, material.roughness, material.metallic, material.refractionIndex) * 1.5;
-    payload.colorAndDistance.rgb += emissive * 0.6;
+    //the triangle lights already carry what emitters give off
+    if(gEmissiveLights == 0)
+        payload.colorAndDistance.rgb += emissive * 0.6;
     payload.colorAndDistance.rgb /= gLightCount;
     payload.colorAndDistance.a = RayTCurrent();
 }
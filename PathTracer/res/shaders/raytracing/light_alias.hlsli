@@ -0,0 +1,11 @@
+//Vose alias table built by LightAliasTable, one entry per light
+uint sampleLightAlias(inout uint seed, out float pdf)
+{
+    uint index = min(uint(nextRand(seed) * gLightCount), gLightCount - 1);
+    LightAliasEntry entry = gLightAlias[index];
+    if(nextRand(seed) >= entry.probability)
+        index = entry.alias;
+
+    pdf = gLightAlias[index].pdf;
+    return index;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+//must match LightClusterGrid.h
+#define CLUSTER_GRID_X      16
+#define CLUSTER_GRID_Y      9
+#define CLUSTER_GRID_Z      24
+#define CLUSTER_OVERFLOW    0xFFFFFFFF
+
+//froxel holding a world space point, false outside the grid
+bool lightCluster(float3 pos, out uint cluster)
+{
+    cluster = 0;
+    float3 viewPos = mul(float4(pos, 1.0), gView).xyz;
+    if(viewPos.z < gClusterDepth.x || viewPos.z >= gClusterDepth.y)
+        return false;
+
+    float2 ndc = viewPos.xy / viewPos.z * gClusterScale;
+    if(any(abs(ndc) > 1.0))
+        return false;
+
+    uint3 c = uint3(max((ndc * 0.5 + 0.5) * float2(CLUSTER_GRID_X, CLUSTER_GRID_Y), 0.0), max(log(viewPos.z / gClusterDepth.x) * gClusterDepth.z, 0.0));
+    c = min(c, uint3(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1));
+    cluster = c.x + CLUSTER_GRID_X * (c.y + CLUSTER_GRID_Y * c.z);
+    return true;
+}
+
+//uniform over the local lights reaching the froxel and the directional lights, pdf is 0 when nothing reaches the point
+//points outside the grid and froxels that overflowed use the light tree
+uint sampleLightCluster(float3 pos, float3 normal, inout uint seed, out float pdf)
+{
+    uint index;
+    if(!lightCluster(pos, index) || gLightClusters[index].count == CLUSTER_OVERFLOW)
+        return sampleLightTree(pos, normal, seed, pdf);
+
+    LightCluster cluster = gLightClusters[index];
+    uint count = cluster.count + gDirectionalLights;
+    pdf = 0.0;
+    if(count == 0)
+        return 0;
+
+    uint i = min(uint(nextRand(seed) * count), count - 1);
+    pdf = 1.0 / count;
+    if(i < cluster.count)
+        return gClusterLights[cluster.offset + i];
+    return gLightTree[gLightTreeNodes + i - cluster.count].offset;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+//must match LightTree.h
+#define LIGHT_TREE_MAX_DEPTH            64
+#define LIGHT_TREE_DIRECTIONAL_SHARE    0.5
+
+float lightTreeImportance(float3 pos, float3 normal, LightTreeNode node)
+{
+    if(node.power <= 0.0)
+        return 0.0;
+
+    float3 toLight = 0.5 * (node.boundsMin + node.boundsMax) - pos;
+    float radius = 0.5 * length(node.boundsMax - node.boundsMin);
+    float dist = length(toLight);
+    if(dist - radius > node.range)
+        return 0.0;
+
+    //angles are widened by the bounding sphere as seen from the point
+    float3 dir = toLight / max(dist, 1e-6);
+    float thetaU = dist > radius ? acos(saturate(sqrt(1.0 - (radius / dist) * (radius / dist)))) : PI;
+
+    float theta = acos(clamp(-dot(node.axis, dir), -1.0, 1.0));
+    float thetaP = max(theta - acos(clamp(node.cosThetaO, -1.0, 1.0)) - thetaU, 0.0);
+    if(thetaP >= acos(clamp(node.cosThetaE, -1.0, 1.0)))
+        return 0.0;
+
+    float thetaI = acos(clamp(dot(normal, dir), -1.0, 1.0));
+    float thetaIP = max(thetaI - thetaU, 0.0);
+    if(thetaIP >= 0.5 * PI)
+        return 0.0;
+
+    float dist2 = max(dist * dist, max(radius * radius, 1e-4));
+    return node.power * cos(thetaP) * cos(thetaIP) / dist2;
+}
+
+//stochastic traversal, pdf is the discrete probability of the returned light
+uint sampleLightTree(float3 pos, float3 normal, inout uint seed, out float pdf)
+{
+    pdf = 1.0;
+    if(gDirectionalLights > 0)
+    {
+        float share = gLightTreeNodes > 0 ? LIGHT_TREE_DIRECTIONAL_SHARE : 1.0;
+        if(nextRand(seed) < share)
+        {
+            uint index = min(uint(nextRand(seed) * gDirectionalLights), gDirectionalLights - 1);
+            pdf = share / gDirectionalLights;
+            return gLightTree[gLightTreeNodes + index].offset;
+        }
+        pdf = 1.0 - share;
+    }
+
+    uint node = 0;
+    [loop]
+    for(uint depth = 0; depth < LIGHT_TREE_MAX_DEPTH && gLightTree[node].count == 0; ++depth)
+    {
+        LightTreeNode left = gLightTree[node + 1];
+        LightTreeNode right = gLightTree[gLightTree[node].offset];
+
+        //nothing reaches the point, the choice is by power so every light keeps a chance
+        float importanceLeft = lightTreeImportance(pos, normal, left);
+        float importanceRight = lightTreeImportance(pos, normal, right);
+        float p = 0.5;
+        if(importanceLeft + importanceRight > 0.0)
+            p = importanceLeft / (importanceLeft + importanceRight);
+        else if(left.power + right.power > 0.0)
+            p = left.power / (left.power + right.power);
+
+        if(nextRand(seed) < p)
+        {
+            pdf *= p;
+            node = node + 1;
+        }
+        else
+        {
+            pdf *= 1.0 - p;
+            node = gLightTree[node].offset;
+        }
+    }
+
+    return gLightTree[node].offset;
+}
\ No newline at end of file
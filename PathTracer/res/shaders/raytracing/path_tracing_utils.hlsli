@@ -2,29 +2,7 @@
 
 #define PI 3.14159265
 
-/*
-    Random number generator from ZijingPeng on GitHub
-    https://github.com/ZijingPeng/DXR-Hybrid-Rendering/blob/main/CommonPasses/Data/CommonPasses/thinLensUtils.hlsli
-*/
-uint initRand(uint val0, uint val1, uint backoff = 16)
-{
-    uint v0 = val0, v1 = val1, s0 = 0;
-
-    [unroll]
-    for(uint n = 0; n < backoff; n++)
-    {
-        s0 += 0x9e3779b9;
-        v0 += ((v1 << 4) + 0xa341316c) ^ (v1 + s0) ^ ((v1 >> 5) + 0xc8013ea4);
-        v1 += ((v0 << 4) + 0xad90777d) ^ (v0 + s0) ^ ((v0 >> 5) + 0x7e95761e);
-    }
-    return v0;
-}
-
-float nextRand(inout uint s)
-{
-    s = (1664525u * s + 1013904223u);
-    return float(s & 0x00FFFFFF) / float(0x01000000);
-}
+#include "../sampling.hlsli"
 
 //constants
 const static float3 wRight = float3(1.0F, 0.0F, 0.0F);
@@ -39,10 +17,8 @@ float3 bendNormal(float3 normal, float lightRadius, Texture2D blueNoise, uint2 p
     return normalize(normal + (lRight * offset.x * lightRadius) + (lFront * offset.y * lightRadius));
 }
 
-float3 cosWeight(Texture2D blueNoise, uint2 pos, float3 normal, float power)
+float3 cosWeight(float2 u, float3 normal, float power)
 {
-    float2 u = blueNoise[pos].xy;
-    
     float cosTheta = pow(u.x, 1.0 / (power + 1.0));
     float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
     float phi = 2.0 * PI * u.y;
@@ -58,6 +34,11 @@ float3 cosWeight(Texture2D blueNoise, uint2 pos, float3 normal, float power)
     return normalize(x * tangent + y * bitangent + z * normal);
 }
 
+float3 cosWeight(Texture2D blueNoise, uint2 pos, float3 normal, float power)
+{
+    return cosWeight(blueNoise[pos].xy, normal, power);
+}
+
 float3 calcRTAODirection(uint seed)
 {
     return normalize(float3(nextRand(seed), nextRand(seed), nextRand(seed)) * 2.0F - 1.0F);
@@ -118,7 +99,7 @@ float3 VNDF(float3 rayDir, float3 normal, float roughness, float2 u)
     return normalize(T * m.x + B * m.y + normal * m.z);
 }
 
-float3 calcShadowDirectionDL(float3 worldOrigin, float3 lightDir, float lightRadius, Texture2D blueNoise, uint2 pos, out float w)
+float3 calcShadowDirectionDL(float3 worldOrigin, float3 lightDir, float lightRadius, float2 u, out float w)
 {
     float3 lFront = cross(lightDir, wRight);
     lFront = normalize(lFront - dot(lFront, lightDir) * lightDir);
@@ -126,7 +107,7 @@ float3 calcShadowDirectionDL(float3 worldOrigin, float3 lightDir, float lightRad
     
     float3 lightPos = -lightDir * DIRECTIONAL_LIGHT_DISTANCE;
     
-    float2 offset = float2(blueNoise[pos].xy) * 2.0F - 1.0F;
+    float2 offset = u * 2.0F - 1.0F;
     float3 offsetPos = lightPos + (lRight * offset.x * lightRadius) + (lFront * offset.y * lightRadius);
     
     w = length(offsetPos);
@@ -134,13 +115,13 @@ float3 calcShadowDirectionDL(float3 worldOrigin, float3 lightDir, float lightRad
     return offsetPos - worldOrigin;
 }
 
-float3 calcShadowDirection(float3 worldOrigin, float3 lightDir, float3 lightPos, float lightRadius, Texture2D blueNoise, uint2 pos, out float w)
+float3 calcShadowDirection(float3 worldOrigin, float3 lightDir, float3 lightPos, float lightRadius, float2 u, out float w)
 {
     float3 lFront = cross(lightDir, wRight);
     lFront = normalize(lFront - dot(lFront, lightDir) * lightDir);
     float3 lRight = cross(lightDir, lFront);
 
-    float2 offset = float2(blueNoise[pos].xy) * 2.0F - 1.0F;
+    float2 offset = u * 2.0F - 1.0F;
     float3 offsetPos = lightPos + (lRight * offset.x * lightRadius) + (lFront * offset.y * lightRadius);
     
     w = length(offsetPos);
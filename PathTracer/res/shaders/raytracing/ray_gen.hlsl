@@ -74,7 +74,7 @@ void RayGen()
     
     if(gRayReconstruction)
     {
-        uint seed = initRand(launchIndex.x * gFrameIndex, launchIndex.y * gFrameIndex, 16);
+        uint seed = initRand(launchIndex.x + launchIndex.y * DispatchRaysDimensions().x, gFrameIndex);
         int2 offset = int2(nextRand(seed) * 3.0, nextRand(seed) * 3.0) - int2(1, 1);
         prevPixel += offset;
     }
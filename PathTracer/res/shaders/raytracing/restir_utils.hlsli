@@ -49,7 +49,7 @@ float3 RESTIR_GGX(float3 R0, float roughness, float3 lightVec, float3 normal, fl
     return ((D * G * F) / (4 * VdotN));
 }
 
-float restirWeight(Light light, float3 hitPos, float3 normal, float3 R0, float roughness, float3 toEye)
+float restirTarget(Light light, float3 hitPos, float3 normal, float3 R0, float roughness, float3 toEye)
 {
     float3 lightDir;
     float distance;
@@ -66,22 +66,39 @@ float restirWeight(Light light, float3 hitPos, float3 normal, float3 R0, float r
         distance = length(lightDir);
         lightDir /= distance;
 
-        radiance *= CalcAttenuation(distance, light.FalloffStart, light.FalloffEnd);
-        if(light.type == LIGHT_TYPE_SPOTLIGHT)
-            radiance *= pow(max(dot(-lightDir, light.Direction), 0.0), light.SpotPower);
+        if(light.type == LIGHT_TYPE_TRIANGLE)
+        {
+            //lambertian emitter, the inverse square is clamped at the triangle's size
+            radiance *= max(dot(-lightDir, light.Direction), 0.0) * (distance < light.FalloffEnd ? 1.0 : 0.0);
+            distance = max(distance, light.FalloffStart);
+        }
+        else
+        {
+            radiance *= CalcAttenuation(distance, light.FalloffStart, light.FalloffEnd);
+            if(light.type == LIGHT_TYPE_SPOTLIGHT)
+                radiance *= pow(max(dot(-lightDir, light.Direction), 0.0), light.SpotPower);
+        }
     }
 
     radiance /= distance * distance + NRD_EPS;
     float ndotl = saturate(dot(normal, lightDir));
     float3 brdf = max(RESTIR_GGX(R0, roughness, lightDir, normal, toEye), 1e-7);
-    float pdf = 1.0 / gLightCount;
 
-    return length(radiance * brdf * ndotl) / pdf;
+    return length(radiance * brdf * ndotl);
 }
 
-void computeLightSample(inout Reservoir reservoir, Light light, float3 hitPos, float3 normal, int index, float3 R0, float roughness, float3 toEye, uint seed)
+//weight of a uniformly picked light
+float restirWeight(Light light, float3 hitPos, float3 normal, float3 R0, float roughness, float3 toEye)
 {
-    float weight = restirWeight(light, hitPos, normal, R0, roughness, toEye);
+    return restirTarget(light, hitPos, normal, R0, roughness, toEye) * gLightCount;
+}
+
+//sourcePdf is the probability the light was picked with, the seed advances so the next candidate gets a fresh number
+void computeLightSample(inout Reservoir reservoir, Light light, float3 hitPos, float3 normal, int index, float3 R0, float roughness, float3 toEye, inout uint seed, float sourcePdf)
+{
+    float target = restirTarget(light, hitPos, normal, R0, roughness, toEye);
+    float weight = target / max(sourcePdf, 1e-20);
+    float previousSum = reservoir.weightSum;
     
     reservoir.M += 1.0;
     reservoir.weightSum += weight;
@@ -89,8 +106,16 @@ void computeLightSample(inout Reservoir reservoir, Light light, float3 hitPos, f
     if(nextRand(seed) < weight / reservoir.weightSum)
     {
         reservoir.sampleIndex = index;
-        reservoir.W = (1.0 / (weight * (1.0 / gLightCount))) * (reservoir.weightSum / reservoir.M);
+        reservoir.W = (1.0 / target) * (reservoir.weightSum / reservoir.M);
     }
+    //W = weightSum / (M * target) has to follow the candidates that were not picked too
+    else if(previousSum > 0.0)
+        reservoir.W *= (reservoir.weightSum / previousSum) * ((reservoir.M - 1.0) / reservoir.M);
+}
+
+void computeLightSample(inout Reservoir reservoir, Light light, float3 hitPos, float3 normal, int index, float3 R0, float roughness, float3 toEye, inout uint seed)
+{
+    computeLightSample(reservoir, light, hitPos, normal, index, R0, roughness, toEye, seed, 1.0 / gLightCount);
 }
 
 Reservoir mergeReservoir(Reservoir a, Reservoir b, float3 hitPos, float3 normal, float3 R0, float roughness, float3 toEye, uint seed)
@@ -141,7 +166,8 @@ Reservoir mergeReservoirSpatial(Reservoir r[9], float3 hitPos, float3 normal, fl
         if(ri.M == 0 || ri.weightSum == 0.0)
             continue;
         
-        float w = restirWeight(gLights[ri.sampleIndex], hitPos, normal, R0, roughness, toEye);
+        //resampled like mergeReservoir, by the contribution weight and the candidates behind it
+        float w = restirWeight(gLights[ri.sampleIndex], hitPos, normal, R0, roughness, toEye) * pdf * ri.W * ri.M;
         totW += w;
         
         if(nextRand(seed) < w / max(totW, 1e-6))
@@ -0,0 +1,148 @@
+#ifndef SAMPLING_HLSLI
+#define SAMPLING_HLSLI
+
+/*
+    Samplers shared by the shaders and the CPU tracer, this file is compiled as both HLSL and C++ (through src/rendering/Sampling.h)
+    so keep it to uint, float and float2
+    - PCG hash and stream after Jarzynski and Olano, "Hash Functions for GPU Rendering"
+    - Owen scrambled Sobol with hashed index shuffling per pixel, after Burley, "Practical Hash-based Owen Scrambling"
+*/
+#ifdef __cplusplus
+    #define SHARED_FUNC inline
+    #define SHARED_INOUT(type) type&
+
+    inline uint reversebits(uint x)
+    {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+        x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+        x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+        x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+        return x;
+    }
+#else
+    #define SHARED_FUNC
+    #define SHARED_INOUT(type) inout type
+#endif
+
+#define SOBOL_DIMENSIONS 2
+#define SAMPLER_BOUNCE_DIMENSIONS 8 //draws one hit makes, the next bounce pads its draws past them
+
+//direction numbers of the first 2 Sobol dimensions (Joe and Kuo), 32 per dimension. Only this pair is a (0, 2) net,
+//further dimensions come from drawing it again with another scramble
+static const uint SOBOL_DIRECTIONS[SOBOL_DIMENSIONS * 32] =
+{
+    0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u,
+    0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u,
+    0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u,
+    0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u,
+
+    0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u,
+    0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u,
+    0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u,
+    0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu
+};
+
+SHARED_FUNC uint pcgHash(uint v)
+{
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+SHARED_FUNC float uintToFloat(uint x)
+{
+    return float(x >> 8) * 5.96046448e-8F;
+}
+
+//one hash per input in place of the 16 TEA rounds the seeds used to take
+SHARED_FUNC uint initRand(uint val0, uint val1)
+{
+    return pcgHash(val0 ^ pcgHash(val1));
+}
+
+//PCG stream, the fallback for everything that is not worth a Sobol dimension
+SHARED_FUNC float nextRand(SHARED_INOUT(uint) s)
+{
+    s = s * 747796405u + 2891336453u;
+    uint word = ((s >> ((s >> 28u) + 4u)) ^ s) * 277803737u;
+    return uintToFloat((word >> 22u) ^ word);
+}
+
+SHARED_FUNC uint hashCombine(uint seed, uint v)
+{
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+//an Owen scramble in reversed bit order, every bit is flipped by a hash of the bits above it
+SHARED_FUNC uint laineKarrasPermutation(uint x, uint seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+SHARED_FUNC uint nestedUniformScramble(uint x, uint seed)
+{
+    return reversebits(laineKarrasPermutation(reversebits(x), seed));
+}
+
+SHARED_FUNC uint sobol(uint index, uint dimension)
+{
+    uint result = 0;
+    for(uint bit = 0; index != 0; ++bit, index >>= 1)
+    {
+        if(index & 1u)
+            result ^= SOBOL_DIRECTIONS[dimension * 32 + bit];
+    }
+    return result;
+}
+
+//one Owen scrambled draw of the (0, 2) sequence, the index shuffle decorrelates draws made with different seeds
+SHARED_FUNC float owenSobol(uint index, uint dimension, uint seed)
+{
+    uint shuffled = nestedUniformScramble(index, seed);
+    return uintToFloat(nestedUniformScramble(sobol(shuffled, dimension), hashCombine(seed, pcgHash(dimension + 1))));
+}
+
+struct SobolSampler
+{
+    uint index;
+    uint seed;
+    uint dimension;
+};
+
+//one sequence per pixel, the sample index goes up by one every frame
+SHARED_FUNC SobolSampler initSampler(uint x, uint y, uint sampleIndex)
+{
+    SobolSampler s;
+    s.index = sampleIndex;
+    s.seed = pcgHash(x ^ pcgHash(y));
+    s.dimension = 0;
+    return s;
+}
+
+SHARED_FUNC SobolSampler initSampler(uint x, uint y, uint sampleIndex, uint bounce)
+{
+    SobolSampler s = initSampler(x, y, sampleIndex);
+    s.dimension = bounce * SAMPLER_BOUNCE_DIMENSIONS;
+    return s;
+}
+
+//every draw is padded with its own seed, so pairs drawn together stay stratified and later draws are not correlated with earlier ones
+SHARED_FUNC float sampleNext1D(SHARED_INOUT(SobolSampler) s)
+{
+    uint seed = hashCombine(s.seed, pcgHash(s.dimension++));
+    return owenSobol(s.index, 0, seed);
+}
+
+SHARED_FUNC float2 sampleNext2D(SHARED_INOUT(SobolSampler) s)
+{
+    uint seed = hashCombine(s.seed, pcgHash(s.dimension++));
+    return float2(owenSobol(s.index, 0, seed), owenSobol(s.index, 1, seed));
+}
+
+#endif
\ No newline at end of file
@@ -3,13 +3,20 @@ float CalcAttenuation(float d, float falloffStart, float falloffEnd)
     return saturate((falloffEnd - d) / (falloffEnd - falloffStart));
 }
 
-float3 normalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW, bool blueBias = false)
+//clamped where the emitter is no longer a point
+float CalcInverseSquare(float d, float clampDistance)
+{
+    return 1.0 / max(d * d, clampDistance * clampDistance);
+}
+
+//w of the tangent is the handedness of the uv mapping, mirrored uvs flip the bitangent
+float3 normalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float4 tangentW, bool blueBias = false)
 {
     float3 normalT = blueBias ? normalMapSample : (2.0 * normalMapSample - 1.0);
     
     float3 N = unitNormalW;
-    float3 T = normalize(tangentW - dot(tangentW, N) * N);
-    float3 B = cross(N, T);
+    float3 T = normalize(tangentW.xyz - dot(tangentW.xyz, N) * N);
+    float3 B = cross(N, T) * tangentW.w;
     
     float3x3 TBN = float3x3(T, B, N);
     return mul(normalT, TBN);
@@ -170,12 +177,26 @@ float3 calcIndirectLight(Reservoir reservoir, float4 diffuseAlbedo, float3 norm,
         float3 cNorm = radiance * max(dot(norm, lightDir), 0.0) * (1.0 - roughness);
         color = cRefr * weights.x + cRefl * weights.y + cNorm * weights.z;
     }
+    else if(light.type == LIGHT_TYPE_TRIANGLE && length(light.Position - worldOrigin) < light.FalloffEnd)
+    {
+        float3 lightDir = light.Position - worldOrigin;
+        float dist = length(lightDir);
+        lightDir /= dist;
+        float cosEmitter = max(dot(-lightDir, light.Direction), 0.0);
+        float lightPower = CalcInverseSquare(dist, light.FalloffStart);
+        
+        float3 radiance = light.Strength * diffuseAlbedo.rgb * lightPower * cosEmitter * reservoir.W;
+        float3 cRefr = radiance * pow(max(dot(refrNorm, lightDir), 0.0), 5.5) * (1.0 - diffuseAlbedo.a);
+        float3 cRefl = radiance * max(dot(norm, normalize(lightDir - WorldRayDirection())), 0.0) * max(metallic * 3.0 - roughness * 1.1, 0.0);
+        float3 cNorm = radiance * max(dot(norm, lightDir), 0.0) * (1.0 - roughness);
+        color = cRefr * weights.x + cRefl * weights.y + cNorm * weights.z;
+    }
     
     return color;
 }
 
-#ifndef NO_BLUE_NOISE
-float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlusion, uint2 pos, out float w)
+//u places the shadow ray on the light disk
+float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlusion, float2 u, out float w)
 {
     const float minDistance = 0.0001;
     
@@ -187,7 +208,7 @@ float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlu
     {
         float maxDist = DIRECTIONAL_LIGHT_DISTANCE;
         
-        float3 lightSphereDirection = calcShadowDirectionDL(worldOrigin, light.Direction, light.radius / 200.0, gBlueNoise, pos, w);
+        float3 lightSphereDirection = calcShadowDirectionDL(worldOrigin, light.Direction, light.radius / 200.0, u, w);
         distanceToLight = length(lightSphereDirection);
                 
         RayDesc ray;
@@ -209,11 +230,11 @@ float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlu
             }
         }
     }
-    else if(light.type == LIGHT_TYPE_POINTLIGHT)
+    else if(light.type == LIGHT_TYPE_POINTLIGHT || light.type == LIGHT_TYPE_TRIANGLE)
     {
         float maxDist = light.FalloffEnd + light.FalloffStart;
         
-        float3 lightSphereDirection = calcShadowDirection(worldOrigin, normalize(light.Position - worldOrigin), light.Position, light.radius, gBlueNoise, pos, w);
+        float3 lightSphereDirection = calcShadowDirection(worldOrigin, normalize(light.Position - worldOrigin), light.Position, light.radius, u, w);
         distanceToLight = length(lightSphereDirection);
         
         RayDesc ray;
@@ -239,7 +260,7 @@ float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlu
     {
         float maxDist = light.FalloffEnd + light.FalloffStart;
         
-        float3 lightSphereDirection = calcShadowDirection(worldOrigin, light.Direction, light.Position, light.radius, gBlueNoise, pos, w);
+        float3 lightSphereDirection = calcShadowDirection(worldOrigin, light.Direction, light.Position, light.radius, u, w);
         distanceToLight = length(lightSphereDirection);
         
         RayDesc ray;
@@ -264,7 +285,6 @@ float calcShadow(Light light, float3 worldOrigin, float3 normal, out float occlu
     
     return shadowDistance;
 }
-#endif
 #else
 float4 sampleTexture(float2 uvs, Texture2DArray tex, int index)
 {
@@ -57,6 +57,36 @@ namespace RT
 		reloadWorld(id);
 	}
 
+	void Entity::setWorld(UINT id, const XMFLOAT4X4& world)
+	{
+		XMVECTOR scale, rotQuat, trans;
+		XMMATRIX W = XMLoadFloat4x4(&world);
+		XMMatrixDecompose(&scale, &rotQuat, &trans, W);
+
+		//euler angles matching the Rx * Ry * Rz order of reloadWorld
+		XMFLOAT4X4 R;
+		XMStoreFloat4x4(&R, XMMatrixRotationQuaternion(rotQuat));
+		InstanceInfo& info = instancesInfo[id];
+		info.rot.y = asinf(std::max<float>(-1.0F, std::min<float>(1.0F, -R._13)));
+		if(fabsf(R._13) < 0.9999F)
+		{
+			info.rot.x = atan2f(R._23, R._33);
+			info.rot.z = atan2f(R._12, R._11);
+		}
+		else
+		{
+			info.rot.x = atan2f(-R._32, R._22);
+			info.rot.z = 0.0F;
+		}
+		XMStoreFloat3(&info.pos, trans);
+		XMStoreFloat3(&info.scale, scale);
+
+		//keep the exact matrix, the hierarchy may carry shear that scale/rotation/translation cannot express
+		instances[id].world = world;
+		saveWorld = true;
+		reloadLookingDirection(id);
+	}
+
 	void Entity::setLookingDirection(UINT id, XMFLOAT3 dir)
 	{
 		XMVECTOR dirV = XMLoadFloat3(&dir);
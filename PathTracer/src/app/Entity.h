@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../utils/header.h"
+#include "../utils/core.h"
 
 namespace RT
 {
@@ -46,6 +46,7 @@ namespace RT
 		void setPos(UINT id, DirectX::XMFLOAT3 pos);
 		void setRotation(UINT id, DirectX::XMFLOAT3 rot);
 		void setScale(UINT id, DirectX::XMFLOAT3 scale);
+		void setWorld(UINT id, const DirectX::XMFLOAT4X4& world);
 		void rotateX(UINT id, float amount);
 		void rotateY(UINT id, float amount);
 		void rotateZ(UINT id, float amount);
@@ -59,8 +60,6 @@ namespace RT
 		}
 
 		//getters/setters
-		constexpr D3D12_PRIMITIVE_TOPOLOGY getPrimitiveTopology() const { return D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST; }
-
 		inline std::vector<ObjectCB>& getInstances() { return instances; }
 		inline std::vector<InstanceInfo>& getInstancesInfos() { return instancesInfo; }
 		inline DirectX::BoundingBox& getBounds() { return bounds; }
@@ -0,0 +1,664 @@
+#include "GpuScene.h"
+
+#include "../utils/TextureLoader.h"
+#include "../rendering/PrefilteredEnvironment.h"
+
+using namespace DirectX;
+
+namespace RT
+{
+	GpuScene::GpuScene(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, settings_struct* settings, const std::string& fileName):
+		Scene(settings, fileName)
+	{
+		mCbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		buildDescriptorHeap(device);
+		loadTextures(device, cmdList, textures);
+		loadNormalMaps(device, cmdList, nmaps);
+		loadRoughnessMaps(device, cmdList, rmaps);
+		loadHeightMaps(device, cmdList, hmaps);
+		loadAOMaps(device, cmdList, aomaps);
+		loadEmissiveMaps(device, cmdList, emimaps);
+		loadMetallicMaps(device, cmdList, mmaps);
+		loadCubemap(device, cmdList, cubemap);
+		loadPrefiltered(device, cmdList, cubemap);
+		uploadEnvironment(device, cmdList);
+		uploadGeometries(device, cmdList);
+	}
+
+	void GpuScene::buildDescriptorHeap(ID3D12Device* device)
+	{
+		Logger::INFO.log("Building shader descriptor heap...");
+
+		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+		heapDesc.NumDescriptors = RESERVED_SPACE + MAX_ADD_RES;
+		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+		ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
+	}
+
+	void GpuScene::loadTextures(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& textures, bool reload)
+	{
+		if(textures.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) textures.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC3_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mTextureArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart());
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mTextureArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < textures.size(); ++i)
+		{
+			std::wstring fileName = L"res/textures/" + std::wstring(textures[i].begin(), textures[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = textures[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mTextureArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mTextures.push_back(std::move(texture));
+		}
+
+		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(mTextureArray.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		cmdList->ResourceBarrier(1, &barrier);
+	}
+
+	void GpuScene::loadNormalMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& nmaps, bool reload)
+	{
+		if(nmaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) nmaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC5_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mNMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 1, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mNMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < nmaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/normal_maps/" + std::wstring(nmaps[i].begin(), nmaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = nmaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mNMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mNMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadRoughnessMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& rmaps, bool reload)
+	{
+		if(rmaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) rmaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mRMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 2, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mRMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < rmaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/roughness_maps/" + std::wstring(rmaps[i].begin(), rmaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = rmaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mRMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mRMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadHeightMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& hmaps, bool reload)
+	{
+		if(hmaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) hmaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mHMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 3, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mHMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < hmaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/height_maps/" + std::wstring(hmaps[i].begin(), hmaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = hmaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mHMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mHMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadAOMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& aomaps, bool reload)
+	{
+		if(aomaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) aomaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mAOMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 4, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mAOMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < aomaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/ao_maps/" + std::wstring(aomaps[i].begin(), aomaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = aomaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mAOMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mAOMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadEmissiveMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& emimaps, bool reload)
+	{
+		if(emimaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) emimaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mEmissiveMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 5, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mEmissiveMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < emimaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/emissive/" + std::wstring(emimaps[i].begin(), emimaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = emimaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mEmissiveMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mEmissiveMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadMetallicMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& mmaps, bool reload)
+	{
+		if(mmaps.size() == 0)
+			return;
+
+		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
+
+		//create texture array
+		D3D12_RESOURCE_DESC texDesc = {};
+		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		texDesc.Alignment = 0;
+		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
+		texDesc.DepthOrArraySize = (UINT) mmaps.size();
+		texDesc.MipLevels = mipmaps;
+		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
+		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mMMapArray));
+
+		//allocate texture array
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 6, mCbvSrvUavDescriptorSize);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = texDesc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
+		srvDesc.Texture2DArray.FirstArraySlice = 0;
+		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
+		srvDesc.Texture2DArray.PlaneSlice = 0;
+		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mMMapArray.Get(), &srvDesc, handle);
+
+		for(int i = 0; i < mmaps.size(); ++i)
+		{
+			std::wstring fileName = L"res/metallic_maps/" + std::wstring(mmaps[i].begin(), mmaps[i].end()) + L".dds";
+
+			auto texture = std::make_unique<Texture>();
+			texture->Name = mmaps[i];
+			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
+
+			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &barrier);
+
+			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			{
+				D3D12_TEXTURE_COPY_LOCATION dst = {};
+				dst.pResource = mMMapArray.Get();
+				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+
+				D3D12_TEXTURE_COPY_LOCATION src = {};
+				src.pResource = texture->Resource.Get();
+				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+				src.SubresourceIndex = mip;
+
+				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			}
+
+			mMMaps.push_back(std::move(texture));
+		}
+	}
+
+	void GpuScene::loadCubemap(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap, bool reload)
+	{
+		if(cubemap == "")
+			return;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.TextureCube.ResourceMinLODClamp = 0.0F;
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), CUBEMAP_OFFSET, mCbvSrvUavDescriptorSize);
+
+		std::wstring fileName = L"res/cubemaps/" + std::wstring(cubemap.begin(), cubemap.end()) + L".dds";
+
+		mCubemap = std::make_unique<Texture>();
+		mCubemap->Name = cubemap;
+		ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), mCubemap->Resource, mCubemap->UploadHeap));
+
+		srvDesc.Format = mCubemap->Resource->GetDesc().Format;
+		srvDesc.TextureCube.MipLevels = settings->mipmaps ? mCubemap->Resource->GetDesc().MipLevels : 1;
+		device->CreateShaderResourceView(mCubemap->Resource.Get(), &srvDesc, handle);
+	}
+
+	void GpuScene::loadPrefiltered(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap)
+	{
+		mPrefiltered = nullptr;
+		mBrdfLut = nullptr;
+		if(cubemap == "" || !PrefilteredEnvironment::bakeCubemap(cubemap) || !PrefilteredEnvironment::bakeBrdfLut())
+			return;
+
+		std::wstring prefiltered = PrefilteredEnvironment::cubemapFile(cubemap);
+		mPrefiltered = std::make_unique<Texture>();
+		mPrefiltered->Name = cubemap + "_ggx";
+		ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, prefiltered.c_str(), mPrefiltered->Resource, mPrefiltered->UploadHeap));
+
+		std::wstring brdfLut = PrefilteredEnvironment::brdfLutFile();
+		mBrdfLut = std::make_unique<Texture>();
+		mBrdfLut->Name = "brdf_lut";
+		ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, brdfLut.c_str(), mBrdfLut->Resource, mBrdfLut->UploadHeap));
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.Format = mPrefiltered->Resource->GetDesc().Format;
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.TextureCube.MipLevels = mPrefiltered->Resource->GetDesc().MipLevels;
+		srvDesc.TextureCube.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mPrefiltered->Resource.Get(), &srvDesc, CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), PREFILTERED_OFFSET, mCbvSrvUavDescriptorSize));
+
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Format = mBrdfLut->Resource->GetDesc().Format;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.ResourceMinLODClamp = 0.0F;
+		device->CreateShaderResourceView(mBrdfLut->Resource.Get(), &srvDesc, CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), BRDF_LUT_OFFSET, mCbvSrvUavDescriptorSize));
+	}
+
+	void GpuScene::uploadEnvironment(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+	{
+		//the shaders always get both tables, a single zero when there is nothing to sample
+		static const float empty = 0.0F;
+		const auto& marginal = mEnvironment.getMarginal();
+		const auto& conditional = mEnvironment.getConditional();
+		if(mEnvironment.isValid())
+		{
+			mEnvMarginal = CreateDefaultBuffer(device, cmdList, marginal.data(), sizeof(float) * marginal.size(), mEnvMarginalUploader);
+			mEnvConditional = CreateDefaultBuffer(device, cmdList, conditional.data(), sizeof(float) * conditional.size(), mEnvConditionalUploader);
+		}
+		else
+		{
+			mEnvMarginal = CreateDefaultBuffer(device, cmdList, &empty, sizeof(float), mEnvMarginalUploader);
+			mEnvConditional = CreateDefaultBuffer(device, cmdList, &empty, sizeof(float), mEnvConditionalUploader);
+		}
+	}
+
+	void GpuScene::uploadGeometries(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList)
+	{
+		Logger::INFO.log("Uploading geometries...");
+
+		for(auto& geo:mGeometries)
+		{
+			if(!geo)
+				continue;
+
+			geo->gpu = std::make_shared<MeshBuffers>();
+			geo->gpu->VertexBufferGPU = CreateDefaultBuffer(device, cmdList, geo->VertexBufferCPU.data(), geo->VertexBufferByteSize, geo->gpu->VertexBufferUploader);
+			geo->gpu->IndexBufferGPU = CreateDefaultBuffer(device, cmdList, geo->IndexBufferCPU.data(), geo->IndexBufferByteSize, geo->gpu->IndexBufferUploader);
+		}
+	}
+
+	void GpuScene::updateSkinnedGeometries()
+	{
+		Scene::updateSkinnedGeometries();
+
+		//the uploader is copied into the vertex buffer right before the BLAS refit
+		for(auto& geo:mGeometries)
+		{
+			if(!geo || !geo->isSkinned || !geo->gpu || !geo->gpu->VertexBufferUploader)
+				continue;
+
+			BYTE* mapped = nullptr;
+			ThrowIfFailed(geo->gpu->VertexBufferUploader->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+			memcpy(mapped, geo->VertexBufferCPU.data(), geo->VertexBufferByteSize);
+			geo->gpu->VertexBufferUploader->Unmap(0, nullptr);
+		}
+	}
+
+	void GpuScene::evictTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap)
+	{
+		std::vector<ID3D12Pageable*> res;
+		if(textures && mTextureArray)
+			res.push_back(mTextureArray.Get());
+		if(nmaps && mNMapArray)
+			res.push_back(mNMapArray.Get());
+		if(rmaps && mRMapArray)
+			res.push_back(mRMapArray.Get());
+		if(hmap && mHMapArray)
+			res.push_back(mHMapArray.Get());
+		if(aomap && mAOMapArray)
+			res.push_back(mAOMapArray.Get());
+		if(mmap && mMMapArray)
+			res.push_back(mMMapArray.Get());
+		if(res.size() > 0)
+			device->Evict((UINT) res.size(), res.data());
+	}
+
+	void GpuScene::makeResidentTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap)
+	{
+		std::vector<ID3D12Pageable*> res;
+		if(textures && mTextureArray)
+			res.push_back(mTextureArray.Get());
+		if(nmaps && mNMapArray)
+			res.push_back(mNMapArray.Get());
+		if(rmaps && mRMapArray)
+			res.push_back(mRMapArray.Get());
+		if(hmap && mHMapArray)
+			res.push_back(mHMapArray.Get());
+		if(aomap && mAOMapArray)
+			res.push_back(mAOMapArray.Get());
+		if(mmap && mMMapArray)
+			res.push_back(mMMapArray.Get());
+		if(res.size() > 0)
+			device->MakeResident((UINT) res.size(), res.data());
+	}
+}
\ No newline at end of file
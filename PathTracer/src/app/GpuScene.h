@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Scene.h"
+#include "../utils/header.h"
+
+#define TEXTURE_OFFSET		0
+#define NORMAL_OFFSET		1
+#define ROUGHNESS_OFFSET	2
+#define HEIGHT_OFFSET		3
+#define AO_OFFSET			4
+#define EMISSIVE_OFFSET		5
+#define METALLIC_OFFSET		6
+#define CUBEMAP_OFFSET		7
+#define PREFILTERED_OFFSET	8
+#define BRDF_LUT_OFFSET		9
+#define RESERVED_SPACE		10
+#define MAX_ADD_RES			25
+
+namespace RT
+{
+	//a Scene with its textures, tables and geometry uploaded to a device
+	class GpuScene: public Scene
+	{
+	public:
+		GpuScene(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, settings_struct* settings, const std::string& fileName);
+		~GpuScene() = default;
+
+		inline ID3D12Resource* getEnvironmentMarginal() const { return mEnvMarginal.Get(); }
+		inline ID3D12Resource* getEnvironmentConditional() const { return mEnvConditional.Get(); }
+		inline UINT getPrefilteredMips() const { return mPrefiltered ? mPrefiltered->Resource->GetDesc().MipLevels : 0; }
+
+		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getLastCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), RESERVED_SPACE + index, mCbvSrvUavDescriptorSize); }
+		inline CD3DX12_GPU_DESCRIPTOR_HANDLE getLastGPUHeapAddress(UINT index = 0) { return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), RESERVED_SPACE + index, mCbvSrvUavDescriptorSize); }
+
+		inline ID3D12DescriptorHeap* getDescriptorHeap() const { return mHeap.Get(); }
+
+		void updateSkinnedGeometries() override;
+
+		void evictTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap);
+		void makeResidentTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap);
+	protected:
+		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getTextureCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mCbvSrvUavDescriptorSize); }
+		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getNMapCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 1 + index, mCbvSrvUavDescriptorSize); }
+		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getRMapCPUHeapAddress() { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 2, mCbvSrvUavDescriptorSize); }
+		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getCubemapCPUHeapAddress() { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 3, mCbvSrvUavDescriptorSize); }
+	private:
+		void buildDescriptorHeap(ID3D12Device* device);
+		void loadTextures(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& textures, bool reload = false);
+		void loadNormalMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& nmaps, bool reload = false);
+		void loadRoughnessMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& rmaps, bool reload = false);
+		void loadHeightMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& hmaps, bool reload = false);
+		void loadAOMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& aomaps, bool reload = false);
+		void loadEmissiveMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& emimaps, bool reload = false);
+		void loadMetallicMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& mmaps, bool reload = false);
+		void loadCubemap(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap, bool reload = false);
+		void loadPrefiltered(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap);
+		void uploadEnvironment(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+		void uploadGeometries(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList);
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> mTextureArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mNMapArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mRMapArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mHMapArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mAOMapArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mMMapArray = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mEmissiveMapArray = nullptr;
+
+		std::vector<std::unique_ptr<Texture>> mTextures;
+		std::vector<std::unique_ptr<Texture>> mNMaps;
+		std::vector<std::unique_ptr<Texture>> mRMaps;
+		std::vector<std::unique_ptr<Texture>> mHMaps;
+		std::vector<std::unique_ptr<Texture>> mAOMaps;
+		std::vector<std::unique_ptr<Texture>> mMMaps;
+		std::vector<std::unique_ptr<Texture>> mEmissiveMaps;
+		std::unique_ptr<Texture> mCubemap = nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> mEnvMarginal = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mEnvConditional = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mEnvMarginalUploader = nullptr;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mEnvConditionalUploader = nullptr;
+
+		//split sum reflections past the clip distances
+		std::unique_ptr<Texture> mPrefiltered = nullptr;
+		std::unique_ptr<Texture> mBrdfLut = nullptr;
+
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+		UINT mCbvSrvUavDescriptorSize;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "Headless.h"
+
+#include "../rendering/cpu/CpuPathTracer.h"
+#ifdef _WIN32
+	#include "../rendering/cpu/CpuTileCoordinator.h"
+#endif
+#include "../rendering/BlueNoise.h"
+
+namespace RT
+{
+	//-cpu <scene> [spp] [output] [width] [height], no window and no GPU
+	static int renderHeadless(const std::vector<std::string>& cmdArgs)
+	{
+		//flags can go anywhere, the rest are positional
+		std::vector<std::string> args;
+		bool wavefront = false;
+		bool benchmark = false;
+		bool adaptive = false;
+		bool denoise = false;
+		bool verify = false;
+		UINT workers = 0;
+		CpuAdaptiveSettings adaptiveSettings;
+		for(size_t i = 0; i < cmdArgs.size(); ++i)
+		{
+			const std::string& arg = cmdArgs[i];
+			if(arg == "-wavefront")
+				wavefront = true;
+			else if(arg == "-benchmark")
+				benchmark = true;
+			else if(arg == "-adaptive")
+				adaptive = true;
+			else if(arg == "-denoise")
+				denoise = true;
+			else if(arg == "-verify")
+				verify = true;
+			else if(arg == "-workers" && i + 1 < cmdArgs.size())
+				workers = std::stoi(cmdArgs[++i]);
+			else if(arg == "-threshold" && i + 1 < cmdArgs.size())
+				adaptiveSettings.threshold = std::stof(cmdArgs[++i]);
+			else if(arg == "-time" && i + 1 < cmdArgs.size())
+				adaptiveSettings.timeBudget = std::stof(cmdArgs[++i]);
+			else
+				args.push_back(arg);
+		}
+
+		std::string sceneName = args.size() > 1 ? args[1] : "box";
+		UINT spp = args.size() > 2 ? std::stoi(args[2]) : 64;
+		std::string output = args.size() > 3 ? args[3] : sceneName + "_cpu.png";
+		UINT32 width = args.size() > 4 ? std::stoi(args[4]) : 1280;
+		UINT32 height = args.size() > 5 ? std::stoi(args[5]) : 720;
+
+		CpuPathTracer tracer(width, height);
+		if(!tracer.initContext(sceneName))
+			return EXIT_FAILURE;
+
+		if(benchmark)
+		{
+			if(adaptive)
+				tracer.benchmarkAdaptive(adaptiveSettings.threshold);
+			else
+				tracer.benchmarkWavefront(spp);
+		}
+
+		if(adaptive)
+		{
+			//the sample count becomes the budget
+			adaptiveSettings.sampleBudget = spp;
+			tracer.renderAdaptive(adaptiveSettings);
+		}
+#ifdef _WIN32
+		else if(workers > 0)
+		{
+			CpuTileCoordinator coordinator(&tracer, sceneName);
+			if(!coordinator.render(spp, workers))
+				return EXIT_FAILURE;
+
+			//the same render in this process has to match bit for bit
+			if(verify)
+			{
+				std::vector<DirectX::XMFLOAT4> distributed = tracer.getColor();
+				tracer.render(spp);
+				if(memcmp(distributed.data(), tracer.getColor().data(), distributed.size() * sizeof(DirectX::XMFLOAT4)) != 0)
+				{
+					Logger::ERR.log("Distributed render differs from the single process render");
+					return EXIT_FAILURE;
+				}
+				Logger::INFO.log("Distributed render matches the single process render");
+			}
+		}
+#endif
+		else
+		{
+			if(wavefront)
+				tracer.setIntegrator(CPU_INTEGRATOR_WAVEFRONT);
+			tracer.render(spp);
+		}
+
+		if(denoise)
+		{
+			tracer.denoise();
+			Logger::INFO.log("Denoised in " + std::to_string(tracer.getDenoiser().getDenoiseTime()) + "ms");
+		}
+		if(!tracer.saveImage(output))
+		{
+			Logger::ERR.log("Couldn't write " + output);
+			return EXIT_FAILURE;
+		}
+
+		Logger::INFO.log("Saved " + output);
+		return EXIT_SUCCESS;
+	}
+
+	//-blue-noise [size] [slices] [channels] [output], spatiotemporal blue noise as an RGBA8 texture array
+	static int generateBlueNoise(const std::vector<std::string>& args)
+	{
+		UINT32 size = args.size() > 1 ? std::stoi(args[1]) : 128;
+		UINT32 slices = args.size() > 2 ? std::stoi(args[2]) : 64;
+		UINT32 channels = args.size() > 3 ? std::stoi(args[3]) : 2;
+		std::string output = args.size() > 4 ? args[4] : BLUE_NOISE_DIR "stbn_" + std::to_string(size) + "x" + std::to_string(slices) + ".dds";
+
+		if(!BlueNoise::generateTexture(std::wstring(output.begin(), output.end()), size, slices, channels))
+			return EXIT_FAILURE;
+
+		Logger::INFO.log("Saved " + output);
+		return EXIT_SUCCESS;
+	}
+
+	bool isHeadless(const std::vector<std::string>& args)
+	{
+		if(args.empty())
+			return false;
+		return args[0] == "-cpu" || args[0] == "-blue-noise" || (args[0] == "-cpu-worker" && args.size() > 1);
+	}
+
+	int runHeadless(const std::vector<std::string>& args)
+	{
+#ifdef _WIN32
+		if(args[0] == "-cpu-worker")
+			return CpuTileCoordinator::runWorker(args[1]);
+#endif
+		if(args[0] == "-cpu")
+			return renderHeadless(args);
+		if(args[0] == "-blue-noise")
+			return generateBlueNoise(args);
+
+		Logger::ERR.log("Unknown command \"" + args[0] + "\"");
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
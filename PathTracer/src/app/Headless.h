@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../utils/core.h"
+
+namespace RT
+{
+	//everything that runs without a window or a GPU, shared by WinMain and the portable main
+	//-cpu, -blue-noise and on windows -cpu-worker, args[0] is the command
+	bool isHeadless(const std::vector<std::string>& args);
+	int runHeadless(const std::vector<std::string>& args);
+}
\ No newline at end of file
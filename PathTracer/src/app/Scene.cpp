@@ -1,19 +1,17 @@
 #include "Scene.h"
 
-#include "../utils/GeometryGenerator.h"
-#include "../utils/TextureLoader.h"
+#include "../utils/GeometryCache.h"
 #include "../utils/ModelLoader.h"
+#include "../utils/Timer.h"
 
 using namespace DirectX;
 
 namespace RT
 {
-	Scene::Scene(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, settings_struct* settings, const std::string& fileName):
+	Scene::Scene(settings_struct* settings, const std::string& fileName):
 		fileName(fileName), settings(settings)
 	{
-		mCbvSrvUavDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-		init(device, cmdList, fileName);
+		init(fileName);
 	}
 
 	Scene::~Scene()
@@ -21,7 +19,7 @@ namespace RT
 		mEntities.clear();
 	}
 
-	void Scene::init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& fileName, bool reload)
+	void Scene::init(const std::string& fileName, bool reload)
 	{
 		Logger::INFO.log("Initializing scene \"" + fileName + "\"...");
 
@@ -43,6 +41,7 @@ namespace RT
 				mmaps = {};
 				cubemap = "";
 				geometries = {};
+				imports = {};
 			}
 			else
 				file.open(fileName);
@@ -180,6 +179,18 @@ namespace RT
 
 					geometries.push_back(value.substr(0, value.find("}")));
 				}
+				else if(param == "imports")
+				{
+					value = value.substr(value.find("{") + 1, value.length());
+
+					while(value.find(",") != std::string::npos)
+					{
+						imports.push_back(value.substr(0, value.find(",")));
+						value = value.substr(value.find(",") + 1, value.length());
+					}
+
+					imports.push_back(value.substr(0, value.find("}")));
+				}
 				else if(param == "lights")
 					mLightCount = std::stoi(value);
 				else if(param == "events")
@@ -191,33 +202,22 @@ namespace RT
 			}
 
 			loadMaterials(materials);
-			buildDescriptorHeap(device);
-			loadTextures(device, cmdList, textures);
-			loadNormalMaps(device, cmdList, nmaps);
-			loadRoughnessMaps(device, cmdList, rmaps);
-			loadHeightMaps(device, cmdList, hmaps);
-			loadAOMaps(device, cmdList, aomaps);
-			loadEmissiveMaps(device, cmdList, emimaps);
-			loadMetallicMaps(device, cmdList, mmaps);
-			loadCubemap(device, cmdList, cubemap);
-			loadGeometries(device, cmdList, geometries);
+			loadEnvironment(cubemap);
+			loadGeometries(geometries);
 			if(mCameraCount > 0)
 				loadCameras(file);
 			if(mLightCount > 0)
 				loadLights(file);
 			loadInstances(file);
+			loadImports(imports);
+			if(settings->emissiveLights)
+				buildEmissiveLights();
 		}
 		else
 		{
 			mMaterials.clear();
-			mTextures.clear();
-			mNMaps.clear();
-			mRMaps.clear();
-			mHMaps.clear();
-			mAOMaps.clear();
-			mEmissiveMaps.clear();
-			mMMaps.clear();
 			mGeometries.clear();
+			mSkinnedGeometries.clear();
 
 			if(fileName != "")
 			{
@@ -226,672 +226,318 @@ namespace RT
 					std::getline(file, line);
 			}
 
-			loadMaterials(materials, true);
-			buildDescriptorHeap(device);
-			loadTextures(device, cmdList, textures);
-			loadNormalMaps(device, cmdList, nmaps);
-			loadRoughnessMaps(device, cmdList, rmaps);
-			loadHeightMaps(device, cmdList, hmaps);
-			loadAOMaps(device, cmdList, aomaps);
-			loadEmissiveMaps(device, cmdList, emimaps);
-			loadMetallicMaps(device, cmdList, mmaps);
-			loadCubemap(device, cmdList, cubemap);
-			loadGeometries(device, cmdList, geometries);
+			//the imported entities are rebuilt from the files as they are now, the ones of the scene file keep their geometry index
+			for(size_t i = mFirstImportedEntity; i < mEntities.size(); ++i)
+				mEntityLayer[(int) mEntities[i]->layer].remove(mEntities[i].get());
+			mEntities.resize(std::min<size_t>(mFirstImportedEntity, mEntities.size()));
 
+			loadMaterials(materials, true);
+			loadEnvironment(cubemap);
+			loadGeometries(geometries);
 			for(auto& e:mEntities)
-				e->setGeo(mGeometries[e->getGeoIndex()].get());
+				e->setGeo(e->getGeoIndex() >= 0 && e->getGeoIndex() < (INT32) mGeometries.size() ? mGeometries[e->getGeoIndex()].get() : nullptr);
+			loadImports(imports, true);
 		}
 
 		if(fileName != "")
 			file.close();
 	}
 
-	void Scene::buildDescriptorHeap(ID3D12Device* device)
-	{
-		Logger::INFO.log("Building shader descriptor heap...");
-
-		D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-		heapDesc.NumDescriptors = RESERVED_SPACE + MAX_ADD_RES;
-		heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mHeap)));
-	}
-
-	void Scene::loadMaterials(const std::vector<std::string>& materials, bool reload)
-	{
-		for(int i = 0; i < materials.size(); ++i)
-		{
-			std::unique_ptr<Material> mat = std::make_unique<Material>(loadMaterial("res/materials/" + materials[i] + ".mat"));
-			mat->name = materials[i];
-			mat->NumFramesDirty = NUM_FRAME_RESOURCES;
-			mMaterials.push_back(std::move(mat));
-		}
-	}
-
-	void Scene::loadTextures(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& textures, bool reload)
-	{
-		if(textures.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) textures.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC3_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mTextureArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart());
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mTextureArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < textures.size(); ++i)
-		{
-			std::wstring fileName = L"res/textures/" + std::wstring(textures[i].begin(), textures[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = textures[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mTextureArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
-
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
-
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mTextures.push_back(std::move(texture));
-		}
-
-		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(mTextureArray.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-		cmdList->ResourceBarrier(1, &barrier);
-	}
-
-	void Scene::loadNormalMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& nmaps, bool reload)
-	{
-		if(nmaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) nmaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC5_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mNMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 1, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mNMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < nmaps.size(); ++i)
-		{
-			std::wstring fileName = L"res/normal_maps/" + std::wstring(nmaps[i].begin(), nmaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = nmaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mNMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
-
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
-
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mNMaps.push_back(std::move(texture));
-		}
-	}
-
-	void Scene::loadRoughnessMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& rmaps, bool reload)
-	{
-		if(rmaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) rmaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mRMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 2, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mRMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < rmaps.size(); ++i)
-		{
-			std::wstring fileName = L"res/roughness_maps/" + std::wstring(rmaps[i].begin(), rmaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = rmaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mRMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
-
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
-
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mRMaps.push_back(std::move(texture));
-		}
-	}
-
-	void Scene::loadHeightMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& hmaps, bool reload)
-	{
-		if(hmaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) hmaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mHMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 3, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mHMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < hmaps.size(); ++i)
-		{
-			std::wstring fileName = L"res/height_maps/" + std::wstring(hmaps[i].begin(), hmaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = hmaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mHMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
-
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
-
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mHMaps.push_back(std::move(texture));
-		}
-	}
-
-	void Scene::loadAOMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& aomaps, bool reload)
+	void Scene::buildEmissiveLights()
 	{
-		if(aomaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) aomaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mAOMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 4, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mAOMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < aomaps.size(); ++i)
+		Logger::INFO.log("Building emissive triangle lights...");
+		Timer timer;
+		timer.reset();
+
+		//every map once, they only have to stay around while the triangles are built
+		std::vector<std::unique_ptr<EmissiveMap>> maps(emimaps.size());
+		//instances are numbered like the ones of the CPU backend, every instance of an entity with a geometry counts
+		UINT32 instanceCount = 0;
+		for(auto& e:mEntities)
 		{
-			std::wstring fileName = L"res/ao_maps/" + std::wstring(aomaps[i].begin(), aomaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = aomaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
+			MeshGeometry* geo = e->getGeo();
+			if(!geo)
+				continue;
+			UINT32 firstInstance = instanceCount;
+			instanceCount += (UINT32) e->getInstances().size();
+			if(geo->VertexBufferCPU.empty() || geo->IndexBufferCPU.empty())
+				continue;
+
+			const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data());
+			const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data());
+			UINT32 triangleCount = geo->DrawArgs["0"].IndexCount / 3;
+			for(UINT32 i = 0; i < (UINT32) e->getInstances().size(); ++i)
 			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mAOMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
+				const ObjectCB& inst = e->getInstances()[i];
+				if(inst.emissiveIndex < 0 || inst.materialIndex < 0 || inst.materialIndex >= (int) mMaterials.size())
+					continue;
 
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
+				const EmissiveMap* map = nullptr;
+				if(inst.emissiveIndex < (int) emimaps.size())
+				{
+					auto& loaded = maps[inst.emissiveIndex];
+					if(!loaded)
+					{
+						loaded = std::make_unique<EmissiveMap>();
+						std::wstring mapName = L"res/emissive/" + std::wstring(emimaps[inst.emissiveIndex].begin(), emimaps[inst.emissiveIndex].end()) + L".dds";
+						if(!EmissiveTriangles::loadMap(mapName, *loaded))
+							Logger::WARN.log("Unsupported emissive map " + emimaps[inst.emissiveIndex] + ", its emission is taken as constant");
+					}
+					if(!loaded->levels.empty())
+						map = loaded.get();
+				}
 
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+				//same order as hit.hlsl, the instance's transform then the material's
+				const Material& material = *mMaterials[inst.materialIndex];
+				XMFLOAT4X4 uvTransform;
+				XMStoreFloat4x4(&uvTransform, XMLoadFloat4x4(&inst.texTransform) * XMLoadFloat4x4(&material.MatTransform));
+				mEmissive.add(vertices, indices, triangleCount, inst.world, uvTransform, material.emission, map, firstInstance + i);
 			}
-
-			mAOMaps.push_back(std::move(texture));
 		}
-	}
-
-	void Scene::loadEmissiveMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& emimaps, bool reload)
-	{
-		if(emimaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) emimaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mEmissiveMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 5, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mEmissiveMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < emimaps.size(); ++i)
-		{
-			std::wstring fileName = L"res/emissive/" + std::wstring(emimaps[i].begin(), emimaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = emimaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mEmissiveMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
 
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
+		mEmissive.build();
+		mEmissive.appendLights(mLights);
+		mLightCount = (UINT) mLights.size();
 
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mEmissiveMaps.push_back(std::move(texture));
-		}
+		timer.tick();
+		Logger::INFO.log(std::to_string(mEmissive.getCount()) + " emissive triangles, total flux " + std::to_string(mEmissive.getTotalFlux()) + ", built in " +
+						 std::to_string(timer.deltaTime() * 1000.0F) + "ms");
 	}
 
-	void Scene::loadMetallicMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& mmaps, bool reload)
+	void Scene::loadMaterials(const std::vector<std::string>& materials, bool reload)
 	{
-		if(mmaps.size() == 0)
-			return;
-
-		int mipmaps = settings->mipmaps ? (12 - settings->texResolution) : 1;
-
-		//create texture array
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Alignment = 0;
-		texDesc.Width = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.Height = (UINT) pow(2, 11 - settings->texResolution);
-		texDesc.DepthOrArraySize = (UINT) mmaps.size();
-		texDesc.MipLevels = mipmaps;
-		texDesc.Format = DXGI_FORMAT_BC4_UNORM;
-		texDesc.SampleDesc.Count = 1;
-		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		CD3DX12_HEAP_PROPERTIES hp(D3D12_HEAP_TYPE_DEFAULT);
-		device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mMMapArray));
-
-		//allocate texture array
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), 6, mCbvSrvUavDescriptorSize);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-		srvDesc.Texture2DArray.MostDetailedMip = 0;
-		srvDesc.Texture2DArray.MipLevels = texDesc.MipLevels;
-		srvDesc.Texture2DArray.FirstArraySlice = 0;
-		srvDesc.Texture2DArray.ArraySize = texDesc.DepthOrArraySize;
-		srvDesc.Texture2DArray.PlaneSlice = 0;
-		srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0F;
-		device->CreateShaderResourceView(mMMapArray.Get(), &srvDesc, handle);
-
-		for(int i = 0; i < mmaps.size(); ++i)
+		for(int i = 0; i < materials.size(); ++i)
 		{
-			std::wstring fileName = L"res/metallic_maps/" + std::wstring(mmaps[i].begin(), mmaps[i].end()) + L".dds";
-
-			auto texture = std::make_unique<Texture>();
-			texture->Name = mmaps[i];
-			ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), texture->Resource, texture->UploadHeap));
-
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(texture->Resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
-			cmdList->ResourceBarrier(1, &barrier);
-
-			for(int mip = settings->texResolution; mip < (settings->mipmaps ? 12 : (settings->texResolution + 1)); ++mip)
-			{
-				D3D12_TEXTURE_COPY_LOCATION dst = {};
-				dst.pResource = mMMapArray.Get();
-				dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				dst.SubresourceIndex = D3D12CalcSubresource(mip - settings->texResolution, i, 0, mipmaps, texDesc.DepthOrArraySize);
-
-				D3D12_TEXTURE_COPY_LOCATION src = {};
-				src.pResource = texture->Resource.Get();
-				src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-				src.SubresourceIndex = mip;
-
-				cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
-			}
-
-			mMMaps.push_back(std::move(texture));
+			std::unique_ptr<Material> mat = std::make_unique<Material>(loadMaterial("res/materials/" + materials[i] + ".mat"));
+			mat->name = materials[i];
+			mat->NumFramesDirty = NUM_FRAME_RESOURCES;
+			mMaterials.push_back(std::move(mat));
 		}
 	}
 
-	void Scene::loadCubemap(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap, bool reload)
+	void Scene::loadEnvironment(const std::string& cubemap)
 	{
-		if(cubemap == "")
-			return;
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-		srvDesc.TextureCube.MostDetailedMip = 0;
-		srvDesc.TextureCube.ResourceMinLODClamp = 0.0F;
-
-		CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mHeap->GetCPUDescriptorHandleForHeapStart(), CUBEMAP_OFFSET, mCbvSrvUavDescriptorSize);
-
-		std::wstring fileName = L"res/cubemaps/" + std::wstring(cubemap.begin(), cubemap.end()) + L".dds";
-
-		mCubemap = std::make_unique<Texture>();
-		mCubemap->Name = cubemap;
-		ThrowIfFailed(CreateDDSTextureFromFile12(device, cmdList, fileName.c_str(), mCubemap->Resource, mCubemap->UploadHeap));
-
-		srvDesc.Format = mCubemap->Resource->GetDesc().Format;
-		srvDesc.TextureCube.MipLevels = settings->mipmaps ? mCubemap->Resource->GetDesc().MipLevels : 1;
-		device->CreateShaderResourceView(mCubemap->Resource.Get(), &srvDesc, handle);
+		//tables and ambient term, GpuScene uploads the tables
+		mEnvironment = EnvironmentMap();
+		if(cubemap != "")
+			mEnvironment.load(cubemap);
 	}
 
-	void Scene::loadGeometries(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& geometries)
+	void Scene::loadGeometries(const std::vector<std::string>& geometries)
 	{
 		Logger::INFO.log("Loading geometries...");
 
-		XMFLOAT3 vMinf3(FLT_MAX, FLT_MAX, FLT_MAX);
-		XMFLOAT3 vMaxf3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
 		for(int i = 0; i < geometries.size(); ++i)
 		{
-			XMVECTOR vMin = XMLoadFloat3(&vMinf3);
-			XMVECTOR vMax = XMLoadFloat3(&vMaxf3);
-
-			auto geom = std::make_unique<MeshGeometry>();
-			geom->name = geometries[i];
-
-			GeometryGenerator::MeshData meshData;
 			std::vector<Vertex> vertices;
-			std::vector<UINT16> indices;
 			std::vector<UINT32> indices32;
 			bool water = false;
 
 			std::string token = geometries[i];
 			if(token.at(0) == '#')
 			{
-				GeometryGenerator geoGen;
+				ProceduralKey key;
 
 				token = token.substr(1, token.length());
 				if(token == "box")
-					meshData = geoGen.createBox(0.5F, 0.5F, 0.5F, 0);
+					key = { PROCEDURAL_SHAPE_BOX, { 0.5F, 0.5F, 0.5F, 0.0F } };
 				else if(token == "hills")
-					meshData = geoGen.createGrid(10.0F, 10.0F, 75, 75);
+					key = { PROCEDURAL_SHAPE_GRID, { 10.0F, 10.0F, 75.0F, 75.0F } };
 				else if(token == "plane")
-					meshData = geoGen.createGrid(10.0F, 10.0F, 2, 2);
+					key = { PROCEDURAL_SHAPE_GRID, { 10.0F, 10.0F, 2.0F, 2.0F } };
 				else if(token == "sphere")
-					meshData = geoGen.createSphere(0.5F, 50, 50);
+					key = { PROCEDURAL_SHAPE_SPHERE, { 0.5F, 50.0F, 50.0F } };
 				else if(token == "quad")
-					meshData = geoGen.createQuad(-3.5F, 2.5F, 7.0F, 3.0F, 2.0F);
+					key = { PROCEDURAL_SHAPE_QUAD, { -3.5F, 2.5F, 7.0F, 3.0F, 2.0F } };
 				else if(token == "grid")
-					meshData = geoGen.createGrid(7.0F, 7.0F, 2, 2);
+					key = { PROCEDURAL_SHAPE_GRID, { 7.0F, 7.0F, 2.0F, 2.0F } };
 				else if(token == "water_body50")
 				{
-					meshData = geoGen.createGrid(20.0F, 20.0F, 50, 50);
+					key = { PROCEDURAL_SHAPE_GRID, { 20.0F, 20.0F, 50.0F, 50.0F } };
 					water = true;
 				}
 				else if(token == "water_body75")
 				{
-					meshData = geoGen.createGrid(20.0F, 20.0F, 75, 75);
+					key = { PROCEDURAL_SHAPE_GRID, { 20.0F, 20.0F, 75.0F, 75.0F } };
 					water = true;
 				}
 				else if(token == "water_body100")
 				{
-					meshData = geoGen.createGrid(20.0F, 20.0F, 100, 100);
+					key = { PROCEDURAL_SHAPE_GRID, { 20.0F, 20.0F, 100.0F, 100.0F } };
 					water = true;
 				}
 				else if(token == "water_body150")
 				{
-					meshData = geoGen.createGrid(20.0F, 20.0F, 150, 150);
+					key = { PROCEDURAL_SHAPE_GRID, { 20.0F, 20.0F, 150.0F, 150.0F } };
 					water = true;
 				}
-
-				vertices.resize(meshData.vertices.size());
-				indices = meshData.getIndices16();
-				indices32 = meshData.indices32;
-
-				for(size_t i = 0; i < meshData.vertices.size(); ++i)
+				else
 				{
-					vertices[i].position = meshData.vertices[i].position;
-					vertices[i].uvs = meshData.vertices[i].texC;
-					vertices[i].tangent = meshData.vertices[i].tangentU;
-					vertices[i].normal = meshData.vertices[i].normal;
-
-					XMVECTOR p = XMLoadFloat3(&vertices[i].position);
-					vMin = XMVectorMin(vMin, p);
-					vMax = XMVectorMax(vMax, p);
+					//the empty slot keeps the indices of the scene file, instances of it are dropped
+					Logger::ERR.log("Unknown procedural geometry \"" + token + "\", skipping it");
+					mGeometries.push_back(nullptr);
+					continue;
 				}
+
+				//generated once per parameter set, reloads and scene switches reuse it
+				auto mesh = GeometryCache::get(key, settings->geometryDiskCache);
+				addGeometry(geometries[i], mesh->vertices, mesh->indices, mesh->bounds, water);
+				continue;
 			}
 			else
 			{
 				ModelLoader::MeshData model = ModelLoader::loadOBJ("res/models/" + geometries[i] + ".glb");
 
-				vertices = model.vertices;
-				indices = model.getIndices16();
-				indices32 = model.indices32;
-
-				for(auto& v:vertices)
+				//skinned models keep their bind pose, the vertex buffer is rewritten every frame
+				if(model.skeleton)
 				{
-					XMVECTOR p = XMLoadFloat3(&v.position);
-					vMin = XMVectorMin(vMin, p);
-					vMax = XMVectorMax(vMax, p);
+					SkinnedGeometry skinned;
+					skinned.geoIndex = (UINT) mGeometries.size();
+					skinned.bindPose = model.vertices;
+					skinned.bones = std::move(model.bones);
+					skinned.skeleton = model.skeleton;
+					mSkinnedGeometries.push_back(std::move(skinned));
 				}
+
+				vertices = std::move(model.vertices);
+				indices32 = std::move(model.indices32);
 			}
 
-			geom->vertexCount = (UINT) vertices.size();
+			addGeometry(geometries[i], vertices, indices32, water);
+		}
+
+		for(auto& s:mSkinnedGeometries)
+		{
+			mGeometries[s.geoIndex]->isSkinned = true;
+			Skinning::evaluate(*s.skeleton, s.clip, 0.0F, s.palette);
+		}
+	}
+
+	UINT64 Scene::addGeometry(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<UINT32>& indices32, bool water)
+	{
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for(auto& v:vertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&v.position);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		BoundingBox bounds;
+		XMStoreFloat3(&bounds.Center, 0.5F * (vMin + vMax));
+		XMStoreFloat3(&bounds.Extents, 0.5F * (vMax - vMin));
+		return addGeometry(name, vertices, indices32, bounds, water);
+	}
+
+	UINT64 Scene::addGeometry(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<UINT32>& indices32, const BoundingBox& bounds, bool water)
+	{
+		auto geom = std::make_unique<MeshGeometry>();
+		geom->name = name;
+		geom->vertexCount = (UINT) vertices.size();
+
+		UINT vbByteSize = (UINT) vertices.size() * sizeof(Vertex);
+		UINT ibByteSize = (UINT) indices32.size() * sizeof(UINT32);
+
+		geom->VertexBufferCPU.resize(vbByteSize);
+		memcpy(geom->VertexBufferCPU.data(), vertices.data(), vbByteSize);
 
-			UINT vbByteSize = (UINT) vertices.size() * sizeof(Vertex);
-			UINT ibByteSize = (UINT) indices32.size() * sizeof(UINT32);
+		geom->IndexBufferCPU.resize(ibByteSize);
+		memcpy(geom->IndexBufferCPU.data(), indices32.data(), ibByteSize);
 
-			ThrowIfFailed(D3DCreateBlob(vbByteSize, &geom->VertexBufferCPU));
-			CopyMemory(geom->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+		geom->VertexByteStride = sizeof(Vertex);
+		geom->VertexBufferByteSize = vbByteSize;
+		geom->IndexFormat = DXGI_FORMAT_R32_UINT;
+		geom->IndexBufferByteSize = ibByteSize;
+		geom->isWater = water;
+
+		SubmeshGeometry submesh;
+		submesh.IndexCount = (UINT) indices32.size();
+		submesh.StartIndexLocation = 0;
+		submesh.BaseVertexLocation = 0;
+		submesh.bounds = bounds;
+
+		geom->DrawArgs["0"] = submesh;
+		mGeometries.push_back(std::move(geom));
+
+		return (UINT64) vbByteSize + ibByteSize;
+	}
+
+	void Scene::loadImports(const std::vector<std::string>& imports, bool reload)
+	{
+		mFirstImportedEntity = (UINT) mEntities.size();
+		if(imports.size() == 0)
+			return;
+
+		Logger::INFO.log(reload ? "Reloading imported scenes..." : "Loading imported scenes...");
+
+		Timer timer;
+		for(auto& name:imports)
+		{
+			timer.reset();
+			ModelLoader::SceneData sceneData = ModelLoader::loadScene("res/models/" + name + ".glb");
+			timer.tick();
+			float parseMs = timer.deltaTime() * 1000.0F;
+
+			//the file's materials go after the scene's, a reload rebuilt those first so the indices come out the same
+			UINT firstMaterial = (UINT) mMaterials.size();
+			for(auto& material:sceneData.materials)
+			{
+				std::unique_ptr<Material> mat = std::make_unique<Material>(material);
+				mat->name = name + "/" + material.name;
+				mat->NumFramesDirty = NUM_FRAME_RESOURCES;
+				mMaterials.push_back(std::move(mat));
+			}
 
-			ThrowIfFailed(D3DCreateBlob(ibByteSize, &geom->IndexBufferCPU));
-			CopyMemory(geom->IndexBufferCPU->GetBufferPointer(), indices32.data(), ibByteSize);
+			//mesh parts become geometries, appended after the ones listed in the scene file
+			UINT firstGeometry = (UINT) mGeometries.size();
+			std::vector<UINT64> meshBytes(sceneData.meshes.size());
+			UINT64 sharedBytes = 0;
+			for(size_t i = 0; i < sceneData.meshes.size(); ++i)
+			{
+				meshBytes[i] = addGeometry(name + "/" + sceneData.meshNames[i] + "#" + std::to_string(i), sceneData.meshes[i].vertices, sceneData.meshes[i].indices32);
+				sharedBytes += meshBytes[i];
+			}
+			timer.tick();
+			float uploadMs = timer.deltaTime() * 1000.0F;
 
-			geom->VertexBufferGPU = CreateDefaultBuffer(device, cmdList, vertices.data(), vbByteSize, geom->VertexBufferUploader);
-			geom->IndexBufferGPU = CreateDefaultBuffer(device, cmdList, indices32.data(), ibByteSize, geom->IndexBufferUploader);
+			//nodes become instances of the entity owning their mesh
+			std::vector<Entity*> meshEntities(sceneData.meshes.size(), nullptr);
+			UINT64 flattenedBytes = 0;
+			for(auto& node:sceneData.instances)
+			{
+				Entity*& entity = meshEntities[node.mesh];
+				if(!entity)
+				{
+					auto instance = std::make_unique<Entity>();
+					instance->index = (UINT) mEntities.size();
+					instance->geoIndex = firstGeometry + node.mesh;
+					instance->geo = mGeometries[instance->geoIndex].get();
+					instance->indexCount = instance->geo->DrawArgs["0"].IndexCount;
+					instance->bounds = instance->geo->DrawArgs["0"].bounds;
+
+					entity = instance.get();
+					mEntityLayer[(int) instance->layer].push_back(entity);
+					mEntities.push_back(std::move(instance));
+				}
 
-			geom->VertexByteStride = sizeof(Vertex);
-			geom->VertexBufferByteSize = vbByteSize;
-			geom->IndexFormat = DXGI_FORMAT_R32_UINT;
-			geom->IndexBufferByteSize = ibByteSize;
-			geom->isWater = water;
+				ObjectCB inst;
+				inst.materialIndex = sceneData.meshMaterials[node.mesh] >= 0 ? (int) firstMaterial + sceneData.meshMaterials[node.mesh] : 0;
+				entity->instances.push_back(inst);
+				entity->instancesInfo.push_back({});
+				entity->instanceCount++;
+				entity->maxInstances = entity->instanceCount;
+				entity->setWorld(entity->instanceCount - 1, node.world);
 
-			SubmeshGeometry submesh;
-			submesh.IndexCount = (UINT) indices.size();
-			submesh.StartIndexLocation = 0;
-			submesh.BaseVertexLocation = 0;
-			XMStoreFloat3(&submesh.bounds.Center, 0.5F * (vMin + vMax));
-			XMStoreFloat3(&submesh.bounds.Extents, 0.5F * (vMax - vMin));
+				flattenedBytes += meshBytes[node.mesh];
+			}
+			timer.tick();
+			float instanceMs = timer.deltaTime() * 1000.0F;
 
-			geom->DrawArgs["0"] = submesh;
-			mGeometries.push_back(std::move(geom));
+			Logger::INFO.log(std::string(reload ? "Reimported \"" : "Imported \"") + name + "\": " + std::to_string(sceneData.meshes.size()) + " meshes, " +
+							 std::to_string(sceneData.materials.size()) + " materials, " + std::to_string(sceneData.instances.size()) + " instances, " +
+							 std::to_string(sharedBytes / 1024) + "KB of geometry (" + std::to_string(flattenedBytes / 1024) + "KB if flattened)");
+			Logger::INFO.log("Import timings: parse " + std::to_string(parseMs) + "ms, geometry " + std::to_string(uploadMs) + "ms, instances " + std::to_string(instanceMs) + "ms");
 		}
 	}
 
@@ -1240,12 +886,37 @@ namespace RT
 					}
 				}
 
+				if(instance->geoIndex >= 0 && !instance->geo)
+				{
+					Logger::ERR.log("Skipping entity " + std::to_string(instance->index) + ", its geometry " + std::to_string(instance->geoIndex) + " wasn't loaded");
+					continue;
+				}
+
 				mEntityLayer[(int) instance->layer].push_back(instance.get());
 				mEntities.push_back(std::move(instance));
 			}
 		}
 	}
 
+	void Scene::animate(float dt)
+	{
+		mAnimationTime += dt;
+	}
+
+	void Scene::updateSkinnedGeometries()
+	{
+		for(auto& s:mSkinnedGeometries)
+		{
+			MeshGeometry* geo = mGeometries[s.geoIndex].get();
+			Skinning::evaluate(*s.skeleton, s.clip, mAnimationTime, s.palette);
+
+			//the CPU copy stays current for the CPU ray queries, GpuScene uploads it afterwards
+			Vertex* skinned = reinterpret_cast<Vertex*>(geo->VertexBufferCPU.data());
+			Skinning::skin(s.bindPose, s.bones, s.palette, skinned);
+			geo->needsRefit = true;
+		}
+	}
+
 	void Scene::reloadMaterials()
 	{
 		for(int i = 0; i < mMaterials.size(); ++i)
@@ -1266,42 +937,4 @@ namespace RT
 		for(auto& c:mCameras)
 			c->setLens(0.25F * XM_PI, static_cast<float>(settings->width) / settings->height, 0.1F, 1000.0F);
 	}
-
-	void Scene::evictTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap)
-	{
-		std::vector<ID3D12Pageable*> res;
-		if(textures && mTextureArray)
-			res.push_back(mTextureArray.Get());
-		if(nmaps && mNMapArray)
-			res.push_back(mNMapArray.Get());
-		if(rmaps && mRMapArray)
-			res.push_back(mRMapArray.Get());
-		if(hmap && mHMapArray)
-			res.push_back(mHMapArray.Get());
-		if(aomap && mAOMapArray)
-			res.push_back(mAOMapArray.Get());
-		if(mmap && mMMapArray)
-			res.push_back(mMMapArray.Get());
-		if(res.size() > 0)
-			device->Evict((UINT) res.size(), res.data());
-	}
-
-	void Scene::makeResidentTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap)
-	{
-		std::vector<ID3D12Pageable*> res;
-		if(textures && mTextureArray)
-			res.push_back(mTextureArray.Get());
-		if(nmaps && mNMapArray)
-			res.push_back(mNMapArray.Get());
-		if(rmaps && mRMapArray)
-			res.push_back(mRMapArray.Get());
-		if(hmap && mHMapArray)
-			res.push_back(mHMapArray.Get());
-		if(aomap && mAOMapArray)
-			res.push_back(mAOMapArray.Get());
-		if(mmap && mMMapArray)
-			res.push_back(mMMapArray.Get());
-		if(res.size() > 0)
-			device->MakeResident((UINT) res.size(), res.data());
-	}
 }
\ No newline at end of file
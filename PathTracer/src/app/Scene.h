@@ -1,27 +1,20 @@
 #pragma once
 
 #include "Entity.h"
-#include "../utils/header.h"
+#include "../utils/core.h"
 #include "../rendering/Camera.h"
-
-#define TEXTURE_OFFSET		0
-#define NORMAL_OFFSET		1
-#define ROUGHNESS_OFFSET	2
-#define HEIGHT_OFFSET		3
-#define AO_OFFSET			4
-#define EMISSIVE_OFFSET		5
-#define METALLIC_OFFSET		6
-#define CUBEMAP_OFFSET		7
-#define RESERVED_SPACE		8
-#define MAX_ADD_RES			25
+#include "../rendering/EmissiveTriangles.h"
+#include "../rendering/EnvironmentMap.h"
+#include "../utils/Skinning.h"
 
 namespace RT
 {
 	class Scene
 	{
 	public:
-		Scene(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, settings_struct* settings, const std::string& fileName);
-		~Scene();
+		//everything the CPU side needs, GpuScene uploads it afterwards
+		Scene(settings_struct* settings, const std::string& fileName);
+		virtual ~Scene();
 		inline Scene(const Scene&) = delete;
 		inline Scene& operator=(const Scene&) = delete;
 
@@ -58,19 +51,25 @@ namespace RT
 		}
 
 		inline Light* getLightPtr(UINT index) { return &mLights[index]; }
-
-		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getLastCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), RESERVED_SPACE + index, mCbvSrvUavDescriptorSize); }
-		inline CD3DX12_GPU_DESCRIPTOR_HANDLE getLastGPUHeapAddress(UINT index = 0) { return CD3DX12_GPU_DESCRIPTOR_HANDLE(mHeap->GetGPUDescriptorHandleForHeapStart(), RESERVED_SPACE + index, mCbvSrvUavDescriptorSize); }
-
-		inline ID3D12DescriptorHeap* getDescriptorHeap() const { return mHeap.Get(); }
+		inline const EmissiveTriangles& getEmissiveTriangles() const { return mEmissive; }
+		inline const EnvironmentMap& getEnvironmentMap() const { return mEnvironment; }
+
+		//map names in the index order of ObjectCB, for backends that load the maps themselves
+		inline const std::vector<std::string>& getTextureNames() const { return textures; }
+		inline const std::vector<std::string>& getNormalMapNames() const { return nmaps; }
+		inline const std::vector<std::string>& getRoughnessMapNames() const { return rmaps; }
+		inline const std::vector<std::string>& getAOMapNames() const { return aomaps; }
+		inline const std::vector<std::string>& getEmissiveMapNames() const { return emimaps; }
+		inline const std::vector<std::string>& getMetallicMapNames() const { return mmaps; }
+		inline const std::string& getCubemapName() const { return cubemap; }
 
 		inline std::vector<std::unique_ptr<Material>>& getMaterials() { return mMaterials; }
 
+		void animate(float dt);
+		virtual void updateSkinnedGeometries();
+
 		void reloadMaterials();
 		void reloadInstances();
-
-		void evictTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap);
-		void makeResidentTextures(ID3D12Device* device, bool textures, bool nmaps, bool rmaps, bool hmap, bool aomap, bool mmap);
 	protected:
 		std::vector<std::string> materials;
 		std::vector<std::string> textures;
@@ -82,6 +81,7 @@ namespace RT
 		std::vector<std::string> mmaps;
 		std::vector<std::string> impostors;
 		std::vector<std::string> geometries;
+		std::vector<std::string> imports;
 		std::string cubemap = "";
 
 		UINT mLightCount = 0;
@@ -93,55 +93,46 @@ namespace RT
 		UINT mCameraCount = 0;
 		std::vector<std::unique_ptr<Camera>> mCameras;
 
-		void init(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& fileName, bool reload = false);
+		void init(const std::string& fileName, bool reload = false);
+
+		std::vector<std::unique_ptr<Material>> mMaterials;
+		std::vector<std::unique_ptr<MeshGeometry>> mGeometries;
+
+		//importance sampling tables of the cubemap
+		EnvironmentMap mEnvironment;
 
-		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getTextureCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), index, mCbvSrvUavDescriptorSize); }
-		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getNMapCPUHeapAddress(UINT index = 0) { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 1 + index, mCbvSrvUavDescriptorSize); }
-		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getRMapCPUHeapAddress() { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 2, mCbvSrvUavDescriptorSize); }
-		inline CD3DX12_CPU_DESCRIPTOR_HANDLE getCubemapCPUHeapAddress() { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mHeap->GetCPUDescriptorHandleForHeapStart(), 3, mCbvSrvUavDescriptorSize); }
+		settings_struct* settings;
+		std::string fileName;
 	private:
 		void loadMaterials(const std::vector<std::string>& materials, bool reload = false);
-		void buildDescriptorHeap(ID3D12Device* device);
-		void loadTextures(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& textures, bool reload = false);
-		void loadNormalMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& nmaps, bool reload = false);
-		void loadRoughnessMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& rmaps, bool reload = false);
-		void loadHeightMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& hmaps, bool reload = false);
-		void loadAOMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& aomaps, bool reload = false);
-		void loadEmissiveMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& emimaps, bool reload = false);
-		void loadMetallicMaps(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& mmaps, bool reload = false);
-		void loadCubemap(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::string& cubemap, bool reload = false);
-		void loadGeometries(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const std::vector<std::string>& geometries);
+		void loadEnvironment(const std::string& cubemap);
+		void loadGeometries(const std::vector<std::string>& geometries);
+		void loadImports(const std::vector<std::string>& imports, bool reload = false);
+		UINT64 addGeometry(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<UINT32>& indices32, bool water = false);
+		UINT64 addGeometry(const std::string& name, const std::vector<Vertex>& vertices, const std::vector<UINT32>& indices32, const DirectX::BoundingBox& bounds, bool water = false);
 		void loadCameras(std::ifstream& file);
 		void loadLights(std::ifstream& file);
 		void loadInstances(std::ifstream& file);
+		void buildEmissiveLights();
 
-		Microsoft::WRL::ComPtr<ID3D12Resource> mTextureArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mNMapArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mRMapArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mHMapArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mAOMapArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mMMapArray = nullptr;
-		Microsoft::WRL::ComPtr<ID3D12Resource> mEmissiveMapArray = nullptr;
-
-		std::vector<std::unique_ptr<Material>> mMaterials;
-		std::vector<std::unique_ptr<Texture>> mTextures;
-		std::vector<std::unique_ptr<Texture>> mNMaps;
-		std::vector<std::unique_ptr<Texture>> mRMaps;
-		std::vector<std::unique_ptr<Texture>> mHMaps;
-		std::vector<std::unique_ptr<Texture>> mAOMaps;
-		std::vector<std::unique_ptr<Texture>> mMMaps;
-		std::vector<std::unique_ptr<Texture>> mEmissiveMaps;
-		std::vector<std::unique_ptr<MeshGeometry>> mGeometries;
-		std::unique_ptr<Texture> mCubemap = nullptr;
+		struct SkinnedGeometry
+		{
+			UINT geoIndex = 0;
+			std::vector<Vertex> bindPose;
+			std::vector<BoneWeights> bones;
+			std::shared_ptr<Skeleton> skeleton = nullptr;
+			std::vector<DirectX::XMFLOAT4X4> palette;
+			UINT clip = 0;
+		};
+
+		std::vector<SkinnedGeometry> mSkinnedGeometries;
+		UINT mFirstImportedEntity = 0; //imports come after the entities of the scene file
+		EmissiveTriangles mEmissive;
+		float mAnimationTime = 0.0F;
 
 		std::vector<std::unique_ptr<Entity>> mEntities;
 		std::list<Entity*> mEntityLayer[(int) RenderLayer::Count];
 
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
 		UINT id = 0;
-
-		UINT mCbvSrvUavDescriptorSize;
-		settings_struct* settings;
-		std::string fileName;
 	};
 }
\ No newline at end of file
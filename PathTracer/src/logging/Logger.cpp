@@ -1,5 +1,12 @@
 #include "Logger.h"
 
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include <cstdlib>
 #include <ctime>
 
 namespace RT
@@ -8,6 +15,7 @@ namespace RT
 
 	void Logger::setup()
 	{
+#ifdef _WIN32
 		INFO.setup(GetStdHandle(STD_OUTPUT_HANDLE));
 		WARN.setup(GetStdHandle(STD_OUTPUT_HANDLE));
 		ERR.setup(GetStdHandle(STD_OUTPUT_HANDLE));
@@ -16,6 +24,41 @@ namespace RT
 		errno_t err = freopen_s(&stream, "CONOUT$", "w", stdout);
 		if(err != 0)
 			::OutputDebugString(L"Error reassigning stdout to custom console window");
+#else
+		//colors only when a terminal reads them
+		void* console = isatty(fileno(stdout)) ? stdout : nullptr;
+		INFO.setup(console);
+		WARN.setup(console);
+		ERR.setup(console);
+		DEBUG.setup(console);
+		stream = stdout;
+#endif
+	}
+
+	//console attributes, 7 is the default
+	void Log::setColor(int color)
+	{
+#ifdef _WIN32
+		SetConsoleTextAttribute(consoleHandle, (WORD) color);
+#else
+		if(!consoleHandle)
+			return;
+		switch(color)
+		{
+		case 14:
+			printf("\033[93m");
+			break;
+		case 12:
+			printf("\033[91m");
+			break;
+		case 3:
+			printf("\033[36m");
+			break;
+		default:
+			printf("\033[0m");
+			break;
+		}
+#endif
 	}
 
 	void Log::log(std::string string, bool breakLine, bool additionalInfo)
@@ -29,33 +72,33 @@ namespace RT
 			output = "[INFO]    ";
 			break;
 		case WARN:
-			SetConsoleTextAttribute(consoleHandle, 14);
+			setColor(14);
 			output = "[WARNING] ";
 			break;
 		case ERR:
-			SetConsoleTextAttribute(consoleHandle, 12);
+			setColor(12);
 			output = "[ERROR]   ";
 			break;
 		case DEBUG:
-			SetConsoleTextAttribute(consoleHandle, 3);
+			setColor(3);
 			output = "[DEBUG]   ";
 			break;
 		}
 
 		if(additionalInfo)
-			printf((output + getTime() + string + end).c_str());
+			printf("%s", (output + getTime() + string + end).c_str());
 		else
-			printf((string + end).c_str());
+			printf("%s", (string + end).c_str());
 
-		SetConsoleTextAttribute(consoleHandle, 7);
+		setColor(7);
 	}
 
 	void Log::log(std::wstring string, bool breakLine, bool additionalInfo)
 	{
 		std::string str;
-		size_t size;
-		str.resize(string.length());
-		wcstombs_s(&size, &str[0], str.size() + 1, string.c_str(), string.size());
+		str.resize(string.length() * MB_CUR_MAX);
+		size_t size = std::wcstombs(&str[0], string.c_str(), str.size());
+		str.resize(size == (size_t) -1 ? 0 : size);
 
 		Log::log(str, breakLine, additionalInfo);
 	}
@@ -72,7 +115,11 @@ namespace RT
 		char buffer[30];
 
 		std::time(&rawTime);
+#ifdef _WIN32
 		localtime_s(&timeInfo, &rawTime);
+#else
+		localtime_r(&rawTime, &timeInfo);
+#endif
 		std::strftime(buffer, 30, "%d/%m/%Y (%H:%M:%S)", &timeInfo);
 
 		return "[" + std::string(buffer) + "] ";
@@ -1,9 +1,7 @@
 #pragma once
 
-#include <Windows.h>
 #include <string>
-
-#include "../utils/header.h"
+#include <cstdio>
 
 namespace RT
 {
@@ -27,13 +25,14 @@ namespace RT
 		void log(float value, bool breakLine = true, bool additionalInfo = true);
 	protected:
 		LoggingSeverity severity;
-		HANDLE consoleHandle = 0;
+		void* consoleHandle = nullptr; //console HANDLE on windows, ANSI colors everywhere else
 
 		inline Log(LoggingSeverity sev): severity(sev) {}
 
-		inline void setup(HANDLE handle) { consoleHandle = handle; }
+		inline void setup(void* handle) { consoleHandle = handle; }
 
 		std::string getTime();
+		void setColor(int color);
 	};
 
 	class Logger
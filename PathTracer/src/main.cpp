@@ -4,6 +4,8 @@
 
 #include "app/Window.h"
 
+#include "app/Headless.h"
+
 using namespace RT;
 
 class App: public Window
@@ -36,6 +38,10 @@ public:
 			mRenderer->toggleFullscreen();
 		if(keyboard.isKeyPressed(KEY_1))
 			settings.vSync = !settings.vSync;
+		if(keyboard.isKeyPressed(KEY_2))
+			settings.progressive = !settings.progressive;
+		if(keyboard.isKeyPressed(KEY_3))
+			settings.lightSampling = (LightSampling) ((settings.lightSampling + 1) % (LIGHT_SAMPLING_CLUSTERED + 1));
 
 		if(keyboard.isKeyPressed(VK_ESCAPE))
 		{
@@ -78,6 +84,18 @@ int CALLBACK WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE prevInstance,
 
 	try
 	{
+		std::vector<std::string> args;
+		std::istringstream cmd(cmdLine);
+		for(std::string arg; cmd >> arg;)
+			args.push_back(arg);
+
+		if(isHeadless(args))
+		{
+			result = runHeadless(args);
+			FreeConsole();
+			return result;
+		}
+
 		App app(hInstance);
 
 		//** Set application settings here **
@@ -0,0 +1,26 @@
+#include "app/Headless.h"
+
+using namespace RT;
+
+//console entry point of the portable build, the windows build reaches the same commands through WinMain
+int main(int argc, char** argv)
+{
+	Logger::setup();
+
+	std::vector<std::string> args(argv + 1, argv + argc);
+	if(!isHeadless(args))
+	{
+		Logger::ERR.log("Usage: -cpu <scene> [spp] [output] [width] [height] | -blue-noise [size] [slices] [channels] [output]");
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		return runHeadless(args);
+	}
+	catch(std::exception& e)
+	{
+		Logger::ERR.log(std::string(e.what()));
+		return EXIT_FAILURE;
+	}
+}
\ No newline at end of file
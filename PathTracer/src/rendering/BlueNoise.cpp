@@ -0,0 +1,430 @@
+#include "BlueNoise.h"
+#include "Sampling.h"
+
+#include "../utils/Timer.h"
+
+#include <algorithm>
+#include <complex>
+#include <filesystem>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//energies of a toroidal size x size x slices volume, with the lowest energy among the free texels and the highest among
+	//the placed ones kept per tile and in two segment trees over the tiles, so a splat only rescans the tiles it touched
+	class EnergyField
+	{
+	public:
+		EnergyField(UINT32 size, UINT32 slices): mSize(size), mSlices(slices)
+		{
+			mRadius = std::min<UINT32>((UINT32) ceilf(3.0F * BLUE_NOISE_SIGMA), (size - 1) / 2);
+			mTemporalRadius = std::min<UINT32>((UINT32) ceilf(3.0F * BLUE_NOISE_SIGMA), (slices - 1) / 2);
+			for(int dy = -(int) mRadius; dy <= (int) mRadius; ++dy)
+				for(int dx = -(int) mRadius; dx <= (int) mRadius; ++dx)
+					mSpatial.push_back(expf(-(dx * dx + dy * dy) / (2.0F * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA)));
+			for(int dt = 0; dt <= (int) mTemporalRadius; ++dt)
+				mTemporal.push_back(expf(-(dt * dt) / (2.0F * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA)));
+
+			mTiles = (size + BLUE_NOISE_TILE - 1) / BLUE_NOISE_TILE;
+			UINT32 tileCount = mTiles * mTiles * slices;
+			mLeaves = 1;
+			while(mLeaves < tileCount)
+				mLeaves *= 2;
+
+			size_t count = (size_t) size * size * slices;
+			mEnergy.assign(count, 0.0F);
+			mPlaced.assign(count, 0);
+			mFree.assign((size_t) mLeaves * 2, { FLT_MAX, UINT32_MAX });
+			mTaken.assign((size_t) mLeaves * 2, { -FLT_MAX, UINT32_MAX });
+			mTouched.assign(tileCount, 0);
+		}
+
+		inline bool isPlaced(UINT32 index) const { return mPlaced[index] != 0; }
+		inline UINT32 lowestFree() const { return mFree[1].second; }
+		inline UINT32 highestTaken() const { return mTaken[1].second; }
+
+		void place(UINT32 index, bool placed)
+		{
+			mPlaced[index] = placed;
+			splat(index, placed ? 1.0F : -1.0F);
+		}
+
+		//energies are splatted without the trees, which are then built once
+		void placeAll(const std::vector<UINT32>& indices)
+		{
+			for(UINT32 i:indices)
+			{
+				mPlaced[i] = 1;
+				splat(i, 1.0F, false);
+			}
+			for(UINT32 t = 0; t < mTiles * mTiles * mSlices; ++t)
+				rescan(t, false);
+			for(UINT32 n = mLeaves - 1; n > 0; --n)
+				pull(n);
+		}
+
+		inline const std::vector<float>& getEnergy() const { return mEnergy; }
+		inline const std::vector<BYTE>& getPlaced() const { return mPlaced; }
+		void restore(const std::vector<float>& energy, const std::vector<BYTE>& placed)
+		{
+			mEnergy = energy;
+			mPlaced = placed;
+			for(UINT32 t = 0; t < mTiles * mTiles * mSlices; ++t)
+				rescan(t, false);
+			for(UINT32 n = mLeaves - 1; n > 0; --n)
+				pull(n);
+		}
+	private:
+		using Entry = std::pair<float, UINT32>;
+
+		inline UINT32 tileOf(UINT32 x, UINT32 y, UINT32 t) const { return (t * mTiles + y / BLUE_NOISE_TILE) * mTiles + x / BLUE_NOISE_TILE; }
+
+		void splat(UINT32 index, float sign, bool update = true)
+		{
+			UINT32 x = index % mSize;
+			UINT32 y = (index / mSize) % mSize;
+			UINT32 t = index / (mSize * mSize);
+			mStamp++;
+			std::vector<UINT32> tiles;
+			auto touch = [&](UINT32 tile)
+			{
+				if(update && mTouched[tile] != mStamp)
+				{
+					mTouched[tile] = mStamp;
+					tiles.push_back(tile);
+				}
+			};
+
+			//the slice around the texel
+			const float* w = mSpatial.data();
+			for(int dy = -(int) mRadius; dy <= (int) mRadius; ++dy)
+			{
+				UINT32 sy = (y + mSize + dy) % mSize;
+				float* row = &mEnergy[((size_t) t * mSize + sy) * mSize];
+				for(int dx = -(int) mRadius; dx <= (int) mRadius; ++dx)
+					row[(x + mSize + dx) % mSize] += sign * *w++;
+				touch(tileOf((x + mSize - mRadius) % mSize, sy, t));
+				touch(tileOf(x, sy, t));
+				touch(tileOf((x + mRadius) % mSize, sy, t));
+			}
+
+			//the same pixel in the other slices, the texel itself is already counted
+			for(int dt = -(int) mTemporalRadius; dt <= (int) mTemporalRadius; ++dt)
+			{
+				if(dt == 0)
+					continue;
+				UINT32 st = (t + mSlices + dt) % mSlices;
+				mEnergy[((size_t) st * mSize + y) * mSize + x] += sign * mTemporal[abs(dt)];
+				touch(tileOf(x, y, st));
+			}
+
+			for(UINT32 tile:tiles)
+				rescan(tile, true);
+		}
+
+		void rescan(UINT32 tile, bool update)
+		{
+			UINT32 tx = tile % mTiles;
+			UINT32 ty = (tile / mTiles) % mTiles;
+			UINT32 t = tile / (mTiles * mTiles);
+
+			Entry lowest = { FLT_MAX, UINT32_MAX };
+			Entry highest = { -FLT_MAX, UINT32_MAX };
+			for(UINT32 y = ty * BLUE_NOISE_TILE; y < std::min<UINT32>((ty + 1) * BLUE_NOISE_TILE, mSize); ++y)
+			{
+				for(UINT32 x = tx * BLUE_NOISE_TILE; x < std::min<UINT32>((tx + 1) * BLUE_NOISE_TILE, mSize); ++x)
+				{
+					UINT32 i = (t * mSize + y) * mSize + x;
+					if(mPlaced[i] && mEnergy[i] > highest.first)
+						highest = { mEnergy[i], i };
+					else if(!mPlaced[i] && mEnergy[i] < lowest.first)
+						lowest = { mEnergy[i], i };
+				}
+			}
+
+			UINT32 n = mLeaves + tile;
+			mFree[n] = lowest;
+			mTaken[n] = highest;
+			if(update)
+				for(n /= 2; n > 0; n /= 2)
+					pull(n);
+		}
+
+		inline void pull(UINT32 n)
+		{
+			mFree[n] = mFree[2 * n].first <= mFree[2 * n + 1].first ? mFree[2 * n] : mFree[2 * n + 1];
+			mTaken[n] = mTaken[2 * n].first >= mTaken[2 * n + 1].first ? mTaken[2 * n] : mTaken[2 * n + 1];
+		}
+
+		UINT32 mSize;
+		UINT32 mSlices;
+		UINT32 mRadius = 0;
+		UINT32 mTemporalRadius = 0;
+		UINT32 mTiles = 0;
+		UINT32 mLeaves = 0;
+		UINT32 mStamp = 0;
+		std::vector<float> mSpatial;
+		std::vector<float> mTemporal;
+		std::vector<float> mEnergy;
+		std::vector<BYTE> mPlaced;
+		std::vector<Entry> mFree;
+		std::vector<Entry> mTaken;
+		std::vector<UINT32> mTouched;
+	};
+
+	std::vector<UINT32> BlueNoise::generate(UINT32 size, UINT32 slices, UINT32 seed)
+	{
+		UINT32 count = size * size * slices;
+		std::vector<UINT32> ranks(count, 0);
+		EnergyField field(size, slices);
+
+		//random initial pattern of a tenth of the texels
+		UINT32 initial = std::max<UINT32>(count / 10, 1);
+		seed = initRand(seed, count);
+		std::vector<UINT32> order(count);
+		for(UINT32 i = 0; i < count; ++i)
+			order[i] = i;
+		for(UINT32 i = 0; i < initial; ++i)
+			std::swap(order[i], order[i + std::min<UINT32>((UINT32) (nextRand(seed) * (count - i)), count - i - 1)]);
+		order.resize(initial);
+		field.placeAll(order);
+
+		//relaxed by moving the tightest cluster into the largest void until it goes back where it was
+		for(UINT32 i = 0; i < count; ++i)
+		{
+			UINT32 cluster = field.highestTaken();
+			field.place(cluster, false);
+			UINT32 gap = field.lowestFree();
+			field.place(gap, true);
+			if(gap == cluster)
+				break;
+		}
+		std::vector<float> energy = field.getEnergy();
+		std::vector<BYTE> placed = field.getPlaced();
+
+		//phase 1, the initial texels are taken out tightest cluster first
+		for(UINT32 rank = initial; rank > 0; --rank)
+		{
+			UINT32 cluster = field.highestTaken();
+			ranks[cluster] = rank - 1;
+			field.place(cluster, false);
+		}
+
+		//phases 2 and 3, the rest fill the largest void. The tightest cluster of free texels is the same texel, the energies of
+		//the placed and of the free texels add up to the same value everywhere
+		field.restore(energy, placed);
+		for(UINT32 rank = initial; rank < count; ++rank)
+		{
+			UINT32 gap = field.lowestFree();
+			ranks[gap] = rank;
+			field.place(gap, true);
+		}
+		return ranks;
+	}
+
+	bool BlueNoise::generateTexture(const std::wstring& fileName, UINT32 size, UINT32 slices, UINT32 channels)
+	{
+		channels = std::clamp<UINT32>(channels, 1, 4);
+		UINT32 count = size * size * slices;
+
+		Timer timer;
+		timer.reset();
+		std::vector<std::vector<UINT32>> ranks(channels);
+		parallelFor(UINT32(0), channels, [&](UINT32 c)
+		{
+			ranks[c] = generate(size, slices, 0x9E3779B9u * (c + 1));
+		});
+		timer.tick();
+		Logger::INFO.log("Generated " + std::to_string(channels) + " blue noise channels of " + std::to_string(size) + "^2 x " + std::to_string(slices) + " in " + std::to_string(timer.deltaTime()) + "s");
+
+		//the spectrum of every channel, a ratio of -1 means the size isn't a power of two
+		for(UINT32 c = 0; c < channels; ++c)
+		{
+			std::vector<float> values(count);
+			for(UINT32 i = 0; i < count; ++i)
+				values[i] = (ranks[c][i] + 0.5F) / count;
+			Logger::INFO.log("Blue noise channel " + std::to_string(c) + ": spatial low over high frequency power " + std::to_string(spatialLowFrequencyRatio(values, size, slices)) +
+							 ", temporal " + std::to_string(temporalLowFrequencyRatio(values, size, slices)));
+		}
+
+		std::filesystem::path path(fileName);
+		std::error_code ec;
+		if(path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path(), ec);
+
+		std::ofstream file(path, std::ios::binary);
+		if(!file.is_open())
+		{
+			Logger::WARN.log("Couldn't write blue noise " + path.string());
+			return false;
+		}
+
+		//DDS_HEADER with a DX10 extension, the words are indexed from the magic
+		UINT32 header[37] = {};
+		header[0] = 0x20534444; //"DDS "
+		header[1] = 124;
+		header[2] = 0x1 | 0x2 | 0x4 | 0x1000; //caps, height, width, pixel format
+		header[3] = size;
+		header[4] = size;
+		header[5] = size * 4;
+		header[7] = 1;
+		header[19] = 32;
+		header[20] = 0x4; //DDPF_FOURCC
+		header[21] = 0x30315844; //"DX10"
+		header[27] = 0x1000;
+		header[32] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		header[33] = 3; //D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		header[35] = slices;
+		file.write((const char*) header, sizeof(header));
+
+		//ranks spread evenly over the 256 values, unused channels stay at 0
+		std::vector<BYTE> texels((size_t) count * 4, 0);
+		for(UINT32 c = 0; c < channels; ++c)
+			for(UINT32 i = 0; i < count; ++i)
+				texels[(size_t) i * 4 + c] = (BYTE) (((UINT64) ranks[c][i] * 256) / count);
+		file.write((const char*) texels.data(), texels.size());
+		return true;
+	}
+
+	static void fft(std::vector<std::complex<double>>& data)
+	{
+		size_t n = data.size();
+		for(size_t i = 1, j = 0; i < n; ++i)
+		{
+			size_t bit = n >> 1;
+			for(; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if(i < j)
+				std::swap(data[i], data[j]);
+		}
+		for(size_t length = 2; length <= n; length <<= 1)
+		{
+			std::complex<double> step = std::polar(1.0, -2.0 * XM_PI / length);
+			for(size_t i = 0; i < n; i += length)
+			{
+				std::complex<double> w = 1.0;
+				for(size_t k = 0; k < length / 2; ++k)
+				{
+					std::complex<double> a = data[i + k];
+					std::complex<double> b = data[i + k + length / 2] * w;
+					data[i + k] = a + b;
+					data[i + k + length / 2] = a - b;
+					w *= step;
+				}
+			}
+		}
+	}
+
+	static bool isPowerOfTwo(UINT32 x)
+	{
+		return x > 0 && (x & (x - 1)) == 0;
+	}
+
+	float BlueNoise::spatialLowFrequencyRatio(const std::vector<float>& values, UINT32 size, UINT32 slices)
+	{
+		if(!isPowerOfTwo(size))
+			return -1.0F;
+
+		//power spectrum of every slice, rows then columns in parallel
+		std::vector<double> power((size_t) size * size, 0.0);
+		for(UINT32 t = 0; t < slices; ++t)
+		{
+			const float* slice = &values[(size_t) t * size * size];
+			double mean = 0.0;
+			for(UINT32 i = 0; i < size * size; ++i)
+				mean += slice[i];
+			mean /= size * size;
+
+			std::vector<std::vector<std::complex<double>>> rows(size, std::vector<std::complex<double>>(size));
+			parallelFor(UINT32(0), size, [&](UINT32 y)
+			{
+				for(UINT32 x = 0; x < size; ++x)
+					rows[y][x] = slice[(size_t) y * size + x] - mean;
+				fft(rows[y]);
+			});
+			parallelFor(UINT32(0), size, [&](UINT32 x)
+			{
+				std::vector<std::complex<double>> column(size);
+				for(UINT32 y = 0; y < size; ++y)
+					column[y] = rows[y][x];
+				fft(column);
+				for(UINT32 y = 0; y < size; ++y)
+					power[(size_t) y * size + x] += std::norm(column[y]);
+			});
+		}
+
+		//below an eighth of the band against above a quarter
+		double low = 0.0, high = 0.0;
+		UINT32 lowCount = 0, highCount = 0;
+		for(UINT32 y = 0; y < size; ++y)
+		{
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				int fx = x < size / 2 ? (int) x : (int) x - (int) size;
+				int fy = y < size / 2 ? (int) y : (int) y - (int) size;
+				float r = sqrtf((float) (fx * fx + fy * fy));
+				if(r > 0.0F && r < size / 8.0F)
+				{
+					low += power[(size_t) y * size + x];
+					lowCount++;
+				}
+				else if(r > size / 4.0F)
+				{
+					high += power[(size_t) y * size + x];
+					highCount++;
+				}
+			}
+		}
+		return lowCount > 0 && high > 0.0 ? (float) ((low / lowCount) / (high / highCount)) : -1.0F;
+	}
+
+	float BlueNoise::temporalLowFrequencyRatio(const std::vector<float>& values, UINT32 size, UINT32 slices)
+	{
+		if(!isPowerOfTwo(slices) || slices < 8)
+			return -1.0F;
+
+		//power spectrum of every pixel over the slices
+		std::vector<double> power(slices, 0.0);
+		std::mutex lock;
+		parallelFor(UINT32(0), size, [&](UINT32 y)
+		{
+			std::vector<double> rowPower(slices, 0.0);
+			std::vector<std::complex<double>> sequence(slices);
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				double mean = 0.0;
+				for(UINT32 t = 0; t < slices; ++t)
+					mean += values[((size_t) t * size + y) * size + x];
+				mean /= slices;
+				for(UINT32 t = 0; t < slices; ++t)
+					sequence[t] = values[((size_t) t * size + y) * size + x] - mean;
+				fft(sequence);
+				for(UINT32 t = 0; t < slices; ++t)
+					rowPower[t] += std::norm(sequence[t]);
+			}
+			std::lock_guard<std::mutex> scoped(lock);
+			for(UINT32 t = 0; t < slices; ++t)
+				power[t] += rowPower[t];
+		});
+
+		double low = 0.0, high = 0.0;
+		UINT32 lowCount = 0, highCount = 0;
+		for(UINT32 t = 1; t < slices; ++t)
+		{
+			UINT32 f = std::min<UINT32>(t, slices - t);
+			if(f < slices / 8 || f == 1)
+			{
+				low += power[t];
+				lowCount++;
+			}
+			else if(f > slices / 4)
+			{
+				high += power[t];
+				highCount++;
+			}
+		}
+		return lowCount > 0 && high > 0.0 ? (float) ((low / lowCount) / (high / highCount)) : -1.0F;
+	}
+}
\ No newline at end of file
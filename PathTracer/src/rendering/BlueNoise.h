@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define BLUE_NOISE_SIGMA				1.9F //of both the spatial and the temporal Gaussian, as in spatiotemporal blue noise
+#define BLUE_NOISE_TILE					8 //texels per side of the tiles the energy minimum and maximum are kept for
+#define BLUE_NOISE_DIR					"res/noise/"
+
+namespace RT
+{
+	//void and cluster (Ulichney) over size x size x slices texels. The energy of a texel is a Gaussian of the texels placed in its slice
+	//plus one of the texels placed at the same pixel in the neighbouring slices, so every slice is blue and every pixel is blue over time
+	class BlueNoise
+	{
+	public:
+		//the order every texel was placed in, from 0 to size * size * slices - 1
+		static std::vector<UINT32> generate(UINT32 size, UINT32 slices, UINT32 seed);
+
+		//up to 4 channels ranked independently in parallel, written as an RGBA8 Texture2DArray with one slice per frame
+		static bool generateTexture(const std::wstring& fileName, UINT32 size, UINT32 slices, UINT32 channels);
+
+		//mean power of the low frequencies over the high ones, about 1 for white noise. Power of two sizes only
+		static float spatialLowFrequencyRatio(const std::vector<float>& values, UINT32 size, UINT32 slices);
+		static float temporalLowFrequencyRatio(const std::vector<float>& values, UINT32 size, UINT32 slices);
+	private:
+		BlueNoise() = default;
+	};
+}
\ No newline at end of file
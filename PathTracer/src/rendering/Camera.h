@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../utils/header.h"
+#include "../utils/core.h"
 
 namespace RT
 {
@@ -0,0 +1,264 @@
+#include "DDSTexture.h"
+
+#include <algorithm>
+#include <filesystem>
+
+using namespace DirectX;
+
+namespace RT
+{
+	static UINT32 readU32(const std::vector<BYTE>& data, size_t offset)
+	{
+		return offset + 4 <= data.size() ? *reinterpret_cast<const UINT32*>(&data[offset]) : 0;
+	}
+
+	static UINT32 fourCC(const char* code)
+	{
+		return (UINT32) code[0] | ((UINT32) code[1] << 8) | ((UINT32) code[2] << 16) | ((UINT32) code[3] << 24);
+	}
+
+	static UINT8 toByte(float c)
+	{
+		return (UINT8) (std::min<float>(std::max<float>(c, 0.0F), 1.0F) * 255.0F + 0.5F);
+	}
+
+	//color part of BC1, BC2 and BC3 blocks, the last two always use the 4 color palette
+	void DDSTexture::decodeColorBlock(const BYTE* block, XMFLOAT3* out, bool fourColors)
+	{
+		UINT16 c0 = block[0] | (block[1] << 8);
+		UINT16 c1 = block[2] | (block[3] << 8);
+		auto expand = [](UINT16 c) { return XMFLOAT3(((c >> 11) & 0x1F) / 31.0F, ((c >> 5) & 0x3F) / 63.0F, (c & 0x1F) / 31.0F); };
+
+		XMFLOAT3 palette[4] = { expand(c0), expand(c1) };
+		if(c0 > c1 || fourColors)
+		{
+			palette[2] = { (2.0F * palette[0].x + palette[1].x) / 3.0F, (2.0F * palette[0].y + palette[1].y) / 3.0F, (2.0F * palette[0].z + palette[1].z) / 3.0F };
+			palette[3] = { (palette[0].x + 2.0F * palette[1].x) / 3.0F, (palette[0].y + 2.0F * palette[1].y) / 3.0F, (palette[0].z + 2.0F * palette[1].z) / 3.0F };
+		}
+		else
+		{
+			palette[2] = { 0.5F * (palette[0].x + palette[1].x), 0.5F * (palette[0].y + palette[1].y), 0.5F * (palette[0].z + palette[1].z) };
+			palette[3] = { 0.0F, 0.0F, 0.0F };
+		}
+
+		UINT32 bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((UINT32) block[7] << 24);
+		for(int i = 0; i < 16; ++i)
+			out[i] = palette[(bits >> (2 * i)) & 0x3];
+	}
+
+	//one 4x4 block, 2 endpoints and 16 3 bit indices
+	void DDSTexture::decodeBC4(const BYTE* block, float* out)
+	{
+		float palette[8];
+		palette[0] = block[0] / 255.0F;
+		palette[1] = block[1] / 255.0F;
+		if(block[0] > block[1])
+		{
+			for(int i = 1; i < 7; ++i)
+				palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7.0F;
+		}
+		else
+		{
+			for(int i = 1; i < 5; ++i)
+				palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5.0F;
+			palette[6] = 0.0F;
+			palette[7] = 1.0F;
+		}
+
+		UINT64 bits = 0;
+		for(int i = 0; i < 6; ++i)
+			bits |= (UINT64) block[2 + i] << (8 * i);
+		for(int i = 0; i < 16; ++i)
+			out[i] = palette[(bits >> (3 * i)) & 0x7];
+	}
+
+	bool DDSTexture::load(const std::wstring& fileName, UINT32 maxSize)
+	{
+		std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+			return false;
+		std::vector<BYTE> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		if(data.size() < 128 || readU32(data, 0) != fourCC("DDS "))
+			return false;
+
+		UINT32 height = readU32(data, 12);
+		UINT32 width = readU32(data, 16);
+		UINT32 mips = std::max<UINT32>(readU32(data, 28), 1);
+		UINT32 code = readU32(data, 84);
+		UINT32 bitCount = readU32(data, 88);
+		UINT32 redMask = readU32(data, 92);
+		size_t offset = 128;
+
+		//sRGB variants are read as stored, the texture arrays on the GPU are UNORM as well
+		enum { FORMAT_UNKNOWN, FORMAT_BC1, FORMAT_BC2, FORMAT_BC3, FORMAT_BC4, FORMAT_BC5, FORMAT_R8, FORMAT_RGBA8, FORMAT_BGRA8 } format = FORMAT_UNKNOWN;
+		if(code == fourCC("DX10"))
+		{
+			UINT32 dxgi = readU32(data, 128);
+			offset += 20;
+			if(dxgi == DXGI_FORMAT_BC1_UNORM || dxgi == DXGI_FORMAT_BC1_UNORM_SRGB)
+				format = FORMAT_BC1;
+			else if(dxgi == DXGI_FORMAT_BC2_UNORM || dxgi == DXGI_FORMAT_BC2_UNORM_SRGB)
+				format = FORMAT_BC2;
+			else if(dxgi == DXGI_FORMAT_BC3_UNORM || dxgi == DXGI_FORMAT_BC3_UNORM_SRGB)
+				format = FORMAT_BC3;
+			else if(dxgi == DXGI_FORMAT_BC4_UNORM || dxgi == DXGI_FORMAT_BC4_TYPELESS)
+				format = FORMAT_BC4;
+			else if(dxgi == DXGI_FORMAT_BC5_UNORM || dxgi == DXGI_FORMAT_BC5_TYPELESS)
+				format = FORMAT_BC5;
+			else if(dxgi == DXGI_FORMAT_R8_UNORM || dxgi == DXGI_FORMAT_A8_UNORM)
+				format = FORMAT_R8;
+			else if(dxgi == DXGI_FORMAT_R8G8B8A8_UNORM || dxgi == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+				format = FORMAT_RGBA8;
+			else if(dxgi == DXGI_FORMAT_B8G8R8A8_UNORM || dxgi == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+				format = FORMAT_BGRA8;
+		}
+		else if(code == fourCC("DXT1"))
+			format = FORMAT_BC1;
+		else if(code == fourCC("DXT2") || code == fourCC("DXT3"))
+			format = FORMAT_BC2;
+		else if(code == fourCC("DXT4") || code == fourCC("DXT5"))
+			format = FORMAT_BC3;
+		else if(code == fourCC("BC4U") || code == fourCC("ATI1"))
+			format = FORMAT_BC4;
+		else if(code == fourCC("BC5U") || code == fourCC("ATI2"))
+			format = FORMAT_BC5;
+		else if(code == 0 && bitCount == 8)
+			format = FORMAT_R8;
+		else if(code == 0 && bitCount == 32)
+			format = redMask == 0x000000FF ? FORMAT_RGBA8 : FORMAT_BGRA8;
+
+		if(format == FORMAT_UNKNOWN || width == 0 || height == 0)
+			return false;
+
+		bool compressed = format <= FORMAT_BC5;
+		UINT32 blockBytes = format == FORMAT_BC1 || format == FORMAT_BC4 ? 8 : 16;
+		UINT32 texelBytes = format == FORMAT_R8 ? 1 : 4;
+		auto mipBytes = [&](UINT32 w, UINT32 h) { return compressed ? (size_t) ((w + 3) / 4) * ((h + 3) / 4) * blockBytes : (size_t) w * h * texelBytes; };
+
+		//skips the levels the GPU leaves out at lower texture resolutions
+		UINT32 level = 0;
+		while(level + 1 < mips && (width > maxSize || height > maxSize))
+		{
+			offset += mipBytes(width, height);
+			width = std::max<UINT32>(width / 2, 1);
+			height = std::max<UINT32>(height / 2, 1);
+			++level;
+		}
+		if(offset + mipBytes(width, height) > data.size())
+			return false;
+
+		mWidth = width;
+		mHeight = height;
+		mTexels.assign((size_t) width * height * 4, 0);
+		for(size_t i = 3; i < mTexels.size(); i += 4)
+			mTexels[i] = 255;
+
+		if(compressed)
+		{
+			UINT32 blocksX = (width + 3) / 4;
+			UINT32 blocksY = (height + 3) / 4;
+			parallelFor(UINT32(0), blocksY, [&](UINT32 by)
+			{
+				for(UINT32 bx = 0; bx < blocksX; ++bx)
+				{
+					const BYTE* b = &data[offset + ((size_t) by * blocksX + bx) * blockBytes];
+
+					//decoded into 16 RGBA texels, then copied into the image
+					UINT8 block[16][4] = {};
+					for(int i = 0; i < 16; ++i)
+						block[i][3] = 255;
+
+					if(format == FORMAT_BC4 || format == FORMAT_BC5)
+					{
+						float channel[16];
+						for(int c = 0; c < (format == FORMAT_BC5 ? 2 : 1); ++c)
+						{
+							decodeBC4(b + 8 * c, channel);
+							for(int i = 0; i < 16; ++i)
+								block[i][c] = toByte(channel[i]);
+						}
+					}
+					else
+					{
+						XMFLOAT3 color[16];
+						decodeColorBlock(format == FORMAT_BC1 ? b : b + 8, color, format != FORMAT_BC1);
+						for(int i = 0; i < 16; ++i)
+						{
+							block[i][0] = toByte(color[i].x);
+							block[i][1] = toByte(color[i].y);
+							block[i][2] = toByte(color[i].z);
+						}
+
+						if(format == FORMAT_BC2)
+						{
+							for(int i = 0; i < 16; ++i)
+								block[i][3] = (UINT8) (((b[i / 2] >> (4 * (i % 2))) & 0xF) * 17);
+						}
+						else if(format == FORMAT_BC3)
+						{
+							float alpha[16];
+							decodeBC4(b, alpha);
+							for(int i = 0; i < 16; ++i)
+								block[i][3] = toByte(alpha[i]);
+						}
+					}
+
+					for(UINT32 y = 0; y < 4 && by * 4 + y < height; ++y)
+						for(UINT32 x = 0; x < 4 && bx * 4 + x < width; ++x)
+							memcpy(&mTexels[((size_t) (by * 4 + y) * width + bx * 4 + x) * 4], block[y * 4 + x], 4);
+				}
+			});
+		}
+		else
+		{
+			for(size_t i = 0; i < (size_t) width * height; ++i)
+			{
+				const BYTE* t = &data[offset + i * texelBytes];
+				UINT8* texel = &mTexels[i * 4];
+				if(format == FORMAT_R8)
+					texel[0] = t[0];
+				else if(format == FORMAT_RGBA8)
+					memcpy(texel, t, 4);
+				else
+				{
+					texel[0] = t[2];
+					texel[1] = t[1];
+					texel[2] = t[0];
+					texel[3] = t[3];
+				}
+			}
+		}
+
+		return true;
+	}
+
+	XMVECTOR DDSTexture::sample(float u, float v) const
+	{
+		if(mWidth == 0)
+			return XMVectorSet(1.0F, 1.0F, 1.0F, 1.0F);
+
+		//texel centers at half integers, like the hardware
+		float x = u * mWidth - 0.5F;
+		float y = v * mHeight - 0.5F;
+		float x0 = floorf(x);
+		float y0 = floorf(y);
+		float fx = x - x0;
+		float fy = y - y0;
+
+		auto wrap = [](float c, UINT32 size) { INT64 i = (INT64) c % (INT64) size; return (UINT32) (i < 0 ? i + size : i); };
+		UINT32 xs[2] = { wrap(x0, mWidth), wrap(x0 + 1.0F, mWidth) };
+		UINT32 ys[2] = { wrap(y0, mHeight), wrap(y0 + 1.0F, mHeight) };
+
+		auto texel = [&](UINT32 tx, UINT32 ty)
+		{
+			const UINT8* t = &mTexels[((size_t) ty * mWidth + tx) * 4];
+			return XMVectorSet(t[0], t[1], t[2], t[3]);
+		};
+
+		XMVECTOR top = XMVectorLerp(texel(xs[0], ys[0]), texel(xs[1], ys[0]), fx);
+		XMVECTOR bottom = XMVectorLerp(texel(xs[0], ys[1]), texel(xs[1], ys[1]), fx);
+		return XMVectorLerp(top, bottom, fy) / 255.0F;
+	}
+}
\ No newline at end of file
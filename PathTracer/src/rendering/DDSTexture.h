@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../utils/core.h"
+
+namespace RT
+{
+	//2D DDS texture decoded to 8 bit RGBA, sampled like gBilinearWrap in the shaders
+	class DDSTexture
+	{
+	public:
+		DDSTexture() = default;
+		~DDSTexture() = default;
+
+		//BC1 to BC5 and the uncompressed 8 bit formats, starts at the first mip no larger than maxSize like the texture arrays on the GPU
+		bool load(const std::wstring& fileName, UINT32 maxSize = UINT32_MAX);
+
+		//uvs wrap, channels the format lacks read 0 and alpha 1
+		DirectX::XMVECTOR sample(float u, float v) const;
+
+		//4x4 blocks, BC3 and BC5 are made of these too
+		static void decodeColorBlock(const BYTE* block, DirectX::XMFLOAT3* out, bool fourColors);
+		static void decodeBC4(const BYTE* block, float* out);
+
+		inline bool isValid() const { return mWidth > 0; }
+		inline UINT32 getWidth() const { return mWidth; }
+		inline UINT32 getHeight() const { return mHeight; }
+	private:
+		std::vector<UINT8> mTexels; //RGBA, rows top to bottom
+		UINT32 mWidth = 0;
+		UINT32 mHeight = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,424 @@
+#include "EmissiveTriangles.h"
+
+#include "DDSTexture.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace RT
+{
+	static float luminance(const XMFLOAT3& c)
+	{
+		return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+	}
+
+	static UINT32 readU32(const std::vector<BYTE>& data, size_t offset)
+	{
+		return offset + 4 <= data.size() ? *reinterpret_cast<const UINT32*>(&data[offset]) : 0;
+	}
+
+	static UINT32 fourCC(const char* code)
+	{
+		return (UINT32) code[0] | ((UINT32) code[1] << 8) | ((UINT32) code[2] << 16) | ((UINT32) code[3] << 24);
+	}
+
+	bool EmissiveTriangles::loadMap(const std::wstring& fileName, EmissiveMap& map)
+	{
+		std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+			return false;
+		std::vector<BYTE> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		if(data.size() < 128 || readU32(data, 0) != fourCC("DDS "))
+			return false;
+
+		UINT32 height = readU32(data, 12);
+		UINT32 width = readU32(data, 16);
+		UINT32 code = readU32(data, 84);
+		UINT32 bitCount = readU32(data, 88);
+		size_t offset = 128;
+
+		//the formats emissive maps are saved with, only the first channel matters
+		enum { FORMAT_UNKNOWN, FORMAT_BC4, FORMAT_R8, FORMAT_RGBA8 } format = FORMAT_UNKNOWN;
+		if(code == fourCC("DX10"))
+		{
+			UINT32 dxgi = readU32(data, 128);
+			offset += 20;
+			if(dxgi == DXGI_FORMAT_BC4_UNORM || dxgi == DXGI_FORMAT_BC4_TYPELESS)
+				format = FORMAT_BC4;
+			else if(dxgi == DXGI_FORMAT_R8_UNORM || dxgi == DXGI_FORMAT_A8_UNORM)
+				format = FORMAT_R8;
+			else if(dxgi == DXGI_FORMAT_R8G8B8A8_UNORM || dxgi == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+				format = FORMAT_RGBA8;
+		}
+		else if(code == fourCC("BC4U") || code == fourCC("ATI1"))
+			format = FORMAT_BC4;
+		else if(code == 0 && bitCount == 8)
+			format = FORMAT_R8;
+		else if(code == 0 && bitCount == 32)
+			format = FORMAT_RGBA8;
+
+		if(format == FORMAT_UNKNOWN || width == 0 || height == 0)
+			return false;
+
+		std::vector<float> texels((size_t) width * height);
+		if(format == FORMAT_BC4)
+		{
+			UINT32 blocksX = (width + 3) / 4;
+			UINT32 blocksY = (height + 3) / 4;
+			if(offset + (size_t) blocksX * blocksY * 8 > data.size())
+				return false;
+
+			for(UINT32 by = 0; by < blocksY; ++by)
+			{
+				for(UINT32 bx = 0; bx < blocksX; ++bx)
+				{
+					float block[16];
+					DDSTexture::decodeBC4(&data[offset + ((size_t) by * blocksX + bx) * 8], block);
+					for(UINT32 y = 0; y < 4 && by * 4 + y < height; ++y)
+						for(UINT32 x = 0; x < 4 && bx * 4 + x < width; ++x)
+							texels[(size_t) (by * 4 + y) * width + bx * 4 + x] = block[y * 4 + x];
+				}
+			}
+		}
+		else
+		{
+			UINT32 stride = format == FORMAT_R8 ? 1 : 4;
+			if(offset + (size_t) width * height * stride > data.size())
+				return false;
+			for(size_t i = 0; i < texels.size(); ++i)
+				texels[i] = data[offset + i * stride] / 255.0F;
+		}
+
+		//mip 0 is far more detail than a flux estimate needs
+		while(width > EMISSIVE_MAP_MAX_SIZE || height > EMISSIVE_MAP_MAX_SIZE)
+		{
+			UINT32 w = std::max<UINT32>(width / 2, 1);
+			UINT32 h = std::max<UINT32>(height / 2, 1);
+			std::vector<float> half((size_t) w * h);
+			for(UINT32 y = 0; y < h; ++y)
+			{
+				for(UINT32 x = 0; x < w; ++x)
+				{
+					UINT32 x0 = std::min<UINT32>(2 * x, width - 1), x1 = std::min<UINT32>(2 * x + 1, width - 1);
+					UINT32 y0 = std::min<UINT32>(2 * y, height - 1), y1 = std::min<UINT32>(2 * y + 1, height - 1);
+					half[(size_t) y * w + x] = 0.25F * (texels[(size_t) y0 * width + x0] + texels[(size_t) y0 * width + x1] + texels[(size_t) y1 * width + x0] + texels[(size_t) y1 * width + x1]);
+				}
+			}
+			texels = std::move(half);
+			width = w;
+			height = h;
+		}
+
+		map.widths = { width };
+		map.heights = { height };
+		map.levels = { std::move(texels) };
+		buildLevels(map);
+		return true;
+	}
+
+	void EmissiveTriangles::buildLevels(EmissiveMap& map)
+	{
+		map.widths.resize(1);
+		map.heights.resize(1);
+		map.levels.resize(1);
+		while(map.widths.back() > 1 || map.heights.back() > 1)
+		{
+			UINT32 width = map.widths.back();
+			UINT32 height = map.heights.back();
+			UINT32 w = std::max<UINT32>(width / 2, 1);
+			UINT32 h = std::max<UINT32>(height / 2, 1);
+
+			const std::vector<float>& texels = map.levels.back();
+			std::vector<float> half((size_t) w * h);
+			for(UINT32 y = 0; y < h; ++y)
+			{
+				for(UINT32 x = 0; x < w; ++x)
+				{
+					UINT32 x0 = std::min<UINT32>(2 * x, width - 1), x1 = std::min<UINT32>(2 * x + 1, width - 1);
+					UINT32 y0 = std::min<UINT32>(2 * y, height - 1), y1 = std::min<UINT32>(2 * y + 1, height - 1);
+					half[(size_t) y * w + x] = 0.25F * (texels[(size_t) y0 * width + x0] + texels[(size_t) y0 * width + x1] + texels[(size_t) y1 * width + x0] + texels[(size_t) y1 * width + x1]);
+				}
+			}
+
+			map.widths.push_back(w);
+			map.heights.push_back(h);
+			map.levels.push_back(std::move(half));
+		}
+	}
+
+	//Sutherland-Hodgman against one side of an axis aligned line
+	static int clipPolygon(const XMFLOAT2* in, int count, XMFLOAT2* out, int axis, float bound, bool keepAbove)
+	{
+		int result = 0;
+		for(int i = 0; i < count; ++i)
+		{
+			const XMFLOAT2& a = in[i];
+			const XMFLOAT2& b = in[(i + 1) % count];
+			float da = (axis == 0 ? a.x : a.y) - bound;
+			float db = (axis == 0 ? b.x : b.y) - bound;
+			if(!keepAbove)
+			{
+				da = -da;
+				db = -db;
+			}
+
+			if(da >= 0.0F)
+				out[result++] = a;
+			if((da >= 0.0F) != (db >= 0.0F))
+			{
+				float t = da / (da - db);
+				out[result++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t };
+			}
+		}
+		return result;
+	}
+
+	static float polygonArea(const XMFLOAT2* p, int count)
+	{
+		float area = 0.0F;
+		for(int i = 0; i < count; ++i)
+		{
+			const XMFLOAT2& a = p[i];
+			const XMFLOAT2& b = p[(i + 1) % count];
+			area += a.x * b.y - b.x * a.y;
+		}
+		return 0.5F * fabsf(area);
+	}
+
+	float EmissiveTriangles::integrate(const EmissiveMap& map, const XMFLOAT2& uv0, const XMFLOAT2& uv1, const XMFLOAT2& uv2)
+	{
+		if(map.levels.empty())
+			return 1.0F;
+
+		float uMin = std::min<float>(std::min<float>(uv0.x, uv1.x), uv2.x);
+		float uMax = std::max<float>(std::max<float>(uv0.x, uv1.x), uv2.x);
+		float vMin = std::min<float>(std::min<float>(uv0.y, uv1.y), uv2.y);
+		float vMax = std::max<float>(std::max<float>(uv0.y, uv1.y), uv2.y);
+
+		//the finest level that keeps the footprint under EMISSIVE_MAX_TEXELS
+		size_t level = 0;
+		while(level + 1 < map.levels.size() && ((uMax - uMin) * map.widths[level] + 2.0F) * ((vMax - vMin) * map.heights[level] + 2.0F) > EMISSIVE_MAX_TEXELS)
+			level++;
+
+		const int width = (int) map.widths[level];
+		const int height = (int) map.heights[level];
+		const std::vector<float>& texels = map.levels[level];
+		auto texel = [&](int x, int y)
+		{
+			x = ((x % width) + width) % width;
+			y = ((y % height) + height) % height;
+			return texels[(size_t) y * width + x];
+		};
+
+		//texel space, where every texel is a unit square
+		XMFLOAT2 triangle[3] = { { uv0.x * width, uv0.y * height }, { uv1.x * width, uv1.y * height }, { uv2.x * width, uv2.y * height } };
+		if(polygonArea(triangle, 3) < 1e-6F)
+		{
+			float cx = (triangle[0].x + triangle[1].x + triangle[2].x) / 3.0F;
+			float cy = (triangle[0].y + triangle[1].y + triangle[2].y) / 3.0F;
+			return texel((int) floorf(cx), (int) floorf(cy));
+		}
+
+		int x0 = (int) floorf(uMin * width);
+		int x1 = (int) ceilf(uMax * width);
+		int y0 = (int) floorf(vMin * height);
+		int y1 = (int) ceilf(vMax * height);
+
+		double sum = 0.0;
+		double covered = 0.0;
+		for(int y = y0; y < y1; ++y)
+		{
+			for(int x = x0; x < x1; ++x)
+			{
+				XMFLOAT2 a[8], b[8];
+				int n = clipPolygon(triangle, 3, a, 0, (float) x, true);
+				n = clipPolygon(a, n, b, 0, (float) (x + 1), false);
+				n = clipPolygon(b, n, a, 1, (float) y, true);
+				n = clipPolygon(a, n, b, 1, (float) (y + 1), false);
+				if(n < 3)
+					continue;
+
+				float area = polygonArea(b, n);
+				sum += (double) area * texel(x, y);
+				covered += area;
+			}
+		}
+
+		return covered > 0.0 ? (float) (sum / covered) : 0.0F;
+	}
+
+	void EmissiveTriangles::add(const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, const XMFLOAT4X4& world, const XMFLOAT4X4& uvTransform,
+								const XMFLOAT3& emission, const EmissiveMap* map, UINT32 instance)
+	{
+		if(triangleCount == 0 || luminance(emission) <= 0.0F)
+			return;
+
+		size_t first = mTriangles.size();
+		mTriangles.resize(first + triangleCount);
+
+		//same uv transforms as hit.hlsl
+		parallelFor(UINT32(0), triangleCount, [&](UINT32 t)
+		{
+			XMMATRIX W = XMLoadFloat4x4(&world);
+			XMMATRIX T = XMLoadFloat4x4(&uvTransform);
+			EmissiveTriangle& tri = mTriangles[first + t];
+			tri.instance = instance;
+			tri.primitive = t;
+
+			XMVECTOR p[3];
+			XMFLOAT2 uv[3];
+			for(int i = 0; i < 3; ++i)
+			{
+				const Vertex& v = vertices[indices[3 * t + i]];
+				p[i] = XMVector3TransformCoord(XMLoadFloat3(&v.position), W);
+				XMStoreFloat2(&uv[i], XMVector4Transform(XMVectorSet(v.uvs.x, v.uvs.y, 0.0F, 1.0F), T));
+			}
+			XMStoreFloat3(&tri.p0, p[0]);
+			XMStoreFloat3(&tri.p1, p[1]);
+			XMStoreFloat3(&tri.p2, p[2]);
+
+			XMVECTOR cross = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+			tri.area = 0.5F * XMVectorGetX(XMVector3Length(cross));
+			XMStoreFloat3(&tri.normal, XMVector3Normalize(cross));
+
+			float mean = map ? integrate(*map, uv[0], uv[1], uv[2]) : 1.0F;
+			tri.radiance = { emission.x * mean, emission.y * mean, emission.z * mean };
+			tri.flux = XM_PI * tri.area * luminance(tri.radiance);
+		});
+
+		//normals point away from the emitter's center, so closed bulbs emit outwards whatever their winding
+		//flat emitters have their center on the surface and keep the front face
+		XMVECTOR center = XMVectorZero();
+		float totalArea = 0.0F;
+		float intensity = 0.0F;
+		for(size_t i = first; i < mTriangles.size(); ++i)
+		{
+			const EmissiveTriangle& tri = mTriangles[i];
+			center += (XMLoadFloat3(&tri.p0) + XMLoadFloat3(&tri.p1) + XMLoadFloat3(&tri.p2)) * (tri.area / 3.0F);
+			totalArea += tri.area;
+			intensity += tri.area * luminance(tri.radiance);
+		}
+		center /= std::max<float>(totalArea, 1e-20F);
+
+		//every triangle reaches as far as the whole emitter does
+		float range = sqrtf(intensity / EMISSIVE_MIN_IRRADIANCE);
+		for(size_t i = first; i < mTriangles.size(); ++i)
+		{
+			EmissiveTriangle& tri = mTriangles[i];
+			XMVECTOR centroid = (XMLoadFloat3(&tri.p0) + XMLoadFloat3(&tri.p1) + XMLoadFloat3(&tri.p2)) / 3.0F;
+			if(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&tri.normal), centroid - center)) < -1e-6F)
+				tri.normal = { -tri.normal.x, -tri.normal.y, -tri.normal.z };
+			tri.range = range;
+		}
+	}
+
+	void EmissiveTriangles::build()
+	{
+		//what barely emits is dropped, the rest gets a CDF and an alias table over its flux
+		float maxFlux = 0.0F;
+		for(auto& tri:mTriangles)
+			maxFlux = std::max<float>(maxFlux, tri.flux);
+		mTriangles.erase(std::remove_if(mTriangles.begin(), mTriangles.end(), [&](const EmissiveTriangle& tri) { return tri.flux <= maxFlux * EMISSIVE_FLUX_EPSILON; }), mTriangles.end());
+
+		mIndices.clear();
+		double total = 0.0;
+		for(size_t i = 0; i < mTriangles.size(); ++i)
+		{
+			mIndices[((UINT64) mTriangles[i].instance << 32) | mTriangles[i].primitive] = (UINT32) i;
+			total += mTriangles[i].flux;
+		}
+		mTotalFlux = (float) total;
+
+		mCdf.resize(mTriangles.size());
+		std::vector<float> weights(mTriangles.size());
+		double running = 0.0;
+		for(size_t i = 0; i < mTriangles.size(); ++i)
+		{
+			running += mTriangles[i].flux;
+			mCdf[i] = (float) (running / total);
+			weights[i] = mTriangles[i].flux;
+		}
+		if(!mCdf.empty())
+			mCdf.back() = 1.0F;
+
+		mAlias.build(weights);
+	}
+
+	void EmissiveTriangles::appendLights(std::vector<Light>& lights)
+	{
+		mFirstLight = (UINT32) lights.size();
+		for(auto& tri:mTriangles)
+			lights.push_back(toLight(tri));
+	}
+
+	UINT32 EmissiveTriangles::sample(float u, float& pdf) const
+	{
+		if(mCdf.empty())
+		{
+			pdf = 0.0F;
+			return UINT32_MAX;
+		}
+
+		UINT32 index = (UINT32) (std::upper_bound(mCdf.begin(), mCdf.end(), u) - mCdf.begin());
+		index = std::min<UINT32>(index, (UINT32) mCdf.size() - 1);
+		pdf = this->pdf(index);
+		return index;
+	}
+
+	UINT32 EmissiveTriangles::sampleAlias(float u0, float u1, float& pdf) const
+	{
+		return mAlias.sample(u0, u1, pdf);
+	}
+
+	XMVECTOR EmissiveTriangles::samplePoint(const EmissiveTriangle& triangle, float u0, float u1)
+	{
+		float s = sqrtf(u0);
+		float b1 = s * (1.0F - u1);
+		float b2 = s * u1;
+		return XMLoadFloat3(&triangle.p0) * (1.0F - b1 - b2) + XMLoadFloat3(&triangle.p1) * b1 + XMLoadFloat3(&triangle.p2) * b2;
+	}
+
+	float EmissiveTriangles::pdf(UINT32 index, FXMVECTOR origin, FXMVECTOR point) const
+	{
+		if(index >= mTriangles.size())
+			return 0.0F;
+
+		//the area pdf over the cosine at the light and the squared distance, nothing is sent out of the back
+		const EmissiveTriangle& tri = mTriangles[index];
+		XMVECTOR toOrigin = origin - point;
+		float distanceSq = XMVectorGetX(XMVector3LengthSq(toOrigin));
+		float cosLight = XMVectorGetX(XMVector3Dot(toOrigin, XMLoadFloat3(&tri.normal))) / sqrtf(std::max<float>(distanceSq, 1e-20F));
+		if(cosLight <= 0.0F || tri.area <= 0.0F)
+			return 0.0F;
+		return pdf(index) * distanceSq / (cosLight * tri.area);
+	}
+
+	UINT32 EmissiveTriangles::find(UINT32 instance, UINT32 primitive) const
+	{
+		auto it = mIndices.find(((UINT64) instance << 32) | primitive);
+		return it == mIndices.end() ? UINT32_MAX : it->second;
+	}
+
+	Light EmissiveTriangles::toLight(const EmissiveTriangle& triangle)
+	{
+		//a lambertian emitter at the centroid, the intensity along the normal is radiance times area
+		Light light = {};
+		light.lightType = LIGHT_TYPE_TRIANGLE;
+		XMStoreFloat3(&light.Position, (XMLoadFloat3(&triangle.p0) + XMLoadFloat3(&triangle.p1) + XMLoadFloat3(&triangle.p2)) / 3.0F);
+		light.Direction = triangle.normal;
+		light.Strength = { triangle.radiance.x * triangle.area, triangle.radiance.y * triangle.area, triangle.radiance.z * triangle.area };
+		light.SpotPower = 1.0F;
+
+		//the inverse square is clamped closer than the triangle's size, shadows see a disk of the same area
+		float size = sqrtf(triangle.area);
+		light.FalloffStart = size;
+		light.FalloffEnd = std::max<float>(triangle.range, 2.0F * size);
+		light.radius = sqrtf(triangle.area / XM_PI);
+		return light;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "LightAliasTable.h"
+
+#define EMISSIVE_MAP_MAX_SIZE			256 //emissive maps are box filtered down to this before integrating
+#define EMISSIVE_MAX_TEXELS				65536 //texels clipped per triangle, larger uv footprints use a coarser level
+#define EMISSIVE_MIN_IRRADIANCE			1e-3F //every triangle of an emitter ends where the whole emitter falls below this
+#define EMISSIVE_FLUX_EPSILON			1e-4F //triangles below this fraction of the brightest one are dropped
+
+namespace RT
+{
+	//single channel, mip 0 clamped to EMISSIVE_MAP_MAX_SIZE and box filtered down to 1x1
+	struct EmissiveMap
+	{
+		std::vector<UINT32> widths;
+		std::vector<UINT32> heights;
+		std::vector<std::vector<float>> levels;
+	};
+
+	struct EmissiveTriangle
+	{
+		DirectX::XMFLOAT3 p0;
+		DirectX::XMFLOAT3 p1;
+		DirectX::XMFLOAT3 p2;
+		DirectX::XMFLOAT3 normal; //away from the emitter's center
+		DirectX::XMFLOAT3 radiance; //material emission times the mean of the emissive map over the triangle
+		float area;
+		float flux;
+		float range;
+		UINT32 instance; //where it was built from, a ray that hits an emitter finds its light through them
+		UINT32 primitive;
+	};
+
+	//emissive instances turned into triangle lights, with a flux proportional distribution over all of them
+	class EmissiveTriangles
+	{
+	public:
+		EmissiveTriangles() = default;
+		~EmissiveTriangles() = default;
+
+		static bool loadMap(const std::wstring& fileName, EmissiveMap& map);
+		static void buildLevels(EmissiveMap& map);
+
+		//mean of the map over a uv triangle, the texels are point sampled and wrap
+		static float integrate(const EmissiveMap& map, const DirectX::XMFLOAT2& uv0, const DirectX::XMFLOAT2& uv1, const DirectX::XMFLOAT2& uv2);
+
+		//one instance, map can be null for a constant emission
+		void add(const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& uvTransform,
+				 const DirectX::XMFLOAT3& emission, const EmissiveMap* map, UINT32 instance = 0);
+		void build();
+		void appendLights(std::vector<Light>& lights);
+
+		//CDF inversion and the alias table give the same distribution
+		UINT32 sample(float u, float& pdf) const;
+		UINT32 sampleAlias(float u0, float u1, float& pdf) const;
+		inline float pdf(UINT32 index) const { return index < mTriangles.size() && mTotalFlux > 0.0F ? mTriangles[index].flux / mTotalFlux : 0.0F; }
+
+		//uniform over the area, so the area pdf is 1 / area
+		static DirectX::XMVECTOR samplePoint(const EmissiveTriangle& triangle, float u0, float u1);
+		//solid angle pdf of picking the triangle by flux and then point on it, seen from origin
+		float pdf(UINT32 index, DirectX::FXMVECTOR origin, DirectX::FXMVECTOR point) const;
+		//UINT32_MAX when the primitive emits nothing or was dropped
+		UINT32 find(UINT32 instance, UINT32 primitive) const;
+
+		static Light toLight(const EmissiveTriangle& triangle);
+
+		inline const std::vector<EmissiveTriangle>& getTriangles() const { return mTriangles; }
+		inline UINT32 getCount() const { return (UINT32) mTriangles.size(); }
+		inline UINT32 getFirstLight() const { return mFirstLight; }
+		inline float getTotalFlux() const { return mTotalFlux; }
+	private:
+		std::vector<EmissiveTriangle> mTriangles;
+		std::vector<float> mCdf;
+		std::unordered_map<UINT64, UINT32> mIndices; //instance in the high bits, primitive in the low ones
+		LightAliasTable mAlias;
+		float mTotalFlux = 0.0F;
+		UINT32 mFirstLight = 0;
+	};
+}
\ No newline at end of file
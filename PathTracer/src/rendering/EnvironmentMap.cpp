@@ -0,0 +1,476 @@
+#include "EnvironmentMap.h"
+
+#include "../utils/Timer.h"
+#include "DDSTexture.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#define ENV_MAP_CACHE_MAGIC				0x45454755 //UGEE
+#define ENV_MAP_CACHE_VERSION			2
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace RT
+{
+	static float luminance(const XMFLOAT3& c)
+	{
+		return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+	}
+
+	static UINT32 readU32(const std::vector<BYTE>& data, size_t offset)
+	{
+		return offset + 4 <= data.size() ? *reinterpret_cast<const UINT32*>(&data[offset]) : 0;
+	}
+
+	static UINT32 fourCC(const char* code)
+	{
+		return (UINT32) code[0] | ((UINT32) code[1] << 8) | ((UINT32) code[2] << 16) | ((UINT32) code[3] << 24);
+	}
+
+	static float srgbToLinear(float c)
+	{
+		return c <= 0.04045F ? c / 12.92F : powf((c + 0.055F) / 1.055F, 2.4F);
+	}
+
+	bool EnvironmentMap::decodeCubemap(const std::wstring& fileName, std::vector<XMFLOAT3>& texels, UINT32& size, UINT32 maxSize)
+	{
+		std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+			return false;
+		std::vector<BYTE> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+
+		if(data.size() < 128 || readU32(data, 0) != fourCC("DDS "))
+			return false;
+
+		UINT32 height = readU32(data, 12);
+		UINT32 width = readU32(data, 16);
+		UINT32 mips = std::max<UINT32>(readU32(data, 28), 1);
+		UINT32 code = readU32(data, 84);
+		UINT32 bitCount = readU32(data, 88);
+		UINT32 redMask = readU32(data, 92);
+		bool cube = (readU32(data, 112) & 0x200) != 0; //DDSCAPS2_CUBEMAP
+		size_t offset = 128;
+
+		//what the D3D cubemaps here are saved with, the values are the ones TextureCube sampling returns
+		enum { FORMAT_UNKNOWN, FORMAT_BC1, FORMAT_BC2, FORMAT_BC3, FORMAT_RGBA8, FORMAT_BGRA8, FORMAT_RGBA16F, FORMAT_RGBA32F } format = FORMAT_UNKNOWN;
+		bool srgb = false;
+		if(code == fourCC("DX10"))
+		{
+			UINT32 dxgi = readU32(data, 128);
+			cube |= (readU32(data, 136) & 0x4) != 0; //D3D11_RESOURCE_MISC_TEXTURECUBE
+			offset += 20;
+			srgb = dxgi == DXGI_FORMAT_BC1_UNORM_SRGB || dxgi == DXGI_FORMAT_BC2_UNORM_SRGB || dxgi == DXGI_FORMAT_BC3_UNORM_SRGB ||
+				   dxgi == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || dxgi == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+			if(dxgi == DXGI_FORMAT_BC1_UNORM || dxgi == DXGI_FORMAT_BC1_UNORM_SRGB)
+				format = FORMAT_BC1;
+			else if(dxgi == DXGI_FORMAT_BC2_UNORM || dxgi == DXGI_FORMAT_BC2_UNORM_SRGB)
+				format = FORMAT_BC2;
+			else if(dxgi == DXGI_FORMAT_BC3_UNORM || dxgi == DXGI_FORMAT_BC3_UNORM_SRGB)
+				format = FORMAT_BC3;
+			else if(dxgi == DXGI_FORMAT_R8G8B8A8_UNORM || dxgi == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+				format = FORMAT_RGBA8;
+			else if(dxgi == DXGI_FORMAT_B8G8R8A8_UNORM || dxgi == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB)
+				format = FORMAT_BGRA8;
+			else if(dxgi == DXGI_FORMAT_R16G16B16A16_FLOAT)
+				format = FORMAT_RGBA16F;
+			else if(dxgi == DXGI_FORMAT_R32G32B32A32_FLOAT)
+				format = FORMAT_RGBA32F;
+		}
+		else if(code == fourCC("DXT1"))
+			format = FORMAT_BC1;
+		else if(code == fourCC("DXT2") || code == fourCC("DXT3"))
+			format = FORMAT_BC2;
+		else if(code == fourCC("DXT4") || code == fourCC("DXT5"))
+			format = FORMAT_BC3;
+		else if(code == 113) //D3DFMT_A16B16G16R16F
+			format = FORMAT_RGBA16F;
+		else if(code == 116) //D3DFMT_A32B32G32R32F
+			format = FORMAT_RGBA32F;
+		else if(code == 0 && bitCount == 32)
+			format = redMask == 0x000000FF ? FORMAT_RGBA8 : FORMAT_BGRA8;
+
+		if(format == FORMAT_UNKNOWN || !cube || width == 0 || width != height)
+			return false;
+
+		bool compressed = format == FORMAT_BC1 || format == FORMAT_BC2 || format == FORMAT_BC3;
+		UINT32 blockBytes = format == FORMAT_BC1 ? 8 : 16;
+		UINT32 texelBytes = format == FORMAT_RGBA32F ? 16 : (format == FORMAT_RGBA16F ? 8 : 4);
+		auto mipBytes = [&](UINT32 level)
+		{
+			UINT32 s = std::max<UINT32>(width >> level, 1);
+			return compressed ? (size_t) ((s + 3) / 4) * ((s + 3) / 4) * blockBytes : (size_t) s * s * texelBytes;
+		};
+
+		//every face is stored with its whole mip chain
+		size_t faceBytes = 0;
+		for(UINT32 m = 0; m < mips; ++m)
+			faceBytes += mipBytes(m);
+		if(offset + faceBytes * 6 > data.size())
+			return false;
+
+		size = std::min<UINT32>(width, maxSize);
+		texels.resize((size_t) 6 * size * size);
+		const UINT32 ratio = width / size;
+
+		parallelFor(UINT32(0), UINT32(6), [&](UINT32 face)
+		{
+			const BYTE* src = &data[offset + faceBytes * face];
+			std::vector<XMFLOAT3> full((size_t) width * width);
+			if(compressed)
+			{
+				UINT32 blocks = (width + 3) / 4;
+				for(UINT32 by = 0; by < blocks; ++by)
+				{
+					for(UINT32 bx = 0; bx < blocks; ++bx)
+					{
+						XMFLOAT3 block[16];
+						const BYTE* b = src + ((size_t) by * blocks + bx) * blockBytes;
+						DDSTexture::decodeColorBlock(format == FORMAT_BC1 ? b : b + 8, block, format != FORMAT_BC1);
+						for(UINT32 y = 0; y < 4 && by * 4 + y < width; ++y)
+							for(UINT32 x = 0; x < 4 && bx * 4 + x < width; ++x)
+								full[(size_t) (by * 4 + y) * width + bx * 4 + x] = block[y * 4 + x];
+					}
+				}
+			}
+			else
+			{
+				for(size_t i = 0; i < full.size(); ++i)
+				{
+					const BYTE* t = src + i * texelBytes;
+					if(format == FORMAT_RGBA8)
+						full[i] = { t[0] / 255.0F, t[1] / 255.0F, t[2] / 255.0F };
+					else if(format == FORMAT_BGRA8)
+						full[i] = { t[2] / 255.0F, t[1] / 255.0F, t[0] / 255.0F };
+					else if(format == FORMAT_RGBA16F)
+					{
+						const HALF* h = reinterpret_cast<const HALF*>(t);
+						full[i] = { XMConvertHalfToFloat(h[0]), XMConvertHalfToFloat(h[1]), XMConvertHalfToFloat(h[2]) };
+					}
+					else
+					{
+						const float* f = reinterpret_cast<const float*>(t);
+						full[i] = { f[0], f[1], f[2] };
+					}
+				}
+			}
+
+			if(srgb)
+			{
+				for(auto& c:full)
+					c = { srgbToLinear(c.x), srgbToLinear(c.y), srgbToLinear(c.z) };
+			}
+
+			//box filtered down to the table size
+			float scale = 1.0F / (ratio * ratio);
+			for(UINT32 y = 0; y < size; ++y)
+			{
+				for(UINT32 x = 0; x < size; ++x)
+				{
+					XMFLOAT3 sum = { 0.0F, 0.0F, 0.0F };
+					for(UINT32 j = 0; j < ratio; ++j)
+					{
+						for(UINT32 i = 0; i < ratio; ++i)
+						{
+							const XMFLOAT3& c = full[(size_t) (y * ratio + j) * width + x * ratio + i];
+							sum.x += c.x;
+							sum.y += c.y;
+							sum.z += c.z;
+						}
+					}
+					texels[((size_t) face * size + y) * size + x] = { sum.x * scale, sum.y * scale, sum.z * scale };
+				}
+			}
+		});
+
+		return true;
+	}
+
+	XMVECTOR EnvironmentMap::faceDirection(UINT32 face, float u, float v)
+	{
+		float s = 2.0F * u - 1.0F;
+		float t = 2.0F * v - 1.0F;
+		switch(face)
+		{
+		case 0: return XMVectorSet(1.0F, -t, -s, 0.0F);
+		case 1: return XMVectorSet(-1.0F, -t, s, 0.0F);
+		case 2: return XMVectorSet(s, 1.0F, t, 0.0F);
+		case 3: return XMVectorSet(s, -1.0F, -t, 0.0F);
+		case 4: return XMVectorSet(s, -t, 1.0F, 0.0F);
+		default: return XMVectorSet(-s, -t, -1.0F, 0.0F);
+		}
+	}
+
+	UINT32 EnvironmentMap::directionFace(FXMVECTOR dir, float& u, float& v)
+	{
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, dir);
+		float ax = fabsf(d.x), ay = fabsf(d.y), az = fabsf(d.z);
+
+		UINT32 face;
+		float ma, sc, tc;
+		if(ax >= ay && ax >= az)
+		{
+			face = d.x > 0.0F ? 0 : 1;
+			ma = ax;
+			sc = d.x > 0.0F ? -d.z : d.z;
+			tc = -d.y;
+		}
+		else if(ay >= az)
+		{
+			face = d.y > 0.0F ? 2 : 3;
+			ma = ay;
+			sc = d.x;
+			tc = d.y > 0.0F ? d.z : -d.z;
+		}
+		else
+		{
+			face = d.z > 0.0F ? 4 : 5;
+			ma = az;
+			sc = d.z > 0.0F ? d.x : -d.x;
+			tc = -d.y;
+		}
+
+		u = 0.5F * (sc / ma + 1.0F);
+		v = 0.5F * (tc / ma + 1.0F);
+		return face;
+	}
+
+	static float areaElement(float x, float y)
+	{
+		return atan2f(x * y, sqrtf(x * x + y * y + 1.0F));
+	}
+
+	float EnvironmentMap::texelSolidAngle(UINT32 x, UINT32 y, UINT32 size)
+	{
+		float s0 = 2.0F * x / size - 1.0F, s1 = 2.0F * (x + 1) / size - 1.0F;
+		float t0 = 2.0F * y / size - 1.0F, t1 = 2.0F * (y + 1) / size - 1.0F;
+		return areaElement(s0, t0) - areaElement(s0, t1) - areaElement(s1, t0) + areaElement(s1, t1);
+	}
+
+	//texels are picked uniformly on the face, dw = dA / (1 + s^2 + t^2)^1.5
+	static float faceJacobian(float u, float v, UINT32 size)
+	{
+		float s = 2.0F * u - 1.0F;
+		float t = 2.0F * v - 1.0F;
+		float r2 = 1.0F + s * s + t * t;
+		return r2 * sqrtf(r2) * (size * size) / 4.0F;
+	}
+
+	void EnvironmentMap::build(const std::vector<XMFLOAT3>& texels, UINT32 size)
+	{
+		Timer timer;
+		timer.reset();
+
+		UINT32 rows = 6 * size;
+		mConditional.resize((size_t) rows * size);
+		std::vector<double> rowSums(rows);
+		parallelFor(UINT32(0), rows, [&](UINT32 r)
+		{
+			UINT32 y = r % size;
+			float* cdf = &mConditional[(size_t) r * size];
+			double sum = 0.0;
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				sum += std::max<float>(luminance(texels[(size_t) r * size + x]), 0.0F) * texelSolidAngle(x, y, size);
+				cdf[x] = (float) sum;
+			}
+
+			//rows that give nothing are never picked, a uniform CDF keeps them well formed
+			for(UINT32 x = 0; x < size; ++x)
+				cdf[x] = sum > 0.0 ? (float) (cdf[x] / sum) : (float) (x + 1) / size;
+			cdf[size - 1] = 1.0F;
+			rowSums[r] = sum;
+		});
+
+		double total = 0.0;
+		for(double s:rowSums)
+			total += s;
+
+		//the ambient term is defined even for a black cubemap
+		mAmbient = SphericalHarmonics::ambient(SphericalHarmonics::projectCubemap(texels, size));
+
+		if(total <= 0.0)
+		{
+			mSize = 0;
+			mTotal = 0.0F;
+			mMarginal.clear();
+			mConditional.clear();
+			return;
+		}
+
+		mMarginal.resize(rows);
+		double running = 0.0;
+		for(UINT32 r = 0; r < rows; ++r)
+		{
+			running += rowSums[r];
+			mMarginal[r] = (float) (running / total);
+		}
+		mMarginal.back() = 1.0F;
+
+		mSize = size;
+		mTotal = (float) total;
+		timer.tick();
+		mBuildMs = timer.deltaTime() * 1000.0F;
+	}
+
+	float EnvironmentMap::texelProbability(UINT32 row, UINT32 column) const
+	{
+		if(mSize == 0)
+			return 0.0F;
+		const float* cdf = &mConditional[(size_t) row * mSize];
+		float pRow = mMarginal[row] - (row > 0 ? mMarginal[row - 1] : 0.0F);
+		float pColumn = cdf[column] - (column > 0 ? cdf[column - 1] : 0.0F);
+		return pRow * pColumn;
+	}
+
+	XMFLOAT3 EnvironmentMap::sample(float u0, float u1, float& pdf) const
+	{
+		XMFLOAT3 dir = { 0.0F, 1.0F, 0.0F };
+		pdf = 0.0F;
+		if(mSize == 0)
+			return dir;
+
+		//the leftovers of both searches place the point inside the texel
+		UINT32 rows = 6 * mSize;
+		UINT32 row = std::min<UINT32>((UINT32) (std::upper_bound(mMarginal.begin(), mMarginal.end(), u0) - mMarginal.begin()), rows - 1);
+		float rowLow = row > 0 ? mMarginal[row - 1] : 0.0F;
+		float rowP = mMarginal[row] - rowLow;
+
+		const float* cdf = &mConditional[(size_t) row * mSize];
+		UINT32 column = std::min<UINT32>((UINT32) (std::upper_bound(cdf, cdf + mSize, u1) - cdf), mSize - 1);
+		float columnLow = column > 0 ? cdf[column - 1] : 0.0F;
+		float columnP = cdf[column] - columnLow;
+		if(rowP <= 0.0F || columnP <= 0.0F)
+			return dir;
+
+		float tu = std::clamp<float>((u1 - columnLow) / columnP, 0.0F, 0.999F);
+		float tv = std::clamp<float>((u0 - rowLow) / rowP, 0.0F, 0.999F);
+		float u = (column + tu) / mSize;
+		float v = (row % mSize + tv) / mSize;
+
+		XMStoreFloat3(&dir, XMVector3Normalize(faceDirection(row / mSize, u, v)));
+		pdf = rowP * columnP * faceJacobian(u, v, mSize);
+		return dir;
+	}
+
+	float EnvironmentMap::pdf(FXMVECTOR dir) const
+	{
+		if(mSize == 0)
+			return 0.0F;
+
+		float u, v;
+		UINT32 face = directionFace(dir, u, v);
+		UINT32 x = std::min<UINT32>((UINT32) std::max<float>(u * mSize, 0.0F), mSize - 1);
+		UINT32 y = std::min<UINT32>((UINT32) std::max<float>(v * mSize, 0.0F), mSize - 1);
+		return texelProbability(face * mSize + y, x) * faceJacobian(u, v, mSize);
+	}
+
+	bool EnvironmentMap::load(const std::string& name, bool useCache)
+	{
+		std::wstring source = L"res/cubemaps/" + std::wstring(name.begin(), name.end()) + L".dds";
+		std::string cache = ENV_MAP_CACHE_DIR + name + ".bin";
+
+		//the cache is tied to the cubemap it was built from
+		UINT64 stamp = 0;
+		if(!sourceStamp(source, stamp))
+			return false;
+
+		if(useCache && loadCache(cache, stamp))
+		{
+			Logger::INFO.log("Loaded environment sampling tables from " + cache);
+			return true;
+		}
+
+		std::vector<XMFLOAT3> texels;
+		UINT32 size = 0;
+		if(!decodeCubemap(source, texels, size))
+		{
+			Logger::WARN.log("Unsupported cubemap format for " + name + ", environment sampling is off");
+			mSize = 0;
+			return false;
+		}
+
+		build(texels, size);
+		if(mSize == 0)
+			return false;
+
+		Logger::INFO.log("Built environment sampling tables for " + name + " in " + std::to_string(mBuildMs) + "ms");
+		if(useCache)
+			saveCache(cache, stamp);
+		return true;
+	}
+
+	bool EnvironmentMap::sourceStamp(const std::wstring& fileName, UINT64& stamp)
+	{
+		std::error_code ec;
+		auto time = std::filesystem::last_write_time(fileName, ec);
+		if(ec)
+			return false;
+		stamp = (UINT64) time.time_since_epoch().count() ^ (UINT64) std::filesystem::file_size(fileName, ec);
+		return true;
+	}
+
+	bool EnvironmentMap::loadCache(const std::string& fileName, UINT64 stamp)
+	{
+		std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+			return false;
+
+		UINT32 header[4] = {};
+		UINT64 cachedStamp = 0;
+		file.read((char*) header, sizeof(header));
+		file.read((char*) &cachedStamp, sizeof(UINT64));
+		if(header[0] != ENV_MAP_CACHE_MAGIC || header[1] != ENV_MAP_CACHE_VERSION || cachedStamp != stamp || header[2] == 0)
+		{
+			Logger::WARN.log("Ignoring stale environment cache " + fileName);
+			return false;
+		}
+
+		UINT32 size = header[2];
+		std::vector<float> marginal((size_t) 6 * size);
+		std::vector<float> conditional((size_t) 6 * size * size);
+		float total = 0.0F;
+		SHCoefficients ambient;
+		file.read((char*) &total, sizeof(float));
+		file.read((char*) ambient.data(), sizeof(XMFLOAT4) * ambient.size());
+		file.read((char*) marginal.data(), sizeof(float) * marginal.size());
+		file.read((char*) conditional.data(), sizeof(float) * conditional.size());
+
+		if(!file)
+		{
+			Logger::WARN.log("Corrupted environment cache " + fileName);
+			return false;
+		}
+
+		mSize = size;
+		mTotal = total;
+		mAmbient = ambient;
+		mMarginal = std::move(marginal);
+		mConditional = std::move(conditional);
+		return true;
+	}
+
+	void EnvironmentMap::saveCache(const std::string& fileName, UINT64 stamp) const
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(ENV_MAP_CACHE_DIR, ec);
+
+		std::ofstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+		{
+			Logger::WARN.log("Couldn't write environment cache " + fileName);
+			return;
+		}
+
+		UINT32 header[4] = { ENV_MAP_CACHE_MAGIC, ENV_MAP_CACHE_VERSION, mSize, 0 };
+		file.write((const char*) header, sizeof(header));
+		file.write((const char*) &stamp, sizeof(UINT64));
+		file.write((const char*) &mTotal, sizeof(float));
+		file.write((const char*) mAmbient.data(), sizeof(XMFLOAT4) * mAmbient.size());
+		file.write((const char*) mMarginal.data(), sizeof(float) * mMarginal.size());
+		file.write((const char*) mConditional.data(), sizeof(float) * mConditional.size());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#include "SphericalHarmonics.h"
+
+#define ENV_MAP_SAMPLING_SIZE			64 //texels per face side the cubemap is box filtered down to before building the tables
+#define ENV_MAP_CACHE_DIR				"res/cache/environment/"
+
+namespace RT
+{
+	//luminance times solid angle over the texels of a cubemap, picked by row (face major) then by column, uniform inside the texel
+	//both CDFs are inclusive, mirrored by environment.hlsli
+	class EnvironmentMap
+	{
+		friend struct EnvironmentMapTests; //round trips the cache without a cubemap on disk
+	public:
+		EnvironmentMap() = default;
+		~EnvironmentMap() = default;
+
+		//res/cubemaps/name.dds, the tables are cached per cubemap until the file changes
+		bool load(const std::string& name, bool useCache = true);
+
+		//6 faces of size x size texels in the D3D order +X -X +Y -Y +Z -Z, rows top to bottom
+		void build(const std::vector<DirectX::XMFLOAT3>& texels, UINT32 size);
+
+		DirectX::XMFLOAT3 sample(float u0, float u1, float& pdf) const;
+		float pdf(DirectX::FXMVECTOR dir) const;
+		float texelProbability(UINT32 row, UINT32 column) const;
+
+		//same face selection as TextureCube sampling, u and v in [0, 1]
+		static DirectX::XMVECTOR faceDirection(UINT32 face, float u, float v);
+		static UINT32 directionFace(DirectX::FXMVECTOR dir, float& u, float& v);
+		static float texelSolidAngle(UINT32 x, UINT32 y, UINT32 size);
+
+		//box filtered down to maxSize, faces laid out like build
+		static bool decodeCubemap(const std::wstring& fileName, std::vector<DirectX::XMFLOAT3>& texels, UINT32& size, UINT32 maxSize = ENV_MAP_SAMPLING_SIZE);
+		//what the caches built from a cubemap are tied to
+		static bool sourceStamp(const std::wstring& fileName, UINT64& stamp);
+
+		inline bool isValid() const { return mSize > 0; }
+		inline UINT32 getSize() const { return mSize; }
+		inline const std::vector<float>& getMarginal() const { return mMarginal; }
+		inline const std::vector<float>& getConditional() const { return mConditional; }
+		inline float getTotal() const { return mTotal; }
+		inline const SHCoefficients& getAmbient() const { return mAmbient; }
+		inline float getBuildTime() const { return mBuildMs; }
+	private:
+		bool loadCache(const std::string& fileName, UINT64 stamp);
+		void saveCache(const std::string& fileName, UINT64 stamp) const;
+
+		std::vector<float> mMarginal; //6 * size rows
+		std::vector<float> mConditional; //size columns per row
+		UINT32 mSize = 0;
+		float mTotal = 0.0F; //luminance integrated over the sphere
+		SHCoefficients mAmbient = SphericalHarmonics::constant(SH_DEFAULT_AMBIENT); //kept when there is no cubemap to project
+		float mBuildMs = 0.0F;
+	};
+}
\ No newline at end of file
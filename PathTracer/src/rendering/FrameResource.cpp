@@ -2,7 +2,7 @@
 
 namespace RT
 {
-	FrameResource::FrameResource(ID3D12Device* device, UINT passNum, UINT materialsNum, std::vector<UINT16> instances, std::vector<std::tuple<UINT, UINT, UINT>> lods)
+	FrameResource::FrameResource(ID3D12Device* device, UINT passNum, UINT materialsNum, std::vector<UINT16> instances, std::vector<std::tuple<UINT, UINT, UINT>> lods, UINT lightNodesNum, UINT lightsNum)
 	{
 		ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&cmdListAlloc)));
 		ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&mvCmdListAlloc)));
@@ -24,5 +24,14 @@ namespace RT
 			i += num;
 		if(i > 0)
 			instanceBufferRT = std::make_unique<UploadBuffer<ObjectCB>>(device, i, false);
+		if(lightNodesNum > 0)
+			lightTree = std::make_unique<UploadBuffer<LightTreeNode>>(device, lightNodesNum, false);
+		if(lightsNum > 0)
+		{
+			lightAlias = std::make_unique<UploadBuffer<LightAliasEntry>>(device, lightsNum, false);
+			lights = std::make_unique<UploadBuffer<Light>>(device, lightsNum, false);
+			lightClusters = std::make_unique<UploadBuffer<LightCluster>>(device, CLUSTER_GRID_COUNT, false);
+			clusterLights = std::make_unique<UploadBuffer<UINT32>>(device, CLUSTER_GRID_INDEX_CAPACITY, false);
+		}
 	}
 }
\ No newline at end of file
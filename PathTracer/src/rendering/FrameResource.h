@@ -2,12 +2,16 @@
 
 #include "../utils/UploadBuffer.h"
 
+#include "LightTree.h"
+#include "LightAliasTable.h"
+#include "LightClusterGrid.h"
+
 namespace RT
 {
 	struct FrameResource
 	{
 	public:
-		FrameResource(ID3D12Device* device, UINT passNum, UINT materialsNum, std::vector<UINT16> instances = {}, std::vector<std::tuple<UINT, UINT, UINT>> lods = {});
+		FrameResource(ID3D12Device* device, UINT passNum, UINT materialsNum, std::vector<UINT16> instances = {}, std::vector<std::tuple<UINT, UINT, UINT>> lods = {}, UINT lightNodesNum = 0, UINT lightsNum = 0);
 		FrameResource(const FrameResource&) = delete;
 		FrameResource& operator=(const FrameResource&) = delete;
 
@@ -21,6 +25,11 @@ namespace RT
 		std::vector<std::unique_ptr<UploadBuffer<ObjectCB>>> instanceBuffer;
 		std::unique_ptr<UploadBuffer<MaterialConstants>> materialCB = nullptr;
 		std::unique_ptr<UploadBuffer<ObjectCB>> instanceBufferRT = nullptr;
+		std::unique_ptr<UploadBuffer<LightTreeNode>> lightTree = nullptr;
+		std::unique_ptr<UploadBuffer<LightAliasEntry>> lightAlias = nullptr;
+		std::unique_ptr<UploadBuffer<Light>> lights = nullptr;
+		std::unique_ptr<UploadBuffer<LightCluster>> lightClusters = nullptr;
+		std::unique_ptr<UploadBuffer<UINT32>> clusterLights = nullptr;
 		Microsoft::WRL::ComPtr<ID3D12Resource> SBTStorage;
 
 		UINT64 fence = 0;
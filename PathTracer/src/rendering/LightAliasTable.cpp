@@ -0,0 +1,118 @@
+#include "LightAliasTable.h"
+
+#include "../utils/Timer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace RT
+{
+	static float luminance(const XMFLOAT3& c)
+	{
+		return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+	}
+
+	float LightAliasTable::weight(const Light& light)
+	{
+		float power = std::max<float>(luminance(light.Strength), 0.0F);
+		if(light.lightType == LIGHT_TYPE_DIRECTIONAL)
+			return power * LIGHT_ALIAS_DIRECTIONAL_RANGE;
+
+		//the linear falloff reaches half way on average, spot lights only cover the part of the sphere pow(cos, SpotPower) leaves
+		//triangles fall off with the clamped inverse square instead and cover a hemisphere like a spot light with SpotPower 1
+		float range = 0.5F * (std::max<float>(light.FalloffStart, 0.0F) + std::max<float>(light.FalloffEnd, 0.0F));
+		if(light.lightType == LIGHT_TYPE_TRIANGLE)
+			range = std::max<float>(light.FalloffEnd - light.FalloffStart * 2.0F / 3.0F, 0.0F);
+		float coverage = light.lightType == LIGHT_TYPE_SPOTLIGHT || light.lightType == LIGHT_TYPE_TRIANGLE ? 0.5F / (std::max<float>(light.SpotPower, 0.0F) + 1.0F) : 1.0F;
+		return power * range * coverage;
+	}
+
+	void LightAliasTable::build(const std::vector<float>& weights)
+	{
+		Timer timer;
+		timer.reset();
+
+		UINT32 n = (UINT32) weights.size();
+		mEntries.resize(n);
+		if(n == 0)
+			return;
+
+		double total = 0.0;
+		for(float w:weights)
+			total += std::max<float>(w, 0.0F);
+
+		//every light gets its mean share, the small ones borrow the rest from a large one
+		std::vector<double> scaled(n);
+		std::vector<UINT32> small;
+		std::vector<UINT32> large;
+		small.reserve(n);
+		large.reserve(n);
+		for(UINT32 i = 0; i < n; ++i)
+		{
+			double p = total > 0.0 ? std::max<float>(weights[i], 0.0F) / total : 1.0 / n;
+			mEntries[i] = { 1.0F, i, (float) p, 0.0F };
+			scaled[i] = p * n;
+			if(scaled[i] < 1.0)
+				small.push_back(i);
+			else
+				large.push_back(i);
+		}
+
+		while(!small.empty() && !large.empty())
+		{
+			UINT32 s = small.back();
+			small.pop_back();
+			UINT32 l = large.back();
+			large.pop_back();
+
+			mEntries[s].probability = (float) scaled[s];
+			mEntries[s].alias = l;
+
+			scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+			if(scaled[l] < 1.0)
+				small.push_back(l);
+			else
+				large.push_back(l);
+		}
+
+		//whatever is left is 1 up to rounding
+		for(UINT32 i:large)
+			mEntries[i].probability = 1.0F;
+		for(UINT32 i:small)
+			mEntries[i].probability = 1.0F;
+
+		timer.tick();
+		mBuildMs = timer.deltaTime() * 1000.0F;
+	}
+
+	bool LightAliasTable::update(const Light* lights, UINT32 count)
+	{
+		if(count == (UINT32) mLights.size() && (count == 0 || memcmp(lights, mLights.data(), count * sizeof(Light)) == 0))
+			return false;
+
+		mLights.assign(lights, lights + count);
+		std::vector<float> weights(count);
+		for(UINT32 i = 0; i < count; ++i)
+			weights[i] = weight(lights[i]);
+		build(weights);
+		return true;
+	}
+
+	UINT32 LightAliasTable::sample(float u0, float u1, float& pdf) const
+	{
+		if(mEntries.empty())
+		{
+			pdf = 0.0F;
+			return UINT32_MAX;
+		}
+
+		UINT32 n = (UINT32) mEntries.size();
+		UINT32 index = std::min<UINT32>((UINT32) (u0 * n), n - 1);
+		if(u1 >= mEntries[index].probability)
+			index = mEntries[index].alias;
+		pdf = mEntries[index].pdf;
+		return index;
+	}
+}
\ No newline at end of file
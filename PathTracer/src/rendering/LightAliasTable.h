@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define LIGHT_ALIAS_DIRECTIONAL_RANGE	20.0F //directional lights weigh like a local light reaching this far
+
+namespace RT
+{
+	//one per light, mirrored by LightAliasEntry in common.hlsli
+	struct LightAliasEntry
+	{
+		float probability; //of keeping this light instead of its alias
+		UINT32 alias;
+		float pdf; //of picking this light through the table
+		float pad;
+	};
+
+	//O(1) light picking proportional to a position independent power estimate, built with Vose's method
+	class LightAliasTable
+	{
+	public:
+		LightAliasTable() = default;
+		~LightAliasTable() = default;
+
+		//rebuilds only when the lights changed, returns true when the table has to be uploaded again
+		bool update(const Light* lights, UINT32 count);
+		void build(const std::vector<float>& weights);
+
+		UINT32 sample(float u0, float u1, float& pdf) const;
+		inline float pdf(UINT32 index) const { return index < mEntries.size() ? mEntries[index].pdf : 0.0F; }
+
+		static float weight(const Light& light);
+
+		inline const std::vector<LightAliasEntry>& getEntries() const { return mEntries; }
+		inline float getBuildTime() const { return mBuildMs; }
+	private:
+		std::vector<LightAliasEntry> mEntries;
+		std::vector<Light> mLights;
+		float mBuildMs = 0.0F;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "LightClusterGrid.h"
+
+#include "../utils/Timer.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	static bool sphereTouchesBox(const XMFLOAT3& center, float radius, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		float dx = std::max<float>(std::max<float>(boxMin.x - center.x, center.x - boxMax.x), 0.0F);
+		float dy = std::max<float>(std::max<float>(boxMin.y - center.y, center.y - boxMax.y), 0.0F);
+		float dz = std::max<float>(std::max<float>(boxMin.z - center.z, center.z - boxMax.z), 0.0F);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+
+	UINT32 LightClusterGrid::slice(float z) const
+	{
+		return std::min<UINT32>((UINT32) std::max<float>(logf(z / mNear) * mSliceScale, 0.0F), CLUSTER_GRID_Z - 1);
+	}
+
+	UINT32 LightClusterGrid::tile(float ndc, UINT32 tiles) const
+	{
+		return std::min<UINT32>((UINT32) std::max<float>((ndc * 0.5F + 0.5F) * tiles, 0.0F), tiles - 1);
+	}
+
+	UINT32 LightClusterGrid::clusterIndex(FXMVECTOR viewPos) const
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, viewPos);
+		if(p.z < mNear || p.z >= mFar)
+			return UINT32_MAX;
+
+		float ndcX = p.x / p.z * mProjScale.x;
+		float ndcY = p.y / p.z * mProjScale.y;
+		if(fabsf(ndcX) > 1.0F || fabsf(ndcY) > 1.0F)
+			return UINT32_MAX;
+		return tile(ndcX, CLUSTER_GRID_X) + CLUSTER_GRID_X * (tile(ndcY, CLUSTER_GRID_Y) + CLUSTER_GRID_Y * slice(p.z));
+	}
+
+	void LightClusterGrid::buildBounds(float fovY, float aspect, float nearZ)
+	{
+		mLens = { fovY, aspect, nearZ };
+		mNear = std::max<float>(nearZ, 1e-3F);
+		mFar = std::max<float>(CLUSTER_GRID_FAR_Z, 2.0F * mNear);
+		mSliceScale = CLUSTER_GRID_Z / logf(mFar / mNear);
+		float tanY = tanf(0.5F * fovY);
+		mProjScale = { 1.0F / (tanY * aspect), 1.0F / tanY };
+
+		mBoundsMin.resize(CLUSTER_GRID_COUNT);
+		mBoundsMax.resize(CLUSTER_GRID_COUNT);
+		for(UINT32 z = 0; z < CLUSTER_GRID_Z; ++z)
+		{
+			float zNear = mNear * expf(z / mSliceScale);
+			float zFar = mNear * expf((z + 1) / mSliceScale);
+			for(UINT32 y = 0; y < CLUSTER_GRID_Y; ++y)
+			{
+				//tile edges in ndc scaled back to view space at both ends of the slice
+				float y0 = (2.0F * y / CLUSTER_GRID_Y - 1.0F) / mProjScale.y;
+				float y1 = (2.0F * (y + 1) / CLUSTER_GRID_Y - 1.0F) / mProjScale.y;
+				for(UINT32 x = 0; x < CLUSTER_GRID_X; ++x)
+				{
+					float x0 = (2.0F * x / CLUSTER_GRID_X - 1.0F) / mProjScale.x;
+					float x1 = (2.0F * (x + 1) / CLUSTER_GRID_X - 1.0F) / mProjScale.x;
+
+					UINT32 c = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+					mBoundsMin[c] = { std::min<float>(x0 * zNear, x0 * zFar), std::min<float>(y0 * zNear, y0 * zFar), zNear };
+					mBoundsMax[c] = { std::max<float>(x1 * zNear, x1 * zFar), std::max<float>(y1 * zNear, y1 * zFar), zFar };
+				}
+			}
+		}
+	}
+
+	void LightClusterGrid::build(const Light* lights, UINT32 count, FXMMATRIX view, float fovY, float aspect, float nearZ)
+	{
+		Timer timer;
+		timer.reset();
+
+		if(mBoundsMin.empty() || fovY != mLens.x || aspect != mLens.y || nearZ != mLens.z)
+			buildBounds(fovY, aspect, nearZ);
+
+		//view space spheres and the froxels they may touch
+		mRanges.resize(count);
+		parallelFor(UINT32(0), count, [&](UINT32 i)
+		{
+			LightRange& r = mRanges[i];
+			r.visible = false;
+			if(lights[i].lightType == LIGHT_TYPE_DIRECTIONAL)
+				return;
+
+			XMStoreFloat3(&r.center, XMVector3TransformCoord(XMLoadFloat3(&lights[i].Position), view));
+			r.radius = std::max<float>(lights[i].FalloffEnd, 0.0F) + lights[i].radius;
+			float zMin = std::max<float>(r.center.z - r.radius, mNear);
+			float zMax = std::min<float>(r.center.z + r.radius, mFar);
+			if(zMin >= zMax)
+				return;
+
+			//for a fixed x, x / z is monotonic in depth so the extremes are at the depth bounds
+			float left = std::min<float>((r.center.x - r.radius) / zMin, (r.center.x - r.radius) / zMax) * mProjScale.x;
+			float right = std::max<float>((r.center.x + r.radius) / zMin, (r.center.x + r.radius) / zMax) * mProjScale.x;
+			float bottom = std::min<float>((r.center.y - r.radius) / zMin, (r.center.y - r.radius) / zMax) * mProjScale.y;
+			float top = std::max<float>((r.center.y + r.radius) / zMin, (r.center.y + r.radius) / zMax) * mProjScale.y;
+			if(left > 1.0F || right < -1.0F || bottom > 1.0F || top < -1.0F)
+				return;
+
+			r.x0 = tile(left, CLUSTER_GRID_X);
+			r.x1 = tile(right, CLUSTER_GRID_X);
+			r.y0 = tile(bottom, CLUSTER_GRID_Y);
+			r.y1 = tile(top, CLUSTER_GRID_Y);
+			r.z0 = slice(zMin);
+			r.z1 = slice(zMax);
+			r.visible = true;
+		});
+
+		mSliceLights.resize(CLUSTER_GRID_Z);
+		for(auto& s:mSliceLights)
+			s.clear();
+		for(UINT32 i = 0; i < count; ++i)
+		{
+			if(!mRanges[i].visible)
+				continue;
+			for(UINT32 z = mRanges[i].z0; z <= mRanges[i].z1; ++z)
+				mSliceLights[z].push_back(i);
+		}
+
+		//every slice owns its froxels, the lists come out sorted by light index
+		mClusterLights.resize(CLUSTER_GRID_COUNT);
+		parallelFor(UINT32(0), UINT32(CLUSTER_GRID_Z), [&](UINT32 z)
+		{
+			const UINT32 sliceSize = CLUSTER_GRID_X * CLUSTER_GRID_Y;
+			for(UINT32 c = z * sliceSize; c < (z + 1) * sliceSize; ++c)
+				mClusterLights[c].clear();
+
+			for(UINT32 i:mSliceLights[z])
+			{
+				const LightRange& r = mRanges[i];
+				for(UINT32 y = r.y0; y <= r.y1; ++y)
+				{
+					for(UINT32 x = r.x0; x <= r.x1; ++x)
+					{
+						UINT32 c = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+						if(sphereTouchesBox(r.center, r.radius, mBoundsMin[c], mBoundsMax[c]))
+							mClusterLights[c].push_back(i);
+					}
+				}
+			}
+		});
+
+		//froxels that do not fit anymore are flagged, the rest are packed in order
+		mClusters.resize(CLUSTER_GRID_COUNT);
+		mOverflows = 0;
+		UINT32 offset = 0;
+		for(UINT32 c = 0; c < CLUSTER_GRID_COUNT; ++c)
+		{
+			UINT32 n = (UINT32) mClusterLights[c].size();
+			if(offset + n > CLUSTER_GRID_INDEX_CAPACITY)
+			{
+				mClusters[c] = { 0, CLUSTER_OVERFLOW };
+				mOverflows++;
+				continue;
+			}
+			mClusters[c] = { offset, n };
+			offset += n;
+		}
+
+		mIndices.resize(offset);
+		parallelFor(UINT32(0), UINT32(CLUSTER_GRID_COUNT), [&](UINT32 c)
+		{
+			if(mClusters[c].count != CLUSTER_OVERFLOW && mClusters[c].count > 0)
+				memcpy(&mIndices[mClusters[c].offset], mClusterLights[c].data(), mClusters[c].count * sizeof(UINT32));
+		});
+
+		timer.tick();
+		mBuildMs = timer.deltaTime() * 1000.0F;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define CLUSTER_GRID_X					16
+#define CLUSTER_GRID_Y					9
+#define CLUSTER_GRID_Z					24
+#define CLUSTER_GRID_COUNT				(CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define CLUSTER_GRID_FAR_Z				300.0F //points further away sample the light tree instead
+#define CLUSTER_GRID_AVERAGE_LIGHTS		32 //index capacity per cluster on average
+#define CLUSTER_GRID_INDEX_CAPACITY		(CLUSTER_GRID_COUNT * CLUSTER_GRID_AVERAGE_LIGHTS)
+#define CLUSTER_OVERFLOW				0xFFFFFFFF //clusters that did not fit, the shaders fall back to the light tree
+
+namespace RT
+{
+	//one per froxel, mirrored by LightCluster in common.hlsli
+	struct LightCluster
+	{
+		UINT32 offset; //into the index list
+		UINT32 count; //local lights reaching the froxel, or CLUSTER_OVERFLOW
+	};
+
+	//view frustum froxels with the local lights reaching each of them, exponential slices in depth
+	//directional lights reach everything and are left to the shaders
+	class LightClusterGrid
+	{
+	public:
+		LightClusterGrid() = default;
+		~LightClusterGrid() = default;
+
+		void build(const Light* lights, UINT32 count, DirectX::FXMMATRIX view, float fovY, float aspect, float nearZ);
+
+		//same mapping as lightCluster in light_cluster.hlsli, UINT32_MAX outside the grid
+		UINT32 clusterIndex(DirectX::FXMVECTOR viewPos) const;
+
+		inline const std::vector<LightCluster>& getClusters() const { return mClusters; }
+		inline const std::vector<UINT32>& getIndices() const { return mIndices; }
+		inline DirectX::XMFLOAT4 getDepthParams() const { return { mNear, mFar, mSliceScale, 0.0F }; }
+		inline DirectX::XMFLOAT2 getProjScale() const { return mProjScale; }
+		inline UINT32 getOverflowCount() const { return mOverflows; }
+		inline float getBuildTime() const { return mBuildMs; }
+	private:
+		struct LightRange
+		{
+			DirectX::XMFLOAT3 center; //view space
+			float radius;
+			UINT32 x0, x1, y0, y1, z0, z1;
+			bool visible;
+		};
+
+		void buildBounds(float fovY, float aspect, float nearZ);
+		UINT32 slice(float z) const;
+		UINT32 tile(float ndc, UINT32 tiles) const;
+
+		std::vector<LightCluster> mClusters;
+		std::vector<UINT32> mIndices;
+
+		//view space bounds of every froxel, rebuilt when the lens changes
+		std::vector<DirectX::XMFLOAT3> mBoundsMin;
+		std::vector<DirectX::XMFLOAT3> mBoundsMax;
+		DirectX::XMFLOAT3 mLens = { 0.0F, 0.0F, 0.0F };
+
+		//scratch kept between builds
+		std::vector<LightRange> mRanges;
+		std::vector<std::vector<UINT32>> mSliceLights;
+		std::vector<std::vector<UINT32>> mClusterLights;
+
+		float mNear = 0.0F;
+		float mFar = 0.0F;
+		float mSliceScale = 0.0F; //slices per unit of log depth
+		DirectX::XMFLOAT2 mProjScale = { 0.0F, 0.0F }; //view x and y over z to ndc
+		UINT32 mOverflows = 0;
+		float mBuildMs = 0.0F;
+	};
+}
\ No newline at end of file
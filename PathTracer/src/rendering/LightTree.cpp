@@ -0,0 +1,445 @@
+#include "LightTree.h"
+
+#include "../utils/Timer.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	static float luminance(const XMFLOAT3& c)
+	{
+		return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+	}
+
+	static float surfaceArea(const LightTreeNode& node)
+	{
+		float x = node.boundsMax.x - node.boundsMin.x;
+		float y = node.boundsMax.y - node.boundsMin.y;
+		float z = node.boundsMax.z - node.boundsMin.z;
+		return 2.0F * (x * y + y * z + z * x);
+	}
+
+	static float safeAcos(float x)
+	{
+		return acosf(std::clamp<float>(x, -1.0F, 1.0F));
+	}
+
+	LightTreeNode LightTree::makeLeaf(const Light& light, UINT32 index)
+	{
+		LightTreeNode node = {};
+		node.offset = index;
+		node.count = 1;
+		node.power = std::max<float>(luminance(light.Strength), 0.0F);
+		node.axis = { 0.0F, 0.0F, 1.0F };
+		node.cosThetaO = -1.0F; //every direction
+		node.cosThetaE = 0.0F;
+		node.range = FLT_MAX;
+
+		if(light.lightType == LIGHT_TYPE_DIRECTIONAL)
+		{
+			XMStoreFloat3(&node.axis, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+			node.cosThetaO = 1.0F;
+			return node;
+		}
+
+		XMVECTOR pos = XMLoadFloat3(&light.Position);
+		XMVECTOR radius = XMVectorReplicate(std::max<float>(light.radius, 0.0F));
+		XMStoreFloat3(&node.boundsMin, pos - radius);
+		XMStoreFloat3(&node.boundsMax, pos + radius);
+		node.range = light.FalloffEnd;
+
+		//the cone ends where pow(cos, SpotPower) gets negligible
+		if(light.lightType == LIGHT_TYPE_SPOTLIGHT && light.SpotPower > 0.0F)
+		{
+			XMStoreFloat3(&node.axis, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+			node.cosThetaO = powf(LIGHT_TREE_SPOT_CUTOFF, 1.0F / light.SpotPower);
+		}
+
+		//lambertian, all of it within 90 degrees of the normal
+		if(light.lightType == LIGHT_TYPE_TRIANGLE)
+		{
+			XMStoreFloat3(&node.axis, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+			node.cosThetaO = 1.0F;
+			node.cosThetaE = 0.0F;
+		}
+
+		return node;
+	}
+
+	LightTreeNode LightTree::merge(const LightTreeNode& a, const LightTreeNode& b)
+	{
+		LightTreeNode node = {};
+		XMStoreFloat3(&node.boundsMin, XMVectorMin(XMLoadFloat3(&a.boundsMin), XMLoadFloat3(&b.boundsMin)));
+		XMStoreFloat3(&node.boundsMax, XMVectorMax(XMLoadFloat3(&a.boundsMax), XMLoadFloat3(&b.boundsMax)));
+		node.power = a.power + b.power;
+		node.range = std::max<float>(a.range, b.range);
+		node.cosThetaE = std::min<float>(a.cosThetaE, b.cosThetaE);
+
+		//smallest cone around both, a is the wider one
+		const LightTreeNode* wide = &a;
+		const LightTreeNode* narrow = &b;
+		if(b.cosThetaO < a.cosThetaO)
+			std::swap(wide, narrow);
+
+		float thetaA = safeAcos(wide->cosThetaO);
+		float thetaB = safeAcos(narrow->cosThetaO);
+		XMVECTOR axisA = XMLoadFloat3(&wide->axis);
+		XMVECTOR axisB = XMLoadFloat3(&narrow->axis);
+		float thetaD = safeAcos(XMVectorGetX(XMVector3Dot(axisA, axisB)));
+
+		node.axis = wide->axis;
+		node.cosThetaO = wide->cosThetaO;
+		if(std::min<float>(thetaD + thetaB, XM_PI) <= thetaA)
+			return node;
+
+		float thetaO = 0.5F * (thetaA + thetaD + thetaB);
+		XMVECTOR rotation = XMVector3Cross(axisA, axisB);
+		if(thetaO >= XM_PI || XMVectorGetX(XMVector3LengthSq(rotation)) < 1e-12F)
+		{
+			node.cosThetaO = -1.0F;
+			return node;
+		}
+
+		XMVECTOR q = XMQuaternionRotationNormal(XMVector3Normalize(rotation), thetaO - thetaA);
+		XMStoreFloat3(&node.axis, XMVector3Normalize(XMVector3Rotate(axisA, q)));
+		node.cosThetaO = cosf(thetaO);
+		return node;
+	}
+
+	//orientation part of the SAOH cost from Conty Estevez and Kulla
+	float LightTree::orientationMeasure(const LightTreeNode& node)
+	{
+		float thetaO = safeAcos(node.cosThetaO);
+		float thetaE = safeAcos(node.cosThetaE);
+		float thetaW = std::min<float>(thetaO + thetaE, XM_PI);
+		float sinO = sinf(thetaO);
+		return XM_2PI * (1.0F - node.cosThetaO) + XM_PIDIV2 * (2.0F * thetaW * sinO - cosf(thetaO - 2.0F * thetaW) - 2.0F * thetaO * sinO + node.cosThetaO);
+	}
+
+	float LightTree::importance(FXMVECTOR pos, FXMVECTOR norm, const LightTreeNode& node)
+	{
+		if(node.power <= 0.0F)
+			return 0.0F;
+
+		XMVECTOR boundsMin = XMLoadFloat3(&node.boundsMin);
+		XMVECTOR boundsMax = XMLoadFloat3(&node.boundsMax);
+		XMVECTOR toLight = 0.5F * (boundsMin + boundsMax) - pos;
+		float radius = 0.5F * XMVectorGetX(XMVector3Length(boundsMax - boundsMin));
+		float dist = XMVectorGetX(XMVector3Length(toLight));
+		if(dist - radius > node.range)
+			return 0.0F;
+
+		//angles are widened by the bounding sphere as seen from the point
+		XMVECTOR dir = toLight / std::max<float>(dist, 1e-6F);
+		float thetaU = dist > radius ? safeAcos(sqrtf(1.0F - (radius / dist) * (radius / dist))) : XM_PI;
+
+		float theta = safeAcos(-XMVectorGetX(XMVector3Dot(XMLoadFloat3(&node.axis), dir)));
+		float thetaP = std::max<float>(theta - safeAcos(node.cosThetaO) - thetaU, 0.0F);
+		if(thetaP >= safeAcos(node.cosThetaE))
+			return 0.0F;
+
+		float thetaI = safeAcos(XMVectorGetX(XMVector3Dot(norm, dir)));
+		float thetaIP = std::max<float>(thetaI - thetaU, 0.0F);
+		if(thetaIP >= XM_PIDIV2)
+			return 0.0F;
+
+		float dist2 = std::max<float>(dist * dist, std::max<float>(radius * radius, 1e-4F));
+		return node.power * cosf(thetaP) * cosf(thetaIP) / dist2;
+	}
+
+	UINT32 LightTree::buildRecursive(std::vector<BuildItem>& items, UINT32 begin, UINT32 end, UINT32 depth)
+	{
+		mStats.maxDepth = std::max<UINT32>(mStats.maxDepth, depth);
+
+		UINT32 index = (UINT32) mNodes.size();
+		if(end - begin == 1)
+		{
+			mNodes.push_back(items[begin].leaf);
+			return index;
+		}
+		mNodes.emplace_back();
+
+		XMVECTOR centroidMin = XMLoadFloat3(&items[begin].centroid);
+		XMVECTOR centroidMax = centroidMin;
+		for(UINT32 i = begin + 1; i < end; ++i)
+		{
+			XMVECTOR c = XMLoadFloat3(&items[i].centroid);
+			centroidMin = XMVectorMin(centroidMin, c);
+			centroidMax = XMVectorMax(centroidMax, c);
+		}
+		XMFLOAT3 extent;
+		XMStoreFloat3(&extent, centroidMax - centroidMin);
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		XMFLOAT3 origin;
+		XMStoreFloat3(&origin, centroidMin);
+		float axisMin = (&origin.x)[axis];
+		float axisExtent = (&extent.x)[axis];
+
+		UINT32 mid = begin;
+		if(depth < LIGHT_TREE_MEDIAN_DEPTH && axisExtent > 1e-6F)
+		{
+			//binned SAOH on the widest axis
+			auto binOf = [&](const BuildItem& item)
+			{
+				int bin = (int) (((&item.centroid.x)[axis] - axisMin) / axisExtent * LIGHT_TREE_BINS);
+				return std::clamp<int>(bin, 0, LIGHT_TREE_BINS - 1);
+			};
+
+			LightTreeNode bins[LIGHT_TREE_BINS] = {};
+			UINT32 binCounts[LIGHT_TREE_BINS] = {};
+			for(UINT32 i = begin; i < end; ++i)
+			{
+				int bin = binOf(items[i]);
+				bins[bin] = binCounts[bin] == 0 ? items[i].leaf : merge(bins[bin], items[i].leaf);
+				binCounts[bin]++;
+			}
+
+			auto cost = [](const LightTreeNode& node) { return node.power * surfaceArea(node) * orientationMeasure(node); };
+
+			float leftCosts[LIGHT_TREE_BINS] = {};
+			LightTreeNode left = {};
+			UINT32 leftCount = 0;
+			for(int b = 0; b < LIGHT_TREE_BINS - 1; ++b)
+			{
+				if(binCounts[b] > 0)
+				{
+					left = leftCount == 0 ? bins[b] : merge(left, bins[b]);
+					leftCount += binCounts[b];
+				}
+				leftCosts[b] = leftCount > 0 ? cost(left) : -1.0F;
+			}
+
+			float bestCost = FLT_MAX;
+			int bestSplit = -1;
+			LightTreeNode right = {};
+			UINT32 rightCount = 0;
+			for(int b = LIGHT_TREE_BINS - 1; b > 0; --b)
+			{
+				if(binCounts[b] > 0)
+				{
+					right = rightCount == 0 ? bins[b] : merge(right, bins[b]);
+					rightCount += binCounts[b];
+				}
+				if(rightCount == 0 || leftCosts[b - 1] < 0.0F)
+					continue;
+
+				float c = leftCosts[b - 1] + cost(right);
+				if(c < bestCost)
+				{
+					bestCost = c;
+					bestSplit = b;
+				}
+			}
+
+			if(bestSplit > 0)
+				mid = (UINT32) (std::partition(items.begin() + begin, items.begin() + end, [&](const BuildItem& item) { return binOf(item) < bestSplit; }) - items.begin());
+		}
+
+		if(mid == begin || mid == end)
+		{
+			mid = (begin + end) / 2;
+			std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+							 [axis](const BuildItem& a, const BuildItem& b) { return (&a.centroid.x)[axis] < (&b.centroid.x)[axis]; });
+		}
+
+		buildRecursive(items, begin, mid, depth + 1);
+		UINT32 right = buildRecursive(items, mid, end, depth + 1);
+
+		LightTreeNode node = merge(mNodes[index + 1], mNodes[right]);
+		node.offset = right;
+		node.count = 0;
+		mNodes[index] = node;
+		return index;
+	}
+
+	void LightTree::build(const Light* lights, UINT32 count)
+	{
+		Timer timer;
+		timer.reset();
+
+		std::vector<BuildItem> items;
+		std::vector<LightTreeNode> directional;
+		items.reserve(count);
+		for(UINT32 i = 0; i < count; ++i)
+		{
+			LightTreeNode leaf = makeLeaf(lights[i], i);
+			if(lights[i].lightType == LIGHT_TYPE_DIRECTIONAL)
+				directional.push_back(leaf);
+			else
+				items.push_back({ leaf, lights[i].Position });
+		}
+
+		mNodes.clear();
+		mNodes.reserve(2 * items.size() + directional.size());
+		mStats.maxDepth = 0;
+		if(!items.empty())
+			buildRecursive(items, 0, (UINT32) items.size(), 0);
+		mLocalNodes = (UINT32) mNodes.size();
+		mNodes.insert(mNodes.end(), directional.begin(), directional.end());
+
+		mParents.assign(mNodes.size(), UINT32_MAX);
+		mLeaves.assign(count, UINT32_MAX);
+		for(UINT32 i = 0; i < (UINT32) mNodes.size(); ++i)
+		{
+			if(mNodes[i].count == 0)
+			{
+				mParents[i + 1] = i;
+				mParents[mNodes[i].offset] = i;
+			}
+			else
+				mLeaves[mNodes[i].offset] = i;
+		}
+
+		mLights.assign(lights, lights + count);
+		mBuildCost = 0.0F;
+		for(UINT32 i = 0; i < mLocalNodes; ++i)
+			mBuildCost += mNodes[i].power * surfaceArea(mNodes[i]) * orientationMeasure(mNodes[i]);
+
+		timer.tick();
+		mStats.localLights = (UINT32) items.size();
+		mStats.directionalLights = (UINT32) directional.size();
+		mStats.nodeCount = (UINT32) mNodes.size();
+		mStats.buildMs = timer.deltaTime() * 1000.0F;
+		mStats.rebuilds++;
+	}
+
+	void LightTree::refit(const Light* lights)
+	{
+		Timer timer;
+		timer.reset();
+
+		//inner nodes above a changed leaf, parents always come before their children
+		std::vector<UINT8> dirty(mNodes.size(), 0);
+		for(UINT32 i = 0; i < (UINT32) mLights.size(); ++i)
+		{
+			if(memcmp(&lights[i], &mLights[i], sizeof(Light)) == 0)
+				continue;
+
+			mLights[i] = lights[i];
+			UINT32 node = mLeaves[i];
+			mNodes[node] = makeLeaf(lights[i], i);
+			for(UINT32 parent = mParents[node]; parent != UINT32_MAX && !dirty[parent]; parent = mParents[parent])
+				dirty[parent] = 1;
+		}
+
+		for(UINT32 i = mLocalNodes; i-- > 0;)
+		{
+			if(!dirty[i])
+				continue;
+
+			UINT32 right = mNodes[i].offset;
+			mNodes[i] = merge(mNodes[i + 1], mNodes[right]);
+			mNodes[i].offset = right;
+			mNodes[i].count = 0;
+		}
+
+		timer.tick();
+		mStats.refitMs = timer.deltaTime() * 1000.0F;
+		mStats.refits++;
+	}
+
+	bool LightTree::update(const Light* lights, UINT32 count)
+	{
+		bool topologyChanged = count != (UINT32) mLights.size();
+		for(UINT32 i = 0; i < count && !topologyChanged; ++i)
+			topologyChanged = lights[i].lightType != mLights[i].lightType;
+
+		if(topologyChanged)
+		{
+			build(lights, count);
+			return true;
+		}
+
+		if(count == 0 || memcmp(lights, mLights.data(), count * sizeof(Light)) == 0)
+			return false;
+
+		refit(lights);
+
+		//lights that moved far apart make the old splits useless
+		float cost = 0.0F;
+		for(UINT32 i = 0; i < mLocalNodes; ++i)
+			cost += mNodes[i].power * surfaceArea(mNodes[i]) * orientationMeasure(mNodes[i]);
+		if(cost > mBuildCost * LIGHT_TREE_REFIT_MAX_GROWTH)
+			build(lights, count);
+		return true;
+	}
+
+	float LightTree::splitProbability(FXMVECTOR pos, FXMVECTOR norm, UINT32 node) const
+	{
+		const LightTreeNode& left = mNodes[node + 1];
+		const LightTreeNode& right = mNodes[mNodes[node].offset];
+
+		//nothing reaches the point, the choice is by power so every light keeps a chance
+		float importanceLeft = importance(pos, norm, left);
+		float importanceRight = importance(pos, norm, right);
+		if(importanceLeft + importanceRight > 0.0F)
+			return importanceLeft / (importanceLeft + importanceRight);
+		if(left.power + right.power > 0.0F)
+			return left.power / (left.power + right.power);
+		return 0.5F;
+	}
+
+	UINT32 LightTree::sample(FXMVECTOR pos, FXMVECTOR norm, float u, float& pdf) const
+	{
+		pdf = 0.0F;
+		if(mNodes.empty())
+			return UINT32_MAX;
+
+		//one random number, rescaled after every choice
+		pdf = 1.0F;
+		UINT32 directionalCount = getDirectionalCount();
+		if(directionalCount > 0)
+		{
+			float share = mLocalNodes > 0 ? LIGHT_TREE_DIRECTIONAL_SHARE : 1.0F;
+			if(u < share)
+			{
+				UINT32 index = std::min<UINT32>((UINT32) (u / share * directionalCount), directionalCount - 1);
+				pdf = share / directionalCount;
+				return mNodes[mLocalNodes + index].offset;
+			}
+			u = (u - share) / (1.0F - share);
+			pdf = 1.0F - share;
+		}
+
+		UINT32 node = 0;
+		while(mNodes[node].count == 0)
+		{
+			float p = splitProbability(pos, norm, node);
+			if(u < p)
+			{
+				u /= p;
+				pdf *= p;
+				node = node + 1;
+			}
+			else
+			{
+				u = (u - p) / (1.0F - p);
+				pdf *= 1.0F - p;
+				node = mNodes[node].offset;
+			}
+			u = std::min<float>(u, 0.99999994F);
+		}
+		return mNodes[node].offset;
+	}
+
+	float LightTree::pdf(FXMVECTOR pos, FXMVECTOR norm, UINT32 lightIndex) const
+	{
+		if(lightIndex >= mLeaves.size())
+			return 0.0F;
+
+		UINT32 node = mLeaves[lightIndex];
+		UINT32 directionalCount = getDirectionalCount();
+		if(node >= mLocalNodes)
+			return (mLocalNodes > 0 ? LIGHT_TREE_DIRECTIONAL_SHARE : 1.0F) / directionalCount;
+
+		float result = directionalCount > 0 ? 1.0F - LIGHT_TREE_DIRECTIONAL_SHARE : 1.0F;
+		for(UINT32 parent = mParents[node]; parent != UINT32_MAX; node = parent, parent = mParents[parent])
+		{
+			float p = splitProbability(pos, norm, parent);
+			result *= node == parent + 1 ? p : 1.0F - p;
+		}
+		return result;
+	}
+}
\ No newline at end of file
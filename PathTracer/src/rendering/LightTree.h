@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define LIGHT_TREE_MAX_DEPTH			64 //also the traversal limit in light_tree.hlsli
+#define LIGHT_TREE_BINS					12
+#define LIGHT_TREE_MEDIAN_DEPTH			24 //deeper ranges are split at the median to keep the depth bounded
+#define LIGHT_TREE_DIRECTIONAL_SHARE	0.5F //chance of picking a directional light when there are local ones too
+#define LIGHT_TREE_REFIT_MAX_GROWTH		2.0F //refitted trees this much worse than their last build are rebuilt
+#define LIGHT_TREE_SPOT_CUTOFF			0.001F //spot attenuation treated as no light when bounding the cone
+
+namespace RT
+{
+	//flattened depth first like BVHNode, mirrored by LightTreeNode in common.hlsli
+	struct LightTreeNode
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		UINT32 offset; //right child for inner nodes, light index for leaves
+		DirectX::XMFLOAT3 boundsMax;
+		UINT32 count; //0 for inner nodes
+		DirectX::XMFLOAT3 axis; //emission cone
+		float power;
+		float cosThetaO; //spread of the axes
+		float cosThetaE; //emission around every axis
+		float range; //no light reaches further than this from the bounds
+		float pad;
+	};
+
+	struct LightTreeStats
+	{
+		UINT32 localLights = 0;
+		UINT32 directionalLights = 0;
+		UINT32 nodeCount = 0;
+		UINT32 maxDepth = 0;
+		float buildMs = 0.0F;
+		float refitMs = 0.0F;
+		UINT32 rebuilds = 0;
+		UINT32 refits = 0;
+	};
+
+	//importance sampling of many lights, the shaders traverse the same nodes stochastically
+	//local lights form the tree, directional lights are appended after it as leaves and picked uniformly
+	class LightTree
+	{
+	public:
+		LightTree() = default;
+		~LightTree() = default;
+
+		//rebuilds when the lights were added, removed or changed type, otherwise refits the nodes above the lights that changed
+		//returns true when the nodes changed and have to be uploaded again
+		bool update(const Light* lights, UINT32 count);
+		void build(const Light* lights, UINT32 count);
+
+		//index into the lights given to update, pdf is the discrete probability of that light
+		UINT32 sample(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR norm, float u, float& pdf) const;
+		float pdf(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR norm, UINT32 lightIndex) const;
+
+		static float importance(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR norm, const LightTreeNode& node);
+
+		inline const std::vector<LightTreeNode>& getNodes() const { return mNodes; }
+		inline UINT32 getLocalNodeCount() const { return mLocalNodes; }
+		inline UINT32 getDirectionalCount() const { return (UINT32) mNodes.size() - mLocalNodes; }
+		inline const LightTreeStats& getStats() const { return mStats; }
+	private:
+		struct BuildItem
+		{
+			LightTreeNode leaf;
+			DirectX::XMFLOAT3 centroid;
+		};
+
+		UINT32 buildRecursive(std::vector<BuildItem>& items, UINT32 begin, UINT32 end, UINT32 depth);
+		void refit(const Light* lights);
+		float splitProbability(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR norm, UINT32 node) const;
+
+		static LightTreeNode makeLeaf(const Light& light, UINT32 index);
+		static LightTreeNode merge(const LightTreeNode& a, const LightTreeNode& b);
+		static float orientationMeasure(const LightTreeNode& node);
+
+		std::vector<LightTreeNode> mNodes;
+		UINT32 mLocalNodes = 0;
+		std::vector<UINT32> mParents; //UINT32_MAX for the root and directional leaves
+		std::vector<UINT32> mLeaves; //node of every light
+
+		//what the last build or refit saw, to find the lights that moved
+		std::vector<Light> mLights;
+		float mBuildCost = 0.0F;
+		LightTreeStats mStats;
+	};
+}
\ No newline at end of file
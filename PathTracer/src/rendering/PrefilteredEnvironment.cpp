@@ -0,0 +1,353 @@
+#include "PrefilteredEnvironment.h"
+#include "EnvironmentMap.h"
+
+#include "../utils/Timer.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#define PREFILTER_CACHE_MAGIC			0x46474755 //UGGF
+#define PREFILTER_CACHE_VERSION			1
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace RT
+{
+	//the same points for every texel and every run
+	static XMFLOAT2 hammersley(UINT32 i, UINT32 count)
+	{
+		UINT32 bits = i;
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555) << 1) | ((bits & 0xAAAAAAAA) >> 1);
+		bits = ((bits & 0x33333333) << 2) | ((bits & 0xCCCCCCCC) >> 2);
+		bits = ((bits & 0x0F0F0F0F) << 4) | ((bits & 0xF0F0F0F0) >> 4);
+		bits = ((bits & 0x00FF00FF) << 8) | ((bits & 0xFF00FF00) >> 8);
+		return XMFLOAT2((i + 0.5F) / count, bits * 2.3283064365386963e-10F);
+	}
+
+	//half vector around +Z drawn proportionally to D * NdotH, alpha = roughness^2 like VNDF in the shaders
+	static XMFLOAT3 sampleGGX(const XMFLOAT2& u, float alpha)
+	{
+		float a2 = alpha * alpha;
+		float cosTheta = sqrtf((1.0F - u.y) / (1.0F + (a2 - 1.0F) * u.y));
+		float sinTheta = sqrtf(std::max<float>(1.0F - cosTheta * cosTheta, 0.0F));
+		float phi = XM_2PI * u.x;
+		return XMFLOAT3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+	}
+
+	static float Dggx(float NdotH, float alpha)
+	{
+		float a2 = alpha * alpha;
+		float denom = NdotH * NdotH * (a2 - 1.0F) + 1.0F;
+		return a2 / (XM_PI * denom * denom);
+	}
+
+	static float G1ggx(float NdotX, float alpha)
+	{
+		float a2 = alpha * alpha;
+		return 2.0F * NdotX / (NdotX + sqrtf(a2 + (1.0F - a2) * NdotX * NdotX));
+	}
+
+	std::vector<std::vector<XMFLOAT3>> PrefilteredEnvironment::prefilter(const std::vector<XMFLOAT3>& texels, UINT32 size, UINT32 mips, UINT32 samples)
+	{
+		//box filtered pyramid of the source, the samples read the level matching their solid angle
+		std::vector<std::vector<XMFLOAT3>> pyramid = { texels };
+		for(UINT32 s = size / 2; s > 0; s /= 2)
+		{
+			const std::vector<XMFLOAT3>& src = pyramid.back();
+			std::vector<XMFLOAT3> level((size_t) 6 * s * s);
+			for(UINT32 face = 0; face < 6; ++face)
+			{
+				for(UINT32 y = 0; y < s; ++y)
+				{
+					for(UINT32 x = 0; x < s; ++x)
+					{
+						XMVECTOR sum = XMVectorZero();
+						for(UINT32 j = 0; j < 2; ++j)
+							for(UINT32 i = 0; i < 2; ++i)
+								sum += XMLoadFloat3(&src[((size_t) face * s * 2 + y * 2 + j) * s * 2 + x * 2 + i]);
+						XMStoreFloat3(&level[((size_t) face * s + y) * s + x], sum * 0.25F);
+					}
+				}
+			}
+			pyramid.push_back(std::move(level));
+		}
+
+		auto fetch = [&](FXMVECTOR dir, float lod)
+		{
+			UINT32 levels = (UINT32) pyramid.size();
+			lod = std::min<float>(lod, levels - 1.0F);
+			UINT32 low = (UINT32) lod;
+			UINT32 high = std::min<UINT32>(low + 1, levels - 1);
+
+			float u, v;
+			UINT32 face = EnvironmentMap::directionFace(dir, u, v);
+			auto texel = [&](UINT32 level)
+			{
+				UINT32 s = std::max<UINT32>(size >> level, 1);
+				UINT32 x = std::min<UINT32>((UINT32) std::max<float>(u * s, 0.0F), s - 1);
+				UINT32 y = std::min<UINT32>((UINT32) std::max<float>(v * s, 0.0F), s - 1);
+				return XMLoadFloat3(&pyramid[level][((size_t) face * s + y) * s + x]);
+			};
+			return XMVectorLerp(texel(low), texel(high), lod - low);
+		};
+
+		std::vector<std::vector<XMFLOAT3>> result(mips);
+		result[0] = texels;
+		const float texelAngle = 4.0F * XM_PI / (6.0F * size * size);
+		for(UINT32 m = 1; m < mips; ++m)
+		{
+			UINT32 s = std::max<UINT32>(size >> m, 1);
+			float alpha = (float) m / (mips - 1);
+			alpha *= alpha;
+
+			//N = V = R, so the light directions are the same around every texel and are worked out once per mip
+			struct Sample { XMFLOAT3 dir; float NdotL; float lod; };
+			std::vector<Sample> lobe;
+			for(UINT32 i = 0; i < samples; ++i)
+			{
+				XMFLOAT3 h = sampleGGX(hammersley(i, samples), alpha);
+				XMFLOAT3 l = { 2.0F * h.z * h.x, 2.0F * h.z * h.y, 2.0F * h.z * h.z - 1.0F };
+				if(l.z <= 0.0F)
+					continue;
+
+				//pdf = D * NdotH / (4 * VdotH) = D / 4 here
+				float pdf = Dggx(h.z, alpha) / 4.0F;
+				float sampleAngle = 1.0F / (samples * pdf + 1e-6F);
+				lobe.push_back({ l, l.z, std::max<float>(0.5F * log2f(sampleAngle / texelAngle) + 1.0F, 0.0F) });
+			}
+
+			result[m].resize((size_t) 6 * s * s);
+			parallelFor(UINT32(0), 6 * s, [&](UINT32 r)
+			{
+				UINT32 face = r / s;
+				UINT32 y = r % s;
+				for(UINT32 x = 0; x < s; ++x)
+				{
+					XMVECTOR N = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / s, (y + 0.5F) / s));
+					XMVECTOR up = fabsf(XMVectorGetZ(N)) < 0.999F ? XMVectorSet(0.0F, 0.0F, 1.0F, 0.0F) : XMVectorSet(1.0F, 0.0F, 0.0F, 0.0F);
+					XMVECTOR T = XMVector3Normalize(XMVector3Cross(up, N));
+					XMVECTOR B = XMVector3Cross(N, T);
+
+					XMVECTOR sum = XMVectorZero();
+					float weight = 0.0F;
+					for(auto& l:lobe)
+					{
+						XMVECTOR dir = T * l.dir.x + B * l.dir.y + N * l.dir.z;
+						sum += fetch(dir, l.lod) * l.NdotL;
+						weight += l.NdotL;
+					}
+					XMStoreFloat3(&result[m][(size_t) r * s + x], weight > 0.0F ? sum / weight : fetch(N, 0.0F));
+				}
+			});
+		}
+		return result;
+	}
+
+	XMFLOAT2 PrefilteredEnvironment::integrateBrdf(float NdotV, float roughness, UINT32 samples)
+	{
+		float alpha = roughness * roughness;
+		XMFLOAT3 v = { sqrtf(std::max<float>(1.0F - NdotV * NdotV, 0.0F)), 0.0F, NdotV };
+
+		//G * VdotH / (NdotH * NdotV) split by the Fresnel term, the part scaled by R0 and the part added to it
+		float scale = 0.0F, bias = 0.0F;
+		for(UINT32 i = 0; i < samples; ++i)
+		{
+			XMFLOAT3 h = sampleGGX(hammersley(i, samples), alpha);
+			float VdotH = v.x * h.x + v.z * h.z;
+			float NdotL = 2.0F * VdotH * h.z - v.z;
+			if(NdotL <= 0.0F || VdotH <= 0.0F)
+				continue;
+
+			float G = G1ggx(NdotV, alpha) * G1ggx(NdotL, alpha);
+			float visibility = G * VdotH / (h.z * NdotV);
+			float fc = powf(1.0F - VdotH, 5.0F);
+			scale += (1.0F - fc) * visibility;
+			bias += fc * visibility;
+		}
+		return XMFLOAT2(scale / samples, bias / samples);
+	}
+
+	std::vector<XMFLOAT2> PrefilteredEnvironment::integrateBrdf(UINT32 size, UINT32 samples)
+	{
+		std::vector<XMFLOAT2> table((size_t) size * size);
+		parallelFor(UINT32(0), size, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < size; ++x)
+				table[(size_t) y * size + x] = integrateBrdf((x + 0.5F) / size, (y + 0.5F) / size, samples);
+		});
+		return table;
+	}
+
+	std::wstring PrefilteredEnvironment::cubemapFile(const std::string& name)
+	{
+		std::string fileName = ENV_MAP_CACHE_DIR + name + "_ggx.dds";
+		return std::wstring(fileName.begin(), fileName.end());
+	}
+
+	std::wstring PrefilteredEnvironment::brdfLutFile()
+	{
+		std::string fileName = ENV_MAP_CACHE_DIR "brdf_lut.dds";
+		return std::wstring(fileName.begin(), fileName.end());
+	}
+
+	bool PrefilteredEnvironment::bakeCubemap(const std::string& name, bool useCache)
+	{
+		std::wstring source = L"res/cubemaps/" + std::wstring(name.begin(), name.end()) + L".dds";
+		std::wstring target = cubemapFile(name);
+
+		UINT64 stamp = 0;
+		if(!EnvironmentMap::sourceStamp(source, stamp))
+			return false;
+		if(useCache && isCached(target, stamp))
+			return true;
+
+		Timer timer;
+		timer.reset();
+
+		std::vector<XMFLOAT3> texels;
+		UINT32 size = 0;
+		if(!EnvironmentMap::decodeCubemap(source, texels, size, PREFILTER_SIZE))
+		{
+			Logger::WARN.log("Unsupported cubemap format for " + name + ", no prefiltered reflections");
+			return false;
+		}
+
+		UINT32 mips = 1;
+		while(mips < PREFILTER_MIPS && (size >> mips) > 0)
+			mips++;
+		if(!writeDDS(target, prefilter(texels, size, mips, PREFILTER_SAMPLES), size, stamp))
+			return false;
+
+		timer.tick();
+		Logger::INFO.log("Prefiltered " + name + " for GGX reflections in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+		return true;
+	}
+
+	bool PrefilteredEnvironment::bakeBrdfLut(bool useCache)
+	{
+		std::wstring target = brdfLutFile();
+		if(useCache && isCached(target, 0))
+			return true;
+
+		Timer timer;
+		timer.reset();
+		if(!writeDDS(target, integrateBrdf(BRDF_LUT_SIZE, BRDF_LUT_SAMPLES), BRDF_LUT_SIZE))
+			return false;
+
+		timer.tick();
+		Logger::INFO.log("Integrated the BRDF table in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+		return true;
+	}
+
+	//DDS_HEADER with a DX10 extension, the words are indexed from the magic
+	static void fillHeader(UINT32 (&header)[37], UINT32 size, UINT32 mips, UINT32 format, bool cube, UINT64 stamp)
+	{
+		memset(header, 0, sizeof(header));
+		header[0] = 0x20534444; //"DDS "
+		header[1] = 124;
+		header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000; //caps, height, width, pixel format, mip count
+		header[3] = size;
+		header[4] = size;
+		header[5] = size * (cube ? 8 : 4);
+		header[7] = mips;
+
+		//reserved words
+		header[8] = PREFILTER_CACHE_MAGIC;
+		header[9] = PREFILTER_CACHE_VERSION;
+		header[10] = (UINT32) stamp;
+		header[11] = (UINT32) (stamp >> 32);
+		header[12] = cube ? PREFILTER_SAMPLES : BRDF_LUT_SAMPLES;
+
+		header[19] = 32;
+		header[20] = 0x4; //DDPF_FOURCC
+		header[21] = 0x30315844; //"DX10"
+		header[27] = 0x1000 | (mips > 1 ? 0x400008 : 0); //texture, mipmap and complex
+		header[28] = cube ? 0xFE00 : 0; //cubemap with every face
+
+		header[32] = format;
+		header[33] = 3; //D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		header[34] = cube ? 0x4 : 0; //D3D11_RESOURCE_MISC_TEXTURECUBE
+		header[35] = 1;
+	}
+
+	bool PrefilteredEnvironment::writeDDS(const std::wstring& fileName, const std::vector<std::vector<XMFLOAT3>>& mips, UINT32 size, UINT64 stamp)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(ENV_MAP_CACHE_DIR, ec);
+
+		std::ofstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+		{
+			Logger::WARN.log("Couldn't write prefiltered cubemap " + std::string(fileName.begin(), fileName.end()));
+			return false;
+		}
+
+		UINT32 header[37];
+		fillHeader(header, size, (UINT32) mips.size(), DXGI_FORMAT_R16G16B16A16_FLOAT, true, stamp);
+		file.write((const char*) header, sizeof(header));
+
+		//faces one after the other, each with its whole mip chain
+		for(UINT32 face = 0; face < 6; ++face)
+		{
+			for(UINT32 m = 0; m < mips.size(); ++m)
+			{
+				UINT32 s = std::max<UINT32>(size >> m, 1);
+				std::vector<HALF> data((size_t) s * s * 4);
+				for(size_t i = 0; i < (size_t) s * s; ++i)
+				{
+					const XMFLOAT3& c = mips[m][(size_t) face * s * s + i];
+					data[i * 4 + 0] = XMConvertFloatToHalf(c.x);
+					data[i * 4 + 1] = XMConvertFloatToHalf(c.y);
+					data[i * 4 + 2] = XMConvertFloatToHalf(c.z);
+					data[i * 4 + 3] = XMConvertFloatToHalf(1.0F);
+				}
+				file.write((const char*) data.data(), sizeof(HALF) * data.size());
+			}
+		}
+		return true;
+	}
+
+	bool PrefilteredEnvironment::writeDDS(const std::wstring& fileName, const std::vector<XMFLOAT2>& table, UINT32 size)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(ENV_MAP_CACHE_DIR, ec);
+
+		std::ofstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+		{
+			Logger::WARN.log("Couldn't write BRDF table " + std::string(fileName.begin(), fileName.end()));
+			return false;
+		}
+
+		UINT32 header[37];
+		fillHeader(header, size, 1, DXGI_FORMAT_R16G16_FLOAT, false, 0);
+		file.write((const char*) header, sizeof(header));
+
+		std::vector<HALF> data(table.size() * 2);
+		for(size_t i = 0; i < table.size(); ++i)
+		{
+			data[i * 2 + 0] = XMConvertFloatToHalf(table[i].x);
+			data[i * 2 + 1] = XMConvertFloatToHalf(table[i].y);
+		}
+		file.write((const char*) data.data(), sizeof(HALF) * data.size());
+		return true;
+	}
+
+	bool PrefilteredEnvironment::isCached(const std::wstring& fileName, UINT64 stamp)
+	{
+		std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+		if(!file.is_open())
+			return false;
+
+		UINT32 header[37] = {};
+		file.read((char*) header, sizeof(header));
+		if(!file || header[8] != PREFILTER_CACHE_MAGIC || header[9] != PREFILTER_CACHE_VERSION || header[10] != (UINT32) stamp || header[11] != (UINT32) (stamp >> 32))
+		{
+			Logger::WARN.log("Ignoring stale prefiltered environment " + std::string(fileName.begin(), fileName.end()));
+			return false;
+		}
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define PREFILTER_SIZE					128 //texels per face side of the first mip, the cubemap is box filtered down to it
+#define PREFILTER_MIPS					6 //mip m holds roughness m / (PREFILTER_MIPS - 1)
+#define PREFILTER_SAMPLES				256
+#define BRDF_LUT_SIZE					64
+#define BRDF_LUT_SAMPLES				512
+
+namespace RT
+{
+	//split sum approximation of GGX reflections, after Karis. The radiance is prefiltered per roughness into the mips of a cubemap
+	//and the rest of the BRDF goes in a 2D table indexed by NdotV and roughness, both written to DDS under ENV_MAP_CACHE_DIR
+	class PrefilteredEnvironment
+	{
+	public:
+		//baked again only when the cubemap or the baker changes
+		static bool bakeCubemap(const std::string& name, bool useCache = true);
+		static bool bakeBrdfLut(bool useCache = true);
+		static std::wstring cubemapFile(const std::string& name);
+		static std::wstring brdfLutFile();
+
+		//faces laid out like EnvironmentMap::build in and out, one vector per mip. Every texel is independent so the result
+		//does not depend on the scheduling
+		static std::vector<std::vector<DirectX::XMFLOAT3>> prefilter(const std::vector<DirectX::XMFLOAT3>& texels, UINT32 size, UINT32 mips, UINT32 samples);
+		//scale and bias of R0, rows by roughness and columns by NdotV
+		static std::vector<DirectX::XMFLOAT2> integrateBrdf(UINT32 size, UINT32 samples);
+		static DirectX::XMFLOAT2 integrateBrdf(float NdotV, float roughness, UINT32 samples);
+	private:
+		friend struct PrefilteredEnvironmentTests; //reads back the DDS it writes without a cubemap on disk
+		PrefilteredEnvironment() = default;
+
+		//RGBA16F for the cubemap, RG16F for the table, the reserved words of the header hold what the cache is checked against
+		static bool writeDDS(const std::wstring& fileName, const std::vector<std::vector<DirectX::XMFLOAT3>>& mips, UINT32 size, UINT64 stamp);
+		static bool writeDDS(const std::wstring& fileName, const std::vector<DirectX::XMFLOAT2>& table, UINT32 size);
+		static bool isCached(const std::wstring& fileName, UINT64 stamp);
+	};
+}
\ No newline at end of file
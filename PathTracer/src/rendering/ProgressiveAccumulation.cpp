@@ -0,0 +1,60 @@
+#include "ProgressiveAccumulation.h"
+
+#include "../app/Scene.h"
+
+using namespace DirectX;
+
+namespace RT
+{
+	bool ProgressiveAccumulation::update(const SceneChangeState& state)
+	{
+		bool changed = !mValid || state.cameraMoved || state.entitiesChanged || state.materialsChanged || state.lightsHash != mLightsHash || state.settingsHash != mSettingsHash;
+
+		mLightsHash = state.lightsHash;
+		mSettingsHash = state.settingsHash;
+		mValid = true;
+
+		if(changed)
+			mFrames = 0;
+		mFrames = std::min<UINT>(mFrames + 1, PROGRESSIVE_MAX_FRAMES);
+		return changed;
+	}
+
+	SceneChangeState ProgressiveAccumulation::detectChanges(Scene* scene, Camera* cam, const settings_struct& settings)
+	{
+		SceneChangeState state;
+		state.cameraMoved = cam->isDirty();
+		for(auto& e:scene->getAllEntities())
+			state.entitiesChanged |= e->isDirty() || e->needsRefit();
+		for(auto& geo:scene->getResidentGeometries())
+			state.entitiesChanged |= geo && geo->needsRefit;
+		for(auto& m:scene->getMaterials())
+			state.materialsChanged |= m->NumFramesDirty > 0;
+
+		state.lightsHash = hash(nullptr, 0);
+		for(UINT i = 0; i < scene->getLightCount(); ++i)
+		{
+			Light l = scene->getLight(i);
+			state.lightsHash = hash(&l, sizeof(Light), state.lightsHash);
+		}
+
+		bool flags[] = { settings.lightSampling == LIGHT_SAMPLING_ALIAS, settings.lightSampling == LIGHT_SAMPLING_TREE, settings.lightSampling == LIGHT_SAMPLING_CLUSTERED, settings.progressive, settings.environmentSampling, settings.prefilteredReflections, settings.rtao, settings.rtReflections, settings.rtRefractions, settings.rtShadows, settings.indirect,
+						 settings.texturing, settings.mipmaps, settings.rayReconstruction };
+		state.settingsHash = hash(flags, sizeof(flags));
+		state.settingsHash = hash(&settings.texFilter, sizeof(TexFilter), state.settingsHash);
+		state.settingsHash = hash(&settings.dlss, sizeof(settings.dlss), state.settingsHash);
+		return state;
+	}
+
+	UINT64 ProgressiveAccumulation::hash(const void* data, size_t size, UINT64 seed)
+	{
+		const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+		UINT64 h = seed;
+		for(size_t i = 0; i < size; ++i)
+		{
+			h ^= bytes[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+}
\ No newline at end of file
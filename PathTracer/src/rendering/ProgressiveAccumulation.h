@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define PROGRESSIVE_MAX_FRAMES		(1 << 20)
+
+namespace RT
+{
+	class Scene;
+	class Camera;
+
+	//what changed since the last frame, filled by the renderer before the frame data is uploaded
+	struct SceneChangeState
+	{
+		bool cameraMoved = false;
+		bool entitiesChanged = false; //transforms, refits and deforming geometry
+		bool materialsChanged = false;
+		UINT64 lightsHash = 0;
+		UINT64 settingsHash = 0;
+	};
+
+	//keeps the running sample count of a static view, knows nothing about the device so it can be driven from anywhere
+	class ProgressiveAccumulation
+	{
+	public:
+		ProgressiveAccumulation() = default;
+		~ProgressiveAccumulation() = default;
+
+		//returns true when the accumulated frames are thrown away
+		bool update(const SceneChangeState& state);
+		inline void reset() { mFrames = 0; mValid = false; }
+
+		//samples in the buffer including the current frame, 0 before the first update
+		inline UINT getFrameCount() const { return mFrames; }
+		inline bool shouldReport() const { return mFrames > 1 && (mFrames & (mFrames - 1)) == 0; }
+
+		//reads the dirty flags, so call it before the frame update cleans them
+		static SceneChangeState detectChanges(Scene* scene, Camera* cam, const settings_struct& settings);
+		//FNV-1a, cheap enough to run over the lights every frame
+		static UINT64 hash(const void* data, size_t size, UINT64 seed = 14695981039346656037ULL);
+	private:
+		UINT mFrames = 0;
+		UINT64 mLightsHash = 0;
+		UINT64 mSettingsHash = 0;
+		bool mValid = false;
+	};
+}
\ No newline at end of file
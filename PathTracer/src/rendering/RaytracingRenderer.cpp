@@ -363,7 +363,7 @@ namespace RT
 		ThrowIfFailed(md3dDevice->CreateCommittedResource(&hpd, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&mMVCopy)));
 		ThrowIfFailed(md3dDevice->CreateCommittedResource(&hpd, D3D12_HEAP_FLAG_NONE, &resDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&mViewAndRF0)));
 
-		UINT stride = 2 * sizeof(float) + 2 * sizeof(UINT);
+		UINT stride = sizeof(Reservoir);
 		UINT elements = settings->getWidth() * settings->getHeight();
 
 		resDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
@@ -388,8 +388,12 @@ namespace RT
 		std::vector<UINT16> instanceCount;
 		for(auto& i:mScene->getAllEntities())
 			instanceCount.push_back(i->getMaxInstances());
+		//a leaf and an inner node per light at most, never empty so the hit groups always have a buffer
+		UINT lights = std::max<UINT>(mScene->getLightCount(), 1);
 		for(int i = 0; i < NUM_FRAME_RESOURCES; ++i)
-			frameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1, mScene->getMaterialCount(), instanceCount));
+			frameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(), 1, mScene->getMaterialCount(), instanceCount, std::vector<std::tuple<UINT, UINT, UINT>>(), 2 * lights, lights));
+		mLightsFramesDirty = NUM_FRAME_RESOURCES;
+		mLightGridFramesDirty = NUM_FRAME_RESOURCES;
 	}
 
 	void RaytracingRenderer::allocatePostProcessingResources()
@@ -430,6 +434,15 @@ namespace RT
 			handle.Offset(1, mCbvSrvUavDescriptorSize);
 			srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
 			md3dDevice->CreateShaderResourceView(mZDepth.Get(), &srvDesc, handle);
+			handle.Offset(1, mCbvSrvUavDescriptorSize);
+
+			//noisy signals for progressive accumulation
+			srvDesc.Format = settings->backBufferFormat;
+			md3dDevice->CreateShaderResourceView(mSpecular.Get(), &srvDesc, handle);
+			handle.Offset(1, mCbvSrvUavDescriptorSize);
+			md3dDevice->CreateShaderResourceView(mDiffSH1.Get(), &srvDesc, handle);
+			handle.Offset(1, mCbvSrvUavDescriptorSize);
+			md3dDevice->CreateShaderResourceView(mSpecSH1.Get(), &srvDesc, handle);
 		}
 
 		D3D12_SHADER_RESOURCE_VIEW_DESC buffer = {};
@@ -437,7 +450,7 @@ namespace RT
 		buffer.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		buffer.Buffer.FirstElement = 0;
 		buffer.Buffer.NumElements = settings->getWidth() * settings->getHeight();
-		buffer.Buffer.StructureByteStride = 2 * sizeof(float) + 2 * sizeof(UINT);
+		buffer.Buffer.StructureByteStride = sizeof(Reservoir);
 		buffer.Format = DXGI_FORMAT_UNKNOWN;
 
 		//restir spatial
@@ -461,7 +474,7 @@ namespace RT
 		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
 		uavDesc.Buffer.NumElements = settings->getWidth() * settings->getHeight();
-		uavDesc.Buffer.StructureByteStride = 2 * sizeof(float) + 2 * sizeof(UINT);
+		uavDesc.Buffer.StructureByteStride = sizeof(Reservoir);
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		md3dDevice->CreateUnorderedAccessView(mCandidateHistory.Get(), nullptr, &uavDesc, handle);
 	}
@@ -508,7 +521,8 @@ namespace RT
 		Logger::INFO.log("Creating acceleration structures...");
 
 		for(auto& data:mScene->getResidentGeometries())
-			mBlbs[data->name] = createBottomLevelAS(data->name, { { data->VertexBufferGPU, data->vertexCount } }, { { data->IndexBufferGPU, data->DrawArgs["0"].IndexCount } }, false, data->isWater, false);
+			if(data)
+				mBlbs[data->name] = createBottomLevelAS(data->name, { { data->gpu->VertexBufferGPU, data->vertexCount } }, { { data->gpu->IndexBufferGPU, data->DrawArgs["0"].IndexCount } }, false, data->isWater || data->isSkinned, false);
 
 		for(auto& i:mScene->getAllEntities())
 		{
@@ -542,6 +556,7 @@ namespace RT
 	{
 		nv_helpers_dx12::RootSignatureGenerator rsc;
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_CBV, 0);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 3);
 		rsc.AddHeapRangesParameter({ { 0, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, CUBEMAP_OFFSET } });
 		auto samplers = getStaticSamplers();
 		rsc.Generate(md3dDevice.Get(), true, pRootSig, (UINT) samplers.size(), samplers.data());
@@ -555,6 +570,13 @@ namespace RT
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1);
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 1);
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 2, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 3, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 4, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 5, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 6, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 7, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 3);
 		rsc.AddHeapRangesParameter({ { 0, RESERVED_SPACE, 2, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0 }, { 2, 2, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, RESERVED_SPACE + RAY_GEN_UAV_RES } });
 		auto samplers = getStaticSamplers();
 		rsc.Generate(md3dDevice.Get(), true, pRootSig, (UINT) samplers.size(), samplers.data());
@@ -568,6 +590,7 @@ namespace RT
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1);
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 1);
 		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 1, 1);
+		rsc.AddRootParameter(D3D12_ROOT_PARAMETER_TYPE_SRV, 0, 3);
 		rsc.AddHeapRangesParameter({ { 0, 2, 2, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 0 }, { 2, 1, 2, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, EMISSIVE_OFFSET },
 									 { 2, 1, 0, D3D12_DESCRIPTOR_RANGE_TYPE_SRV, RESERVED_SPACE + RAY_GEN_UAV_RES } });
 		auto samplers = getStaticSamplers();
@@ -653,6 +676,7 @@ namespace RT
 			});
 			mSBTHelper.AddMissProgram(L"Miss", {
 				(void*) frameResources[j]->passCB->resource()->GetGPUVirtualAddress(),
+				(void*) frameResources[j]->lights->resource()->GetGPUVirtualAddress(),
 				heapPointer
 			});
 			mSBTHelper.AddMissProgram(L"ShadowMiss", {});
@@ -669,25 +693,33 @@ namespace RT
 
 					mSBTHelper.AddHitGroup(L"HitGroup", {
 						(void*) frameResources[j]->passCB->resource()->GetGPUVirtualAddress(),
-						(void*) i->getGeo()->VertexBufferGPU->GetGPUVirtualAddress(),
-						(void*) i->getGeo()->IndexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->VertexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->IndexBufferGPU->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->materialCB->resource()->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->instanceBufferRT->resource()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->lightTree->resource()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->lightAlias->resource()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->lightClusters->resource()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->clusterLights->resource()->GetGPUVirtualAddress(),
+						(void*) mScene->getEnvironmentMarginal()->GetGPUVirtualAddress(),
+						(void*) mScene->getEnvironmentConditional()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->lights->resource()->GetGPUVirtualAddress(),
 						heapPointer
 					});
 					mSBTHelper.AddHitGroup(L"ShadowHitGroup", {
-						(void*) i->getGeo()->VertexBufferGPU->GetGPUVirtualAddress(),
-						(void*) i->getGeo()->IndexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->VertexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->IndexBufferGPU->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->materialCB->resource()->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->instanceBufferRT->resource()->GetGPUVirtualAddress(),
 						heapPointer
 					});
 					mSBTHelper.AddHitGroup(L"IndirectHitGroup", {
 						(void*) frameResources[j]->passCB->resource()->GetGPUVirtualAddress(),
-						(void*) i->getGeo()->VertexBufferGPU->GetGPUVirtualAddress(),
-						(void*) i->getGeo()->IndexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->VertexBufferGPU->GetGPUVirtualAddress(),
+						(void*) i->getGeo()->gpu->IndexBufferGPU->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->materialCB->resource()->GetGPUVirtualAddress(),
 						(void*) frameResources[j]->instanceBufferRT->resource()->GetGPUVirtualAddress(),
+						(void*) frameResources[j]->lights->resource()->GetGPUVirtualAddress(),
 						heapPointer
 					});
 					count++;
@@ -749,7 +781,7 @@ namespace RT
 		uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
 		uavDesc.Buffer.FirstElement = 0;
 		uavDesc.Buffer.NumElements = settings->getWidth() * settings->getHeight();
-		uavDesc.Buffer.StructureByteStride = 2 * sizeof(float) + 2 * sizeof(UINT);
+		uavDesc.Buffer.StructureByteStride = sizeof(Reservoir);
 		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
 		md3dDevice->CreateUnorderedAccessView(mCandidates.Get(), nullptr, &uavDesc, handle);
 		handle.Offset(1, mCbvSrvUavDescriptorSize);
@@ -789,7 +821,7 @@ namespace RT
 		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		srvDesc.Buffer.FirstElement = 0;
 		srvDesc.Buffer.NumElements = settings->getWidth() * settings->getHeight();
-		srvDesc.Buffer.StructureByteStride = 2 * sizeof(float) + 2 * sizeof(UINT);
+		srvDesc.Buffer.StructureByteStride = sizeof(Reservoir);
 		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 		md3dDevice->CreateShaderResourceView(mCandidateHistory.Get(), &srvDesc, handle);
 	}
@@ -800,12 +832,22 @@ namespace RT
 		mCurrFrameResource = frameResources[mCurrFrameResourceIndex].get();
 
 		{
+			updateProgressive();
 			updateMaterialCB();
+			mScene->updateSkinnedGeometries();
 			updateBLAS();
 			updateTLAS();
 
 			if(settings->dlss)
 				jitter = { (haltonSequence(2, phase + 1) - 0.5F) / settings->getWidth(), (haltonSequence(3, phase + 1) - 0.5F) / settings->getHeight() };
+			else if(settings->progressive && mProgressive.getFrameCount() > 1)
+			{
+				//subpixel offsets antialias the accumulated image
+				int index = (int) mProgressive.getFrameCount();
+				jitter = { (haltonSequence(2, index) - 0.5F) / settings->getWidth(), (haltonSequence(3, index) - 0.5F) / settings->getHeight() };
+			}
+			else
+				jitter = { 0.0F, 0.0F };
 
 			mCam->updateViewMatrix();
 
@@ -814,7 +856,7 @@ namespace RT
 			updateDenoiser();
 
 			if(mMainPassCB.lightsCount > 1)
-				((RestirSpatial*) mEffects[EFFECT_RESTIR_SPATIAL].get())->setData(mMainPassCB.invView, mMainPassCB.invProj, mCam->getPos3F(), mMainPassCB.frameIndex, mMainPassCB.lightsCount, settings->getWidth(), settings->getHeight(), &mMainPassCB.lights[0]);
+				((RestirSpatial*) mEffects[EFFECT_RESTIR_SPATIAL].get())->setData(mMainPassCB.invView, mMainPassCB.invProj, mCam->getPos3F(), mMainPassCB.frameIndex, mMainPassCB.lightsCount, settings->getWidth(), settings->getHeight(), mCurrFrameResource->lights->resource()->GetGPUVirtualAddress());
 		}
 	}
 
@@ -919,6 +961,8 @@ namespace RT
 
 		mCurrFrameResource->fence = ++mCurrentFence;
 		mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+		if(mCaptureFrames > 0 && mCaptureFence == 0)
+			mCaptureFence = mCurrentFence;
 
 		mMainPassCB.frameIndex++;
 		mCam->saveState();
@@ -1116,6 +1160,30 @@ namespace RT
 		mDenoiserCBV->Unmap(0, nullptr);
 	}
 
+	void RaytracingRenderer::updateProgressive()
+	{
+		//runs before the updates below clean the dirty flags
+		SceneChangeState state = ProgressiveAccumulation::detectChanges(mScene.get(), mCam, *settings);
+
+		if(!settings->progressive || settings->rayReconstruction)
+			mProgressive.reset();
+		else if(mProgressive.update(state))
+		{
+			mCaptureFrames = 0;
+			mCaptureFence = 0;
+			mRTComposite->clearCaptures();
+		}
+
+		//convergence report, read back once the frame that copied it is done
+		if(mCaptureFence > 0 && mFence->GetCompletedValue() >= mCaptureFence)
+		{
+			float change = mRTComposite->readCapture(mCaptureFrames);
+			Logger::INFO.log("Progressive: " + std::to_string(mCaptureFrames) + " spp, rms change " + std::to_string(change));
+			mCaptureFrames = 0;
+			mCaptureFence = 0;
+		}
+	}
+
 	void RaytracingRenderer::denoiseAndComposite()
 	{
 		ThrowIfFailed(mCurrFrameResource->denoiserCmdListAlloc->Reset());
@@ -1124,7 +1192,17 @@ namespace RT
 		if(!settings->rayReconstruction)
 		{
 			denoise();
-			mRTComposite->effect(0, mDenoisedDiffuse.Get(), settings->dlss ? currentDLSSBuffer() : currentBackBuffer());
+
+			//a static view averages the noisy signals instead, NRD still filters the shadows
+			UINT frames = settings->progressive ? mProgressive.getFrameCount() : 0;
+			mRTComposite->setAccumulation(frames, frames < PROGRESSIVE_MAX_FRAMES);
+			if(frames > 0 && mProgressive.shouldReport() && mCaptureFrames == 0)
+			{
+				mRTComposite->requestCapture();
+				mCaptureFrames = frames;
+			}
+
+			mRTComposite->effect(0, frames > 0 ? mDiffuse.Get() : mDenoisedDiffuse.Get(), settings->dlss ? currentDLSSBuffer() : currentBackBuffer());
 		}
 
 		ThrowIfFailed(mDenoiserCmdList->Close());
@@ -1139,12 +1217,12 @@ namespace RT
 		{
 			if(ri->getGeo() != nullptr && ri->getInstanceCount() > 0)
 			{
-				auto vb = ri->getGeo()->VertexBufferView();
-				auto ib = ri->getGeo()->IndexBufferView();
+				auto vb = ri->getGeo()->gpu->VertexBufferView(*ri->getGeo());
+				auto ib = ri->getGeo()->gpu->IndexBufferView(*ri->getGeo());
 
 				cmdList->IASetVertexBuffers(0, 1, &vb);
 				cmdList->IASetIndexBuffer(&ib);
-				cmdList->IASetPrimitiveTopology(ri->getPrimitiveTopology());
+				cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 				cmdList->SetGraphicsRootShaderResourceView(2, mCurrFrameResource->instanceBuffer[ri->getIndex()]->resource()->GetGPUVirtualAddress());
 				cmdList->DrawIndexedInstanced(ri->getIndexCount(), ri->getInstanceCount(), ri->getStartIndex(), ri->getBaseVertex(), 0);
@@ -1251,13 +1329,24 @@ namespace RT
 	{
 		for(auto& e:mScene->getResidentGeometries())
 		{
-			if(e->needsRefit)
+			if(e && e->needsRefit)
 			{
-				mBottomLevelAS[e->name].updateVertexBuffer(e->VertexBufferGPU.Get(), 0, e->vertexCount, sizeof(Vertex),
-																e->IndexBufferGPU.Get(), 0, e->DrawArgs["0"].IndexCount, nullptr, 0, !e->isWater);
+				mBottomLevelAS[e->name].updateVertexBuffer(e->gpu->VertexBufferGPU.Get(), 0, e->vertexCount, sizeof(Vertex),
+																e->gpu->IndexBufferGPU.Get(), 0, e->DrawArgs["0"].IndexCount, nullptr, 0, !e->isWater);
 
 				ThrowIfFailed(mDirectCmdListAlloc->Reset());
 				ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
+
+				//skinned vertices are written by the CPU into the uploader
+				if(e->isSkinned)
+				{
+					auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(e->gpu->VertexBufferGPU.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+					mCommandList->ResourceBarrier(1, &barrier);
+					mCommandList->CopyBufferRegion(e->gpu->VertexBufferGPU.Get(), 0, e->gpu->VertexBufferUploader.Get(), 0, e->VertexBufferByteSize);
+					barrier = CD3DX12_RESOURCE_BARRIER::Transition(e->gpu->VertexBufferGPU.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+					mCommandList->ResourceBarrier(1, &barrier);
+				}
+
 				mBottomLevelAS[e->name].Generate(mCommandList.Get(), mBlbs[e->name].pScratch.Get(), mBlbs[e->name].pResult.Get(), true, mBlbs[e->name].pResult.Get());
 
 				ThrowIfFailed(mCommandList->Close());
@@ -1323,19 +1412,10 @@ namespace RT
 
 			mMainPassCB.fov = 0.25F * XM_PI;
 			mMainPassCB.aspectRatio = aspectRatio();
-
-			UINT lightCount = 0;
-			for(UINT i = 0; i < mScene->getLightCount(); ++i)
-			{
-				Light l = mScene->getLight(i);
-				mMainPassCB.lights[lightCount++] = l;
-				if(lightCount >= MAX_LIGHTS)
-					break;
-			}
-
-			mMainPassCB.lightsCount = lightCount;
 		}
 
+		updateLightSampling();
+
 		XMMATRIX viewPrev = mCam->getViewPrev();
 		XMMATRIX projPrev = mCam->getProjPrev();
 		XMMATRIX viewProjPrev = XMMatrixMultiply(viewPrev, projPrev);
@@ -1370,6 +1450,99 @@ namespace RT
 		mCurrFrameResource->passCB->copyData(0, mMainPassCB);
 	}
 
+	void RaytracingRenderer::updateLightSampling()
+	{
+		//every light of the scene goes to the shaders, the buffers are sized for them when the frame resources are built and grown when lights are added
+		if(mScene->getLightCount() > frameResources[0]->lights->elementCount)
+			growLightBuffers(mScene->getLightCount());
+		UINT count = std::min<UINT>(mScene->getLightCount(), frameResources[0]->lights->elementCount);
+		bool lightsChanged = count != (UINT) mLights.size();
+		mLights.resize(count);
+		for(UINT i = 0; i < count; ++i)
+		{
+			Light l = mScene->getLight(i);
+			lightsChanged |= memcmp(&l, &mLights[i], sizeof(Light)) != 0;
+			mLights[i] = l;
+		}
+		mMainPassCB.lightsCount = count;
+		mMainPassCB.emissiveLights = std::min<UINT>(mScene->getEmissiveTriangles().getCount(), count);
+		mMainPassCB.environmentSize = settings->environmentSampling ? mScene->getEnvironmentMap().getSize() : 0;
+		const auto& ambient = mScene->getEnvironmentMap().getAmbient();
+		std::copy(ambient.begin(), ambient.end(), mMainPassCB.ambientSH);
+		mMainPassCB.prefilteredMips = settings->prefilteredReflections ? mScene->getPrefilteredMips() : 0;
+
+		//built over the same lights, copied to every frame resource like the materials
+		lightsChanged |= mLightTree.update(mLights.data(), count);
+		lightsChanged |= mLightAlias.update(mLights.data(), count);
+		if(lightsChanged)
+			mLightsFramesDirty = NUM_FRAME_RESOURCES;
+
+		if(mLightsFramesDirty > 0)
+		{
+			const auto& nodes = mLightTree.getNodes();
+			const auto& entries = mLightAlias.getEntries();
+			mCurrFrameResource->lights->copyData(0, mLights.data(), count);
+			mCurrFrameResource->lightTree->copyData(0, nodes.data(), (UINT) nodes.size());
+			mCurrFrameResource->lightAlias->copyData(0, entries.data(), (UINT) entries.size());
+			mLightsFramesDirty--;
+		}
+
+		//the grid follows the camera and is only kept while the shaders sample it
+		if(settings->lightSampling == LIGHT_SAMPLING_CLUSTERED)
+		{
+			XMFLOAT4X4 view = mCam->getView4x4();
+			XMFLOAT3 lens = { mCam->getFovY(), mCam->getAspect(), mCam->getNearZ() };
+			if(lightsChanged || !mLightGridValid || memcmp(&view, &mLightGridView, sizeof(XMFLOAT4X4)) != 0 || memcmp(&lens, &mLightGridLens, sizeof(XMFLOAT3)) != 0)
+			{
+				mLightGrid.build(mLights.data(), count, mCam->getView(), lens.x, lens.y, lens.z);
+				//the index buffer has a fixed capacity, froxels past it fall back to the light tree in the shaders
+				if(lightsChanged && mLightGrid.getOverflowCount() > 0)
+					Logger::WARN.log("Light grid full, " + std::to_string(mLightGrid.getOverflowCount()) + " clusters fall back to the light tree");
+				mLightGridView = view;
+				mLightGridLens = lens;
+				mLightGridValid = true;
+				mLightGridFramesDirty = NUM_FRAME_RESOURCES;
+			}
+
+			if(mLightGridFramesDirty > 0)
+			{
+				const auto& clusters = mLightGrid.getClusters();
+				const auto& indices = mLightGrid.getIndices();
+				mCurrFrameResource->lightClusters->copyData(0, clusters.data(), (UINT) clusters.size());
+				mCurrFrameResource->clusterLights->copyData(0, indices.data(), (UINT) indices.size());
+				mLightGridFramesDirty--;
+			}
+
+			mMainPassCB.clusterDepth = mLightGrid.getDepthParams();
+			mMainPassCB.clusterScale = mLightGrid.getProjScale();
+		}
+		else
+			mLightGridValid = false;
+
+		mMainPassCB.lightTreeNodes = mLightTree.getLocalNodeCount();
+		mMainPassCB.directionalLights = mLightTree.getDirectionalCount();
+		mMainPassCB.lightSampling = settings->lightSampling;
+	}
+
+	void RaytracingRenderer::growLightBuffers(UINT lightCount)
+	{
+		//doubled so lights added one at a time do not stall every frame
+		UINT capacity = std::max<UINT>(lightCount, 2 * frameResources[0]->lights->elementCount);
+		Logger::INFO.log("Growing light buffers to " + std::to_string(capacity) + " lights...");
+
+		//the shader tables point at the old buffers, nothing in flight may still read them
+		flushCommandQueue();
+		for(auto& fr:frameResources)
+		{
+			fr->lightTree = std::make_unique<UploadBuffer<LightTreeNode>>(md3dDevice.Get(), 2 * capacity, false);
+			fr->lightAlias = std::make_unique<UploadBuffer<LightAliasEntry>>(md3dDevice.Get(), capacity, false);
+			fr->lights = std::make_unique<UploadBuffer<Light>>(md3dDevice.Get(), capacity, false);
+		}
+		createShaderBindingTable();
+
+		mLightsFramesDirty = NUM_FRAME_RESOURCES;
+	}
+
 	void RaytracingRenderer::updateObjCB()
 	{
 		//for mvs
@@ -1401,13 +1574,13 @@ namespace RT
 				BoundingBox shadowCullingBox = ri->getBounds();
 				if(settings->rtShadows)
 				{
-					if(mMainPassCB.lightsCount > 0 && mMainPassCB.lights[0].lightType == LIGHT_TYPE_DIRECTIONAL)
+					if(!mLights.empty() && mLights[0].lightType == LIGHT_TYPE_DIRECTIONAL)
 					{
 						const float scale = 7.5F;
-						shadowCullingBox.Center.x += mMainPassCB.lights[0].Direction.x * scale;
-						shadowCullingBox.Center.z += mMainPassCB.lights[0].Direction.z * scale;
-						shadowCullingBox.Extents.x += fabsf(mMainPassCB.lights[0].Direction.x) * scale;
-						shadowCullingBox.Extents.z += fabsf(mMainPassCB.lights[0].Direction.z) * scale;
+						shadowCullingBox.Center.x += mLights[0].Direction.x * scale;
+						shadowCullingBox.Center.z += mLights[0].Direction.z * scale;
+						shadowCullingBox.Extents.x += fabsf(mLights[0].Direction.x) * scale;
+						shadowCullingBox.Extents.z += fabsf(mLights[0].Direction.z) * scale;
 					}
 					else
 					{
@@ -1682,7 +1855,7 @@ namespace RT
 
 		if(mScene)
 			mScene.reset();
-		mScene = std::make_unique<Scene>(md3dDevice.Get(), mCommandList.Get(), settings, "res/scenes/" + sceneName + ".uge");
+		mScene = std::make_unique<GpuScene>(md3dDevice.Get(), mCommandList.Get(), settings, "res/scenes/" + sceneName + ".uge");
 		mScene->reloadMaterials();
 
 		mCam = mScene->getSelectedCamera();
@@ -11,6 +11,8 @@
 #include "postprocessing/RestirSpatial.h"
 #include "postprocessing/RTComposite.h"
 
+#include "ProgressiveAccumulation.h"
+
 namespace RT
 {
 	class RaytracingRenderer: public Renderer
@@ -50,9 +52,12 @@ namespace RT
 		void updateBLAS();
 		void updateTLAS();
 		void updateMainPassCB();
+		void updateLightSampling();
+		void growLightBuffers(UINT lightCount);
 		void updateObjCB();
 		void updateMaterialCB();
 		void updateDenoiser();
+		void updateProgressive();
 
 		void denoise();
 		void denoiseAndComposite();
@@ -139,5 +144,22 @@ namespace RT
 		DirectX::XMFLOAT2 jitterPrev = { 0.0F, 0.0F };
 
 		std::unique_ptr<RTComposite> mRTComposite;
+
+		//light sampling
+		std::vector<Light> mLights;
+		LightTree mLightTree;
+		LightAliasTable mLightAlias;
+		int mLightsFramesDirty = 0;
+
+		LightClusterGrid mLightGrid;
+		DirectX::XMFLOAT4X4 mLightGridView = Identity4x4();
+		DirectX::XMFLOAT3 mLightGridLens = { 0.0F, 0.0F, 0.0F };
+		bool mLightGridValid = false;
+		int mLightGridFramesDirty = 0;
+
+		//progressive
+		ProgressiveAccumulation mProgressive;
+		UINT mCaptureFrames = 0;
+		UINT64 mCaptureFence = 0;
 	};
 }
\ No newline at end of file
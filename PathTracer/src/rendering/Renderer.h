@@ -1,6 +1,6 @@
 #pragma once
 
-#include "../app/Scene.h"
+#include "../app/GpuScene.h"
 
 #include "../utils/header.h"
 
@@ -51,7 +51,7 @@ namespace RT
 			percUsedVMem = ((float) info.CurrentUsage / info.Budget) * 100.0F;
 		}
 
-		inline Scene* getScene() const { return mScene.get(); }
+		inline GpuScene* getScene() const { return mScene.get(); }
 
 		void toggleEffect(int effect, bool active);
 
@@ -170,7 +170,7 @@ namespace RT
 		DirectX::BoundingFrustum mCamFrustum;
 		bool mFirstPerson = false;
 
-		std::unique_ptr<Scene> mScene;
+		std::unique_ptr<GpuScene> mScene;
 
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mRtvHeap;
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mDsvHeap;
@@ -0,0 +1,208 @@
+#include "Restir.h"
+#include "LightAliasTable.h"
+#include "Sampling.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//NRD_EPS of the shaders
+	#define RESTIR_EPS					1e-6F
+
+	static float calcAttenuation(float d, float falloffStart, float falloffEnd)
+	{
+		return std::clamp<float>((falloffEnd - d) / (falloffEnd - falloffStart), 0.0F, 1.0F);
+	}
+
+	//RESTIR_GGX and its terms
+	static float Dggx(FXMVECTOR normal, FXMVECTOR halfVec, float roughness)
+	{
+		float nDotH = XMVectorGetX(XMVector3Dot(normal, halfVec));
+		float alpha2 = roughness * roughness;
+		if(nDotH <= 0.0F)
+			return 0.0F;
+
+		float denom = nDotH * nDotH * (alpha2 - 1.0F) + 1.0F;
+		return alpha2 / (XM_PI * denom * denom);
+	}
+
+	static float G1ggx(FXMVECTOR x, FXMVECTOR normal, float roughness)
+	{
+		float xDotN = XMVectorGetX(XMVector3Dot(x, normal));
+		float alpha2 = roughness * roughness;
+		if(xDotN <= 0.0F)
+			return 0.0F;
+		return (2.0F * xDotN) / (xDotN + sqrtf(alpha2 + (1.0F - alpha2) * xDotN * xDotN));
+	}
+
+	static XMVECTOR GGX(FXMVECTOR R0, float roughness, FXMVECTOR lightVec, FXMVECTOR normal, GXMVECTOR toEye)
+	{
+		XMVECTOR halfVec = XMVector3Normalize(toEye + lightVec);
+		float D = Dggx(normal, halfVec, roughness);
+		float G = G1ggx(toEye, normal, roughness) * G1ggx(lightVec, normal, roughness);
+		float vDotH = 1.0F - XMVectorGetX(XMVector3Dot(toEye, halfVec));
+		XMVECTOR F = R0 + (XMVectorReplicate(1.0F) - R0) * (vDotH * vDotH * vDotH * vDotH * vDotH);
+
+		float VdotN = XMVectorGetX(XMVector3Dot(toEye, normal));
+		if(VdotN <= 0.0F)
+			return XMVectorZero();
+		return F * (D * G / (4.0F * VdotN));
+	}
+
+	XMVECTOR Restir::contribution(const Light& light, const RestirSurface& surface)
+	{
+		XMVECTOR lightDir;
+		float distance;
+		XMVECTOR radiance = XMLoadFloat3(&light.Strength);
+		XMVECTOR direction = XMLoadFloat3(&light.Direction);
+
+		if(light.lightType == LIGHT_TYPE_DIRECTIONAL)
+		{
+			lightDir = -direction;
+			distance = 1.0F;
+		}
+		else
+		{
+			lightDir = XMLoadFloat3(&light.Position) - XMLoadFloat3(&surface.position);
+			distance = XMVectorGetX(XMVector3Length(lightDir));
+			lightDir /= distance;
+
+			if(light.lightType == LIGHT_TYPE_TRIANGLE)
+			{
+				//lambertian emitter, the inverse square is clamped at the triangle's size
+				radiance *= std::max<float>(XMVectorGetX(XMVector3Dot(-lightDir, direction)), 0.0F) * (distance < light.FalloffEnd ? 1.0F : 0.0F);
+				distance = std::max<float>(distance, light.FalloffStart);
+			}
+			else
+			{
+				radiance *= calcAttenuation(distance, light.FalloffStart, light.FalloffEnd);
+				if(light.lightType == LIGHT_TYPE_SPOTLIGHT)
+					radiance *= powf(std::max<float>(XMVectorGetX(XMVector3Dot(-lightDir, direction)), 0.0F), light.SpotPower);
+			}
+		}
+
+		radiance /= distance * distance + RESTIR_EPS;
+		XMVECTOR normal = XMLoadFloat3(&surface.normal);
+		float ndotl = std::clamp<float>(XMVectorGetX(XMVector3Dot(normal, lightDir)), 0.0F, 1.0F);
+		XMVECTOR brdf = XMVectorMax(GGX(XMLoadFloat3(&surface.R0), surface.roughness, lightDir, normal, XMLoadFloat3(&surface.toEye)), XMVectorReplicate(1e-7F));
+		return radiance * brdf * ndotl;
+	}
+
+	float Restir::target(const Light& light, const RestirSurface& surface)
+	{
+		return XMVectorGetX(XMVector3Length(contribution(light, surface)));
+	}
+
+	float Restir::weight(const std::vector<Light>& lights, UINT32 index, const RestirSurface& surface)
+	{
+		return target(lights[index], surface) * lights.size();
+	}
+
+	void Restir::computeLightSample(Reservoir& reservoir, const std::vector<Light>& lights, UINT32 index, const RestirSurface& surface, UINT32& seed, float sourcePdf)
+	{
+		float t = target(lights[index], surface);
+		float w = t / std::max<float>(sourcePdf, 1e-20F);
+
+		float previousSum = reservoir.weightSum;
+		reservoir.M += 1;
+		reservoir.weightSum += w;
+
+		if(nextRand(seed) < w / reservoir.weightSum)
+		{
+			reservoir.sampleIndex = index;
+			reservoir.W = (1.0F / t) * (reservoir.weightSum / reservoir.M);
+		}
+		//W = weightSum / (M * target) has to follow the candidates that were not picked too
+		else if(previousSum > 0.0F)
+			reservoir.W *= (reservoir.weightSum / previousSum) * ((reservoir.M - 1.0F) / reservoir.M);
+	}
+
+	Reservoir Restir::mergeReservoir(const Reservoir& a, const Reservoir& b, const std::vector<Light>& lights, const RestirSurface& surface, UINT32 seed)
+	{
+		//the shader leaves the index undefined when neither weight is positive
+		Reservoir s = {};
+		s.M = a.M + b.M;
+
+		float totW = 0.0F;
+
+		float pdf = 1.0F / lights.size();
+		float r = nextRand(seed);
+		float weightA = weight(lights, a.sampleIndex, surface) * pdf * a.W * a.M;
+		totW += weightA;
+		if(r < weightA / std::max<float>(totW, 1e-6F))
+			s.sampleIndex = a.sampleIndex;
+
+		float weightB = weight(lights, b.sampleIndex, surface) * pdf * b.W * b.M;
+		totW += weightB;
+		if(r < weightB / totW)
+			s.sampleIndex = b.sampleIndex;
+
+		s.weightSum = totW;
+		float weightS = std::max<float>(weight(lights, s.sampleIndex, surface), 1e-6F);
+		if(s.M == 0)
+			s.W = 0.0F;
+		else
+			s.W = (1.0F / (weightS * pdf)) * (s.weightSum / s.M);
+		return s;
+	}
+
+	Reservoir Restir::mergeReservoirSpatial(const Reservoir* r, const std::vector<Light>& lights, const RestirSurface& surface, UINT32 seed)
+	{
+		Reservoir merged;
+		merged.sampleIndex = r[0].sampleIndex;
+		merged.M = 0;
+		merged.weightSum = 0.0F;
+		merged.W = 1.0F;
+
+		float pdf = 1.0F / lights.size();
+		float totW = 0.0F;
+
+		for(int i = 0; i < RESTIR_SPATIAL_NEIGHBOURS; ++i)
+		{
+			const Reservoir& ri = r[i];
+			if(ri.M == 0 || ri.weightSum == 0.0F)
+				continue;
+
+			//resampled like mergeReservoir, by the contribution weight and the candidates behind it
+			float w = weight(lights, ri.sampleIndex, surface) * pdf * ri.W * ri.M;
+			totW += w;
+
+			if(nextRand(seed) < w / std::max<float>(totW, 1e-6F))
+				merged.sampleIndex = ri.sampleIndex;
+
+			merged.M += ri.M;
+		}
+
+		merged.weightSum = totW;
+
+		float finalWeight = weight(lights, merged.sampleIndex, surface);
+		float denom = std::max<float>(finalWeight * pdf, 1e-6F);
+		merged.W = (1.0F / denom) * (merged.weightSum / std::max<UINT32>(merged.M, 1));
+		return merged;
+	}
+
+	Reservoir Restir::sampleCandidates(const std::vector<Light>& lights, const RestirSurface& surface, UINT32 candidates, UINT32& seed, const LightAliasTable* table)
+	{
+		Reservoir reservoir = {};
+		UINT32 count = (UINT32) lights.size();
+		for(UINT32 i = 0; i < candidates; ++i)
+		{
+			float sourcePdf = 1.0F / count;
+			UINT32 chosenLight;
+			if(table)
+			{
+				float u0 = nextRand(seed);
+				float u1 = nextRand(seed);
+				chosenLight = table->sample(u0, u1, sourcePdf);
+			}
+			else
+				chosenLight = std::min<UINT32>(UINT32(nextRand(seed) * count), count - 1);
+			if(sourcePdf <= 0.0F)
+				continue;
+			computeLightSample(reservoir, lights, chosenLight, surface, seed, sourcePdf);
+		}
+		return reservoir;
+	}
+}
\ No newline at end of file
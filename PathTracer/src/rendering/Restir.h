@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define RESTIR_CANDIDATES				8 //picked per pixel in hit.hlsl
+#define RESTIR_SPATIAL_NEIGHBOURS		9 //3x3 window of restir_spatial.hlsl, the pixel included
+
+namespace RT
+{
+	class LightAliasTable;
+
+	//what restir_utils.hlsli shades a light sample at
+	struct RestirSurface
+	{
+		DirectX::XMFLOAT3 position;
+		DirectX::XMFLOAT3 normal;
+		DirectX::XMFLOAT3 R0;
+		DirectX::XMFLOAT3 toEye;
+		float roughness;
+	};
+
+	//C++ mirror of restir_utils.hlsli, the light list stands for gLights and its size for gLightCount. Seeds are passed like the
+	//shaders pass them, inout for every candidate and by value for the merges, so the random numbers line up with a GPU frame
+	class Restir
+	{
+	public:
+		//radiance times BRDF times cosine, its length is the target function
+		static DirectX::XMVECTOR contribution(const Light& light, const RestirSurface& surface);
+		static float target(const Light& light, const RestirSurface& surface);
+		static float weight(const std::vector<Light>& lights, UINT32 index, const RestirSurface& surface);
+
+		static void computeLightSample(Reservoir& reservoir, const std::vector<Light>& lights, UINT32 index, const RestirSurface& surface, UINT32& seed, float sourcePdf);
+		static Reservoir mergeReservoir(const Reservoir& a, const Reservoir& b, const std::vector<Light>& lights, const RestirSurface& surface, UINT32 seed);
+		static Reservoir mergeReservoirSpatial(const Reservoir* r, const std::vector<Light>& lights, const RestirSurface& surface, UINT32 seed);
+
+		//the candidate loop of hit.hlsl, lights are picked uniformly or through the alias table when there is one
+		static Reservoir sampleCandidates(const std::vector<Light>& lights, const RestirSurface& surface, UINT32 candidates, UINT32& seed, const LightAliasTable* table = nullptr);
+	private:
+		Restir() = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "Sampling.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	double Sampling::starDiscrepancy(const std::vector<XMFLOAT2>& points)
+	{
+		double n = (double) points.size();
+		double single = 0.0, pairs = 0.0;
+		for(auto& p:points)
+			single += (1.0 - p.x * p.x) * (1.0 - p.y * p.y);
+		for(auto& p:points)
+			for(auto& q:points)
+				pairs += (1.0 - std::max<float>(p.x, q.x)) * (1.0 - std::max<float>(p.y, q.y));
+		return sqrt(std::max<double>(1.0 / 9.0 - single / (2.0 * n) + pairs / (n * n), 0.0));
+	}
+}
\ No newline at end of file
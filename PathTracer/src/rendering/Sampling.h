@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../utils/core.h"
+
+namespace RT
+{
+	//the types res/shaders/sampling.hlsli is written with
+	using uint = UINT32;
+	using float2 = DirectX::XMFLOAT2;
+
+	#include "../../res/shaders/sampling.hlsli"
+
+	class Sampling
+	{
+	public:
+		//L2 star discrepancy of a 2D point set (Warnock)
+		static double starDiscrepancy(const std::vector<DirectX::XMFLOAT2>& points);
+	private:
+		Sampling() = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "SphericalHarmonics.h"
+#include "EnvironmentMap.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//normalization of every basis function, and the clamped cosine convolution over pi per band
+	static const float basisScale[SH_COEFFICIENTS] = { 0.282095F, 0.488603F, 0.488603F, 0.488603F, 1.092548F, 1.092548F, 0.315392F, 1.092548F, 0.546274F };
+	static const float cosineLobe[SH_COEFFICIENTS] = { 1.0F, 2.0F / 3.0F, 2.0F / 3.0F, 2.0F / 3.0F, 0.25F, 0.25F, 0.25F, 0.25F, 0.25F };
+
+	//the basis polynomials without their normalization
+	static void basisPolynomials(FXMVECTOR dir, float (&p)[SH_COEFFICIENTS])
+	{
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, dir);
+		p[0] = 1.0F;
+		p[1] = d.y;
+		p[2] = d.z;
+		p[3] = d.x;
+		p[4] = d.x * d.y;
+		p[5] = d.y * d.z;
+		p[6] = 3.0F * d.z * d.z - 1.0F;
+		p[7] = d.x * d.z;
+		p[8] = d.x * d.x - d.y * d.y;
+	}
+
+	SHCoefficients SphericalHarmonics::projectCubemap(const std::vector<XMFLOAT3>& texels, UINT32 size)
+	{
+		//one partial sum per row, the rows run in parallel and each texel is a multiply add per coefficient
+		UINT32 rows = 6 * size;
+		std::vector<SHCoefficients> rowSums(rows);
+		parallelFor(UINT32(0), rows, [&](UINT32 r)
+		{
+			UINT32 face = r / size;
+			UINT32 y = r % size;
+
+			XMVECTOR sum[SH_COEFFICIENTS];
+			for(auto& s:sum)
+				s = XMVectorZero();
+
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				XMVECTOR dir = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size));
+				XMVECTOR radiance = XMLoadFloat3(&texels[(size_t) r * size + x]) * EnvironmentMap::texelSolidAngle(x, y, size);
+
+				float p[SH_COEFFICIENTS];
+				basisPolynomials(dir, p);
+				for(int i = 0; i < SH_COEFFICIENTS; ++i)
+					sum[i] = XMVectorMultiplyAdd(radiance, XMVectorReplicate(p[i] * basisScale[i]), sum[i]);
+			}
+
+			for(int i = 0; i < SH_COEFFICIENTS; ++i)
+				XMStoreFloat4(&rowSums[r][i], sum[i]);
+		});
+
+		XMVECTOR total[SH_COEFFICIENTS];
+		for(auto& t:total)
+			t = XMVectorZero();
+		for(auto& row:rowSums)
+			for(int i = 0; i < SH_COEFFICIENTS; ++i)
+				total[i] += XMLoadFloat4(&row[i]);
+
+		SHCoefficients result;
+		for(int i = 0; i < SH_COEFFICIENTS; ++i)
+			XMStoreFloat4(&result[i], XMVectorSetW(total[i], 0.0F));
+		return result;
+	}
+
+	SHCoefficients SphericalHarmonics::ambient(const SHCoefficients& radiance)
+	{
+		SHCoefficients result;
+		for(int i = 0; i < SH_COEFFICIENTS; ++i)
+			XMStoreFloat4(&result[i], XMLoadFloat4(&radiance[i]) * (cosineLobe[i] * basisScale[i]));
+		return result;
+	}
+
+	SHCoefficients SphericalHarmonics::constant(float value)
+	{
+		SHCoefficients result = {};
+		result[0] = { value, value, value, 0.0F };
+		return result;
+	}
+
+	XMVECTOR SphericalHarmonics::evaluate(const SHCoefficients& ambient, FXMVECTOR normal)
+	{
+		float p[SH_COEFFICIENTS];
+		basisPolynomials(XMVector3Normalize(normal), p);
+
+		XMVECTOR result = XMVectorZero();
+		for(int i = 0; i < SH_COEFFICIENTS; ++i)
+			result = XMVectorMultiplyAdd(XMLoadFloat4(&ambient[i]), XMVectorReplicate(p[i]), result);
+		return XMVectorMax(result, XMVectorZero());
+	}
+}
\ No newline at end of file
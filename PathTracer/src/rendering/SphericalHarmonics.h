@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../utils/core.h"
+
+#define SH_COEFFICIENTS					9
+#define SH_DEFAULT_AMBIENT				0.2F //what the shaders used before there was a cubemap to project
+
+namespace RT
+{
+	//rgb in xyz, one per real L2 basis function in the order 00, 1-1, 10, 11, 2-2, 2-1, 20, 21, 22
+	using SHCoefficients = std::array<DirectX::XMFLOAT4, SH_COEFFICIENTS>;
+
+	//L2 projection of a cubemap and the irradiance it gives, after Ramamoorthi and Hanrahan
+	class SphericalHarmonics
+	{
+	public:
+		//texels laid out like EnvironmentMap::build, weighted by their exact solid angle
+		static SHCoefficients projectCubemap(const std::vector<DirectX::XMFLOAT3>& texels, UINT32 size);
+
+		//cosine convolved, divided by pi and folded with the basis constants, what gAmbientSH holds
+		static SHCoefficients ambient(const SHCoefficients& radiance);
+		static SHCoefficients constant(float value);
+
+		//same polynomial as evaluateAmbient in environment.hlsli
+		static DirectX::XMVECTOR evaluate(const SHCoefficients& ambient, DirectX::FXMVECTOR normal);
+	private:
+		SphericalHarmonics() = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,829 @@
+#include "BVH.h"
+
+#include "../../utils/Timer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <numeric>
+
+#define LBVH_LEAF	0x80000000 //child references with this bit set point at a sorted primitive
+
+using namespace DirectX;
+
+namespace RT
+{
+	struct BuildNode
+	{
+		XMFLOAT3 boundsMin;
+		XMFLOAT3 boundsMax;
+		UINT32 left = 0;
+		UINT32 first = 0;
+		UINT32 count = 0;
+		bool leaf = true;
+	};
+
+	struct SAHBin
+	{
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+		UINT32 count = 0;
+	};
+
+	typedef std::array<std::array<SAHBin, BVH_SAH_BINS>, 3> SAHBins;
+
+	struct BuildState
+	{
+		std::vector<BVHPrimitive>& primitives;
+		std::vector<BuildNode> nodes;
+		std::atomic<UINT32> nodeCount = 1;
+		BVHBuilder builder;
+
+		BuildState(std::vector<BVHPrimitive>& primitives, BVHBuilder builder): primitives(primitives), builder(builder) {}
+	};
+
+	//internal node of the Karras hierarchy, covers the sorted primitives [first, last]
+	struct LBVHNode
+	{
+		XMFLOAT3 boundsMin;
+		UINT32 first = 0;
+		XMFLOAT3 boundsMax;
+		UINT32 last = 0;
+		UINT32 child[2] = { 0, 0 };
+		UINT32 parent = UINT32_MAX;
+		UINT32 flatSize = 0;
+	};
+
+	static inline XMVECTOR centroid(const BVHPrimitive& p)
+	{
+		return 0.5F * (XMLoadFloat3(&p.boundsMin) + XMLoadFloat3(&p.boundsMax));
+	}
+
+	static inline float halfArea(FXMVECTOR boundsMin, FXMVECTOR boundsMax)
+	{
+		XMFLOAT3 e;
+		XMStoreFloat3(&e, XMVectorMax(boundsMax - boundsMin, XMVectorZero()));
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	static void computeBounds(const BuildState& state, UINT32 first, UINT32 count, XMVECTOR& bMin, XMVECTOR& bMax, XMVECTOR& cMin, XMVECTOR& cMax)
+	{
+		auto reduce = [&state](UINT32 begin, UINT32 end, XMVECTOR* out)
+		{
+			XMVECTOR r[4] = { XMVectorReplicate(FLT_MAX), XMVectorReplicate(-FLT_MAX), XMVectorReplicate(FLT_MAX), XMVectorReplicate(-FLT_MAX) };
+			for(UINT32 i = begin; i < end; ++i)
+			{
+				const BVHPrimitive& p = state.primitives[i];
+				XMVECTOR pMin = XMLoadFloat3(&p.boundsMin);
+				XMVECTOR pMax = XMLoadFloat3(&p.boundsMax);
+				XMVECTOR c = 0.5F * (pMin + pMax);
+				r[0] = XMVectorMin(r[0], pMin);
+				r[1] = XMVectorMax(r[1], pMax);
+				r[2] = XMVectorMin(r[2], c);
+				r[3] = XMVectorMax(r[3], c);
+			}
+			for(int k = 0; k < 4; ++k)
+				out[k] = r[k];
+		};
+
+		if(count <= BVH_PARALLEL_THRESHOLD)
+		{
+			XMVECTOR r[4];
+			reduce(first, first + count, r);
+			bMin = r[0]; bMax = r[1]; cMin = r[2]; cMax = r[3];
+			return;
+		}
+
+		//large nodes near the root reduce in chunks
+		UINT32 chunkCount = (count + BVH_PARALLEL_THRESHOLD - 1) / BVH_PARALLEL_THRESHOLD;
+		std::vector<XMFLOAT4> partial(chunkCount * 4);
+		parallelFor(UINT32(0), chunkCount, [&](UINT32 chunk)
+		{
+			XMVECTOR r[4];
+			UINT32 begin = first + chunk * BVH_PARALLEL_THRESHOLD;
+			reduce(begin, std::min<UINT32>(begin + BVH_PARALLEL_THRESHOLD, first + count), r);
+			for(int k = 0; k < 4; ++k)
+				XMStoreFloat4(&partial[chunk * 4 + k], r[k]);
+		});
+
+		bMin = cMin = XMVectorReplicate(FLT_MAX);
+		bMax = cMax = XMVectorReplicate(-FLT_MAX);
+		for(UINT32 chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			bMin = XMVectorMin(bMin, XMLoadFloat4(&partial[chunk * 4]));
+			bMax = XMVectorMax(bMax, XMLoadFloat4(&partial[chunk * 4 + 1]));
+			cMin = XMVectorMin(cMin, XMLoadFloat4(&partial[chunk * 4 + 2]));
+			cMax = XMVectorMax(cMax, XMLoadFloat4(&partial[chunk * 4 + 3]));
+		}
+	}
+
+	static void binPrimitives(const BuildState& state, UINT32 first, UINT32 count, FXMVECTOR cMin, FXMVECTOR scale, SAHBins& bins)
+	{
+		auto bin = [&](UINT32 begin, UINT32 end, SAHBins& out)
+		{
+			for(UINT32 i = begin; i < end; ++i)
+			{
+				const BVHPrimitive& p = state.primitives[i];
+				XMVECTOR pMin = XMLoadFloat3(&p.boundsMin);
+				XMVECTOR pMax = XMLoadFloat3(&p.boundsMax);
+
+				XMFLOAT3 b;
+				XMStoreFloat3(&b, XMVectorMin(XMVectorMax((0.5F * (pMin + pMax) - cMin) * scale, XMVectorZero()), XMVectorReplicate(BVH_SAH_BINS - 1)));
+				UINT32 index[3] = { (UINT32) b.x, (UINT32) b.y, (UINT32) b.z };
+				for(int axis = 0; axis < 3; ++axis)
+				{
+					SAHBin& target = out[axis][index[axis]];
+					target.boundsMin = XMVectorMin(target.boundsMin, pMin);
+					target.boundsMax = XMVectorMax(target.boundsMax, pMax);
+					target.count++;
+				}
+			}
+		};
+
+		if(count <= BVH_PARALLEL_THRESHOLD)
+		{
+			bin(first, first + count, bins);
+			return;
+		}
+
+		UINT32 chunkCount = (count + BVH_PARALLEL_THRESHOLD - 1) / BVH_PARALLEL_THRESHOLD;
+		std::vector<SAHBins> partial(chunkCount);
+		parallelFor(UINT32(0), chunkCount, [&](UINT32 chunk)
+		{
+			UINT32 begin = first + chunk * BVH_PARALLEL_THRESHOLD;
+			bin(begin, std::min<UINT32>(begin + BVH_PARALLEL_THRESHOLD, first + count), partial[chunk]);
+		});
+
+		for(UINT32 chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			for(int axis = 0; axis < 3; ++axis)
+			{
+				for(int b = 0; b < BVH_SAH_BINS; ++b)
+				{
+					const SAHBin& src = partial[chunk][axis][b];
+					bins[axis][b].boundsMin = XMVectorMin(bins[axis][b].boundsMin, src.boundsMin);
+					bins[axis][b].boundsMax = XMVectorMax(bins[axis][b].boundsMax, src.boundsMax);
+					bins[axis][b].count += src.count;
+				}
+			}
+		}
+	}
+
+	//returns the first primitive of the right child, or first if the node should stay a leaf
+	static UINT32 splitBinnedSAH(BuildState& state, UINT32 first, UINT32 count, FXMVECTOR bMin, FXMVECTOR bMax, FXMVECTOR cMin, GXMVECTOR cMax)
+	{
+		XMVECTOR extent = cMax - cMin;
+		XMVECTOR scale = XMVectorSelect(XMVectorZero(), XMVectorReplicate((float) BVH_SAH_BINS) / extent, XMVectorGreater(extent, XMVectorReplicate(1e-12F)));
+
+		SAHBins bins;
+		binPrimitives(state, first, count, cMin, scale, bins);
+
+		//sweep the planes from both sides
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		int bestPlane = 0;
+		for(int axis = 0; axis < 3; ++axis)
+		{
+			if(XMVectorGetByIndex(extent, axis) <= 1e-12F)
+				continue;
+
+			float rightArea[BVH_SAH_BINS];
+			UINT32 rightCount[BVH_SAH_BINS];
+			XMVECTOR rMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR rMax = XMVectorReplicate(-FLT_MAX);
+			UINT32 n = 0;
+			for(int b = BVH_SAH_BINS - 1; b > 0; --b)
+			{
+				rMin = XMVectorMin(rMin, bins[axis][b].boundsMin);
+				rMax = XMVectorMax(rMax, bins[axis][b].boundsMax);
+				n += bins[axis][b].count;
+				rightArea[b] = halfArea(rMin, rMax);
+				rightCount[b] = n;
+			}
+
+			XMVECTOR lMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR lMax = XMVectorReplicate(-FLT_MAX);
+			n = 0;
+			for(int b = 0; b < BVH_SAH_BINS - 1; ++b)
+			{
+				lMin = XMVectorMin(lMin, bins[axis][b].boundsMin);
+				lMax = XMVectorMax(lMax, bins[axis][b].boundsMax);
+				n += bins[axis][b].count;
+				if(n == 0 || rightCount[b + 1] == 0)
+					continue;
+
+				float cost = halfArea(lMin, lMax) * n + rightArea[b + 1] * rightCount[b + 1];
+				if(cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestPlane = b;
+				}
+			}
+		}
+
+		float parentArea = std::max<float>(halfArea(bMin, bMax), 1e-12F);
+		float splitCost = BVH_SAH_TRAVERSAL_COST + BVH_SAH_INTERSECTION_COST * bestCost / parentArea;
+		float leafCost = BVH_SAH_INTERSECTION_COST * count;
+
+		if(bestAxis < 0)
+		{
+			//every centroid in the same spot, split by index if the leaf would be too big
+			if(count <= BVH_MAX_LEAF_SIZE)
+				return first;
+			return first + count / 2;
+		}
+		if(count <= BVH_MAX_LEAF_SIZE && leafCost <= splitCost)
+			return first;
+
+		float axisMin = XMVectorGetByIndex(cMin, bestAxis);
+		float axisScale = XMVectorGetByIndex(scale, bestAxis);
+		auto middle = std::partition(state.primitives.begin() + first, state.primitives.begin() + first + count, [&](const BVHPrimitive& p)
+		{
+			int b = std::min<int>((int) ((XMVectorGetByIndex(centroid(p), bestAxis) - axisMin) * axisScale), BVH_SAH_BINS - 1);
+			return b <= bestPlane;
+		});
+
+		UINT32 mid = (UINT32) (middle - state.primitives.begin());
+		if(mid == first || mid == first + count)
+			mid = first + count / 2;
+		return mid;
+	}
+
+	static UINT32 splitMedian(BuildState& state, UINT32 first, UINT32 count, FXMVECTOR cMin, FXMVECTOR cMax)
+	{
+		if(count <= BVH_LEAF_SIZE)
+			return first;
+
+		XMFLOAT3 extent;
+		XMStoreFloat3(&extent, cMax - cMin);
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+		UINT32 mid = first + count / 2;
+		std::nth_element(state.primitives.begin() + first, state.primitives.begin() + mid, state.primitives.begin() + first + count, [axis](const BVHPrimitive& a, const BVHPrimitive& b)
+		{
+			return XMVectorGetByIndex(centroid(a), axis) < XMVectorGetByIndex(centroid(b), axis);
+		});
+		return mid;
+	}
+
+	static void buildRecursive(BuildState& state, UINT32 nodeIndex, UINT32 first, UINT32 count, UINT32 depth)
+	{
+		XMVECTOR bMin, bMax, cMin, cMax;
+		computeBounds(state, first, count, bMin, bMax, cMin, cMax);
+
+		BuildNode& node = state.nodes[nodeIndex];
+		XMStoreFloat3(&node.boundsMin, bMin);
+		XMStoreFloat3(&node.boundsMax, bMax);
+		node.first = first;
+		node.count = count;
+		node.leaf = true;
+
+		if(count <= 1 || depth >= BVH_MAX_DEPTH - 1)
+			return;
+
+		UINT32 mid = state.builder == BVH_BUILDER_MEDIAN ? splitMedian(state, first, count, cMin, cMax) : splitBinnedSAH(state, first, count, bMin, bMax, cMin, cMax);
+		if(mid == first)
+			return;
+
+		UINT32 left = state.nodeCount.fetch_add(2);
+		node.leaf = false;
+		node.left = left;
+
+		//the partitions are disjoint, big subtrees are built as separate tasks
+		if(count > BVH_PARALLEL_THRESHOLD)
+		{
+			parallelInvoke(
+				[&] { buildRecursive(state, left, first, mid - first, depth + 1); },
+				[&] { buildRecursive(state, left + 1, mid, first + count - mid, depth + 1); }
+			);
+		}
+		else
+		{
+			buildRecursive(state, left, first, mid - first, depth + 1);
+			buildRecursive(state, left + 1, mid, first + count - mid, depth + 1);
+		}
+	}
+
+	static UINT32 flatten(const BuildState& state, UINT32 buildIndex, std::vector<BVHNode>& nodes)
+	{
+		const BuildNode& src = state.nodes[buildIndex];
+		UINT32 index = (UINT32) nodes.size();
+		nodes.push_back({ src.boundsMin, src.first, src.boundsMax, src.count });
+
+		if(!src.leaf)
+		{
+			flatten(state, src.left, nodes);
+			UINT32 right = flatten(state, src.left + 1, nodes);
+			nodes[index].offset = right;
+			nodes[index].count = 0;
+		}
+
+		return index;
+	}
+
+	static inline UINT64 expandBits10(UINT32 v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	static inline UINT64 expandBits21(UINT32 v)
+	{
+		UINT64 x = v & 0x1FFFFF;
+		x = (x | x << 32) & 0x001F00000000FFFFull;
+		x = (x | x << 16) & 0x001F0000FF0000FFull;
+		x = (x | x << 8) & 0x100F00F00F00F00Full;
+		x = (x | x << 4) & 0x10C30C30C30C30C3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	}
+
+	static void computeMortonCodes(const std::vector<BVHPrimitive>& primitives, FXMVECTOR cMin, FXMVECTOR cMax, UINT32 bitsPerAxis, std::vector<UINT64>& codes)
+	{
+		//each axis is normalized on its own so flat meshes like the water grids don't waste bits
+		XMVECTOR extent = cMax - cMin;
+		XMVECTOR cells = XMVectorReplicate((float) ((1u << bitsPerAxis) - 1));
+		XMVECTOR scale = XMVectorSelect(XMVectorZero(), cells / extent, XMVectorGreater(extent, XMVectorReplicate(1e-12F)));
+		XMVECTOR origin = cMin;
+
+		codes.resize(primitives.size());
+		parallelFor(size_t(0), primitives.size(), [&](size_t i)
+		{
+			XMFLOAT3 q;
+			XMStoreFloat3(&q, XMVectorClamp((centroid(primitives[i]) - origin) * scale, XMVectorZero(), cells));
+			if(bitsPerAxis > 10)
+				codes[i] = (expandBits21((UINT32) q.x) << 2) | (expandBits21((UINT32) q.y) << 1) | expandBits21((UINT32) q.z);
+			else
+				codes[i] = (expandBits10((UINT32) q.x) << 2) | (expandBits10((UINT32) q.y) << 1) | expandBits10((UINT32) q.z);
+		});
+	}
+
+	static inline int commonPrefix(const std::vector<UINT64>& codes, int i, int j)
+	{
+		if(j < 0 || j >= (int) codes.size())
+			return -1;
+
+		//duplicated codes fall back to the index so every key is unique
+		UINT64 diff = codes[i] ^ codes[j];
+		if(diff == 0)
+			return 64 + std::countl_zero((UINT32) (i ^ j));
+		return std::countl_zero(diff);
+	}
+
+	//every internal node finds its own range and split, no node depends on another
+	static void emitHierarchy(const std::vector<UINT64>& codes, std::vector<LBVHNode>& nodes, std::vector<UINT32>& leafParents)
+	{
+		parallelFor(0, (int) nodes.size(), [&](int i)
+		{
+			int d = commonPrefix(codes, i, i + 1) > commonPrefix(codes, i, i - 1) ? 1 : -1;
+
+			//upper bound of the range length, then binary search the other end
+			int minPrefix = commonPrefix(codes, i, i - d);
+			int lengthMax = 2;
+			while(commonPrefix(codes, i, i + lengthMax * d) > minPrefix)
+				lengthMax <<= 1;
+
+			int length = 0;
+			for(int t = lengthMax >> 1; t > 0; t >>= 1)
+			{
+				if(commonPrefix(codes, i, i + (length + t) * d) > minPrefix)
+					length += t;
+			}
+			int j = i + length * d;
+
+			//split where the common prefix of the range ends
+			int nodePrefix = commonPrefix(codes, i, j);
+			int s = 0;
+			int t = length;
+			do
+			{
+				t = (t + 1) >> 1;
+				if(commonPrefix(codes, i, i + (s + t) * d) > nodePrefix)
+					s += t;
+			}
+			while(t > 1);
+			UINT32 split = (UINT32) (i + s * d + std::min<int>(d, 0));
+
+			LBVHNode& node = nodes[i];
+			node.first = (UINT32) std::min<int>(i, j);
+			node.last = (UINT32) std::max<int>(i, j);
+			node.child[0] = node.first == split ? split | LBVH_LEAF : split;
+			node.child[1] = node.last == split + 1 ? (split + 1) | LBVH_LEAF : split + 1;
+
+			for(UINT32 child:node.child)
+			{
+				if(child & LBVH_LEAF)
+					leafParents[child & ~LBVH_LEAF] = (UINT32) i;
+				else
+					nodes[child].parent = (UINT32) i;
+			}
+		});
+	}
+
+	//bottom up from the leaves, the second thread to reach a node has both children ready
+	static void computeHierarchyBounds(const std::vector<BVHPrimitive>& primitives, std::vector<LBVHNode>& nodes, const std::vector<UINT32>& leafParents)
+	{
+		std::vector<std::atomic<UINT32>> visits(nodes.size());
+		parallelFor(size_t(0), leafParents.size(), [&](size_t leaf)
+		{
+			UINT32 index = leafParents[leaf];
+			while(index != UINT32_MAX && visits[index].fetch_add(1) == 1)
+			{
+				LBVHNode& node = nodes[index];
+				XMVECTOR bMin = XMVectorReplicate(FLT_MAX);
+				XMVECTOR bMax = XMVectorReplicate(-FLT_MAX);
+				UINT32 flatSize = 1;
+				for(UINT32 child:node.child)
+				{
+					if(child & LBVH_LEAF)
+					{
+						const BVHPrimitive& p = primitives[child & ~LBVH_LEAF];
+						bMin = XMVectorMin(bMin, XMLoadFloat3(&p.boundsMin));
+						bMax = XMVectorMax(bMax, XMLoadFloat3(&p.boundsMax));
+						flatSize++;
+					}
+					else
+					{
+						bMin = XMVectorMin(bMin, XMLoadFloat3(&nodes[child].boundsMin));
+						bMax = XMVectorMax(bMax, XMLoadFloat3(&nodes[child].boundsMax));
+						flatSize += nodes[child].flatSize;
+					}
+				}
+
+				XMStoreFloat3(&node.boundsMin, bMin);
+				XMStoreFloat3(&node.boundsMax, bMax);
+				node.flatSize = node.last - node.first + 1 <= BVH_LEAF_SIZE ? 1 : flatSize;
+				index = node.parent;
+			}
+		});
+	}
+
+	static void flattenHierarchy(const std::vector<LBVHNode>& nodes, const std::vector<BVHPrimitive>& primitives, UINT32 ref, UINT32 flatIndex, UINT32 depth, std::vector<BVHNode>& flat)
+	{
+		if(ref & LBVH_LEAF)
+		{
+			const BVHPrimitive& p = primitives[ref & ~LBVH_LEAF];
+			flat[flatIndex] = { p.boundsMin, ref & ~LBVH_LEAF, p.boundsMax, 1 };
+			return;
+		}
+
+		//small ranges are contiguous in morton order and collapse into a single leaf
+		const LBVHNode& node = nodes[ref];
+		UINT32 count = node.last - node.first + 1;
+		if(node.flatSize == 1 || depth >= BVH_MAX_DEPTH - 1)
+		{
+			flat[flatIndex] = { node.boundsMin, node.first, node.boundsMax, count };
+			return;
+		}
+
+		UINT32 left = flatIndex + 1;
+		UINT32 right = left + (node.child[0] & LBVH_LEAF ? 1 : nodes[node.child[0]].flatSize);
+		flat[flatIndex] = { node.boundsMin, right, node.boundsMax, 0 };
+
+		if(count > BVH_PARALLEL_THRESHOLD)
+		{
+			parallelInvoke(
+				[&] { flattenHierarchy(nodes, primitives, node.child[0], left, depth + 1, flat); },
+				[&] { flattenHierarchy(nodes, primitives, node.child[1], right, depth + 1, flat); }
+			);
+		}
+		else
+		{
+			flattenHierarchy(nodes, primitives, node.child[0], left, depth + 1, flat);
+			flattenHierarchy(nodes, primitives, node.child[1], right, depth + 1, flat);
+		}
+	}
+
+	static void buildLBVH(std::vector<BVHPrimitive>& primitives, std::vector<BVHNode>& flat)
+	{
+		UINT32 n = (UINT32) primitives.size();
+		flat.clear();
+		if(n == 0)
+			return;
+
+		BuildState state(primitives, BVH_BUILDER_LBVH);
+		XMVECTOR bMin, bMax, cMin, cMax;
+		computeBounds(state, 0, n, bMin, bMax, cMin, cMax);
+
+		if(n <= BVH_LEAF_SIZE)
+		{
+			flat.resize(1);
+			XMStoreFloat3(&flat[0].boundsMin, bMin);
+			XMStoreFloat3(&flat[0].boundsMax, bMax);
+			flat[0].offset = 0;
+			flat[0].count = n;
+			return;
+		}
+
+		UINT32 bitsPerAxis = n > BVH_LBVH_WIDE_THRESHOLD ? 21 : 10;
+		std::vector<UINT64> codes;
+		computeMortonCodes(primitives, cMin, cMax, bitsPerAxis, codes);
+
+		std::vector<UINT32> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		radixSort(order.begin(), order.end(), [&](UINT32 i) -> size_t { return (size_t) codes[i]; });
+
+		std::vector<BVHPrimitive> sorted(n);
+		std::vector<UINT64> sortedCodes(n);
+		parallelFor(UINT32(0), n, [&](UINT32 i)
+		{
+			sorted[i] = primitives[order[i]];
+			sortedCodes[i] = codes[order[i]];
+		});
+		primitives.swap(sorted);
+		codes.swap(sortedCodes);
+
+		std::vector<LBVHNode> nodes(n - 1);
+		std::vector<UINT32> leafParents(n);
+		emitHierarchy(codes, nodes, leafParents);
+		computeHierarchyBounds(primitives, nodes, leafParents);
+
+		//nodes cut by the depth limit leave unused slots behind, they are never referenced
+		flat.assign(nodes[0].flatSize, BVHNode {});
+		flattenHierarchy(nodes, primitives, 0, 0, 0, flat);
+	}
+
+	void BVH::build(std::vector<BVHPrimitive>& primitives, BVHBuilder builder)
+	{
+		Timer timer;
+		timer.reset();
+
+		if(builder == BVH_BUILDER_LBVH)
+			buildLBVH(primitives, mNodes);
+		else
+		{
+			BuildState state(primitives, builder);
+			state.nodes.resize(std::max<size_t>(1, 2 * primitives.size()));
+			buildRecursive(state, 0, 0, (UINT32) primitives.size(), 0);
+
+			mNodes.clear();
+			mNodes.reserve(state.nodeCount);
+			flatten(state, 0, mNodes);
+		}
+
+		mPrimitiveIndices.resize(primitives.size());
+		for(size_t i = 0; i < primitives.size(); ++i)
+			mPrimitiveIndices[i] = primitives[i].index;
+
+		mLevelNodes.clear();
+		mLevelOffsets.clear();
+		mChanged.clear();
+		mSahGrowth = 1.0F;
+
+		timer.tick();
+		mBuildMs = timer.deltaTime() * 1000.0F;
+	}
+
+	static void triangleBounds(const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, std::vector<BVHPrimitive>& primitives)
+	{
+		primitives.resize(triangleCount);
+		parallelFor(UINT32(0), triangleCount, [&](UINT32 t)
+		{
+			XMVECTOR v0 = XMLoadFloat3(&vertices[indices[3 * t]].position);
+			XMVECTOR v1 = XMLoadFloat3(&vertices[indices[3 * t + 1]].position);
+			XMVECTOR v2 = XMLoadFloat3(&vertices[indices[3 * t + 2]].position);
+
+			BVHPrimitive& p = primitives[t];
+			XMStoreFloat3(&p.boundsMin, XMVectorMin(v0, XMVectorMin(v1, v2)));
+			XMStoreFloat3(&p.boundsMax, XMVectorMax(v0, XMVectorMax(v1, v2)));
+			p.index = t;
+			p.pad = 0.0F;
+		});
+	}
+
+	void BVH::build(const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, BVHBuilder builder)
+	{
+		std::vector<BVHPrimitive> primitives;
+		triangleBounds(vertices, indices, triangleCount, primitives);
+		build(primitives, builder);
+	}
+
+	void BVH::build(const MeshGeometry* geo, BVHBuilder builder)
+	{
+		const SubmeshGeometry& submesh = geo->DrawArgs.at("0");
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data()) + submesh.BaseVertexLocation;
+		const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data()) + submesh.StartIndexLocation;
+		build(vertices, indices, submesh.IndexCount / 3, builder);
+	}
+
+	void BVH::prepareRefit()
+	{
+		//depth of every reachable node, then a counting sort by level
+		std::vector<UINT32> depths(mNodes.size(), UINT32_MAX);
+		std::vector<UINT32> levelCounts;
+		std::vector<UINT32> stack = { 0 };
+		depths[0] = 0;
+		while(!stack.empty())
+		{
+			UINT32 index = stack.back();
+			stack.pop_back();
+
+			UINT32 depth = depths[index];
+			if(depth >= levelCounts.size())
+				levelCounts.resize(depth + 1, 0);
+			levelCounts[depth]++;
+
+			if(mNodes[index].count == 0)
+			{
+				depths[index + 1] = depths[mNodes[index].offset] = depth + 1;
+				stack.push_back(index + 1);
+				stack.push_back(mNodes[index].offset);
+			}
+		}
+
+		mLevelOffsets.assign(levelCounts.size() + 1, 0);
+		for(size_t level = 0; level < levelCounts.size(); ++level)
+			mLevelOffsets[level + 1] = mLevelOffsets[level] + levelCounts[level];
+
+		std::vector<UINT32> cursor(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+		mLevelNodes.resize(mLevelOffsets.back());
+		for(UINT32 index = 0; index < (UINT32) mNodes.size(); ++index)
+		{
+			if(depths[index] != UINT32_MAX)
+				mLevelNodes[cursor[depths[index]]++] = index;
+		}
+
+		mChanged.assign(mNodes.size(), 0);
+		mBuildSahCost = computeSAHCost();
+	}
+
+	bool BVH::refit(const std::vector<BVHPrimitive>& primitives, const UINT8* dirty)
+	{
+		if(primitives.size() != mPrimitiveIndices.size())
+			return true;
+		if(mPrimitiveIndices.empty())
+			return false;
+
+		if(mLevelOffsets.empty())
+			prepareRefit();
+
+		Timer timer;
+		timer.reset();
+
+		auto refitNode = [&](UINT32 index)
+		{
+			BVHNode& node = mNodes[index];
+			XMVECTOR bMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR bMax = XMVectorReplicate(-FLT_MAX);
+
+			if(node.count > 0)
+			{
+				bool touched = !dirty;
+				for(UINT32 i = node.offset; i < node.offset + node.count && !touched; ++i)
+					touched = dirty[mPrimitiveIndices[i]] != 0;
+				if(!touched)
+				{
+					mChanged[index] = 0;
+					return;
+				}
+
+				for(UINT32 i = node.offset; i < node.offset + node.count; ++i)
+				{
+					const BVHPrimitive& p = primitives[mPrimitiveIndices[i]];
+					bMin = XMVectorMin(bMin, XMLoadFloat3(&p.boundsMin));
+					bMax = XMVectorMax(bMax, XMLoadFloat3(&p.boundsMax));
+				}
+			}
+			else
+			{
+				//untouched subtrees keep their bounds
+				const BVHNode& left = mNodes[index + 1];
+				const BVHNode& right = mNodes[node.offset];
+				if(!mChanged[index + 1] && !mChanged[node.offset])
+				{
+					mChanged[index] = 0;
+					return;
+				}
+
+				bMin = XMVectorMin(XMLoadFloat3(&left.boundsMin), XMLoadFloat3(&right.boundsMin));
+				bMax = XMVectorMax(XMLoadFloat3(&left.boundsMax), XMLoadFloat3(&right.boundsMax));
+			}
+
+			bool same = XMVector3Equal(bMin, XMLoadFloat3(&node.boundsMin)) && XMVector3Equal(bMax, XMLoadFloat3(&node.boundsMax));
+			mChanged[index] = same ? 0 : 1;
+			XMStoreFloat3(&node.boundsMin, bMin);
+			XMStoreFloat3(&node.boundsMax, bMax);
+		};
+
+		//deepest level first, the nodes of a level are independent of each other
+		for(size_t level = mLevelOffsets.size() - 1; level > 0; --level)
+		{
+			UINT32 begin = mLevelOffsets[level - 1];
+			UINT32 end = mLevelOffsets[level];
+			if(end - begin > BVH_PARALLEL_THRESHOLD)
+				parallelFor(begin, end, [&](UINT32 k) { refitNode(mLevelNodes[k]); });
+			else
+			{
+				for(UINT32 k = begin; k < end; ++k)
+					refitNode(mLevelNodes[k]);
+			}
+		}
+
+		if(mChanged[0])
+			mSahGrowth = computeSAHCost() / std::max<float>(mBuildSahCost, 1e-6F);
+
+		timer.tick();
+		mRefitMs = timer.deltaTime() * 1000.0F;
+		return mSahGrowth > BVH_REFIT_MAX_SAH_GROWTH;
+	}
+
+	bool BVH::refit(const Vertex* vertices, const UINT32* indices, const UINT8* dirty)
+	{
+		std::vector<BVHPrimitive> primitives;
+		triangleBounds(vertices, indices, (UINT32) mPrimitiveIndices.size(), primitives);
+		return refit(primitives, dirty);
+	}
+
+	bool BVH::refit(const MeshGeometry* geo, const UINT8* dirty)
+	{
+		const SubmeshGeometry& submesh = geo->DrawArgs.at("0");
+		if(submesh.IndexCount / 3 != mPrimitiveIndices.size())
+			return true;
+
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data()) + submesh.BaseVertexLocation;
+		const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data()) + submesh.StartIndexLocation;
+		return refit(vertices, indices, dirty);
+	}
+
+	float BVH::computeSAHCost() const
+	{
+		if(mNodes.empty())
+			return 0.0F;
+
+		//nodes are summed independently, no need to walk the tree
+		UINT32 nodeCount = (UINT32) mNodes.size();
+		UINT32 chunkCount = (nodeCount + BVH_PARALLEL_THRESHOLD - 1) / BVH_PARALLEL_THRESHOLD;
+		std::vector<double> partial(chunkCount, 0.0);
+		parallelFor(UINT32(0), chunkCount, [&](UINT32 chunk)
+		{
+			UINT32 end = std::min<UINT32>((chunk + 1) * BVH_PARALLEL_THRESHOLD, nodeCount);
+			for(UINT32 i = chunk * BVH_PARALLEL_THRESHOLD; i < end; ++i)
+			{
+				const BVHNode& node = mNodes[i];
+				float cost = node.count > 0 ? BVH_SAH_INTERSECTION_COST * node.count : BVH_SAH_TRAVERSAL_COST;
+				partial[chunk] += cost * halfArea(XMLoadFloat3(&node.boundsMin), XMLoadFloat3(&node.boundsMax));
+			}
+		});
+
+		double sum = 0.0;
+		for(double p:partial)
+			sum += p;
+
+		float rootArea = std::max<float>(halfArea(XMLoadFloat3(&mNodes[0].boundsMin), XMLoadFloat3(&mNodes[0].boundsMax)), 1e-12F);
+		return (float) (sum / rootArea);
+	}
+
+	BVHStats BVH::computeStats() const
+	{
+		BVHStats stats;
+		stats.buildMs = mBuildMs;
+		stats.nodeCount = (UINT32) mNodes.size();
+		if(mNodes.empty())
+			return stats;
+
+		float rootArea = std::max<float>(halfArea(XMLoadFloat3(&mNodes[0].boundsMin), XMLoadFloat3(&mNodes[0].boundsMax)), 1e-12F);
+		UINT64 leafPrimitives = 0;
+		UINT64 leafDepths = 0;
+
+		std::vector<std::pair<UINT32, UINT32>> stack = { { 0, 0 } };
+		while(!stack.empty())
+		{
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+
+			const BVHNode& node = mNodes[index];
+			float area = halfArea(XMLoadFloat3(&node.boundsMin), XMLoadFloat3(&node.boundsMax)) / rootArea;
+			stats.maxDepth = std::max<UINT32>(stats.maxDepth, depth);
+
+			if(node.count > 0)
+			{
+				stats.sahCost += BVH_SAH_INTERSECTION_COST * node.count * area;
+				stats.leafCount++;
+				stats.maxLeafSize = std::max<UINT32>(stats.maxLeafSize, node.count);
+				leafPrimitives += node.count;
+				leafDepths += depth;
+			}
+			else
+			{
+				stats.sahCost += BVH_SAH_TRAVERSAL_COST * area;
+				stack.push_back({ index + 1, depth + 1 });
+				stack.push_back({ node.offset, depth + 1 });
+			}
+		}
+
+		stats.avgLeafSize = stats.leafCount > 0 ? (float) leafPrimitives / stats.leafCount : 0.0F;
+		stats.avgLeafDepth = stats.leafCount > 0 ? (float) leafDepths / stats.leafCount : 0.0F;
+		return stats;
+	}
+
+	UINT32 BVH::mortonCode(FXMVECTOR unitPosition)
+	{
+		XMFLOAT3 q;
+		XMStoreFloat3(&q, XMVectorClamp(unitPosition * 1023.0F, XMVectorZero(), XMVectorReplicate(1023.0F)));
+		return (UINT32) ((expandBits10((UINT32) q.x) << 2) | (expandBits10((UINT32) q.y) << 1) | expandBits10((UINT32) q.z));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../../utils/core.h"
+
+#define BVH_MAX_DEPTH				64
+#define BVH_LEAF_SIZE				4
+#define BVH_MAX_LEAF_SIZE			8
+#define BVH_SAH_BINS				16
+#define BVH_SAH_TRAVERSAL_COST		1.0F
+#define BVH_SAH_INTERSECTION_COST	1.0F
+#define BVH_PARALLEL_THRESHOLD		4096
+#define BVH_LBVH_WIDE_THRESHOLD		262144 //63 bit morton codes above this many primitives
+#define BVH_REFIT_MAX_SAH_GROWTH	1.5F //refitted trees this much worse than their last build should be rebuilt
+
+namespace RT
+{
+	enum BVHBuilder
+	{
+		BVH_BUILDER_MEDIAN = 0,
+		BVH_BUILDER_BINNED_SAH,
+		BVH_BUILDER_LBVH //morton sorted, meant for geometry rebuilt every frame
+	};
+
+	//flattened depth first, the left child of an inner node is always the next node
+	struct BVHNode
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		UINT32 offset; //right child for inner nodes, first primitive for leaves
+		DirectX::XMFLOAT3 boundsMax;
+		UINT32 count; //0 for inner nodes
+	};
+
+	struct BVHPrimitive
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		UINT32 index;
+		DirectX::XMFLOAT3 boundsMax;
+		float pad;
+	};
+
+	struct BVHStats
+	{
+		float sahCost = 0.0F;
+		float buildMs = 0.0F;
+		UINT32 nodeCount = 0;
+		UINT32 leafCount = 0;
+		UINT32 maxDepth = 0;
+		UINT32 maxLeafSize = 0;
+		float avgLeafSize = 0.0F;
+		float avgLeafDepth = 0.0F;
+	};
+
+	class BVH
+	{
+	public:
+		BVH() = default;
+		~BVH() = default;
+
+		void build(std::vector<BVHPrimitive>& primitives, BVHBuilder builder = BVH_BUILDER_BINNED_SAH);
+		void build(const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, BVHBuilder builder = BVH_BUILDER_BINNED_SAH);
+		void build(const MeshGeometry* geo, BVHBuilder builder = BVH_BUILDER_BINNED_SAH);
+
+		//updates the bounds of the last build, primitives are indexed like the ones it was built from
+		//dirty flags the primitives that moved, everything else is skipped. Returns true when the tree should be rebuilt
+		bool refit(const std::vector<BVHPrimitive>& primitives, const UINT8* dirty = nullptr);
+		bool refit(const Vertex* vertices, const UINT32* indices, const UINT8* dirty = nullptr);
+		bool refit(const MeshGeometry* geo, const UINT8* dirty = nullptr);
+
+		BVHStats computeStats() const;
+		float computeSAHCost() const;
+
+		static UINT32 mortonCode(DirectX::FXMVECTOR unitPosition); //10 bits per axis, position in [0, 1]
+
+		inline const std::vector<BVHNode>& getNodes() const { return mNodes; }
+		inline const std::vector<UINT32>& getPrimitiveIndices() const { return mPrimitiveIndices; }
+		inline const std::vector<UINT8>& getChangeMask() const { return mChanged; }
+		inline float getBuildTime() const { return mBuildMs; }
+		inline float getRefitTime() const { return mRefitMs; }
+		inline float getSAHGrowth() const { return mSahGrowth; }
+	private:
+		void prepareRefit();
+
+		std::vector<BVHNode> mNodes;
+		std::vector<UINT32> mPrimitiveIndices; //leaves reference ranges of this array
+		float mBuildMs = 0.0F;
+
+		//refit data, created by the first refit after a build
+		std::vector<UINT32> mLevelNodes; //nodes grouped by depth
+		std::vector<UINT32> mLevelOffsets;
+		std::vector<UINT8> mChanged; //nodes whose bounds moved during the last refit
+		float mBuildSahCost = 0.0F;
+		float mSahGrowth = 1.0F;
+		float mRefitMs = 0.0F;
+	};
+}
\ No newline at end of file
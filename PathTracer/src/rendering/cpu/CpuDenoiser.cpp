@@ -0,0 +1,269 @@
+#include "CpuDenoiser.h"
+
+#include "../../utils/Timer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//B3 spline, the 5 taps of every a-trous pass
+	static const float kernel[3] = { 3.0F / 8.0F, 1.0F / 4.0F, 1.0F / 16.0F };
+
+	static inline float luma(FXMVECTOR color)
+	{
+		return XMVectorGetX(XMVector3Dot(color, XMVectorSet(0.2126F, 0.7152F, 0.0722F, 0.0F)));
+	}
+
+	void CpuDenoiser::resize(UINT32 width, UINT32 height)
+	{
+		mWidth = width;
+		mHeight = height;
+
+		size_t size = (size_t) width * height;
+		mPing.resize(size);
+		mPong.resize(size);
+		mNormalRoughness.resize(size);
+		mViewZ.resize(size);
+		mMoments.resize(size);
+		mHistoryLength.resize(size);
+
+		mHistory.resize(size);
+		mHistoryMoments.resize(size);
+		mPrevNormalRoughness.resize(size);
+		mPrevViewZ.resize(size);
+		mPrevHistoryLength.resize(size);
+		resetHistory();
+	}
+
+	void CpuDenoiser::prepare(const float* color, const CpuDenoiserGuides& guides)
+	{
+		parallelFor(UINT32(0), mHeight, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < mWidth; ++x)
+			{
+				size_t i = (size_t) y * mWidth + x;
+				mNormalRoughness[i] = XMFLOAT4(guides.normalRoughness + 4 * i);
+				mViewZ[i] = guides.viewZ[i];
+
+				//filter the lighting only, the albedo goes back on at the end
+				XMVECTOR irradiance = XMVectorSetW(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(color + 4 * i)), 0.0F);
+				if(guides.albedo && mViewZ[i] > 0.0F)
+					irradiance /= XMVectorMax(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(guides.albedo + 4 * i)), XMVectorReplicate(CPU_DENOISER_ALBEDO_EPSILON));
+
+				float l = luma(irradiance);
+				XMStoreFloat4(&mPing[i], XMVectorSetW(irradiance, 0.0F));
+				mMoments[i] = { l, l * l };
+				mHistoryLength[i] = 1.0F;
+			}
+		});
+	}
+
+	void CpuDenoiser::accumulate(const CpuDenoiserGuides& guides)
+	{
+		if(!settings.temporal || !mHistoryValid || !guides.motion)
+			return;
+
+		parallelFor(UINT32(0), mHeight, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < mWidth; ++x)
+			{
+				size_t i = (size_t) y * mWidth + x;
+				float z = mViewZ[i];
+				if(z <= 0.0F)
+					continue;
+
+				int px = (int) floorf(x + 0.5F + guides.motion[2 * i]);
+				int py = (int) floorf(y + 0.5F + guides.motion[2 * i + 1]);
+				if(px < 0 || py < 0 || px >= (int) mWidth || py >= (int) mHeight)
+					continue;
+
+				//disocclusions, the previous pixel has to be the same surface
+				size_t prev = (size_t) py * mWidth + px;
+				float prevZ = mPrevViewZ[prev];
+				if(prevZ <= 0.0F || fabsf(prevZ - z) > 0.1F * z)
+					continue;
+				if(XMVectorGetX(XMVector3Dot(XMLoadFloat4(&mNormalRoughness[i]), XMLoadFloat4(&mPrevNormalRoughness[prev]))) < 0.9F)
+					continue;
+
+				float length = std::min<float>(mPrevHistoryLength[prev] + 1.0F, 1.0F / settings.temporalAlpha);
+				float alpha = 1.0F / length;
+				XMStoreFloat4(&mPing[i], XMVectorLerp(XMLoadFloat4(&mHistory[prev]), XMLoadFloat4(&mPing[i]), alpha));
+				mMoments[i].x += (mHistoryMoments[prev].x - mMoments[i].x) * (1.0F - alpha);
+				mMoments[i].y += (mHistoryMoments[prev].y - mMoments[i].y) * (1.0F - alpha);
+				mHistoryLength[i] = length;
+			}
+		});
+	}
+
+	void CpuDenoiser::estimateVariance()
+	{
+		parallelFor(UINT32(0), mHeight, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < mWidth; ++x)
+			{
+				size_t i = (size_t) y * mWidth + x;
+				XMFLOAT2 moments = mMoments[i];
+
+				//too little history, the neighbours on the same surface stand in for it
+				if(mHistoryLength[i] < CPU_DENOISER_MIN_HISTORY && mViewZ[i] > 0.0F)
+				{
+					XMVECTOR n = XMLoadFloat4(&mNormalRoughness[i]);
+					float z = mViewZ[i];
+					float weightSum = 0.0F;
+					moments = { 0.0F, 0.0F };
+					for(int dy = -1; dy <= 1; ++dy)
+					{
+						for(int dx = -1; dx <= 1; ++dx)
+						{
+							int qx = (int) x + dx;
+							int qy = (int) y + dy;
+							if(qx < 0 || qy < 0 || qx >= (int) mWidth || qy >= (int) mHeight)
+								continue;
+
+							size_t q = (size_t) qy * mWidth + qx;
+							if(mViewZ[q] <= 0.0F || fabsf(mViewZ[q] - z) > settings.phiDepth * z * 4.0F)
+								continue;
+
+							float w = std::max<float>(XMVectorGetX(XMVector3Dot(n, XMLoadFloat4(&mNormalRoughness[q]))), 0.0F);
+							moments.x += mMoments[q].x * w;
+							moments.y += mMoments[q].y * w;
+							weightSum += w;
+						}
+					}
+					moments.x /= std::max<float>(weightSum, 1e-6F);
+					moments.y /= std::max<float>(weightSum, 1e-6F);
+				}
+
+				mPing[i].w = std::max<float>(moments.y - moments.x * moments.x, 0.0F);
+			}
+		});
+	}
+
+	void CpuDenoiser::filter(UINT step, const std::vector<XMFLOAT4>& input, std::vector<XMFLOAT4>& output) const
+	{
+		parallelFor(UINT32(0), mHeight, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < mWidth; ++x)
+			{
+				size_t i = (size_t) y * mWidth + x;
+				float z = mViewZ[i];
+				if(z <= 0.0F)
+				{
+					output[i] = input[i];
+					continue;
+				}
+
+				XMVECTOR center = XMLoadFloat4(&input[i]);
+				XMVECTOR nr = XMLoadFloat4(&mNormalRoughness[i]);
+				float roughness = mNormalRoughness[i].w;
+				float l = luma(center);
+
+				//the variance of a single pixel is noisy itself, blur it a little before it drives the edge stopping
+				float variance = 0.0F;
+				float varianceWeight = 0.0F;
+				for(int dy = -1; dy <= 1; ++dy)
+				{
+					for(int dx = -1; dx <= 1; ++dx)
+					{
+						int qx = std::clamp<int>((int) x + dx, 0, (int) mWidth - 1);
+						int qy = std::clamp<int>((int) y + dy, 0, (int) mHeight - 1);
+						float w = kernel[abs(dx)] * kernel[abs(dy)];
+						variance += input[(size_t) qy * mWidth + qx].w * w;
+						varianceWeight += w;
+					}
+				}
+
+				float invColor = 1.0F / (settings.phiColor * sqrtf(variance / varianceWeight) + 1e-4F);
+				float invDepth = 1.0F / (settings.phiDepth * z * step + 1e-4F);
+				float invRoughness = 1.0F / settings.phiRoughness;
+
+				XMVECTOR sum = XMVectorZero();
+				float weightSum = 0.0F;
+				for(int dy = -2; dy <= 2; ++dy)
+				{
+					int qy = (int) y + dy * (int) step;
+					if(qy < 0 || qy >= (int) mHeight)
+						continue;
+
+					for(int dx = -2; dx <= 2; ++dx)
+					{
+						int qx = (int) x + dx * (int) step;
+						if(qx < 0 || qx >= (int) mWidth)
+							continue;
+
+						size_t q = (size_t) qy * mWidth + qx;
+						if(mViewZ[q] <= 0.0F)
+							continue;
+
+						XMVECTOR sample = XMLoadFloat4(&input[q]);
+						float cosTheta = std::max<float>(XMVectorGetX(XMVector3Dot(nr, XMLoadFloat4(&mNormalRoughness[q]))), 0.0F);
+						float exponent = fabsf(mViewZ[q] - z) * invDepth + fabsf(mNormalRoughness[q].w - roughness) * invRoughness + fabsf(luma(sample) - l) * invColor;
+						float w = kernel[abs(dx)] * kernel[abs(dy)] * powf(cosTheta, settings.phiNormal) * expf(-exponent);
+
+						//color takes the weight, the variance its square
+						sum += sample * XMVectorSet(w, w, w, w * w);
+						weightSum += w;
+					}
+				}
+
+				//the center always passes, weightSum is never 0
+				XMStoreFloat4(&output[i], sum / XMVectorSet(weightSum, weightSum, weightSum, weightSum * weightSum));
+			}
+		});
+	}
+
+	void CpuDenoiser::denoise(const float* color, const CpuDenoiserGuides& guides, float* output)
+	{
+		Timer timer;
+		timer.reset();
+
+		prepare(color, guides);
+		accumulate(guides);
+		estimateVariance();
+
+		//unfiltered on purpose, the history would blur more every frame otherwise
+		if(settings.temporal)
+		{
+			mHistory = mPing;
+			mHistoryMoments = mMoments;
+		}
+
+		std::vector<XMFLOAT4>* input = &mPing;
+		std::vector<XMFLOAT4>* result = &mPong;
+		UINT iterations = std::min<UINT>(settings.iterations, CPU_DENOISER_MAX_ITERATIONS);
+		for(UINT i = 0; i < iterations; ++i)
+		{
+			filter(1 << i, *input, *result);
+			std::swap(input, result);
+		}
+
+		parallelFor(UINT32(0), mHeight, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < mWidth; ++x)
+			{
+				size_t i = (size_t) y * mWidth + x;
+				float alpha = color[4 * i + 3];
+
+				XMVECTOR irradiance = XMLoadFloat4(&(*input)[i]);
+				if(guides.albedo && mViewZ[i] > 0.0F)
+					irradiance *= XMVectorMax(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(guides.albedo + 4 * i)), XMVectorReplicate(CPU_DENOISER_ALBEDO_EPSILON));
+
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(output + 4 * i), XMVectorSetW(irradiance, alpha));
+			}
+		});
+
+		if(settings.temporal)
+		{
+			mPrevNormalRoughness.swap(mNormalRoughness);
+			mPrevViewZ.swap(mViewZ);
+			mPrevHistoryLength.swap(mHistoryLength);
+			mHistoryValid = true;
+		}
+
+		timer.tick();
+		mDenoiseTime = timer.deltaTime() * 1000.0F;
+	}
+}
\ No newline at end of file
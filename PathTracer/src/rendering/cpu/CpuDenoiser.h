@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../../utils/core.h"
+
+#define CPU_DENOISER_MAX_ITERATIONS		8
+#define CPU_DENOISER_MIN_HISTORY		4 //frames before the temporal variance replaces the spatial estimate
+#define CPU_DENOISER_ALBEDO_EPSILON		0.01F
+
+namespace RT
+{
+	//same guides ray_gen.hlsl writes for NRD, every buffer is width * height pixels
+	struct CpuDenoiserGuides
+	{
+		const float* normalRoughness = nullptr; //4 floats, world normal and linear roughness
+		const float* viewZ = nullptr; //1 float, 0 or less for the sky like roughAndZ.y
+		const float* albedo = nullptr; //4 floats, optional, the lighting is filtered without texture detail
+		const float* motion = nullptr; //2 floats, optional, offset in pixels to the previous frame
+	};
+
+	struct CpuDenoiserSettings
+	{
+		UINT iterations = 5;
+		float phiColor = 4.0F; //in standard deviations of the luminance
+		float phiNormal = 64.0F;
+		float phiDepth = 0.02F; //relative to the view Z, grows with the step size
+		float phiRoughness = 0.25F;
+		bool temporal = false;
+		float temporalAlpha = 0.2F;
+	};
+
+	//edge avoiding a-trous filter guided by variance like SVGF, for outputs that never reach NRD
+	class CpuDenoiser
+	{
+	public:
+		CpuDenoiser() = default;
+		~CpuDenoiser() = default;
+		CpuDenoiser(const CpuDenoiser&) = delete;
+		CpuDenoiser& operator=(const CpuDenoiser&) = delete;
+
+		void resize(UINT32 width, UINT32 height);
+		inline void resetHistory() { mHistoryValid = false; }
+
+		//color and output are 4 floats per pixel and can be the same buffer
+		void denoise(const float* color, const CpuDenoiserGuides& guides, float* output);
+
+		CpuDenoiserSettings settings {};
+		inline float getDenoiseTime() const { return mDenoiseTime; }
+	private:
+		void prepare(const float* color, const CpuDenoiserGuides& guides);
+		void accumulate(const CpuDenoiserGuides& guides);
+		void estimateVariance();
+		void filter(UINT step, const std::vector<DirectX::XMFLOAT4>& input, std::vector<DirectX::XMFLOAT4>& output) const;
+
+		UINT32 mWidth = 0;
+		UINT32 mHeight = 0;
+
+		//rgb irradiance and luminance variance
+		std::vector<DirectX::XMFLOAT4> mPing;
+		std::vector<DirectX::XMFLOAT4> mPong;
+		std::vector<DirectX::XMFLOAT4> mNormalRoughness;
+		std::vector<float> mViewZ;
+		std::vector<DirectX::XMFLOAT2> mMoments;
+		std::vector<float> mHistoryLength;
+
+		std::vector<DirectX::XMFLOAT4> mHistory;
+		std::vector<DirectX::XMFLOAT2> mHistoryMoments;
+		std::vector<DirectX::XMFLOAT4> mPrevNormalRoughness;
+		std::vector<float> mPrevViewZ;
+		std::vector<float> mPrevHistoryLength;
+		bool mHistoryValid = false;
+
+		float mDenoiseTime = 0.0F;
+	};
+}
\ No newline at end of file
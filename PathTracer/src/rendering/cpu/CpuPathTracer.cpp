@@ -0,0 +1,1526 @@
+#include "CpuPathTracer.h"
+
+#include "../../utils/Timer.h"
+#include "../EmissiveTriangles.h"
+#include "../EnvironmentMap.h"
+#include "../Sampling.h"
+
+#include <stb_image_write.h>
+#include <algorithm>
+#include <numeric>
+
+#define DIRECTIONAL_LIGHT_DISTANCE	60.0F
+
+using namespace DirectX;
+
+namespace RT
+{
+	static void tangentFrame(FXMVECTOR normal, XMVECTOR& tangent, XMVECTOR& bitangent)
+	{
+		XMVECTOR up = fabsf(XMVectorGetZ(normal)) < 0.999F ? XMVectorSet(0.0F, 0.0F, 1.0F, 0.0F) : XMVectorSet(1.0F, 0.0F, 0.0F, 0.0F);
+		tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+		bitangent = XMVector3Cross(normal, tangent);
+	}
+
+	static XMVECTOR cosWeight(FXMVECTOR normal, float u0, float u1)
+	{
+		float cosTheta = sqrtf(u0);
+		float sinTheta = sqrtf(1.0F - cosTheta * cosTheta);
+		float phi = XM_2PI * u1;
+
+		XMVECTOR T, B;
+		tangentFrame(normal, T, B);
+		return XMVector3Normalize(T * (sinTheta * cosf(phi)) + B * (sinTheta * sinf(phi)) + normal * cosTheta);
+	}
+
+	//visible normal sampling, VNDF in path_tracing_utils.hlsli
+	static XMVECTOR VNDF(FXMVECTOR toEye, FXMVECTOR normal, float roughness, float u0, float u1)
+	{
+		float alpha = roughness * roughness;
+
+		XMVECTOR T, B;
+		tangentFrame(normal, T, B);
+
+		XMVECTOR Vh = XMVector3Normalize(XMVectorSet(alpha * XMVectorGetX(XMVector3Dot(toEye, T)), alpha * XMVectorGetX(XMVector3Dot(toEye, B)), XMVectorGetX(XMVector3Dot(toEye, normal)), 0.0F));
+		float lensq = XMVectorGetX(Vh) * XMVectorGetX(Vh) + XMVectorGetY(Vh) * XMVectorGetY(Vh);
+		XMVECTOR T1 = lensq > 0.0F ? XMVectorSet(-XMVectorGetY(Vh), XMVectorGetX(Vh), 0.0F, 0.0F) / sqrtf(lensq) : XMVectorSet(1.0F, 0.0F, 0.0F, 0.0F);
+		XMVECTOR T2 = XMVector3Cross(Vh, T1);
+
+		float r = sqrtf(u0);
+		float phi = XM_2PI * u1;
+		float t1 = r * cosf(phi);
+		float t2 = r * sinf(phi);
+		float s = 0.5F * (1.0F + XMVectorGetZ(Vh));
+		t2 = (1.0F - s) * sqrtf(1.0F - t1 * t1) + s * t2;
+
+		XMVECTOR Nh = T1 * t1 + T2 * t2 + Vh * sqrtf(std::max<float>(1.0F - t1 * t1 - t2 * t2, 0.0F));
+		XMVECTOR m = XMVector3Normalize(XMVectorSet(alpha * XMVectorGetX(Nh), alpha * XMVectorGetY(Nh), std::max<float>(XMVectorGetZ(Nh), 0.0F), 0.0F));
+		return XMVector3Normalize(T * XMVectorGetX(m) + B * XMVectorGetY(m) + normal * XMVectorGetZ(m));
+	}
+
+	//GGX terms from pbr.hlsli
+	static float Dggx(FXMVECTOR normal, FXMVECTOR halfVec, float roughness)
+	{
+		float nDotH = XMVectorGetX(XMVector3Dot(normal, halfVec));
+		float alpha2 = roughness * roughness;
+		if(nDotH <= 0.0F)
+			return 0.0F;
+
+		float denom = nDotH * nDotH * (alpha2 - 1.0F) + 1.0F;
+		return alpha2 / (XM_PI * denom * denom);
+	}
+
+	static float G1ggx(FXMVECTOR x, FXMVECTOR normal, float roughness)
+	{
+		float xDotN = XMVectorGetX(XMVector3Dot(x, normal));
+		float alpha2 = roughness * roughness;
+		if(xDotN <= 0.0F)
+			return 0.0F;
+		return (2.0F * xDotN) / (xDotN + sqrtf(alpha2 + (1.0F - alpha2) * xDotN * xDotN));
+	}
+
+	static XMVECTOR Fggx(FXMVECTOR R0, FXMVECTOR toEye, FXMVECTOR halfVec)
+	{
+		float vDotH = 1.0F - XMVectorGetX(XMVector3Dot(toEye, halfVec));
+		return R0 + (XMVectorReplicate(1.0F) - R0) * (vDotH * vDotH * vDotH * vDotH * vDotH);
+	}
+
+	static XMVECTOR GGX(FXMVECTOR R0, float roughness, FXMVECTOR lightVec, FXMVECTOR normal, GXMVECTOR toEye)
+	{
+		float nDotV = XMVectorGetX(XMVector3Dot(toEye, normal));
+		if(nDotV <= 0.0F)
+			return XMVectorZero();
+
+		XMVECTOR halfVec = XMVector3Normalize(toEye + lightVec);
+		float D = Dggx(normal, halfVec, roughness);
+		float G = G1ggx(toEye, normal, roughness) * G1ggx(lightVec, normal, roughness);
+		return Fggx(R0, toEye, halfVec) * (D * G / (4.0F * nDotV));
+	}
+
+	static XMVECTOR reflectionsGGX_PDF(FXMVECTOR toEye, FXMVECTOR reflectionDir, FXMVECTOR normal, GXMVECTOR halfVec, float roughness, HXMVECTOR R0)
+	{
+		float NdotL = XMVectorGetX(XMVector3Dot(normal, reflectionDir));
+		float NdotV = XMVectorGetX(XMVector3Dot(normal, toEye));
+		float NdotH = XMVectorGetX(XMVector3Dot(normal, halfVec));
+		float VdotH = XMVectorGetX(XMVector3Dot(toEye, halfVec));
+		if(NdotL <= 0.0F || NdotH <= 0.0F || VdotH <= 0.0F || NdotV <= 0.0F)
+			return XMVectorZero();
+
+		float G = G1ggx(toEye, normal, roughness) * G1ggx(reflectionDir, normal, roughness);
+		return Fggx(R0, reflectionDir, halfVec) * (G * VdotH / (NdotV * NdotL * NdotH));
+	}
+
+	static float luma(FXMVECTOR color)
+	{
+		return XMVectorGetX(XMVector3Dot(color, XMVectorSet(0.2126F, 0.7152F, 0.0722F, 0.0F)));
+	}
+
+	CpuPathTracer::CpuPathTracer(UINT32 width, UINT32 height)
+	{
+		settings.width = width;
+		settings.height = height;
+	}
+
+	bool CpuPathTracer::initContext(std::string sceneName)
+	{
+		Logger::INFO.log("Initializing CPU path tracer (" + std::to_string(settings.width) + "x" + std::to_string(settings.height) + ")...");
+
+		loadScene(sceneName);
+		return true;
+	}
+
+	void CpuPathTracer::loadScene(std::string name)
+	{
+		//no device, the scene only loads the data the CPU can trace
+		mScene = std::make_unique<Scene>(&settings, "res/scenes/" + name + ".uge");
+		mCam = mScene->getSelectedCamera();
+		loadTextures();
+		onResize(settings.width, settings.height);
+	}
+
+	void CpuPathTracer::loadTextures()
+	{
+		Timer timer;
+		timer.reset();
+
+		//same folders and index order as the texture arrays of GpuScene, mip 0 is the one the GPU starts at
+		const UINT32 maxSize = 2048 >> settings.texResolution;
+		const std::pair<const char*, const std::vector<std::string>*> folders[CPU_MAP_COUNT] =
+		{
+			{ "res/textures/", &mScene->getTextureNames() },
+			{ "res/normal_maps/", &mScene->getNormalMapNames() },
+			{ "res/roughness_maps/", &mScene->getRoughnessMapNames() },
+			{ "res/ao_maps/", &mScene->getAOMapNames() },
+			{ "res/emissive/", &mScene->getEmissiveMapNames() },
+			{ "res/metallic_maps/", &mScene->getMetallicMapNames() }
+		};
+
+		UINT32 count = 0;
+		for(UINT32 m = 0; m < CPU_MAP_COUNT; ++m)
+		{
+			const std::string folder = folders[m].first;
+			const std::vector<std::string>& names = *folders[m].second;
+			mMaps[m].assign(names.size(), DDSTexture());
+			for(size_t i = 0; i < names.size(); ++i)
+			{
+				std::string fileName = folder + names[i] + ".dds";
+				if(mMaps[m][i].load(std::wstring(fileName.begin(), fileName.end()), maxSize))
+					count++;
+				else
+					Logger::WARN.log("Could not load " + fileName + ", the CPU path tracer shades without it");
+			}
+		}
+
+		//the CPU has no hardware filtering to lean on, the cubemap is kept at a resolution bilinear lookups still resolve
+		mCubemap.clear();
+		mCubemapSize = 0;
+		const std::string& cubemap = mScene->getCubemapName();
+		if(!cubemap.empty())
+		{
+			std::wstring fileName = L"res/cubemaps/" + std::wstring(cubemap.begin(), cubemap.end()) + L".dds";
+			if(!EnvironmentMap::decodeCubemap(fileName, mCubemap, mCubemapSize, CPU_CUBEMAP_SIZE))
+				Logger::WARN.log("Could not load the cubemap " + cubemap + ", the CPU path tracer uses a constant sky");
+		}
+
+		timer.tick();
+		Logger::INFO.log(std::to_string(count) + " textures" + (mCubemapSize > 0 ? " and the cubemap" : "") + " decoded for the CPU in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+	}
+
+	void CpuPathTracer::update(float dt)
+	{
+		if(dt <= 0.0F)
+			return;
+
+		mScene->animate(dt);
+		mScene->updateSkinnedGeometries();
+
+		for(auto& geo:mScene->getResidentGeometries())
+		{
+			if(geo && geo->needsRefit)
+				resetAccumulation();
+		}
+		if(mCam->isDirty())
+			resetAccumulation();
+	}
+
+	void CpuPathTracer::updateFrameData()
+	{
+		mCam->updateViewMatrix();
+
+		buildInstances();
+
+		//deforming geometry degrades the tree quickly, trade some traversal speed for a faster rebuild
+		bool dynamic = false;
+		for(auto& geo:mScene->getResidentGeometries())
+		{
+			if(!geo)
+				continue;
+			dynamic |= geo->needsRefit;
+			geo->needsRefit = false;
+		}
+
+		buildBVH(dynamic ? BVH_BUILDER_LBVH : mBuilder);
+	}
+
+	void CpuPathTracer::onResize(UINT32 width, UINT32 height)
+	{
+		settings.width = width;
+		settings.height = height;
+		mScene->resizeCameras();
+
+		mAccumulation.assign((size_t) width * height, { 0.0F, 0.0F, 0.0F, 0.0F });
+		mColor.assign((size_t) width * height, { 0.0F, 0.0F, 0.0F, 1.0F });
+		mMoments.assign((size_t) width * height, { 0.0F, 0.0F });
+
+		mGuideNormalRoughness.resize((size_t) width * height);
+		mGuideViewZ.resize((size_t) width * height);
+		mGuideAlbedo.resize((size_t) width * height);
+		mGuideMotion.resize((size_t) width * height);
+		mDenoiser.resize(width, height);
+		resetAccumulation();
+	}
+
+	void CpuPathTracer::buildInstances()
+	{
+		std::vector<CpuInstance> previous = std::move(mInstances);
+		mInstances.clear();
+
+		std::vector<UINT32> firstTriangle;
+		UINT32 triangleCount = 0;
+		for(auto& e:mScene->getAllEntities())
+		{
+			MeshGeometry* geo = e->getGeo();
+			if(!geo)
+				continue;
+
+			for(auto& inst:e->getInstances())
+			{
+				CpuInstance instance;
+				instance.world = inst.world;
+				instance.vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data());
+				instance.indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data());
+				instance.materialIndex = inst.materialIndex >= 0 ? (UINT) inst.materialIndex : 0;
+				if(instance.materialIndex < mScene->getMaterialCount())
+					XMStoreFloat4x4(&instance.uvTransform, XMLoadFloat4x4(&inst.texTransform) * XMLoadFloat4x4(&mScene->getMaterials()[instance.materialIndex]->MatTransform));
+				const INT32 maps[CPU_MAP_COUNT] = { inst.textureIndex, inst.normalIndex, inst.roughIndex, inst.aoIndex, inst.emissiveIndex, inst.metallicIndex };
+				std::copy(maps, maps + CPU_MAP_COUNT, instance.maps);
+				instance.emissive = inst.emissiveIndex >= 0;
+				instance.shadeKey = ((UINT32) (inst.materialIndex + 1) << 16) | (UINT32) ((inst.textureIndex + 1) & 0xFFFF);
+				instance.shadowIgnore = instance.emissive || e->getType() == INSTANCE_TYPE_WATER;
+
+				//only triangles that moved since the last frame are refitted
+				size_t index = mInstances.size();
+				instance.dirty = geo->needsRefit || index >= previous.size() || previous[index].vertices != instance.vertices ||
+								 memcmp(&previous[index].world, &instance.world, sizeof(XMFLOAT4X4)) != 0;
+				mInstances.push_back(instance);
+
+				firstTriangle.push_back(triangleCount);
+				triangleCount += geo->DrawArgs["0"].IndexCount / 3;
+			}
+		}
+		firstTriangle.push_back(triangleCount);
+
+		//flatten every instance into world space triangles
+		mTriangles.resize(triangleCount);
+		mDirtyTriangles.resize(triangleCount);
+		parallelFor(size_t(0), mInstances.size(), [&](size_t i)
+		{
+			const CpuInstance& instance = mInstances[i];
+			XMMATRIX world = XMLoadFloat4x4(&instance.world);
+			std::fill(mDirtyTriangles.begin() + firstTriangle[i], mDirtyTriangles.begin() + firstTriangle[i + 1], instance.dirty ? 1 : 0);
+
+			for(UINT32 t = firstTriangle[i]; t < firstTriangle[i + 1]; ++t)
+			{
+				UINT32 prim = t - firstTriangle[i];
+				XMVECTOR p0 = XMVector3TransformCoord(XMLoadFloat3(&instance.vertices[instance.indices[3 * prim]].position), world);
+				XMVECTOR p1 = XMVector3TransformCoord(XMLoadFloat3(&instance.vertices[instance.indices[3 * prim + 1]].position), world);
+				XMVECTOR p2 = XMVector3TransformCoord(XMLoadFloat3(&instance.vertices[instance.indices[3 * prim + 2]].position), world);
+
+				CpuTriangle& tri = mTriangles[t];
+				XMStoreFloat3(&tri.v0, p0);
+				XMStoreFloat3(&tri.e1, p1 - p0);
+				XMStoreFloat3(&tri.e2, p2 - p0);
+				tri.instance = (UINT32) i;
+				tri.primitive = prim;
+				tri.pad = 0.0F;
+			}
+		});
+	}
+
+	void CpuPathTracer::buildBVH(BVHBuilder builder)
+	{
+		std::vector<BVHPrimitive> primitives(mTriangles.size());
+		parallelFor(size_t(0), mTriangles.size(), [&](size_t i)
+		{
+			const CpuTriangle& tri = mTriangles[i];
+			XMVECTOR v0 = XMLoadFloat3(&tri.v0);
+			XMVECTOR v1 = v0 + XMLoadFloat3(&tri.e1);
+			XMVECTOR v2 = v0 + XMLoadFloat3(&tri.e2);
+
+			XMStoreFloat3(&primitives[i].boundsMin, XMVectorMin(v0, XMVectorMin(v1, v2)));
+			XMStoreFloat3(&primitives[i].boundsMax, XMVectorMax(v0, XMVectorMax(v1, v2)));
+			primitives[i].index = (UINT32) i;
+			primitives[i].pad = 0.0F;
+		});
+
+		//same triangles as last frame, moving the bounds is enough until the tree degrades
+		if(mBVH.refit(primitives, mDirtyTriangles.data()))
+			mBVH.build(primitives, builder);
+
+		//leaves index contiguous ranges, store the triangles in leaf order
+		const auto& order = mBVH.getPrimitiveIndices();
+		std::vector<CpuTriangle> sorted(mTriangles.size());
+		parallelFor(size_t(0), order.size(), [&](size_t i) { sorted[i] = mTriangles[order[i]]; });
+		mTriangles = std::move(sorted);
+	}
+
+	bool CpuPathTracer::intersect(const CpuRay& ray, CpuHit& hit, bool shadow) const
+	{
+		const auto& nodes = mBVH.getNodes();
+		if(mTriangles.empty())
+			return false;
+
+		XMVECTOR origin = XMLoadFloat3(&ray.origin);
+		XMVECTOR dir = XMLoadFloat3(&ray.direction);
+		XMVECTOR invDir = XMVectorReciprocal(dir);
+		float tMax = ray.tMax;
+		bool found = false;
+
+		auto intersectBounds = [&](const BVHNode& node, float tFar)
+		{
+			XMVECTOR t0 = (XMLoadFloat3(&node.boundsMin) - origin) * invDir;
+			XMVECTOR t1 = (XMLoadFloat3(&node.boundsMax) - origin) * invDir;
+			XMVECTOR tNear = XMVectorMin(t0, t1);
+			XMVECTOR tExit = XMVectorMax(t0, t1);
+			float enter = std::max<float>(std::max<float>(XMVectorGetX(tNear), XMVectorGetY(tNear)), std::max<float>(XMVectorGetZ(tNear), ray.tMin));
+			float exit = std::min<float>(std::min<float>(XMVectorGetX(tExit), XMVectorGetY(tExit)), std::min<float>(XMVectorGetZ(tExit), tFar));
+			return enter <= exit ? enter : FLT_MAX;
+		};
+
+		if(intersectBounds(nodes[0], tMax) == FLT_MAX)
+			return false;
+
+		UINT32 stack[BVH_MAX_DEPTH];
+		UINT32 sp = 0;
+		stack[sp++] = 0;
+
+		while(sp > 0)
+		{
+			UINT32 index = stack[--sp];
+			const BVHNode& node = nodes[index];
+
+			//children are visited near first, the far one waits on the stack
+			if(node.count == 0)
+			{
+				float tLeft = intersectBounds(nodes[index + 1], tMax);
+				float tRight = intersectBounds(nodes[node.offset], tMax);
+				if(tLeft <= tRight)
+				{
+					if(tRight != FLT_MAX)
+						stack[sp++] = node.offset;
+					if(tLeft != FLT_MAX)
+						stack[sp++] = index + 1;
+				}
+				else
+				{
+					if(tLeft != FLT_MAX)
+						stack[sp++] = index + 1;
+					stack[sp++] = node.offset;
+				}
+				continue;
+			}
+
+			for(UINT32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				const CpuTriangle& tri = mTriangles[i];
+				if(shadow && mInstances[tri.instance].shadowIgnore)
+					continue;
+
+				//moller-trumbore
+				XMVECTOR e1 = XMLoadFloat3(&tri.e1);
+				XMVECTOR e2 = XMLoadFloat3(&tri.e2);
+				XMVECTOR p = XMVector3Cross(dir, e2);
+				float det = XMVectorGetX(XMVector3Dot(e1, p));
+				if(fabsf(det) < 1e-12F)
+					continue;
+
+				float invDet = 1.0F / det;
+				XMVECTOR s = origin - XMLoadFloat3(&tri.v0);
+				float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+				if(u < 0.0F || u > 1.0F)
+					continue;
+
+				XMVECTOR q = XMVector3Cross(s, e1);
+				float v = XMVectorGetX(XMVector3Dot(dir, q)) * invDet;
+				if(v < 0.0F || u + v > 1.0F)
+					continue;
+
+				float t = XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+				if(t <= ray.tMin || t >= tMax)
+					continue;
+
+				tMax = t;
+				hit.t = t;
+				hit.bary = { u, v };
+				hit.triangle = i;
+				found = true;
+			}
+		}
+
+		return found;
+	}
+
+	float CpuPathTracer::traceShadow(const CpuRay& ray) const
+	{
+		//like ShadowHit, the closest occluder decides the occlusion
+		CpuHit hit;
+		if(!intersect(ray, hit, true))
+			return 0.0F;
+
+		const auto& materials = mScene->getMaterials();
+		UINT materialIndex = mInstances[mTriangles[hit.triangle].instance].materialIndex;
+		return materialIndex < materials.size() ? std::min<float>(materials[materialIndex]->DiffuseAlbedo.w, 1.0F) : 1.0F;
+	}
+
+	XMVECTOR CpuPathTracer::miss(FXMVECTOR direction) const
+	{
+		//the cubemap with the sun/moon disk from miss.hlsl
+		XMVECTOR color = mCubemapSize > 0 ? sampleCubemap(direction) : XMLoadFloat3(&mSkyColor);
+
+		if(mScene->getLightCount() > 0)
+		{
+			Light sun = mScene->getLight(0);
+			if(sun.lightType == LIGHT_TYPE_DIRECTIONAL)
+			{
+				XMVECTOR lightPos = -XMLoadFloat3(&sun.Direction);
+				float dist = XMVectorGetX(XMVector3Length(XMVector3Normalize(direction) - lightPos)) * 2.4F;
+				float blend = std::min<float>(std::max<float>(1.0F / (dist / sun.radius + 0.5F), 0.0F), 1.0F);
+				color = XMVectorLerp(color, XMLoadFloat3(&sun.Strength), blend);
+			}
+		}
+
+		return color;
+	}
+
+	XMVECTOR CpuPathTracer::sampleCubemap(FXMVECTOR direction) const
+	{
+		float u, v;
+		UINT32 face = EnvironmentMap::directionFace(direction, u, v);
+
+		//bilinear inside the face, clamped at its edges
+		const float last = (float) (mCubemapSize - 1);
+		float x = std::min<float>(std::max<float>(u * mCubemapSize - 0.5F, 0.0F), last);
+		float y = std::min<float>(std::max<float>(v * mCubemapSize - 0.5F, 0.0F), last);
+		UINT32 x0 = (UINT32) x, y0 = (UINT32) y;
+		UINT32 x1 = std::min<UINT32>(x0 + 1, mCubemapSize - 1), y1 = std::min<UINT32>(y0 + 1, mCubemapSize - 1);
+
+		auto texel = [&](UINT32 tx, UINT32 ty) { return XMLoadFloat3(&mCubemap[((size_t) face * mCubemapSize + ty) * mCubemapSize + tx]); };
+		XMVECTOR top = XMVectorLerp(texel(x0, y0), texel(x1, y0), x - x0);
+		XMVECTOR bottom = XMVectorLerp(texel(x0, y1), texel(x1, y1), x - x0);
+		return XMVectorLerp(top, bottom, y - y0);
+	}
+
+	bool CpuPathTracer::sampleLight(const Light& light, const Material& material, float roughness, FXMVECTOR pos, FXMVECTOR norm, FXMVECTOR toEye, UINT& seed, CpuLightSample& sample) const
+	{
+		XMVECTOR strength = XMLoadFloat3(&light.Strength);
+		XMVECTOR lightVec;
+		XMVECTOR lightPos;
+		float radius = light.radius;
+
+		if(light.lightType == LIGHT_TYPE_DIRECTIONAL)
+		{
+			lightVec = XMVector3Normalize(-XMLoadFloat3(&light.Direction));
+			lightPos = lightVec * DIRECTIONAL_LIGHT_DISTANCE;
+			radius /= 200.0F;
+		}
+		else
+		{
+			lightPos = XMLoadFloat3(&light.Position);
+			lightVec = lightPos - pos;
+			float d = XMVectorGetX(XMVector3Length(lightVec));
+			if(d > light.FalloffEnd)
+				return false;
+			lightVec /= d;
+
+			if(light.lightType == LIGHT_TYPE_TRIANGLE)
+			{
+				strength *= std::max<float>(XMVectorGetX(XMVector3Dot(-lightVec, XMLoadFloat3(&light.Direction))), 0.0F);
+				strength /= std::max<float>(d * d, light.FalloffStart * light.FalloffStart);
+			}
+			else
+			{
+				strength *= std::min<float>(std::max<float>((light.FalloffEnd - d) / (light.FalloffEnd - light.FalloffStart), 0.0F), 1.0F);
+				if(light.lightType == LIGHT_TYPE_SPOTLIGHT)
+					strength *= powf(std::max<float>(XMVectorGetX(XMVector3Dot(-lightVec, XMLoadFloat3(&light.Direction))), 0.0F), light.SpotPower);
+			}
+		}
+
+		float ndotl = std::max<float>(XMVectorGetX(XMVector3Dot(lightVec, norm)), 0.0F);
+		if(ndotl <= 0.0F)
+			return false;
+
+		//soft shadows, the shadow ray targets a random point on the light disk
+		sample.occlusionScale = 0.0F;
+		if(settings.rtShadows && material.castsShadows)
+		{
+			XMVECTOR T, B;
+			tangentFrame(lightVec, T, B);
+			float u0 = nextRand(seed) * 2.0F - 1.0F;
+			float u1 = nextRand(seed) * 2.0F - 1.0F;
+			XMVECTOR toLight = lightPos + (T * u0 + B * u1) * radius - pos;
+			float distance = XMVectorGetX(XMVector3Length(toLight));
+
+			XMStoreFloat3(&sample.shadowRay.origin, pos);
+			XMStoreFloat3(&sample.shadowRay.direction, toLight / distance);
+			sample.shadowRay.tMin = 0.001F;
+			sample.shadowRay.tMax = distance;
+			sample.occlusionScale = light.lightType == LIGHT_TYPE_DIRECTIONAL ? 0.5F : 1.0F;
+		}
+
+		XMVECTOR Ls = XMVectorZero();
+		if(settings.specular && material.specular > 0.0F)
+			Ls = strength * GGX(XMLoadFloat3(&material.FresnelR0), roughness, lightVec, norm, toEye);
+
+		sample.specular = Ls * material.specular;
+		sample.diffuse = strength * (ndotl * std::max<float>(1.0F - XMVectorGetX(XMVector3Length(Ls)) * material.specular, 0.0F));
+		return true;
+	}
+
+	//interpolated world space normal, facing the viewer
+	XMVECTOR CpuPathTracer::hitNormal(const CpuHit& hit, FXMVECTOR toEye) const
+	{
+		const CpuTriangle& tri = mTriangles[hit.triangle];
+		const CpuInstance& instance = mInstances[tri.instance];
+
+		const Vertex& a = instance.vertices[instance.indices[3 * tri.primitive]];
+		const Vertex& b = instance.vertices[instance.indices[3 * tri.primitive + 1]];
+		const Vertex& c = instance.vertices[instance.indices[3 * tri.primitive + 2]];
+		float w = 1.0F - hit.bary.x - hit.bary.y;
+		XMVECTOR norm = XMLoadFloat3(&a.normal) * w + XMLoadFloat3(&b.normal) * hit.bary.x + XMLoadFloat3(&c.normal) * hit.bary.y;
+		norm = XMVector3Normalize(XMVector3TransformNormal(norm, XMLoadFloat4x4(&instance.world)));
+
+		if(XMVectorGetX(XMVector3Dot(norm, toEye)) < 0.0F)
+			norm = -norm;
+		return norm;
+	}
+
+	//the maps in the order hit.hlsl samples them, bilinear at mip 0 since the CPU has no ray cones
+	CpuSurface CpuPathTracer::surface(const CpuHit& hit, const Material& material, FXMVECTOR toEye, UINT depth) const
+	{
+		const CpuTriangle& tri = mTriangles[hit.triangle];
+		const CpuInstance& instance = mInstances[tri.instance];
+
+		CpuSurface result;
+		result.albedo = XMLoadFloat4(&material.DiffuseAlbedo);
+		result.normal = hitNormal(hit, toEye);
+		result.emission = instance.emissive ? XMLoadFloat3(&material.emission) : XMVectorZero();
+		result.roughness = material.Roughness;
+		result.metallic = material.metallic;
+
+		auto map = [&](CpuTextureMap type, bool enabled) -> const DDSTexture*
+		{
+			INT32 index = instance.maps[type];
+			return enabled && index >= 0 && index < (INT32) mMaps[type].size() && mMaps[type][index].isValid() ? &mMaps[type][index] : nullptr;
+		};
+		const DDSTexture* albedoMap = map(CPU_MAP_ALBEDO, settings.texturing);
+		const DDSTexture* normalMap = map(CPU_MAP_NORMAL, settings.normalMapping);
+		const DDSTexture* roughnessMap = map(CPU_MAP_ROUGHNESS, settings.roughnessMapping);
+		const DDSTexture* aoMap = map(CPU_MAP_AO, settings.aoMapping && depth == 1);
+		const DDSTexture* emissiveMap = map(CPU_MAP_EMISSIVE, instance.emissive);
+		const DDSTexture* metallicMap = map(CPU_MAP_METALLIC, settings.metallicMapping);
+		if(!albedoMap && !normalMap && !roughnessMap && !aoMap && !emissiveMap && !metallicMap)
+			return result;
+
+		const Vertex& a = instance.vertices[instance.indices[3 * tri.primitive]];
+		const Vertex& b = instance.vertices[instance.indices[3 * tri.primitive + 1]];
+		const Vertex& c = instance.vertices[instance.indices[3 * tri.primitive + 2]];
+		float w = 1.0F - hit.bary.x - hit.bary.y;
+		XMVECTOR uv = XMLoadFloat2(&a.uvs) * w + XMLoadFloat2(&b.uvs) * hit.bary.x + XMLoadFloat2(&c.uvs) * hit.bary.y;
+		XMFLOAT2 uvs;
+		XMStoreFloat2(&uvs, XMVector2Transform(uv, XMLoadFloat4x4(&instance.uvTransform)));
+
+		if(albedoMap)
+			result.albedo *= albedoMap->sample(uvs.x, uvs.y);
+		if(normalMap)
+		{
+			//BC5 keeps x and y, z is rebuilt
+			XMFLOAT2 s;
+			XMStoreFloat2(&s, normalMap->sample(uvs.x, uvs.y) * 2.0F - XMVectorReplicate(1.0F));
+			float z = sqrtf(std::min<float>(std::max<float>(1.0F - s.x * s.x - s.y * s.y, 0.0F), 1.0F));
+
+			XMVECTOR tangent = XMLoadFloat4(&a.tangent) * w + XMLoadFloat4(&b.tangent) * hit.bary.x + XMLoadFloat4(&c.tangent) * hit.bary.y;
+			float handedness = XMVectorGetW(tangent) < 0.0F ? -1.0F : 1.0F;
+			tangent = XMVector3TransformNormal(tangent, XMLoadFloat4x4(&instance.world));
+			XMVECTOR N = result.normal;
+			XMVECTOR T = tangent - XMVector3Dot(tangent, N) * N;
+			if(XMVectorGetX(XMVector3LengthSq(T)) > 1e-12F)
+			{
+				T = XMVector3Normalize(T);
+				XMVECTOR B = XMVector3Cross(N, T) * handedness;
+				result.normal = XMVector3Normalize(T * s.x + B * s.y + N * z);
+			}
+		}
+		if(roughnessMap)
+		{
+			float roughness = XMVectorGetX(roughnessMap->sample(uvs.x, uvs.y));
+			result.roughness = roughness * roughness;
+		}
+		if(aoMap)
+			result.albedo *= std::max<float>(XMVectorGetX(aoMap->sample(uvs.x, uvs.y)), 0.15F);
+		if(emissiveMap)
+			result.emission *= XMVectorGetX(emissiveMap->sample(uvs.x, uvs.y));
+		if(metallicMap)
+			result.metallic = XMVectorGetX(metallicMap->sample(uvs.x, uvs.y));
+
+		return result;
+	}
+
+	//power heuristic between light sampling and the diffuse bounce, both in solid angle
+	static float misWeight(float pdf, float otherPdf)
+	{
+		return pdf * pdf / std::max<float>(pdf * pdf + otherPdf * otherPdf, 1e-20F);
+	}
+
+	//evaluates one hit like hit.hlsl, returns what needs no ray. Shadow tests and bounces are handed to the callers,
+	//radiance() traces them right away and the wavefront queues them for the next stage
+	template<typename ShadowFn, typename BounceFn>
+	XMVECTOR CpuPathTracer::shade(const CpuRay& ray, const CpuHit& hit, UINT depth, float bouncePdf, UINT& seed, ShadowFn&& shadow, BounceFn&& bounce) const
+	{
+		XMVECTOR dir = XMLoadFloat3(&ray.direction);
+		const CpuTriangle& triangle = mTriangles[hit.triangle];
+		const CpuInstance& instance = mInstances[triangle.instance];
+		const auto& materials = mScene->getMaterials();
+		static const Material defaultMaterial{};
+		const Material& material = instance.materialIndex < materials.size() ? *materials[instance.materialIndex] : defaultMaterial;
+
+		XMVECTOR pos = XMLoadFloat3(&ray.origin) + dir * hit.t;
+		XMVECTOR toEye = -dir;
+		CpuSurface surf = surface(hit, material, toEye, depth);
+		XMVECTOR norm = surf.normal;
+
+		XMVECTOR albedo = surf.albedo;
+		XMVECTOR R0 = XMLoadFloat3(&material.FresnelR0);
+		float roughness = surf.roughness;
+
+		float metallic = 0.0F;
+		bool transparent = material.DiffuseAlbedo.w < 1.0F;
+		XMVECTOR vndfNormal = norm;
+		if((surf.metallic > 0.0F || transparent) && depth < CPU_MAX_DEPTH)
+			vndfNormal = VNDF(toEye, norm, roughness, nextRand(seed), nextRand(seed));
+
+		//reflections
+		if(settings.rtReflections && surf.metallic > 0.0F && depth < CPU_MAX_DEPTH)
+		{
+			XMVECTOR reflDir = XMVector3Reflect(dir, vndfNormal);
+			if(XMVectorGetX(XMVector3Dot(reflDir, norm)) > 0.0F)
+			{
+				CpuRay reflRay;
+				XMStoreFloat3(&reflRay.origin, pos);
+				XMStoreFloat3(&reflRay.direction, reflDir);
+				reflRay.tMin = 0.01F;
+				reflRay.tMax = 1000.0F;
+
+				XMVECTOR ggx = reflectionsGGX_PDF(toEye, reflDir, norm, vndfNormal, roughness, R0);
+				bounce(reflRay, ggx * surf.metallic, 0.0F);
+				metallic = luma(ggx) * surf.metallic;
+			}
+		}
+
+		//refractions
+		if(transparent && depth < CPU_MAX_DEPTH)
+		{
+			float visibility = 1.0F - material.DiffuseAlbedo.w;
+			float f = XMVectorGetX(Fggx(R0, toEye, vndfNormal));
+
+			XMVECTOR refrDir = dir;
+			if(settings.rtRefractions)
+			{
+				refrDir = XMVector3Refract(dir, vndfNormal, material.refractionIndex);
+				if(XMVector3Equal(refrDir, XMVectorZero()))
+					refrDir = XMVector3Reflect(dir, vndfNormal);
+			}
+
+			CpuRay refrRay;
+			XMStoreFloat3(&refrRay.origin, pos);
+			XMStoreFloat3(&refrRay.direction, XMVector3Normalize(refrDir));
+			refrRay.tMin = 0.001F;
+			refrRay.tMax = 1000.0F;
+
+			float m = (1.0F - f) * (1.0F - metallic) * visibility;
+			bounce(refrRay, XMVectorReplicate(m), 0.0F);
+			metallic += m;
+		}
+
+		//whatever the lobes above took is missing from the diffuse terms
+		XMVECTOR diffuse = albedo * std::max<float>(1.0F - metallic, 0.0F);
+
+		//ambient from the cubemap irradiance and emissive, the emissive map counts as fully lit
+		//diffuse bounces share the emitters with the triangle lights, camera rays, reflections and refractions keep all of it
+		const EmissiveTriangles& emissive = mScene->getEmissiveTriangles();
+		XMVECTOR color = diffuse * SphericalHarmonics::evaluate(mScene->getEnvironmentMap().getAmbient(), norm);
+		if(instance.emissive)
+		{
+			float weight = 1.0F;
+			UINT32 index = bouncePdf > 0.0F ? emissive.find(triangle.instance, triangle.primitive) : UINT32_MAX;
+			if(index != UINT32_MAX && hit.t <= mScene->getLight(emissive.getFirstLight() + index).FalloffEnd)
+				weight = misWeight(bouncePdf, emissive.pdf(index, XMLoadFloat3(&ray.origin), pos));
+			color += surf.emission * (std::max<float>(1.0F - metallic, 0.0F) * weight);
+		}
+		bool bounces = settings.indirect && !instance.emissive && depth < CPU_MAX_DEPTH;
+
+		//direct, every light instead of the reservoir sample
+		UINT lightCount = emissive.getCount() > 0 ? emissive.getFirstLight() : mScene->getLightCount();
+		for(UINT i = 0; i < lightCount; ++i)
+		{
+			CpuLightSample sample;
+			if(!sampleLight(mScene->getLight(i), material, roughness, pos, norm, toEye, seed, sample))
+				continue;
+
+			XMVECTOR contribution = sample.diffuse * diffuse + sample.specular;
+			if(sample.occlusionScale > 0.0F)
+				shadow(sample.shadowRay, contribution, sample.occlusionScale);
+			else
+				color += contribution;
+		}
+
+		//one emissive triangle picked by flux and a uniform point on it, the shadow ray goes to that point
+		if(emissive.getCount() > 0)
+		{
+			float pdf;
+			UINT32 index = emissive.sampleAlias(nextRand(seed), nextRand(seed), pdf);
+			Light light = index < emissive.getCount() ? mScene->getLight(emissive.getFirstLight() + index) : Light{};
+			XMVECTOR point = index < emissive.getCount() ? EmissiveTriangles::samplePoint(emissive.getTriangles()[index], nextRand(seed), nextRand(seed)) : XMVectorZero();
+			XMStoreFloat3(&light.Position, point);
+			light.radius = 0.0F;
+
+			CpuLightSample sample;
+			if(index < emissive.getCount() && pdf > 0.0F && sampleLight(light, material, roughness, pos, norm, toEye, seed, sample))
+			{
+				//the diffuse bounce could reach the same point, the specular lobe only through here
+				float lightWeight = 1.0F;
+				if(bounces)
+				{
+					float cosine = std::max<float>(XMVectorGetX(XMVector3Dot(norm, XMVector3Normalize(point - pos))), 0.0F);
+					lightWeight = misWeight(emissive.pdf(index, pos, point), cosine / XM_PI);
+				}
+				XMVECTOR contribution = (sample.diffuse * diffuse * lightWeight + sample.specular) / pdf;
+				if(sample.occlusionScale > 0.0F)
+					shadow(sample.shadowRay, contribution, sample.occlusionScale);
+				else
+					color += contribution;
+			}
+		}
+
+		//indirect
+		if(bounces)
+		{
+			XMVECTOR indirectDir = cosWeight(norm, nextRand(seed), nextRand(seed));
+			CpuRay indirectRay;
+			XMStoreFloat3(&indirectRay.origin, pos);
+			XMStoreFloat3(&indirectRay.direction, indirectDir);
+			indirectRay.tMin = 0.01F;
+			indirectRay.tMax = 1000.0F;
+			bounce(indirectRay, diffuse, std::max<float>(XMVectorGetX(XMVector3Dot(norm, indirectDir)), 1e-6F) / XM_PI);
+		}
+
+		return color;
+	}
+
+	XMVECTOR CpuPathTracer::radiance(const CpuRay& ray, UINT depth, UINT& seed, float bouncePdf) const
+	{
+		CpuHit hit;
+		if(!intersect(ray, hit))
+			return miss(XMLoadFloat3(&ray.direction));
+
+		XMVECTOR traced = XMVectorZero();
+		XMVECTOR color = shade(ray, hit, depth, bouncePdf, seed,
+			[&](const CpuRay& shadowRay, FXMVECTOR contribution, float occlusionScale) { traced += contribution * (1.0F - traceShadow(shadowRay) * occlusionScale); },
+			[&](const CpuRay& bounceRay, FXMVECTOR weight, float pdf) { traced += radiance(bounceRay, depth + 1, seed, pdf) * weight; });
+		return color + traced;
+	}
+
+	void CpuPathTracer::updateCameraRays()
+	{
+		setCameraRays(mCam->getView4x4(), mCam->getProj4x4());
+	}
+
+	void CpuPathTracer::setCameraRays(const XMFLOAT4X4& view4x4, const XMFLOAT4X4& proj4x4)
+	{
+		XMMATRIX view = XMLoadFloat4x4(&view4x4);
+		XMMATRIX proj = XMLoadFloat4x4(&proj4x4);
+		XMVECTOR det = XMMatrixDeterminant(view);
+		XMMATRIX invView = XMMatrixInverse(&det, view);
+		det = XMMatrixDeterminant(proj);
+
+		XMStoreFloat4x4(&mInvView, invView);
+		XMStoreFloat4x4(&mInvProj, XMMatrixInverse(&det, proj));
+		XMStoreFloat3(&mEyePos, XMVector3TransformCoord(XMVectorZero(), invView));
+	}
+
+	CpuRay CpuPathTracer::primaryRay(UINT32 x, UINT32 y, UINT& seed) const
+	{
+		//jittered inside the pixel
+		float px = x + nextRand(seed);
+		float py = y + nextRand(seed);
+		return cameraRay(px, py);
+	}
+
+	CpuRay CpuPathTracer::cameraRay(float px, float py) const
+	{
+		//same camera ray as ray_gen.hlsl
+		float dx = (px / settings.width) * 2.0F - 1.0F;
+		float dy = (py / settings.height) * 2.0F - 1.0F;
+		XMVECTOR target = XMVector4Transform(XMVectorSet(dx, -dy, 1.0F, 1.0F), XMLoadFloat4x4(&mInvProj));
+
+		CpuRay ray;
+		ray.origin = mEyePos;
+		XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVector3TransformNormal(target, XMLoadFloat4x4(&mInvView))));
+		ray.tMin = 0.1F;
+		ray.tMax = 1000.0F;
+		return ray;
+	}
+
+	void CpuPathTracer::renderGuides()
+	{
+		const UINT32 width = settings.width;
+		const auto& materials = mScene->getMaterials();
+		XMMATRIX view = mCam->getView();
+		XMMATRIX prevViewProj = XMLoadFloat4x4(&mPrevViewProj);
+
+		parallelFor(UINT32(0), settings.height, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < width; ++x)
+			{
+				size_t i = (size_t) y * width + x;
+				CpuRay ray = cameraRay(x + 0.5F, y + 0.5F);
+
+				//misses get a negative view Z like the sky in ray_gen.hlsl
+				CpuHit hit;
+				if(!intersect(ray, hit))
+				{
+					mGuideNormalRoughness[i] = { 0.0F, 0.0F, 0.0F, 1.0F };
+					mGuideViewZ[i] = -1.0F;
+					mGuideAlbedo[i] = { 0.0F, 0.0F, 0.0F, 0.0F };
+					mGuideMotion[i] = { 0.0F, 0.0F };
+					continue;
+				}
+
+				const CpuInstance& instance = mInstances[mTriangles[hit.triangle].instance];
+				static const Material defaultMaterial{};
+				const Material& material = instance.materialIndex < materials.size() ? *materials[instance.materialIndex] : defaultMaterial;
+
+				XMVECTOR dir = XMLoadFloat3(&ray.direction);
+				XMVECTOR pos = XMLoadFloat3(&ray.origin) + dir * hit.t;
+				CpuSurface surf = surface(hit, material, -dir, 1);
+				XMStoreFloat4(&mGuideNormalRoughness[i], XMVectorSetW(surf.normal, surf.roughness));
+				mGuideViewZ[i] = XMVectorGetZ(XMVector3TransformCoord(pos, view));
+				XMStoreFloat4(&mGuideAlbedo[i], surf.albedo);
+
+				//where the surface was on the screen last frame
+				XMFLOAT3 prev;
+				XMStoreFloat3(&prev, XMVector3TransformCoord(pos, prevViewProj));
+				mGuideMotion[i] = { (prev.x * 0.5F + 0.5F) * width - (x + 0.5F), (0.5F - prev.y * 0.5F) * settings.height - (y + 0.5F) };
+			}
+		});
+
+		XMStoreFloat4x4(&mPrevViewProj, view * mCam->getProj());
+	}
+
+	void CpuPathTracer::denoise()
+	{
+		if(mSampleCount == 0)
+			updateFrameData();
+		updateCameraRays();
+		renderGuides();
+
+		CpuDenoiserGuides guides;
+		guides.normalRoughness = reinterpret_cast<const float*>(mGuideNormalRoughness.data());
+		guides.viewZ = mGuideViewZ.data();
+		guides.albedo = reinterpret_cast<const float*>(mGuideAlbedo.data());
+		guides.motion = reinterpret_cast<const float*>(mGuideMotion.data());
+
+		//in place, draw() rebuilds mColor from the accumulation anyway
+		float* color = reinterpret_cast<float*>(mColor.data());
+		mDenoiser.denoise(color, guides, color);
+	}
+
+	void CpuPathTracer::draw()
+	{
+		if(mIntegrator == CPU_INTEGRATOR_WAVEFRONT)
+		{
+			drawWavefront();
+			return;
+		}
+
+		if(mSampleCount == 0)
+			updateFrameData();
+
+		const UINT32 width = settings.width;
+		const UINT32 height = settings.height;
+		const UINT32 tilesX = (width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+		const UINT32 tilesY = (height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+		const UINT frameIndex = mSampleCount + 1;
+		const float invSamples = 1.0F / frameIndex;
+
+		updateCameraRays();
+
+		//tiles keep the pixels of one task close in memory and in the BVH
+		parallelFor(UINT32(0), tilesX * tilesY, [&](UINT32 tile)
+		{
+			UINT32 x0 = (tile % tilesX) * CPU_TILE_SIZE;
+			UINT32 y0 = (tile / tilesX) * CPU_TILE_SIZE;
+			UINT32 x1 = std::min<UINT32>(x0 + CPU_TILE_SIZE, width);
+			UINT32 y1 = std::min<UINT32>(y0 + CPU_TILE_SIZE, height);
+
+			for(UINT32 y = y0; y < y1; ++y)
+			{
+				for(UINT32 x = x0; x < x1; ++x)
+				{
+					UINT seed = initRand(x + y * width, frameIndex);
+					CpuRay ray = primaryRay(x, y, seed);
+
+					size_t index = (size_t) y * width + x;
+					XMVECTOR sum = XMLoadFloat4(&mAccumulation[index]);
+					if(mSampleCount == 0)
+						sum = XMVectorZero();
+					sum += radiance(ray, 1, seed);
+
+					XMStoreFloat4(&mAccumulation[index], sum);
+					XMStoreFloat4(&mColor[index], XMVectorSetW(sum * invSamples, 1.0F));
+				}
+			}
+		});
+
+		mSampleCount++;
+	}
+
+	//moves the per chunk queues of a stage into one array, keeping the chunk order
+	template<typename T>
+	static void concatChunks(std::vector<std::vector<T>>& chunks, std::vector<T>& out)
+	{
+		std::vector<size_t> offsets(chunks.size() + 1, 0);
+		for(size_t i = 0; i < chunks.size(); ++i)
+			offsets[i + 1] = offsets[i] + chunks[i].size();
+
+		out.resize(offsets.back());
+		parallelFor(size_t(0), chunks.size(), [&](size_t i) { std::copy(chunks[i].begin(), chunks[i].end(), out.begin() + offsets[i]); });
+	}
+
+	void CpuPathTracer::sortPaths()
+	{
+		const auto& nodes = mBVH.getNodes();
+		if(nodes.empty())
+			return;
+
+		//direction octant first, then the origin along a morton curve over the scene bounds
+		XMVECTOR bMin = XMLoadFloat3(&nodes[0].boundsMin);
+		XMVECTOR scale = XMVectorReciprocal(XMVectorMax(XMLoadFloat3(&nodes[0].boundsMax) - bMin, XMVectorReplicate(1e-6F)));
+		std::vector<UINT64> keys(mPaths.size());
+		parallelFor(size_t(0), mPaths.size(), [&](size_t i)
+		{
+			const CpuRay& ray = mPaths[i].ray;
+			UINT64 octant = (ray.direction.x < 0.0F ? 1 : 0) | (ray.direction.y < 0.0F ? 2 : 0) | (ray.direction.z < 0.0F ? 4 : 0);
+			keys[i] = (octant << 30) | BVH::mortonCode((XMLoadFloat3(&ray.origin) - bMin) * scale);
+		});
+
+		std::vector<UINT32> order(mPaths.size());
+		std::iota(order.begin(), order.end(), 0);
+		radixSort(order.begin(), order.end(), [&](UINT32 i) -> size_t { return (size_t) keys[i]; });
+
+		std::vector<CpuPathState> sorted(mPaths.size());
+		parallelFor(size_t(0), order.size(), [&](size_t i) { sorted[i] = mPaths[order[i]]; });
+		mPaths.swap(sorted);
+	}
+
+	void CpuPathTracer::drawWavefront()
+	{
+		if(mSampleCount == 0)
+			updateFrameData();
+
+		const UINT32 width = settings.width;
+		const UINT32 height = settings.height;
+		const UINT32 pixelCount = width * height;
+		const UINT frameIndex = mSampleCount + 1;
+		const float invSamples = 1.0F / frameIndex;
+
+		updateCameraRays();
+
+		Timer timer;
+
+		//generate, the same jittered camera rays as draw()
+		mPaths.resize(pixelCount);
+		parallelFor(UINT32(0), height, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < width; ++x)
+			{
+				UINT32 pixel = y * width + x;
+				UINT seed = initRand(pixel, frameIndex);
+
+				CpuPathState& path = mPaths[pixel];
+				path.ray = primaryRay(x, y, seed);
+				path.weight = { 1.0F, 1.0F, 1.0F };
+				path.pixel = pixel;
+				path.depth = 1;
+				path.seed = seed;
+				path.bouncePdf = 0.0F;
+			}
+		});
+		mFrame.assign(pixelCount, { 0.0F, 0.0F, 0.0F });
+
+		std::vector<CpuShadowState> shadows;
+		std::vector<float> occlusion;
+		while(!mPaths.empty())
+		{
+			//every path of a wave has the same depth
+			const UINT32 depth = mPaths[0].depth;
+			const UINT32 count = (UINT32) mPaths.size();
+			const UINT32 chunkCount = (count + CPU_WAVEFRONT_CHUNK - 1) / CPU_WAVEFRONT_CHUNK;
+
+			//bounces leave in every direction, grouping them again gives the traversal some coherence back
+			if(mSortRays && depth > 1)
+			{
+				timer.reset();
+				sortPaths();
+				timer.tick();
+				mStats.sortMs += timer.deltaTime() * 1000.0;
+			}
+
+			//extend
+			timer.reset();
+			mHits.resize(count);
+			parallelFor(UINT32(0), chunkCount, [&](UINT32 chunk)
+			{
+				UINT32 end = std::min<UINT32>((chunk + 1) * CPU_WAVEFRONT_CHUNK, count);
+				for(UINT32 i = chunk * CPU_WAVEFRONT_CHUNK; i < end; ++i)
+				{
+					mHits[i] = {};
+					intersect(mPaths[i].ray, mHits[i]);
+				}
+			});
+			timer.tick();
+			mStats.extendMs[depth] += timer.deltaTime() * 1000.0;
+			mStats.extendRays[depth] += count;
+
+			//misses first, then hits grouped by material and texture
+			timer.reset();
+			std::vector<UINT32> order(count);
+			std::iota(order.begin(), order.end(), 0);
+			radixSort(order.begin(), order.end(), [&](UINT32 i) -> size_t
+			{
+				return mHits[i].triangle == UINT32_MAX ? 0 : (size_t) mInstances[mTriangles[mHits[i].triangle].instance].shadeKey + 1;
+			});
+			timer.tick();
+			mStats.sortMs += timer.deltaTime() * 1000.0;
+
+			//shade, every chunk fills its own queues
+			timer.reset();
+			std::vector<std::vector<CpuPathState>> nextChunks(chunkCount);
+			std::vector<std::vector<CpuShadowState>> shadowChunks(chunkCount);
+			std::vector<std::vector<std::pair<UINT32, XMFLOAT3>>> colorChunks(chunkCount);
+			parallelFor(UINT32(0), chunkCount, [&](UINT32 chunk)
+			{
+				UINT32 end = std::min<UINT32>((chunk + 1) * CPU_WAVEFRONT_CHUNK, count);
+				colorChunks[chunk].reserve(end - chunk * CPU_WAVEFRONT_CHUNK);
+				for(UINT32 i = chunk * CPU_WAVEFRONT_CHUNK; i < end; ++i)
+				{
+					const CpuPathState& path = mPaths[order[i]];
+					const CpuHit& hit = mHits[order[i]];
+					XMVECTOR weight = XMLoadFloat3(&path.weight);
+
+					XMFLOAT3 color;
+					if(hit.triangle == UINT32_MAX)
+					{
+						XMStoreFloat3(&color, miss(XMLoadFloat3(&path.ray.direction)) * weight);
+						colorChunks[chunk].push_back({ path.pixel, color });
+						continue;
+					}
+
+					UINT seed = path.seed;
+					UINT branch = 0;
+					XMVECTOR emitted = shade(path.ray, hit, path.depth, path.bouncePdf, seed,
+						[&](const CpuRay& shadowRay, FXMVECTOR contribution, float occlusionScale)
+						{
+							CpuShadowState shadow;
+							shadow.ray = shadowRay;
+							XMStoreFloat3(&shadow.contribution, contribution * weight);
+							shadow.pixel = path.pixel;
+							shadow.occlusionScale = occlusionScale;
+							shadowChunks[chunk].push_back(shadow);
+						},
+						[&](const CpuRay& bounceRay, FXMVECTOR bounceWeight, float bouncePdf)
+						{
+							//every branch of the path continues with its own random sequence
+							CpuPathState next;
+							next.ray = bounceRay;
+							XMStoreFloat3(&next.weight, bounceWeight * weight);
+							next.pixel = path.pixel;
+							next.depth = path.depth + 1;
+							next.seed = initRand(seed, ++branch);
+							next.bouncePdf = bouncePdf;
+							nextChunks[chunk].push_back(next);
+						});
+
+					XMStoreFloat3(&color, emitted * weight);
+					colorChunks[chunk].push_back({ path.pixel, color });
+				}
+			});
+			timer.tick();
+			mStats.shadeMs += timer.deltaTime() * 1000.0;
+			mStats.shaded += count;
+
+			for(auto& chunk:colorChunks)
+			{
+				for(auto& [pixel, color]:chunk)
+					XMStoreFloat3(&mFrame[pixel], XMLoadFloat3(&mFrame[pixel]) + XMLoadFloat3(&color));
+			}
+			concatChunks(shadowChunks, shadows);
+			concatChunks(nextChunks, mPaths);
+
+			//connect, the occluders of every shadow ray of the wave
+			timer.reset();
+			occlusion.resize(shadows.size());
+			UINT32 shadowChunkCount = (UINT32) ((shadows.size() + CPU_WAVEFRONT_CHUNK - 1) / CPU_WAVEFRONT_CHUNK);
+			parallelFor(UINT32(0), shadowChunkCount, [&](UINT32 chunk)
+			{
+				size_t end = std::min<size_t>((size_t) (chunk + 1) * CPU_WAVEFRONT_CHUNK, shadows.size());
+				for(size_t i = (size_t) chunk * CPU_WAVEFRONT_CHUNK; i < end; ++i)
+					occlusion[i] = traceShadow(shadows[i].ray) * shadows[i].occlusionScale;
+			});
+			timer.tick();
+			mStats.shadowMs += timer.deltaTime() * 1000.0;
+			mStats.shadowRays += shadows.size();
+
+			for(size_t i = 0; i < shadows.size(); ++i)
+			{
+				XMFLOAT3& sum = mFrame[shadows[i].pixel];
+				XMStoreFloat3(&sum, XMLoadFloat3(&sum) + XMLoadFloat3(&shadows[i].contribution) * (1.0F - occlusion[i]));
+			}
+		}
+
+		parallelFor(UINT32(0), pixelCount, [&](UINT32 pixel)
+		{
+			XMVECTOR sum = XMLoadFloat4(&mAccumulation[pixel]);
+			if(mSampleCount == 0)
+				sum = XMVectorZero();
+			sum += XMVectorSetW(XMLoadFloat3(&mFrame[pixel]), 0.0F);
+
+			XMStoreFloat4(&mAccumulation[pixel], sum);
+			XMStoreFloat4(&mColor[pixel], XMVectorSetW(sum * invSamples, 1.0F));
+		});
+
+		mSampleCount++;
+	}
+
+	void CpuPathTracer::logWavefrontStats(const std::string& label) const
+	{
+		auto mrays = [](double rays, double ms) { return std::to_string(rays / std::max<double>(ms, 1e-6) * 1e-3); };
+
+		std::string extend;
+		double rays = (double) mStats.shadowRays;
+		double ms = mStats.shadowMs;
+		for(UINT32 depth = 1; depth <= CPU_MAX_DEPTH; ++depth)
+		{
+			if(mStats.extendRays[depth] == 0)
+				continue;
+
+			extend += (depth == 1 ? " primary " : ", bounce " + std::to_string(depth - 1) + " ") + mrays((double) mStats.extendRays[depth], mStats.extendMs[depth]);
+			rays += (double) mStats.extendRays[depth];
+			ms += mStats.extendMs[depth];
+		}
+
+		Logger::INFO.log("CPU wavefront (" + label + "): extend" + extend + " Mrays/s, shadow " + mrays((double) mStats.shadowRays, mStats.shadowMs) + " Mrays/s, shade " +
+						 mrays((double) mStats.shaded, mStats.shadeMs) + " Mhits/s, sorting " + std::to_string(mStats.sortMs) + "ms, " + mrays(rays, ms) + " Mrays/s overall");
+	}
+
+	void CpuPathTracer::benchmarkWavefront(UINT samplesPerPixel)
+	{
+		CpuIntegrator integrator = mIntegrator;
+		bool sortRays = mSortRays;
+		mIntegrator = CPU_INTEGRATOR_WAVEFRONT;
+
+		for(int sorted = 0; sorted < 2; ++sorted)
+		{
+			mSortRays = sorted == 1;
+			resetAccumulation();
+			mStats = {};
+
+			for(UINT i = 0; i < samplesPerPixel; ++i)
+				draw();
+
+			logWavefrontStats(mSortRays ? "coherent bounces" : "incoherent bounces");
+		}
+
+		mIntegrator = integrator;
+		mSortRays = sortRays;
+	}
+
+	void CpuPathTracer::render(UINT samplesPerPixel)
+	{
+		Timer timer;
+		timer.reset();
+		mStats = {};
+
+		for(UINT i = 0; i < samplesPerPixel; ++i)
+			draw();
+
+		timer.tick();
+		float seconds = std::max<float>(timer.deltaTime(), 1e-6F);
+		double paths = (double) settings.width * settings.height * samplesPerPixel;
+
+		Logger::INFO.log("CPU path tracer: " + std::to_string(samplesPerPixel) + "spp, " + std::to_string(mTriangles.size()) + " triangles, " + std::to_string(mBVH.getNodes().size()) + " BVH nodes, " +
+						 std::to_string(seconds) + "s (" + std::to_string(paths / seconds / 1e6) + " Mpaths/s)");
+
+		if(mIntegrator == CPU_INTEGRATOR_WAVEFRONT)
+			logWavefrontStats(mSortRays ? "coherent bounces" : "incoherent bounces");
+	}
+
+	void CpuPathTracer::beginTileJob(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+	{
+		updateFrameData();
+		setCameraRays(view, proj);
+	}
+
+	void CpuPathTracer::renderTile(const CpuTile& tile, UINT samplesPerPixel, XMFLOAT4* pixels) const
+	{
+		const UINT32 tileWidth = tile.x1 - tile.x0;
+		const float invSamples = 1.0F / samplesPerPixel;
+
+		//same seeds and summation order as draw(), any split of the image gives the same bits
+		parallelFor(tile.y0, tile.y1, [&](UINT32 y)
+		{
+			for(UINT32 x = tile.x0; x < tile.x1; ++x)
+			{
+				XMVECTOR sum = XMVectorZero();
+				for(UINT frameIndex = 1; frameIndex <= samplesPerPixel; ++frameIndex)
+				{
+					UINT seed = initRand(x + y * settings.width, frameIndex);
+					sum += radiance(primaryRay(x, y, seed), 1, seed);
+				}
+
+				XMStoreFloat4(&pixels[(size_t) (y - tile.y0) * tileWidth + x - tile.x0], XMVectorSetW(sum * invSamples, 1.0F));
+			}
+		});
+	}
+
+	void CpuPathTracer::writeTile(const CpuTile& tile, const XMFLOAT4* pixels)
+	{
+		const UINT32 tileWidth = tile.x1 - tile.x0;
+		for(UINT32 y = tile.y0; y < tile.y1; ++y)
+			memcpy(&mColor[(size_t) y * settings.width + tile.x0], &pixels[(size_t) (y - tile.y0) * tileWidth], sizeof(XMFLOAT4) * tileWidth);
+	}
+
+	void CpuPathTracer::buildTiles()
+	{
+		const UINT32 tilesX = (settings.width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+		const UINT32 tilesY = (settings.height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+
+		mTiles.resize((size_t) tilesX * tilesY);
+		for(UINT32 i = 0; i < mTiles.size(); ++i)
+		{
+			CpuTile& tile = mTiles[i];
+			tile.x0 = (i % tilesX) * CPU_TILE_SIZE;
+			tile.y0 = (i / tilesX) * CPU_TILE_SIZE;
+			tile.x1 = std::min<UINT32>(tile.x0 + CPU_TILE_SIZE, settings.width);
+			tile.y1 = std::min<UINT32>(tile.y0 + CPU_TILE_SIZE, settings.height);
+			tile.samples = 0;
+			tile.error = FLT_MAX;
+		}
+	}
+
+	void CpuPathTracer::sampleTile(CpuTile& tile, UINT samples)
+	{
+		for(UINT32 y = tile.y0; y < tile.y1; ++y)
+		{
+			for(UINT32 x = tile.x0; x < tile.x1; ++x)
+			{
+				size_t index = (size_t) y * settings.width + x;
+				XMVECTOR sum = XMLoadFloat4(&mAccumulation[index]);
+				XMFLOAT2 moments = mMoments[index];
+				if(tile.samples == 0)
+				{
+					sum = XMVectorZero();
+					moments = { 0.0F, 0.0F };
+				}
+
+				for(UINT i = 1; i <= samples; ++i)
+				{
+					UINT n = tile.samples + i;
+					UINT seed = initRand((UINT) index, n);
+					XMVECTOR color = radiance(primaryRay(x, y, seed), 1, seed);
+					sum += color;
+
+					//Welford, running mean and squared deviations of the luminance
+					float value = luma(color);
+					float delta = value - moments.x;
+					moments.x += delta / n;
+					moments.y += delta * (value - moments.x);
+				}
+
+				XMStoreFloat4(&mAccumulation[index], sum);
+				XMStoreFloat4(&mColor[index], XMVectorSetW(sum / (float) (tile.samples + samples), 1.0F));
+				mMoments[index] = moments;
+			}
+		}
+
+		tile.samples += samples;
+		tile.error = tileError(tile);
+	}
+
+	float CpuPathTracer::tileError(const CpuTile& tile) const
+	{
+		if(tile.samples < 2)
+			return FLT_MAX;
+
+		//relative standard error of the pixel estimates, averaged over the tile
+		const float n = (float) tile.samples;
+		float error = 0.0F;
+		for(UINT32 y = tile.y0; y < tile.y1; ++y)
+		{
+			for(UINT32 x = tile.x0; x < tile.x1; ++x)
+			{
+				const XMFLOAT2& moments = mMoments[(size_t) y * settings.width + x];
+				error += sqrtf(moments.y / ((n - 1.0F) * n)) / (moments.x + CPU_ADAPTIVE_BLACK_LEVEL);
+			}
+		}
+
+		return error / ((tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+	}
+
+	CpuAdaptiveResult CpuPathTracer::renderAdaptive(const CpuAdaptiveSettings& adaptive, CpuSampling sampling)
+	{
+		updateFrameData();
+		updateCameraRays();
+		buildTiles();
+
+		const UINT64 pixelCount = (UINT64) settings.width * settings.height;
+		const UINT64 budget = adaptive.sampleBudget > 0 ? adaptive.sampleBudget * pixelCount : UINT64_MAX;
+		const UINT minSamples = std::max<UINT>(adaptive.minSamples, 2);
+		const UINT maxSamples = std::max<UINT>(adaptive.maxSamples, minSamples);
+
+		auto pixels = [](const CpuTile& tile) { return (UINT64) (tile.x1 - tile.x0) * (tile.y1 - tile.y0); };
+		auto active = [&](const CpuTile& tile) { return tile.error > adaptive.threshold && tile.samples < maxSamples; };
+
+		CpuAdaptiveResult result;
+		UINT64 traced = 0;
+		float lastReport = 0.0F;
+
+		Timer timer;
+		timer.reset();
+
+		//every tile starts with enough samples for a variance estimate
+		std::vector<UINT> pass(mTiles.size(), minSamples);
+		while(true)
+		{
+			parallelFor(size_t(0), mTiles.size(), [&](size_t i)
+			{
+				if(pass[i] > 0)
+					sampleTile(mTiles[i], pass[i]);
+			});
+			for(size_t i = 0; i < mTiles.size(); ++i)
+				traced += pass[i] * pixels(mTiles[i]);
+
+			timer.tick();
+			float elapsed = timer.totalTime();
+
+			//the error falls with the square root of the sample count, which gives the samples each tile still needs
+			UINT32 converged = 0;
+			UINT64 remaining = 0;
+			UINT64 uniformNeeded = 0;
+			result.error = 0.0F;
+			for(auto& tile:mTiles)
+			{
+				result.error = std::max<float>(result.error, tile.error);
+				if(!active(tile))
+				{
+					converged++;
+					continue;
+				}
+
+				float ratio = tile.error / adaptive.threshold;
+				UINT64 needed = std::min<UINT64>((UINT64) (tile.samples * ratio * ratio), maxSamples);
+				remaining += (needed - std::min<UINT64>(needed, tile.samples)) * pixels(tile);
+				uniformNeeded = std::max<UINT64>(uniformNeeded, needed);
+			}
+			if(sampling == CPU_SAMPLING_UNIFORM)
+				remaining = (uniformNeeded - std::min<UINT64>(uniformNeeded, mTiles[0].samples)) * pixelCount;
+
+			bool done = converged == mTiles.size() || traced >= budget || (adaptive.timeBudget > 0.0F && elapsed >= adaptive.timeBudget);
+			if(done || elapsed - lastReport >= CPU_ADAPTIVE_REPORT_INTERVAL)
+			{
+				double rate = traced / std::max<double>(elapsed, 1e-6);
+				double eta = remaining / rate;
+				if(budget != UINT64_MAX)
+					eta = std::min<double>(eta, (budget - std::min<UINT64>(traced, budget)) / rate);
+				if(adaptive.timeBudget > 0.0F)
+					eta = std::min<double>(eta, adaptive.timeBudget - elapsed);
+
+				Logger::INFO.log("CPU " + std::string(sampling == CPU_SAMPLING_UNIFORM ? "uniform" : "adaptive") + " render: " + std::to_string(converged) + "/" + std::to_string(mTiles.size()) +
+								 " tiles converged, " + std::to_string((double) traced / pixelCount) + "spp, " + std::to_string(elapsed) + "s" + (done ? "" : ", ETA " + std::to_string(std::max<double>(eta, 0.0)) + "s"));
+				lastReport = elapsed;
+			}
+
+			if(done)
+			{
+				result.seconds = elapsed;
+				result.samplesPerPixel = (double) traced / pixelCount;
+				result.convergedTiles = converged;
+				break;
+			}
+
+			if(sampling == CPU_SAMPLING_UNIFORM)
+			{
+				for(size_t i = 0; i < mTiles.size(); ++i)
+					pass[i] = mTiles[i].samples < maxSamples ? 1 : 0;
+				continue;
+			}
+
+			//a pass spends a few samples per unconverged pixel, handed out in proportion to the error of each tile
+			double errorSum = 0.0;
+			UINT64 activePixels = 0;
+			for(auto& tile:mTiles)
+			{
+				if(active(tile))
+				{
+					errorSum += (double) tile.error * pixels(tile);
+					activePixels += pixels(tile);
+				}
+			}
+
+			double passBudget = (double) std::min<UINT64>(activePixels * CPU_ADAPTIVE_PASS_SAMPLES, budget - traced);
+			for(size_t i = 0; i < mTiles.size(); ++i)
+			{
+				const CpuTile& tile = mTiles[i];
+				pass[i] = 0;
+				if(active(tile))
+					pass[i] = std::clamp<UINT>((UINT) (passBudget * tile.error / errorSum + 0.5), 1, maxSamples - tile.samples);
+			}
+		}
+
+		//mColor holds the result, draw() starts over
+		resetAccumulation();
+		return result;
+	}
+
+	void CpuPathTracer::benchmarkAdaptive(float threshold)
+	{
+		CpuAdaptiveSettings adaptive;
+		adaptive.threshold = threshold;
+
+		CpuAdaptiveResult uniform = renderAdaptive(adaptive, CPU_SAMPLING_UNIFORM);
+		CpuAdaptiveResult result = renderAdaptive(adaptive, CPU_SAMPLING_ADAPTIVE);
+
+		Logger::INFO.log("CPU time to " + std::to_string(threshold) + " relative error: uniform " + std::to_string(uniform.seconds) + "s (" + std::to_string(uniform.samplesPerPixel) + "spp), adaptive " +
+						 std::to_string(result.seconds) + "s (" + std::to_string(result.samplesPerPixel) + "spp), " + std::to_string(uniform.seconds / std::max<float>(result.seconds, 1e-6F)) + "x");
+	}
+
+	bool CpuPathTracer::saveImage(const std::string& fileName) const
+	{
+		const int width = (int) settings.width;
+		const int height = (int) settings.height;
+
+		std::string extension = fileName.substr(fileName.find_last_of('.') + 1);
+		if(extension == "hdr")
+			return stbi_write_hdr(fileName.c_str(), width, height, 4, reinterpret_cast<const float*>(mColor.data())) != 0;
+
+		//ldr output goes through the same curve as color_adjust.hlsl, then to sRGB
+		std::vector<BYTE> pixels((size_t) width * height * 4);
+		parallelFor(size_t(0), mColor.size(), [&](size_t i)
+		{
+			XMVECTOR color = XMLoadFloat4(&mColor[i]) * settings.exposure;
+			color = (color - XMVectorReplicate(0.5F)) * settings.contrast + XMVectorReplicate(0.5F + settings.brightness);
+			color = XMVectorLerp(XMVectorReplicate(XMVectorGetX(XMVector3Dot(color, XMVectorSet(0.299F, 0.587F, 0.144F, 0.0F)))), color, settings.saturation);
+
+			switch(settings.tonemapping)
+			{
+			default:
+			case TONEMAPPING_OFF:
+				break;
+			case TONEMAPPING_REINHARD:
+				color *= 1.2F;
+				color /= XMVectorReplicate(1.0F) + color;
+				break;
+			case TONEMAPPING_UNCHARTED:
+			{
+				auto curve = [](XMVECTOR x)
+				{
+					return (x * (x * 0.15F + XMVectorReplicate(0.05F)) + XMVectorReplicate(0.004F)) / (x * (x * 0.15F + XMVectorReplicate(0.5F)) + XMVectorReplicate(0.06F)) - XMVectorReplicate(0.02F / 0.3F);
+				};
+				color = curve(color * 2.5F) / curve(XMVectorReplicate(11.2F));
+				break;
+			}
+			case TONEMAPPING_ACES:
+				color *= 0.65F;
+				color = (color * (color * 2.51F + XMVectorReplicate(0.03F))) / (color * (color * 2.43F + XMVectorReplicate(0.59F)) + XMVectorReplicate(0.14F));
+				break;
+			}
+
+			color = XMVectorPow(XMVectorSaturate(color), XMVectorReplicate(settings.gamma / 2.2F));
+			pixels[4 * i] = (BYTE) (XMVectorGetX(color) * 255.0F + 0.5F);
+			pixels[4 * i + 1] = (BYTE) (XMVectorGetY(color) * 255.0F + 0.5F);
+			pixels[4 * i + 2] = (BYTE) (XMVectorGetZ(color) * 255.0F + 0.5F);
+			pixels[4 * i + 3] = 255;
+		});
+
+		return stbi_write_png(fileName.c_str(), width, height, 4, pixels.data(), width * 4) != 0;
+	}
+}
\ No newline at end of file
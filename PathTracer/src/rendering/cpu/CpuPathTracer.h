@@ -0,0 +1,268 @@
+#pragma once
+
+#include "../../app/Scene.h"
+
+#include "../../utils/core.h"
+#include "../DDSTexture.h"
+
+#include "BVH.h"
+#include "CpuDenoiser.h"
+#include "RayQuery.h"
+
+#define CPU_TILE_SIZE				16
+#define CPU_MAX_DEPTH				4
+#define CPU_WAVEFRONT_CHUNK			256
+#define CPU_ADAPTIVE_PASS_SAMPLES	4 //average samples per unconverged pixel in one adaptive pass
+#define CPU_ADAPTIVE_BLACK_LEVEL	0.01F //keeps the relative error of dark pixels finite
+#define CPU_ADAPTIVE_REPORT_INTERVAL	1.0F
+#define CPU_CUBEMAP_SIZE			512 //texels per face side the cubemap is box filtered down to
+
+namespace RT
+{
+	enum CpuIntegrator
+	{
+		CPU_INTEGRATOR_RECURSIVE = 0,
+		CPU_INTEGRATOR_WAVEFRONT
+	};
+
+	enum CpuSampling
+	{
+		CPU_SAMPLING_UNIFORM = 0,
+		CPU_SAMPLING_ADAPTIVE
+	};
+
+	//the texture arrays hit.hlsl samples, height maps are left out since the CPU has no parallax mapping
+	enum CpuTextureMap
+	{
+		CPU_MAP_ALBEDO = 0,
+		CPU_MAP_NORMAL,
+		CPU_MAP_ROUGHNESS,
+		CPU_MAP_AO,
+		CPU_MAP_EMISSIVE,
+		CPU_MAP_METALLIC,
+		CPU_MAP_COUNT
+	};
+
+	struct CpuAdaptiveSettings
+	{
+		float threshold = 0.02F; //relative standard error every tile has to reach
+		UINT minSamples = 16;
+		UINT maxSamples = 4096;
+		UINT sampleBudget = 0; //average samples per pixel, 0 for no limit
+		float timeBudget = 0.0F; //seconds, 0 for no limit
+	};
+
+	struct CpuAdaptiveResult
+	{
+		float seconds = 0.0F;
+		double samplesPerPixel = 0.0;
+		float error = 0.0F; //of the noisiest tile
+		UINT32 convergedTiles = 0;
+	};
+
+	struct CpuTile
+	{
+		UINT32 x0, y0, x1, y1;
+		UINT samples = 0;
+		float error = FLT_MAX;
+	};
+
+	struct CpuHit
+	{
+		float t = FLT_MAX;
+		DirectX::XMFLOAT2 bary = { 0.0F, 0.0F }; //same convention as Attributes in the shaders
+		UINT32 triangle = UINT32_MAX;
+	};
+
+	//world space triangle, stored as origin + edges for the intersection test
+	struct CpuTriangle
+	{
+		DirectX::XMFLOAT3 v0;
+		UINT32 instance;
+		DirectX::XMFLOAT3 e1;
+		UINT32 primitive;
+		DirectX::XMFLOAT3 e2;
+		float pad;
+	};
+
+	struct CpuInstance
+	{
+		DirectX::XMFLOAT4X4 world = Identity4x4();
+		const Vertex* vertices = nullptr;
+		const UINT32* indices = nullptr;
+		UINT materialIndex = 0;
+		DirectX::XMFLOAT4X4 uvTransform = Identity4x4(); //the instance's then the material's
+		INT32 maps[CPU_MAP_COUNT] = { -1, -1, -1, -1, -1, -1 };
+		bool emissive = false;
+		UINT32 shadeKey = 0; //material and texture, the wavefront shades hits grouped by it
+		bool shadowIgnore = false;
+		bool dirty = true;
+	};
+
+	//material constants after the maps, what hit.hlsl shades with
+	struct CpuSurface
+	{
+		DirectX::XMVECTOR albedo;
+		DirectX::XMVECTOR normal;
+		DirectX::XMVECTOR emission;
+		float roughness;
+		float metallic;
+	};
+
+	struct CpuLightSample
+	{
+		DirectX::XMVECTOR diffuse;
+		DirectX::XMVECTOR specular;
+		CpuRay shadowRay;
+		float occlusionScale = 0.0F; //0 when the light is never shadowed
+	};
+
+	//one path segment waiting in a wavefront queue
+	struct CpuPathState
+	{
+		CpuRay ray;
+		DirectX::XMFLOAT3 weight;
+		UINT32 pixel;
+		UINT32 depth;
+		UINT32 seed;
+		float bouncePdf; //solid angle pdf of a diffuse bounce, 0 for the rays light sampling never takes
+	};
+
+	struct CpuShadowState
+	{
+		CpuRay ray;
+		DirectX::XMFLOAT3 contribution;
+		UINT32 pixel;
+		float occlusionScale;
+	};
+
+	struct CpuWavefrontStats
+	{
+		double extendMs[CPU_MAX_DEPTH + 1] = {};
+		UINT64 extendRays[CPU_MAX_DEPTH + 1] = {};
+		double sortMs = 0.0;
+		double shadeMs = 0.0;
+		UINT64 shaded = 0;
+		double shadowMs = 0.0;
+		UINT64 shadowRays = 0;
+	};
+
+	//headless reference backend, traces the same light transport as hit.hlsl on the CPU
+	class CpuPathTracer
+	{
+		friend struct CpuPathTracerTests; //checks the radiance against the shaded surface it starts from
+	public:
+		CpuPathTracer(UINT32 width, UINT32 height);
+		~CpuPathTracer() = default;
+		CpuPathTracer(const CpuPathTracer&) = delete;
+		CpuPathTracer& operator=(const CpuPathTracer&) = delete;
+
+		bool initContext(std::string sceneName);
+		void loadScene(std::string name);
+
+		void update(float dt);
+		void updateFrameData();
+		void draw();
+		void render(UINT samplesPerPixel);
+		void benchmarkWavefront(UINT samplesPerPixel);
+		//offline render, stops when every tile converged or a budget runs out
+		CpuAdaptiveResult renderAdaptive(const CpuAdaptiveSettings& adaptive, CpuSampling sampling = CPU_SAMPLING_ADAPTIVE);
+		void benchmarkAdaptive(float threshold);
+		//tiles rendered on their own, for the coordinator and its workers
+		void beginTileJob(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+		void renderTile(const CpuTile& tile, UINT samplesPerPixel, DirectX::XMFLOAT4* pixels) const;
+		void writeTile(const CpuTile& tile, const DirectX::XMFLOAT4* pixels);
+
+		//filters mColor with guides from a primary ray per pixel, call once per displayed frame for the temporal part
+		void denoise();
+		void onResize(UINT32 width, UINT32 height);
+
+		bool saveImage(const std::string& fileName) const;
+
+		inline Scene* getScene() const { return mScene.get(); }
+		inline Camera* getCamera() const { return mCam; }
+		inline const std::vector<DirectX::XMFLOAT4>& getColor() const { return mColor; }
+		inline CpuDenoiser& getDenoiser() { return mDenoiser; }
+		inline UINT getSampleCount() const { return mSampleCount; }
+		inline void resetAccumulation() { mSampleCount = 0; }
+
+		inline void setIntegrator(CpuIntegrator integrator) { mIntegrator = integrator; resetAccumulation(); }
+		inline void setRaySorting(bool value) { mSortRays = value; }
+		inline void setBVHBuilder(BVHBuilder builder) { mBuilder = builder; mBVH = BVH(); resetAccumulation(); }
+		inline void setSkyColor(DirectX::XMFLOAT3 color) { mSkyColor = color; resetAccumulation(); }
+
+		settings_struct settings {};
+	private:
+		void loadTextures();
+		void buildInstances();
+		void buildBVH(BVHBuilder builder);
+
+		void updateCameraRays();
+		void setCameraRays(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+		CpuRay primaryRay(UINT32 x, UINT32 y, UINT& seed) const;
+		CpuRay cameraRay(float px, float py) const;
+		void renderGuides();
+
+		bool intersect(const CpuRay& ray, CpuHit& hit, bool shadow = false) const;
+		float traceShadow(const CpuRay& ray) const;
+
+		DirectX::XMVECTOR radiance(const CpuRay& ray, UINT depth, UINT& seed, float bouncePdf = 0.0F) const;
+		DirectX::XMVECTOR miss(DirectX::FXMVECTOR direction) const;
+		DirectX::XMVECTOR sampleCubemap(DirectX::FXMVECTOR direction) const;
+		DirectX::XMVECTOR hitNormal(const CpuHit& hit, DirectX::FXMVECTOR toEye) const;
+		CpuSurface surface(const CpuHit& hit, const Material& material, DirectX::FXMVECTOR toEye, UINT depth) const;
+		bool sampleLight(const Light& light, const Material& material, float roughness, DirectX::FXMVECTOR pos, DirectX::FXMVECTOR norm, DirectX::FXMVECTOR toEye, UINT& seed, CpuLightSample& sample) const;
+
+		template<typename ShadowFn, typename BounceFn>
+		DirectX::XMVECTOR shade(const CpuRay& ray, const CpuHit& hit, UINT depth, float bouncePdf, UINT& seed, ShadowFn&& shadow, BounceFn&& bounce) const;
+
+		//generate, extend, sort, shade and connect stages over the whole frame
+		void drawWavefront();
+		void sortPaths();
+		void logWavefrontStats(const std::string& label) const;
+
+		void buildTiles();
+		void sampleTile(CpuTile& tile, UINT samples);
+		float tileError(const CpuTile& tile) const;
+
+		std::unique_ptr<Scene> mScene;
+		Camera* mCam = nullptr;
+
+		std::vector<DDSTexture> mMaps[CPU_MAP_COUNT];
+		std::vector<DirectX::XMFLOAT3> mCubemap; //faces laid out like EnvironmentMap::build
+		UINT32 mCubemapSize = 0;
+
+		std::vector<CpuInstance> mInstances;
+		std::vector<CpuTriangle> mTriangles;
+		std::vector<UINT8> mDirtyTriangles;
+		BVH mBVH;
+		BVHBuilder mBuilder = BVH_BUILDER_BINNED_SAH;
+
+		CpuIntegrator mIntegrator = CPU_INTEGRATOR_RECURSIVE;
+		bool mSortRays = true;
+		std::vector<CpuPathState> mPaths;
+		std::vector<CpuHit> mHits;
+		std::vector<DirectX::XMFLOAT3> mFrame;
+		CpuWavefrontStats mStats;
+
+		std::vector<DirectX::XMFLOAT4> mAccumulation;
+		std::vector<DirectX::XMFLOAT4> mColor;
+		UINT mSampleCount = 0;
+
+		std::vector<CpuTile> mTiles;
+		std::vector<DirectX::XMFLOAT2> mMoments; //luminance mean and sum of squared deviations per pixel
+
+		DirectX::XMFLOAT4X4 mInvView = Identity4x4();
+		DirectX::XMFLOAT4X4 mInvProj = Identity4x4();
+		DirectX::XMFLOAT3 mEyePos = { 0.0F, 0.0F, 0.0F };
+		DirectX::XMFLOAT4X4 mPrevViewProj = Identity4x4();
+
+		CpuDenoiser mDenoiser;
+		std::vector<DirectX::XMFLOAT4> mGuideNormalRoughness;
+		std::vector<float> mGuideViewZ;
+		std::vector<DirectX::XMFLOAT4> mGuideAlbedo;
+		std::vector<DirectX::XMFLOAT2> mGuideMotion;
+
+		DirectX::XMFLOAT3 mSkyColor = { 0.5F, 0.6F, 0.75F }; //scenes without a cubemap
+	};
+}
\ No newline at end of file
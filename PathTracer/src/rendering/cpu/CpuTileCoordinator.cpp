@@ -0,0 +1,306 @@
+#include "CpuTileCoordinator.h"
+
+#include "../../utils/Timer.h"
+
+#include <thread>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//moves the whole buffer, overlapped handles wait on their event
+	static bool pipeTransfer(HANDLE pipe, HANDLE event, void* data, DWORD size, bool write)
+	{
+		BYTE* bytes = reinterpret_cast<BYTE*>(data);
+		while(size > 0)
+		{
+			OVERLAPPED overlapped = {};
+			overlapped.hEvent = event;
+
+			DWORD done = 0;
+			BOOL ok = write ? WriteFile(pipe, bytes, size, &done, event ? &overlapped : nullptr) : ReadFile(pipe, bytes, size, &done, event ? &overlapped : nullptr);
+			if(!ok && event && GetLastError() == ERROR_IO_PENDING)
+				ok = GetOverlappedResult(pipe, &overlapped, &done, TRUE);
+			if(!ok || done == 0)
+				return false;
+
+			bytes += done;
+			size -= done;
+		}
+		return true;
+	}
+
+	CpuTileCoordinator::CpuTileCoordinator(CpuPathTracer* tracer, const std::string& sceneName): mTracer(tracer), mSceneName(sceneName) {}
+
+	bool CpuTileCoordinator::startWorker(Worker& worker)
+	{
+		worker.pipe = CreateNamedPipeA(worker.pipeName.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, 1,
+									   CPU_WORKER_PIPE_BUFFER, CPU_WORKER_PIPE_BUFFER, 0, nullptr);
+		if(worker.pipe == INVALID_HANDLE_VALUE)
+		{
+			Logger::ERR.log("Couldn't create " + worker.pipeName);
+			return false;
+		}
+		if(!worker.event)
+			worker.event = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+		char exePath[MAX_PATH];
+		GetModuleFileNameA(nullptr, exePath, MAX_PATH);
+		std::string cmdLine = "\"" + std::string(exePath) + "\" -cpu-worker " + worker.pipeName;
+
+		STARTUPINFOA startup = {};
+		startup.cb = sizeof(startup);
+		if(!CreateProcessA(nullptr, cmdLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &startup, &worker.process))
+		{
+			Logger::ERR.log("Couldn't start worker for " + worker.pipeName);
+			stopWorker(worker, false);
+			return false;
+		}
+
+		//a worker that dies while loading never connects, wait on the process as well
+		OVERLAPPED overlapped = {};
+		overlapped.hEvent = worker.event;
+		bool connected = ConnectNamedPipe(worker.pipe, &overlapped) || GetLastError() == ERROR_PIPE_CONNECTED;
+		if(!connected && GetLastError() == ERROR_IO_PENDING)
+		{
+			HANDLE handles[2] = { worker.event, worker.process.hProcess };
+			DWORD connectedOrDead = WaitForMultipleObjects(2, handles, FALSE, CPU_WORKER_CONNECT_TIMEOUT);
+			DWORD unused;
+			connected = connectedOrDead == WAIT_OBJECT_0 && GetOverlappedResult(worker.pipe, &overlapped, &unused, FALSE);
+			if(!connected)
+				CancelIo(worker.pipe);
+		}
+
+		if(!connected || !pipeTransfer(worker.pipe, worker.event, &mJob, sizeof(mJob), true))
+		{
+			Logger::WARN.log("Worker on " + worker.pipeName + " didn't connect");
+			stopWorker(worker, true);
+			return false;
+		}
+
+		return true;
+	}
+
+	void CpuTileCoordinator::stopWorker(Worker& worker, bool kill)
+	{
+		if(worker.pipe != INVALID_HANDLE_VALUE)
+		{
+			if(!kill)
+			{
+				CpuTileMessage exit;
+				pipeTransfer(worker.pipe, worker.event, &exit, sizeof(exit), true);
+			}
+			CloseHandle(worker.pipe);
+			worker.pipe = INVALID_HANDLE_VALUE;
+		}
+
+		if(worker.process.hProcess)
+		{
+			if(kill || WaitForSingleObject(worker.process.hProcess, 5000) != WAIT_OBJECT_0)
+				TerminateProcess(worker.process.hProcess, EXIT_FAILURE);
+			CloseHandle(worker.process.hProcess);
+			CloseHandle(worker.process.hThread);
+			worker.process = {};
+		}
+	}
+
+	void CpuTileCoordinator::serveWorker(Worker& worker)
+	{
+		if(!startWorker(worker))
+			return;
+
+		std::vector<XMFLOAT4> pixels((size_t) CPU_JOB_TILE_SIZE * CPU_JOB_TILE_SIZE);
+		while(true)
+		{
+			//next tile for whoever asks first, fast workers simply take more of them
+			UINT32 index;
+			{
+				std::lock_guard<std::mutex> lock(mQueueMutex);
+				if(mQueue.empty())
+					break;
+				index = mQueue.back();
+				mQueue.pop_back();
+			}
+
+			const CpuTile& tile = mTiles[index];
+			CpuTileMessage request;
+			request.index = index;
+			request.x0 = tile.x0;
+			request.y0 = tile.y0;
+			request.x1 = tile.x1;
+			request.y1 = tile.y1;
+
+			CpuTileMessage reply;
+			DWORD pixelBytes = (DWORD) (sizeof(XMFLOAT4) * (tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+			bool ok = pipeTransfer(worker.pipe, worker.event, &request, sizeof(request), true) &&
+					  pipeTransfer(worker.pipe, worker.event, &reply, sizeof(reply), false) && reply.index == index &&
+					  pipeTransfer(worker.pipe, worker.event, pixels.data(), pixelBytes, false);
+
+			if(ok)
+			{
+				//tiles never overlap, merging needs no lock
+				mTracer->writeTile(tile, pixels.data());
+				mCompleted++;
+				continue;
+			}
+
+			//the tile goes back to the queue and the worker gets replaced
+			{
+				std::lock_guard<std::mutex> lock(mQueueMutex);
+				if(++mRetries[index] < CPU_JOB_TILE_RETRIES)
+					mQueue.push_back(index);
+			}
+			Logger::WARN.log("Worker on " + worker.pipeName + " failed tile " + std::to_string(index));
+
+			stopWorker(worker, true);
+			if(worker.restarts >= CPU_WORKER_RESTARTS)
+				return;
+			worker.restarts++;
+			if(!startWorker(worker))
+				return;
+		}
+
+		stopWorker(worker, false);
+	}
+
+	bool CpuTileCoordinator::render(UINT samplesPerPixel, UINT workerCount)
+	{
+		const UINT32 width = mTracer->settings.width;
+		const UINT32 height = mTracer->settings.height;
+
+		Camera* cam = mTracer->getCamera();
+		cam->updateViewMatrix();
+		strncpy_s(mJob.scene, mSceneName.c_str(), _TRUNCATE);
+		mJob.width = width;
+		mJob.height = height;
+		mJob.samplesPerPixel = samplesPerPixel;
+		mJob.view = cam->getView4x4();
+		mJob.proj = cam->getProj4x4();
+		mTracer->beginTileJob(mJob.view, mJob.proj);
+
+		const UINT32 tilesX = (width + CPU_JOB_TILE_SIZE - 1) / CPU_JOB_TILE_SIZE;
+		const UINT32 tilesY = (height + CPU_JOB_TILE_SIZE - 1) / CPU_JOB_TILE_SIZE;
+		mTiles.resize((size_t) tilesX * tilesY);
+		mQueue.resize(mTiles.size());
+		mRetries.assign(mTiles.size(), 0);
+		mCompleted = 0;
+		for(UINT32 i = 0; i < mTiles.size(); ++i)
+		{
+			CpuTile& tile = mTiles[i];
+			tile.x0 = (i % tilesX) * CPU_JOB_TILE_SIZE;
+			tile.y0 = (i / tilesX) * CPU_JOB_TILE_SIZE;
+			tile.x1 = std::min<UINT32>(tile.x0 + CPU_JOB_TILE_SIZE, width);
+			tile.y1 = std::min<UINT32>(tile.y0 + CPU_JOB_TILE_SIZE, height);
+
+			//popped from the back, the top rows go first
+			mQueue[mTiles.size() - 1 - i] = i;
+		}
+
+		Timer timer;
+		timer.reset();
+
+		std::vector<Worker> workers(workerCount);
+		std::vector<std::thread> threads;
+		for(UINT i = 0; i < workerCount; ++i)
+		{
+			workers[i].pipeName = "\\\\.\\pipe\\uge_cpu_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(i);
+			threads.emplace_back([this, &workers, i] { serveWorker(workers[i]); });
+		}
+
+		UINT32 reported = 0;
+		while(mCompleted < mTiles.size())
+		{
+			bool alive = false;
+			for(auto& thread:threads)
+				alive |= WaitForSingleObject(thread.native_handle(), 0) == WAIT_TIMEOUT;
+			if(!alive)
+				break;
+
+			UINT32 completed = mCompleted;
+			if(completed != reported)
+			{
+				timer.tick();
+				float elapsed = timer.totalTime();
+				Logger::INFO.log("CPU tiles: " + std::to_string(completed) + "/" + std::to_string(mTiles.size()) + ", ETA " +
+								 std::to_string(elapsed / completed * (mTiles.size() - completed)) + "s");
+				reported = completed;
+			}
+			Sleep(250);
+		}
+		for(auto& thread:threads)
+			thread.join();
+		for(auto& worker:workers)
+			CloseHandle(worker.event);
+
+		//whatever no worker could finish is rendered here, the result stays the same
+		if(!mQueue.empty() || mCompleted < mTiles.size())
+		{
+			std::vector<bool> done(mTiles.size(), true);
+			for(UINT32 index:mQueue)
+				done[index] = false;
+			for(UINT32 i = 0; i < mTiles.size(); ++i)
+			{
+				if(mRetries[i] >= CPU_JOB_TILE_RETRIES)
+					done[i] = false;
+			}
+
+			std::vector<XMFLOAT4> pixels((size_t) CPU_JOB_TILE_SIZE * CPU_JOB_TILE_SIZE);
+			UINT32 local = 0;
+			for(UINT32 i = 0; i < mTiles.size(); ++i)
+			{
+				if(done[i])
+					continue;
+
+				mTracer->renderTile(mTiles[i], samplesPerPixel, pixels.data());
+				mTracer->writeTile(mTiles[i], pixels.data());
+				mCompleted++;
+				local++;
+			}
+			Logger::WARN.log("CPU tiles: " + std::to_string(local) + " tiles rendered by the coordinator");
+		}
+
+		timer.tick();
+		Logger::INFO.log("CPU distributed render: " + std::to_string(workerCount) + " workers, " + std::to_string(mTiles.size()) + " tiles, " + std::to_string(timer.totalTime()) + "s");
+		return mCompleted == mTiles.size();
+	}
+
+	int CpuTileCoordinator::runWorker(const std::string& pipeName)
+	{
+		if(!WaitNamedPipeA(pipeName.c_str(), CPU_WORKER_CONNECT_TIMEOUT))
+			return EXIT_FAILURE;
+
+		HANDLE pipe = CreateFileA(pipeName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if(pipe == INVALID_HANDLE_VALUE)
+			return EXIT_FAILURE;
+
+		CpuRenderJob job;
+		if(!pipeTransfer(pipe, nullptr, &job, sizeof(job), false))
+		{
+			CloseHandle(pipe);
+			return EXIT_FAILURE;
+		}
+
+		CpuPathTracer tracer(job.width, job.height);
+		tracer.initContext(job.scene);
+		tracer.beginTileJob(job.view, job.proj);
+
+		std::vector<XMFLOAT4> pixels((size_t) CPU_JOB_TILE_SIZE * CPU_JOB_TILE_SIZE);
+		CpuTileMessage message;
+		while(pipeTransfer(pipe, nullptr, &message, sizeof(message), false) && message.index != UINT32_MAX)
+		{
+			CpuTile tile;
+			tile.x0 = message.x0;
+			tile.y0 = message.y0;
+			tile.x1 = message.x1;
+			tile.y1 = message.y1;
+			tracer.renderTile(tile, job.samplesPerPixel, pixels.data());
+
+			DWORD pixelBytes = (DWORD) (sizeof(XMFLOAT4) * (tile.x1 - tile.x0) * (tile.y1 - tile.y0));
+			if(!pipeTransfer(pipe, nullptr, &message, sizeof(message), true) || !pipeTransfer(pipe, nullptr, pixels.data(), pixelBytes, true))
+				break;
+		}
+
+		CloseHandle(pipe);
+		return EXIT_SUCCESS;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CpuPathTracer.h"
+
+#include <atomic>
+#include <mutex>
+
+#define CPU_JOB_TILE_SIZE			64
+#define CPU_JOB_TILE_RETRIES		3 //a tile that kills this many workers is rendered by the coordinator
+#define CPU_WORKER_RESTARTS			2
+#define CPU_WORKER_CONNECT_TIMEOUT	30000 //ms, scene loading included
+#define CPU_WORKER_PIPE_BUFFER		(1 << 20)
+
+namespace RT
+{
+	//sent once to every worker after it connected
+	struct CpuRenderJob
+	{
+		char scene[128] = {};
+		UINT32 width = 0;
+		UINT32 height = 0;
+		UINT32 samplesPerPixel = 0;
+		DirectX::XMFLOAT4X4 view = Identity4x4();
+		DirectX::XMFLOAT4X4 proj = Identity4x4();
+	};
+
+	//tile request, the reply is the same header followed by the pixels
+	struct CpuTileMessage
+	{
+		UINT32 index = UINT32_MAX; //UINT32_MAX tells the worker to exit
+		UINT32 x0, y0, x1, y1;
+	};
+
+	//splits one render into tiles for local worker processes over named pipes, the tiles are merged into the tracer as they come back
+	class CpuTileCoordinator
+	{
+	public:
+		CpuTileCoordinator(CpuPathTracer* tracer, const std::string& sceneName);
+		~CpuTileCoordinator() = default;
+		CpuTileCoordinator(const CpuTileCoordinator&) = delete;
+		CpuTileCoordinator& operator=(const CpuTileCoordinator&) = delete;
+
+		bool render(UINT samplesPerPixel, UINT workerCount);
+
+		//entry point of the worker processes, started with -cpu-worker <pipe>
+		static int runWorker(const std::string& pipeName);
+	private:
+		struct Worker
+		{
+			std::string pipeName;
+			HANDLE pipe = INVALID_HANDLE_VALUE;
+			HANDLE event = nullptr;
+			PROCESS_INFORMATION process = {};
+			UINT restarts = 0;
+		};
+
+		bool startWorker(Worker& worker);
+		void stopWorker(Worker& worker, bool kill);
+		void serveWorker(Worker& worker);
+
+		CpuPathTracer* mTracer;
+		std::string mSceneName;
+		CpuRenderJob mJob;
+
+		std::vector<CpuTile> mTiles;
+		std::vector<UINT32> mQueue;
+		std::vector<UINT> mRetries;
+		std::mutex mQueueMutex;
+		std::atomic<UINT32> mCompleted = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,520 @@
+#include "RayQuery.h"
+
+#include <algorithm>
+#include <bit>
+#if defined(__SSE__) || defined(_M_X64)
+	#include <immintrin.h>
+#endif
+#include <unordered_set>
+
+using namespace DirectX;
+
+namespace RT
+{
+	//ray prepared for the box tests and the watertight triangle test (Woop, Benthin, Wald 2013)
+	struct QueryRay
+	{
+		float origin[3];
+		float invDir[3];
+		float tMin;
+		int kx, ky, kz;
+		float sx, sy, sz;
+	};
+
+	static QueryRay prepareRay(FXMVECTOR origin, FXMVECTOR direction, float tMin)
+	{
+		QueryRay ray;
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.origin), origin);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(ray.invDir), XMVectorReciprocal(direction));
+		ray.tMin = tMin;
+
+		float dir[3];
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(dir), direction);
+
+		//the dominant axis becomes z, winding is kept by swapping the other two
+		XMFLOAT3 absDir;
+		XMStoreFloat3(&absDir, XMVectorAbs(direction));
+		ray.kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+		ray.kx = (ray.kz + 1) % 3;
+		ray.ky = (ray.kx + 1) % 3;
+		if(dir[ray.kz] < 0.0F)
+			std::swap(ray.kx, ray.ky);
+
+		ray.sx = dir[ray.kx] / dir[ray.kz];
+		ray.sy = dir[ray.ky] / dir[ray.kz];
+		ray.sz = 1.0F / dir[ray.kz];
+		return ray;
+	}
+
+	static inline UINT32 intersectNode(const RayQueryNode& node, const QueryRay& ray, float tMax, float* tNear)
+	{
+	#ifdef __AVX__
+		__m256 ox = _mm256_set1_ps(ray.origin[0]);
+		__m256 oy = _mm256_set1_ps(ray.origin[1]);
+		__m256 oz = _mm256_set1_ps(ray.origin[2]);
+		__m256 ix = _mm256_set1_ps(ray.invDir[0]);
+		__m256 iy = _mm256_set1_ps(ray.invDir[1]);
+		__m256 iz = _mm256_set1_ps(ray.invDir[2]);
+
+		__m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinX), ox), ix);
+		__m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinY), oy), iy);
+		__m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMinZ), oz), iz);
+		__m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxX), ox), ix);
+		__m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxY), oy), iy);
+		__m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(node.boundsMaxZ), oz), iz);
+
+		__m256 enter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)), _mm256_max_ps(_mm256_min_ps(t0z, t1z), _mm256_set1_ps(ray.tMin)));
+		__m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)), _mm256_min_ps(_mm256_max_ps(t0z, t1z), _mm256_set1_ps(tMax)));
+
+		_mm256_storeu_ps(tNear, enter);
+		return (UINT32) _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+	#elif defined(__SSE__) || defined(_M_X64)
+		//without /arch:AVX the 8 slots are tested as two SSE halves
+		__m128 ox = _mm_set1_ps(ray.origin[0]);
+		__m128 oy = _mm_set1_ps(ray.origin[1]);
+		__m128 oz = _mm_set1_ps(ray.origin[2]);
+		__m128 ix = _mm_set1_ps(ray.invDir[0]);
+		__m128 iy = _mm_set1_ps(ray.invDir[1]);
+		__m128 iz = _mm_set1_ps(ray.invDir[2]);
+
+		UINT32 mask = 0;
+		for(int h = 0; h < RAY_QUERY_WIDTH; h += 4)
+		{
+			__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinX + h), ox), ix);
+			__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinY + h), oy), iy);
+			__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMinZ + h), oz), iz);
+			__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxX + h), ox), ix);
+			__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxY + h), oy), iy);
+			__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.boundsMaxZ + h), oz), iz);
+
+			__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_set1_ps(ray.tMin)));
+			__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(tMax)));
+
+			_mm_storeu_ps(tNear + h, enter);
+			mask |= (UINT32) _mm_movemask_ps(_mm_cmple_ps(enter, exit)) << h;
+		}
+		return mask;
+	#else
+		//scalar slab test for targets without SSE, same order of operations
+		UINT32 mask = 0;
+		for(int i = 0; i < RAY_QUERY_WIDTH; ++i)
+		{
+			float t0x = (node.boundsMinX[i] - ray.origin[0]) * ray.invDir[0];
+			float t0y = (node.boundsMinY[i] - ray.origin[1]) * ray.invDir[1];
+			float t0z = (node.boundsMinZ[i] - ray.origin[2]) * ray.invDir[2];
+			float t1x = (node.boundsMaxX[i] - ray.origin[0]) * ray.invDir[0];
+			float t1y = (node.boundsMaxY[i] - ray.origin[1]) * ray.invDir[1];
+			float t1z = (node.boundsMaxZ[i] - ray.origin[2]) * ray.invDir[2];
+
+			float enter = std::max<float>(std::max<float>(std::min<float>(t0x, t1x), std::min<float>(t0y, t1y)), std::max<float>(std::min<float>(t0z, t1z), ray.tMin));
+			float exit = std::min<float>(std::min<float>(std::max<float>(t0x, t1x), std::max<float>(t0y, t1y)), std::min<float>(std::max<float>(t0z, t1z), tMax));
+
+			tNear[i] = enter;
+			if(enter <= exit)
+				mask |= 1u << i;
+		}
+		return mask;
+	#endif
+	}
+
+	static inline bool intersectTriangle(const QueryRay& ray, const RayQueryTriangle& tri, float tMax, float& t, XMFLOAT2& bary)
+	{
+		const float* v0 = reinterpret_cast<const float*>(&tri.v0);
+		const float* v1 = reinterpret_cast<const float*>(&tri.v1);
+		const float* v2 = reinterpret_cast<const float*>(&tri.v2);
+
+		float a[3], b[3], c[3];
+		for(int k = 0; k < 3; ++k)
+		{
+			a[k] = v0[k] - ray.origin[k];
+			b[k] = v1[k] - ray.origin[k];
+			c[k] = v2[k] - ray.origin[k];
+		}
+
+		//shear so the ray points down +z, then the edge functions decide the hit
+		float ax = a[ray.kx] - ray.sx * a[ray.kz];
+		float ay = a[ray.ky] - ray.sy * a[ray.kz];
+		float bx = b[ray.kx] - ray.sx * b[ray.kz];
+		float by = b[ray.ky] - ray.sy * b[ray.kz];
+		float cx = c[ray.kx] - ray.sx * c[ray.kz];
+		float cy = c[ray.ky] - ray.sy * c[ray.kz];
+
+		float u = cx * by - cy * bx;
+		float v = ax * cy - ay * cx;
+		float w = bx * ay - by * ax;
+
+		//rays exactly on an edge are decided in double precision, so neighbours can't both miss
+		if(u == 0.0F || v == 0.0F || w == 0.0F)
+		{
+			u = (float) ((double) cx * by - (double) cy * bx);
+			v = (float) ((double) ax * cy - (double) ay * cx);
+			w = (float) ((double) bx * ay - (double) by * ax);
+		}
+
+		if((u < 0.0F || v < 0.0F || w < 0.0F) && (u > 0.0F || v > 0.0F || w > 0.0F))
+			return false;
+
+		float det = u + v + w;
+		if(det == 0.0F)
+			return false;
+
+		float invDet = 1.0F / det;
+		float hitT = (u * a[ray.kz] + v * b[ray.kz] + w * c[ray.kz]) * ray.sz * invDet;
+		if(hitT <= ray.tMin || hitT >= tMax)
+			return false;
+
+		t = hitT;
+		bary = { v * invDet, w * invDet };
+		return true;
+	}
+
+	//leaf returns true to end the traversal
+	template<typename Leaf>
+	static bool traverse(const std::vector<RayQueryNode>& nodes, const QueryRay& ray, const float& tMax, Leaf&& leaf)
+	{
+		struct StackEntry
+		{
+			UINT32 index;
+			UINT32 count;
+			float t;
+		};
+
+		StackEntry stack[RAY_QUERY_STACK_SIZE];
+		UINT32 sp = 0;
+		stack[sp++] = { 0, 0, ray.tMin };
+
+		while(sp > 0)
+		{
+			StackEntry entry = stack[--sp];
+			if(entry.t > tMax)
+				continue;
+
+			if(entry.count > 0)
+			{
+				if(leaf(entry.index, entry.count))
+					return true;
+				continue;
+			}
+
+			const RayQueryNode& node = nodes[entry.index];
+			float tNear[RAY_QUERY_WIDTH];
+			UINT32 mask = intersectNode(node, ray, tMax, tNear) & ((1u << node.childCount) - 1);
+
+			//farthest first, so the nearest child is popped next
+			UINT32 order[RAY_QUERY_WIDTH];
+			UINT32 hits = 0;
+			while(mask)
+			{
+				UINT32 k = (UINT32) std::countr_zero(mask);
+				mask &= mask - 1;
+
+				UINT32 i = hits++;
+				for(; i > 0 && tNear[order[i - 1]] < tNear[k]; --i)
+					order[i] = order[i - 1];
+				order[i] = k;
+			}
+
+			for(UINT32 i = 0; i < hits; ++i)
+				stack[sp++] = { node.child[order[i]], node.count[order[i]], tNear[order[i]] };
+		}
+
+		return false;
+	}
+
+	static inline float halfArea(const BVHNode& node)
+	{
+		XMFLOAT3 e;
+		XMStoreFloat3(&e, XMVectorMax(XMLoadFloat3(&node.boundsMax) - XMLoadFloat3(&node.boundsMin), XMVectorZero()));
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+
+	//opens the largest inner children of the binary tree until a node has 8 slots filled
+	static UINT32 collapse(const std::vector<BVHNode>& binary, UINT32 index, std::vector<RayQueryNode>& wide)
+	{
+		UINT32 children[RAY_QUERY_WIDTH];
+		UINT32 childCount = 0;
+		if(binary[index].count > 0)
+			children[childCount++] = index;
+		else
+		{
+			children[childCount++] = index + 1;
+			children[childCount++] = binary[index].offset;
+		}
+
+		while(childCount < RAY_QUERY_WIDTH)
+		{
+			int best = -1;
+			float bestArea = -1.0F;
+			for(UINT32 k = 0; k < childCount; ++k)
+			{
+				const BVHNode& child = binary[children[k]];
+				if(child.count == 0 && halfArea(child) > bestArea)
+				{
+					bestArea = halfArea(child);
+					best = (int) k;
+				}
+			}
+			if(best < 0)
+				break;
+
+			UINT32 open = children[best];
+			children[best] = open + 1;
+			children[childCount++] = binary[open].offset;
+		}
+
+		UINT32 wideIndex = (UINT32) wide.size();
+		wide.emplace_back();
+		for(UINT32 k = 0; k < RAY_QUERY_WIDTH; ++k)
+		{
+			RayQueryNode& node = wide[wideIndex];
+			node.boundsMinX[k] = node.boundsMinY[k] = node.boundsMinZ[k] = FLT_MAX;
+			node.boundsMaxX[k] = node.boundsMaxY[k] = node.boundsMaxZ[k] = -FLT_MAX;
+			node.child[k] = 0;
+			node.count[k] = 0;
+		}
+		wide[wideIndex].childCount = childCount;
+
+		for(UINT32 k = 0; k < childCount; ++k)
+		{
+			const BVHNode& child = binary[children[k]];
+			UINT32 target = child.count > 0 ? child.offset : collapse(binary, children[k], wide);
+
+			//the recursion may have moved the vector
+			RayQueryNode& node = wide[wideIndex];
+			node.boundsMinX[k] = child.boundsMin.x;
+			node.boundsMinY[k] = child.boundsMin.y;
+			node.boundsMinZ[k] = child.boundsMin.z;
+			node.boundsMaxX[k] = child.boundsMax.x;
+			node.boundsMaxY[k] = child.boundsMax.y;
+			node.boundsMaxZ[k] = child.boundsMax.z;
+			node.child[k] = target;
+			node.count[k] = child.count;
+		}
+
+		return wideIndex;
+	}
+
+	static void buildBottomLevel(const MeshGeometry* geo, RayQueryBottomLevel& bottomLevel, bool update)
+	{
+		if(!update || bottomLevel.bvh.refit(geo))
+			bottomLevel.bvh.build(geo);
+
+		const SubmeshGeometry& submesh = geo->DrawArgs.at("0");
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data()) + submesh.BaseVertexLocation;
+		const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data()) + submesh.StartIndexLocation;
+
+		const auto& order = bottomLevel.bvh.getPrimitiveIndices();
+		bottomLevel.triangles.resize(order.size());
+		parallelFor(size_t(0), order.size(), [&](size_t i)
+		{
+			UINT32 prim = order[i];
+			RayQueryTriangle& tri = bottomLevel.triangles[i];
+			tri.v0 = vertices[indices[3 * prim]].position;
+			tri.v1 = vertices[indices[3 * prim + 1]].position;
+			tri.v2 = vertices[indices[3 * prim + 2]].position;
+			tri.primitive = prim;
+			tri.pad0 = tri.pad1 = 0.0F;
+		});
+
+		bottomLevel.nodes.clear();
+		if(!order.empty())
+			collapse(bottomLevel.bvh.getNodes(), 0, bottomLevel.nodes);
+	}
+
+	void RayQuery::build(Scene* scene)
+	{
+		//bottom levels are kept between builds, only deforming geometries are refitted
+		std::unordered_set<const MeshGeometry*> updated;
+		for(auto& e:scene->getAllEntities())
+		{
+			const MeshGeometry* geo = e->getGeo();
+			if(!geo || updated.count(geo))
+				continue;
+			updated.insert(geo);
+
+			auto& bottomLevel = mBottomLevels[geo];
+			if(!bottomLevel)
+			{
+				bottomLevel = std::make_unique<RayQueryBottomLevel>();
+				buildBottomLevel(geo, *bottomLevel, false);
+			}
+			else if(geo->needsRefit)
+				buildBottomLevel(geo, *bottomLevel, true);
+		}
+
+		//top level over the world bounds of every instance, same masks as rebuildTLAS
+		std::vector<RayQueryInstance> instances;
+		std::vector<BVHPrimitive> primitives;
+		UINT32 instanceID = 0;
+		for(auto& e:scene->getAllEntities())
+		{
+			UINT32 entityInstance = 0;
+			for(auto& inst:e->getInstances())
+			{
+				const MeshGeometry* geo = e->getGeo();
+				if(!geo || mBottomLevels[geo]->nodes.empty())
+				{
+					instanceID++;
+					entityInstance++;
+					continue;
+				}
+
+				RayQueryInstance instance;
+				instance.world = inst.world;
+				XMMATRIX world = XMLoadFloat4x4(&inst.world);
+				XMVECTOR det = XMMatrixDeterminant(world);
+				XMStoreFloat4x4(&instance.invWorld, XMMatrixInverse(&det, world));
+				instance.bottomLevel = mBottomLevels[geo].get();
+				instance.entity = e.get();
+				instance.entityInstance = entityInstance++;
+				instance.instanceID = instanceID++;
+				instance.mask = inst.emissiveIndex >= 0 || e->getType() == INSTANCE_TYPE_WATER ? 0x01 : 0xFF;
+
+				const BVHNode& root = instance.bottomLevel->bvh.getNodes()[0];
+				XMVECTOR bMin = XMVectorReplicate(FLT_MAX);
+				XMVECTOR bMax = XMVectorReplicate(-FLT_MAX);
+				for(int corner = 0; corner < 8; ++corner)
+				{
+					XMVECTOR p = XMVectorSet(corner & 1 ? root.boundsMax.x : root.boundsMin.x, corner & 2 ? root.boundsMax.y : root.boundsMin.y, corner & 4 ? root.boundsMax.z : root.boundsMin.z, 1.0F);
+					p = XMVector3TransformCoord(p, world);
+					bMin = XMVectorMin(bMin, p);
+					bMax = XMVectorMax(bMax, p);
+				}
+
+				BVHPrimitive primitive;
+				XMStoreFloat3(&primitive.boundsMin, bMin);
+				XMStoreFloat3(&primitive.boundsMax, bMax);
+				primitive.index = (UINT32) instances.size();
+				primitive.pad = 0.0F;
+				primitives.push_back(primitive);
+				instances.push_back(instance);
+			}
+		}
+
+		mInstances.clear();
+		mTopLevel.clear();
+		if(instances.empty())
+			return;
+
+		mTopLevelBVH.build(primitives);
+		for(UINT32 index:mTopLevelBVH.getPrimitiveIndices())
+			mInstances.push_back(instances[index]);
+		collapse(mTopLevelBVH.getNodes(), 0, mTopLevel);
+	}
+
+	template<bool anyHit>
+	bool RayQuery::trace(const CpuRay& ray, RayQueryHit& hit, UINT8 instanceMask) const
+	{
+		if(mTopLevel.empty())
+			return false;
+
+		XMVECTOR origin = XMLoadFloat3(&ray.origin);
+		XMVECTOR dir = XMLoadFloat3(&ray.direction);
+		QueryRay worldRay = prepareRay(origin, dir, ray.tMin);
+		float tMax = ray.tMax;
+		bool found = false;
+
+		traverse(mTopLevel, worldRay, tMax, [&](UINT32 first, UINT32 count)
+		{
+			for(UINT32 i = first; i < first + count; ++i)
+			{
+				const RayQueryInstance& instance = mInstances[i];
+				if(!(instance.mask & instanceMask))
+					continue;
+
+				//the direction isn't normalized again, t stays the same in both spaces
+				XMMATRIX invWorld = XMLoadFloat4x4(&instance.invWorld);
+				QueryRay localRay = prepareRay(XMVector3TransformCoord(origin, invWorld), XMVector3TransformNormal(dir, invWorld), ray.tMin);
+				const RayQueryBottomLevel& bottomLevel = *instance.bottomLevel;
+
+				bool done = traverse(bottomLevel.nodes, localRay, tMax, [&](UINT32 firstTriangle, UINT32 triangleCount)
+				{
+					for(UINT32 t = firstTriangle; t < firstTriangle + triangleCount; ++t)
+					{
+						float tHit;
+						XMFLOAT2 bary;
+						if(!intersectTriangle(localRay, bottomLevel.triangles[t], tMax, tHit, bary))
+							continue;
+
+						tMax = tHit;
+						found = true;
+						hit.t = tHit;
+						hit.bary = bary;
+						hit.primitiveIndex = bottomLevel.triangles[t].primitive;
+						hit.instanceID = instance.instanceID;
+						hit.entity = instance.entity;
+						hit.entityInstance = instance.entityInstance;
+						if constexpr(anyHit)
+							return true;
+					}
+					return false;
+				});
+
+				if(done)
+					return true;
+			}
+			return false;
+		});
+
+		return found;
+	}
+
+	bool RayQuery::closestHit(const CpuRay& ray, RayQueryHit& hit, UINT8 instanceMask) const
+	{
+		hit = {};
+		return trace<false>(ray, hit, instanceMask);
+	}
+
+	bool RayQuery::anyHit(const CpuRay& ray, UINT8 instanceMask) const
+	{
+		RayQueryHit hit;
+		return trace<true>(ray, hit, instanceMask);
+	}
+
+	void RayQuery::closestHit(const std::vector<CpuRay>& rays, std::vector<RayQueryHit>& hits, UINT8 instanceMask) const
+	{
+		hits.assign(rays.size(), {});
+		UINT32 batchCount = (UINT32) ((rays.size() + RAY_QUERY_BATCH_SIZE - 1) / RAY_QUERY_BATCH_SIZE);
+		parallelFor(UINT32(0), batchCount, [&](UINT32 batch)
+		{
+			size_t end = std::min<size_t>((size_t) (batch + 1) * RAY_QUERY_BATCH_SIZE, rays.size());
+			for(size_t i = (size_t) batch * RAY_QUERY_BATCH_SIZE; i < end; ++i)
+				trace<false>(rays[i], hits[i], instanceMask);
+		});
+	}
+
+	void RayQuery::anyHit(const std::vector<CpuRay>& rays, std::vector<UINT8>& occluded, UINT8 instanceMask) const
+	{
+		occluded.assign(rays.size(), 0);
+		UINT32 batchCount = (UINT32) ((rays.size() + RAY_QUERY_BATCH_SIZE - 1) / RAY_QUERY_BATCH_SIZE);
+		parallelFor(UINT32(0), batchCount, [&](UINT32 batch)
+		{
+			size_t end = std::min<size_t>((size_t) (batch + 1) * RAY_QUERY_BATCH_SIZE, rays.size());
+			for(size_t i = (size_t) batch * RAY_QUERY_BATCH_SIZE; i < end; ++i)
+			{
+				RayQueryHit hit;
+				occluded[i] = trace<true>(rays[i], hit, instanceMask) ? 1 : 0;
+			}
+		});
+	}
+
+	CpuRay RayQuery::cameraRay(Camera* cam, float u, float v)
+	{
+		XMMATRIX view = cam->getView();
+		XMMATRIX proj = cam->getProj();
+		XMVECTOR det = XMMatrixDeterminant(view);
+		XMMATRIX invView = XMMatrixInverse(&det, view);
+		det = XMMatrixDeterminant(proj);
+		XMMATRIX invProj = XMMatrixInverse(&det, proj);
+
+		//same camera ray as ray_gen.hlsl
+		XMVECTOR target = XMVector4Transform(XMVectorSet(u * 2.0F - 1.0F, 1.0F - v * 2.0F, 1.0F, 1.0F), invProj);
+
+		CpuRay ray;
+		XMStoreFloat3(&ray.origin, XMVector3TransformCoord(XMVectorZero(), invView));
+		XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVector3TransformNormal(target, invView)));
+		ray.tMin = cam->getNearZ();
+		ray.tMax = cam->getFarZ();
+		return ray;
+	}
+}
\ No newline at end of file
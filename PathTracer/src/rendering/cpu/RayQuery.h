@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../../app/Scene.h"
+
+#include "../../utils/core.h"
+
+#include "BVH.h"
+
+#define RAY_QUERY_WIDTH			8
+#define RAY_QUERY_STACK_SIZE	(BVH_MAX_DEPTH * (RAY_QUERY_WIDTH - 1) + 1)
+#define RAY_QUERY_BATCH_SIZE	64
+
+namespace RT
+{
+	struct CpuRay
+	{
+		DirectX::XMFLOAT3 origin = { 0.0F, 0.0F, 0.0F };
+		float tMin = 0.0F;
+		DirectX::XMFLOAT3 direction = { 0.0F, 0.0F, 1.0F };
+		float tMax = FLT_MAX;
+	};
+
+	struct RayQueryHit
+	{
+		float t = FLT_MAX;
+		DirectX::XMFLOAT2 bary = { 0.0F, 0.0F }; //same convention as Attributes in the shaders
+		UINT32 instanceID = UINT32_MAX; //every entity instance in scene order, like the hit group index of the TLAS
+		UINT32 primitiveIndex = UINT32_MAX;
+		Entity* entity = nullptr;
+		UINT32 entityInstance = 0;
+	};
+
+	//8 children tested at once, the used slots come first
+	struct RayQueryNode
+	{
+		float boundsMinX[RAY_QUERY_WIDTH];
+		float boundsMinY[RAY_QUERY_WIDTH];
+		float boundsMinZ[RAY_QUERY_WIDTH];
+		float boundsMaxX[RAY_QUERY_WIDTH];
+		float boundsMaxY[RAY_QUERY_WIDTH];
+		float boundsMaxZ[RAY_QUERY_WIDTH];
+		UINT32 child[RAY_QUERY_WIDTH]; //node index, first primitive for leaves
+		UINT32 count[RAY_QUERY_WIDTH]; //0 for inner nodes
+		UINT32 childCount;
+	};
+
+	struct RayQueryTriangle
+	{
+		DirectX::XMFLOAT3 v0;
+		UINT32 primitive;
+		DirectX::XMFLOAT3 v1;
+		float pad0;
+		DirectX::XMFLOAT3 v2;
+		float pad1;
+	};
+
+	//mirror of a BLAS, object space triangles in leaf order
+	struct RayQueryBottomLevel
+	{
+		BVH bvh;
+		std::vector<RayQueryNode> nodes;
+		std::vector<RayQueryTriangle> triangles;
+	};
+
+	struct RayQueryInstance
+	{
+		DirectX::XMFLOAT4X4 world = Identity4x4();
+		DirectX::XMFLOAT4X4 invWorld = Identity4x4();
+		const RayQueryBottomLevel* bottomLevel = nullptr;
+		Entity* entity = nullptr;
+		UINT32 entityInstance = 0;
+		UINT32 instanceID = 0;
+		UINT8 mask = 0xFF;
+	};
+
+	//CPU side TLAS/BLAS pair for picking, visibility and gameplay queries
+	//instanceMask works like InstanceInclusionMask in TraceRay, water and emissive instances only have bit 0 set
+	class RayQuery
+	{
+	public:
+		RayQuery() = default;
+		~RayQuery() = default;
+		RayQuery(const RayQuery&) = delete;
+		RayQuery& operator=(const RayQuery&) = delete;
+
+		//call before MeshGeometry::needsRefit is cleared, deforming geometries get their bottom level refitted
+		void build(Scene* scene);
+
+		bool closestHit(const CpuRay& ray, RayQueryHit& hit, UINT8 instanceMask = 0xFF) const;
+		bool anyHit(const CpuRay& ray, UINT8 instanceMask = 0xFF) const;
+		void closestHit(const std::vector<CpuRay>& rays, std::vector<RayQueryHit>& hits, UINT8 instanceMask = 0xFF) const;
+		void anyHit(const std::vector<CpuRay>& rays, std::vector<UINT8>& occluded, UINT8 instanceMask = 0xFF) const;
+
+		//u and v go from 0 to 1 across the screen, top left first
+		static CpuRay cameraRay(Camera* cam, float u, float v);
+
+		inline UINT32 getInstanceCount() const { return (UINT32) mInstances.size(); }
+		inline UINT32 getBottomLevelCount() const { return (UINT32) mBottomLevels.size(); }
+	private:
+		template<bool anyHit>
+		bool trace(const CpuRay& ray, RayQueryHit& hit, UINT8 instanceMask) const;
+
+		std::unordered_map<const MeshGeometry*, std::unique_ptr<RayQueryBottomLevel>> mBottomLevels;
+		std::vector<RayQueryInstance> mInstances; //in leaf order of the top level
+		BVH mTopLevelBVH;
+		std::vector<RayQueryNode> mTopLevel;
+	};
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "RTComposite.h"
 
+using namespace DirectX;
+
 namespace RT
 {
 	/*
@@ -15,13 +17,19 @@ namespace RT
 	* 8 SRV: Normals and roughness
 	* 9 SRV: View direction
 	* 10 SRV: View z
-	* 11 UAV: Output
+	* 11 SRV: Noisy specular
+	* 12 SRV: Noisy diffuse spherical harmonics
+	* 13 SRV: Noisy specular spherical harmonics
+	* 14 UAV: Output
+	* 15 UAV: Accumulation
 	*/
 
 	RTComposite::RTComposite(ID3D12GraphicsCommandList* cmdList, ID3D12Device* device, settings_struct* settings): PostProcessing(device, settings, 1.0F), cmdList(cmdList)
 	{
 		mFollowsDLSSSizes = true;
-		mAdditionalSrvSpace = 10;
+		mAdditionalSrvSpace = 13;
+		mNeedsBuffer = true;
+		mBufferHighPrecision = true;
 
 		init(device, { L"rt_composite" });
 	}
@@ -29,13 +37,14 @@ namespace RT
 	void RTComposite::buildRootSignature(ID3D12Device* device)
 	{
 		CD3DX12_DESCRIPTOR_RANGE ranges[2];
-		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 11, 0, 0, 0);
-		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, 11);
+		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 14, 0, 0, 0);
+		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0, 0, 14);
 
-		CD3DX12_ROOT_PARAMETER slotRootParameter;
-		slotRootParameter.InitAsDescriptorTable(2, ranges, D3D12_SHADER_VISIBILITY_ALL);
+		CD3DX12_ROOT_PARAMETER slotRootParameter[2];
+		slotRootParameter[0].InitAsDescriptorTable(2, ranges, D3D12_SHADER_VISIBILITY_ALL);
+		slotRootParameter[1].InitAsConstants(2, 0);
 
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(1, &slotRootParameter);
+		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(2, slotRootParameter);
 
 		Microsoft::WRL::ComPtr<ID3DBlob> serializedRootSig = nullptr;
 		Microsoft::WRL::ComPtr<ID3DBlob> errorBlob = nullptr;
@@ -62,6 +71,8 @@ namespace RT
 
 		cmdList->SetPipelineState(mPSOs[0].Get());
 		cmdList->SetComputeRootDescriptorTable(0, getHeapGpu());
+		cmdList->SetComputeRoot32BitConstant(1, mAccumulatedFrames, 0);
+		cmdList->SetComputeRoot32BitConstant(1, mAccumulate ? 1 : 0, 1);
 
 		UINT numGroupsX = (UINT) ceil(settings->getWidth() / 32.0F);
 		UINT numGroupsY = (UINT) ceil(settings->getHeight() / 16.0F);
@@ -78,5 +89,65 @@ namespace RT
 		barriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(copyTo, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET);
 		barriers[2] = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 		cmdList->ResourceBarrier(3, barriers);
+
+		if(mCaptureRequested && mAccumulatedFrames > 0)
+		{
+			t = CD3DX12_RESOURCE_BARRIER::Transition(mIntermediateBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+			cmdList->ResourceBarrier(1, &t);
+
+			CD3DX12_TEXTURE_COPY_LOCATION dst(mReadback.Get(), mFootprint);
+			CD3DX12_TEXTURE_COPY_LOCATION src(mIntermediateBuffer.Get(), 0);
+			cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+			t = CD3DX12_RESOURCE_BARRIER::Transition(mIntermediateBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+			cmdList->ResourceBarrier(1, &t);
+		}
+		mCaptureRequested = false;
+	}
+
+	void RTComposite::onResize(ID3D12Device* device, bool ignoreActiveCheck)
+	{
+		PostProcessing::onResize(device, ignoreActiveCheck);
+
+		//the accumulation is read back for the convergence report
+		D3D12_RESOURCE_DESC desc = mIntermediateBuffer->GetDesc();
+		UINT64 size;
+		device->GetCopyableFootprints(&desc, 0, 1, 0, &mFootprint, nullptr, nullptr, &size);
+
+		auto hp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+		auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+		ThrowIfFailed(device->CreateCommittedResource(&hp, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&mReadback)));
+		mPrevCapture.clear();
+	}
+
+	float RTComposite::readCapture(UINT frames)
+	{
+		const UINT width = mFootprint.Footprint.Width;
+		const UINT height = mFootprint.Footprint.Height;
+
+		BYTE* data;
+		ThrowIfFailed(mReadback->Map(0, nullptr, reinterpret_cast<void**>(&data)));
+
+		bool first = mPrevCapture.empty();
+		mPrevCapture.resize((size_t) width * height);
+
+		double error = 0.0;
+		for(UINT y = 0; y < height; ++y)
+		{
+			const XMFLOAT4* row = reinterpret_cast<const XMFLOAT4*>(data + mFootprint.Offset + (size_t) y * mFootprint.Footprint.RowPitch);
+			for(UINT x = 0; x < width; ++x)
+			{
+				XMFLOAT3 average = { row[x].x / frames, row[x].y / frames, row[x].z / frames };
+				XMFLOAT3& prev = mPrevCapture[(size_t) y * width + x];
+
+				float delta = 0.2126F * (average.x - prev.x) + 0.7152F * (average.y - prev.y) + 0.0722F * (average.z - prev.z);
+				error += delta * delta;
+				prev = average;
+			}
+		}
+
+		D3D12_RANGE written = { 0, 0 };
+		mReadback->Unmap(0, &written);
+		return first ? 0.0F : (float) sqrt(error / ((double) width * height));
 	}
 }
\ No newline at end of file
@@ -10,9 +10,24 @@ namespace RT
 		RTComposite(ID3D12GraphicsCommandList* cmdList, ID3D12Device* device, settings_struct* settings);
 
 		void effect(UINT index, ID3D12Resource* backBuffer, ID3D12Resource* copyTo = nullptr) override;
+		void onResize(ID3D12Device* device, bool ignoreActiveCheck = false) override;
+
+		//0 composites the denoised signals, otherwise the noisy ones are added to the accumulation buffer
+		inline void setAccumulation(UINT frames, bool accumulate) { mAccumulatedFrames = frames; mAccumulate = accumulate; }
+		inline void requestCapture() { mCaptureRequested = true; }
+		inline void clearCaptures() { mPrevCapture.clear(); }
+		//rms luminance change of the average since the previous capture, only once the capturing frame is done on the GPU
+		float readCapture(UINT frames);
 	private:
 		void buildRootSignature(ID3D12Device* device) override;
 
 		ID3D12GraphicsCommandList* cmdList;
+
+		UINT mAccumulatedFrames = 0;
+		bool mAccumulate = false;
+		bool mCaptureRequested = false;
+		Microsoft::WRL::ComPtr<ID3D12Resource> mReadback = nullptr;
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT mFootprint = {};
+		std::vector<DirectX::XMFLOAT3> mPrevCapture;
 	};
 }
\ No newline at end of file
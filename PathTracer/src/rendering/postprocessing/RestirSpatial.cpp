@@ -9,6 +9,7 @@ namespace RT
 	* 2 SRV: Normals and roughness
 	* 3 SRV: Fresnel RF0
 	* 4 UAV: Spatial reused reservoirs
+	* root SRV: Lights of the current frame resource
 	*/
 
 	RestirSpatial::RestirSpatial(ID3D12Device* device, settings_struct* settings): PostProcessing(device, settings, 0.0F)
@@ -29,12 +30,13 @@ namespace RT
 		CD3DX12_DESCRIPTOR_RANGE samplerRange;
 		samplerRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0, 0, 1);
 
-		CD3DX12_ROOT_PARAMETER slotRootParameters[3];
+		CD3DX12_ROOT_PARAMETER slotRootParameters[4];
 		slotRootParameters[0].InitAsConstantBufferView(0);
 		slotRootParameters[1].InitAsDescriptorTable(2, ranges, D3D12_SHADER_VISIBILITY_ALL);
 		slotRootParameters[2].InitAsDescriptorTable(1, &samplerRange, D3D12_SHADER_VISIBILITY_ALL);
+		slotRootParameters[3].InitAsShaderResourceView(4);
 
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(3, slotRootParameters);
+		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameters);
 
 		Microsoft::WRL::ComPtr<ID3DBlob> serializedRootSig = nullptr;
 		Microsoft::WRL::ComPtr<ID3DBlob> errorBlob = nullptr;
@@ -61,6 +63,7 @@ namespace RT
 		mCommandList[index]->SetComputeRootConstantBufferView(0, mCB->resource()->GetGPUVirtualAddress());
 		mCommandList[index]->SetComputeRootDescriptorTable(1, getHeapGpu());
 		mCommandList[index]->SetComputeRootDescriptorTable(2, gSamplerHeap->GetGPUDescriptorHandleForHeapStart());
+		mCommandList[index]->SetComputeRootShaderResourceView(3, mLights);
 
 		UINT numGroupsX = (UINT) ceil(settings->getWidth() / 16.0F);
 		UINT numGroupsY = (UINT) ceil(settings->getHeight() / 8.0F);
@@ -71,7 +74,7 @@ namespace RT
 		mCommandList[index]->ResourceBarrier(2, barriers);
 	}
 
-	void RestirSpatial::setData(DirectX::XMFLOAT4X4 invView, DirectX::XMFLOAT4X4 invProj, DirectX::XMFLOAT3 camPos, UINT frameIndex, UINT lightCount, UINT width, UINT height, Light* lights)
+	void RestirSpatial::setData(DirectX::XMFLOAT4X4 invView, DirectX::XMFLOAT4X4 invProj, DirectX::XMFLOAT3 camPos, UINT frameIndex, UINT lightCount, UINT width, UINT height, D3D12_GPU_VIRTUAL_ADDRESS lights)
 	{
 		PassCB cb;
 		cb.invView = invView;
@@ -81,7 +84,7 @@ namespace RT
 		cb.lightCount = lightCount;
 		cb.width = width;
 		cb.height = height;
-		memcpy(&cb.lights[0], lights, sizeof(Light) * lightCount);
 		mCB->copyData(0, cb);
+		mLights = lights;
 	}
 }
\ No newline at end of file
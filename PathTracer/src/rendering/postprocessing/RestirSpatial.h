@@ -13,7 +13,7 @@ namespace RT
 
 		void effect(UINT index, ID3D12Resource* candidates, ID3D12Resource* history = nullptr) override;
 
-		void setData(DirectX::XMFLOAT4X4 invView, DirectX::XMFLOAT4X4 invProj, DirectX::XMFLOAT3 camPos, UINT frameIndex, UINT lightCount, UINT width, UINT height, Light* lights);
+		void setData(DirectX::XMFLOAT4X4 invView, DirectX::XMFLOAT4X4 invProj, DirectX::XMFLOAT3 camPos, UINT frameIndex, UINT lightCount, UINT width, UINT height, D3D12_GPU_VIRTUAL_ADDRESS lights);
 	private:
 		struct PassCB
 		{
@@ -25,11 +25,11 @@ namespace RT
 			UINT lightCount;
 			UINT width;
 			UINT height;
-			Light lights[MAX_LIGHTS];
 		};
 
 		void buildRootSignature(ID3D12Device* device) override;
 
 		std::unique_ptr<UploadBuffer<PassCB>> mCB;
+		D3D12_GPU_VIRTUAL_ADDRESS mLights = 0;
 	};
 }
\ No newline at end of file
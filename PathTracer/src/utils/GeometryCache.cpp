@@ -0,0 +1,157 @@
+#include "GeometryCache.h"
+
+#include "GeometryGenerator.h"
+
+#include <filesystem>
+
+#define GEOMETRY_CACHE_DIR		"res/cache/geometry/"
+#define GEOMETRY_CACHE_MAGIC	0x47454755 //UGEG
+#define GEOMETRY_CACHE_VERSION	3
+
+using namespace DirectX;
+
+namespace RT
+{
+	std::shared_ptr<const ProceduralMesh> GeometryCache::get(const ProceduralKey& key, bool useDisk)
+	{
+		auto it = mMeshes.find(key);
+		if(it != mMeshes.end())
+			return it->second;
+
+		std::stringstream fileName;
+		fileName << GEOMETRY_CACHE_DIR << std::hex << ProceduralKeyHash()(key) << ".bin";
+
+		std::shared_ptr<ProceduralMesh> mesh = useDisk ? loadFromDisk(fileName.str(), key) : nullptr;
+		if(!mesh)
+		{
+			mesh = generate(key);
+			if(useDisk)
+				saveToDisk(fileName.str(), key, *mesh);
+		}
+
+		mMeshes[key] = mesh;
+		return mesh;
+	}
+
+	std::shared_ptr<ProceduralMesh> GeometryCache::generate(const ProceduralKey& key)
+	{
+		GeometryGenerator geoGen;
+		GeometryGenerator::MeshData meshData;
+
+		const auto& p = key.params;
+		switch(key.shape)
+		{
+		case PROCEDURAL_SHAPE_BOX:
+			meshData = geoGen.createBox(p[0], p[1], p[2], (UINT32) p[3]);
+			break;
+		case PROCEDURAL_SHAPE_SPHERE:
+			meshData = geoGen.createSphere(p[0], (UINT32) p[1], (UINT32) p[2]);
+			break;
+		case PROCEDURAL_SHAPE_GEOSPHERE:
+			meshData = geoGen.createGeosphere(p[0], (UINT32) p[1]);
+			break;
+		case PROCEDURAL_SHAPE_CYLINDER:
+			meshData = geoGen.createCylinder(p[0], p[1], p[2], (UINT32) p[3], (UINT32) p[4]);
+			break;
+		case PROCEDURAL_SHAPE_GRID:
+			meshData = geoGen.createGrid(p[0], p[1], (UINT32) p[2], (UINT32) p[3]);
+			break;
+		case PROCEDURAL_SHAPE_QUAD:
+			meshData = geoGen.createQuad(p[0], p[1], p[2], p[3], p[4]);
+			break;
+		}
+
+		auto mesh = std::make_shared<ProceduralMesh>();
+		mesh->vertices.resize(meshData.vertices.size());
+		mesh->indices = std::move(meshData.indices32);
+
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for(size_t i = 0; i < meshData.vertices.size(); ++i)
+		{
+			Vertex& v = mesh->vertices[i];
+			v.position = meshData.vertices[i].position;
+			v.normal = meshData.vertices[i].normal;
+			v.uvs = meshData.vertices[i].texC;
+			v.tangent = { meshData.vertices[i].tangentU.x, meshData.vertices[i].tangentU.y, meshData.vertices[i].tangentU.z, 1.0F };
+
+			XMVECTOR pos = XMLoadFloat3(&v.position);
+			vMin = XMVectorMin(vMin, pos);
+			vMax = XMVectorMax(vMax, pos);
+		}
+
+		XMStoreFloat3(&mesh->bounds.Center, 0.5F * (vMin + vMax));
+		XMStoreFloat3(&mesh->bounds.Extents, 0.5F * (vMax - vMin));
+		return mesh;
+	}
+
+	std::shared_ptr<ProceduralMesh> GeometryCache::loadFromDisk(const std::string& fileName, const ProceduralKey& key)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if(!file.is_open())
+			return nullptr;
+
+		UINT32 magic = 0, version = 0, vertexCount = 0, indexCount = 0;
+		file.read((char*) &magic, sizeof(UINT32));
+		file.read((char*) &version, sizeof(UINT32));
+		if(magic != GEOMETRY_CACHE_MAGIC || version != GEOMETRY_CACHE_VERSION)
+		{
+			Logger::WARN.log("Ignoring stale geometry cache " + fileName);
+			return nullptr;
+		}
+
+		ProceduralKey stored;
+		UINT32 shape = 0;
+		file.read((char*) &shape, sizeof(UINT32));
+		file.read((char*) stored.params.data(), sizeof(float) * stored.params.size());
+		stored.shape = (ProceduralShape) shape;
+		if(!file || !(stored == key))
+		{
+			Logger::WARN.log("Ignoring geometry cache " + fileName + " of another shape");
+			return nullptr;
+		}
+
+		auto mesh = std::make_shared<ProceduralMesh>();
+		file.read((char*) &vertexCount, sizeof(UINT32));
+		file.read((char*) &indexCount, sizeof(UINT32));
+		file.read((char*) &mesh->bounds.Center, sizeof(XMFLOAT3));
+		file.read((char*) &mesh->bounds.Extents, sizeof(XMFLOAT3));
+
+		mesh->vertices.resize(vertexCount);
+		mesh->indices.resize(indexCount);
+		file.read((char*) mesh->vertices.data(), sizeof(Vertex) * vertexCount);
+		file.read((char*) mesh->indices.data(), sizeof(UINT32) * indexCount);
+
+		if(!file)
+		{
+			Logger::WARN.log("Corrupted geometry cache " + fileName);
+			return nullptr;
+		}
+
+		return mesh;
+	}
+
+	void GeometryCache::saveToDisk(const std::string& fileName, const ProceduralKey& key, const ProceduralMesh& mesh)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(GEOMETRY_CACHE_DIR, ec);
+
+		std::ofstream file(fileName, std::ios::binary);
+		if(!file.is_open())
+		{
+			Logger::WARN.log("Couldn't write geometry cache " + fileName);
+			return;
+		}
+
+		UINT32 header[3] = { GEOMETRY_CACHE_MAGIC, GEOMETRY_CACHE_VERSION, (UINT32) key.shape };
+		file.write((const char*) header, sizeof(header));
+		file.write((const char*) key.params.data(), sizeof(float) * key.params.size());
+
+		UINT32 counts[2] = { (UINT32) mesh.vertices.size(), (UINT32) mesh.indices.size() };
+		file.write((const char*) counts, sizeof(counts));
+		file.write((const char*) &mesh.bounds.Center, sizeof(XMFLOAT3));
+		file.write((const char*) &mesh.bounds.Extents, sizeof(XMFLOAT3));
+		file.write((const char*) mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size());
+		file.write((const char*) mesh.indices.data(), sizeof(UINT32) * mesh.indices.size());
+	}
+}
\ No newline at end of file
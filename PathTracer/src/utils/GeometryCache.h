@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core.h"
+
+namespace RT
+{
+	enum ProceduralShape
+	{
+		PROCEDURAL_SHAPE_BOX = 0,
+		PROCEDURAL_SHAPE_SPHERE,
+		PROCEDURAL_SHAPE_GEOSPHERE,
+		PROCEDURAL_SHAPE_CYLINDER,
+		PROCEDURAL_SHAPE_GRID,
+		PROCEDURAL_SHAPE_QUAD
+	};
+
+	struct ProceduralKey
+	{
+		ProceduralShape shape = PROCEDURAL_SHAPE_BOX;
+		std::array<float, 5> params = { 0.0F, 0.0F, 0.0F, 0.0F, 0.0F };
+
+		inline bool operator==(const ProceduralKey& other) const { return shape == other.shape && params == other.params; }
+	};
+
+	struct ProceduralKeyHash
+	{
+		inline size_t operator()(const ProceduralKey& key) const
+		{
+			//fnv-1a over the raw key bytes
+			UINT64 hash = 14695981039346656037ULL;
+			auto mix = [&hash](const void* data, size_t size)
+			{
+				const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+				for(size_t i = 0; i < size; ++i)
+					hash = (hash ^ bytes[i]) * 1099511628211ULL;
+			};
+			mix(&key.shape, sizeof(key.shape));
+			mix(key.params.data(), sizeof(float) * key.params.size());
+			return (size_t) hash;
+		}
+	};
+
+	//ready to upload output of the geometry generator
+	struct ProceduralMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<UINT32> indices;
+		DirectX::BoundingBox bounds;
+	};
+
+	class GeometryCache
+	{
+	public:
+		static std::shared_ptr<const ProceduralMesh> get(const ProceduralKey& key, bool useDisk = false);
+		static inline void clear() { mMeshes.clear(); }
+	private:
+		GeometryCache() = default;
+
+		static std::shared_ptr<ProceduralMesh> generate(const ProceduralKey& key);
+		//the files are named by the key's hash, the full key in the header catches collisions
+		static std::shared_ptr<ProceduralMesh> loadFromDisk(const std::string& fileName, const ProceduralKey& key);
+		static void saveToDisk(const std::string& fileName, const ProceduralKey& key, const ProceduralMesh& mesh);
+
+		inline static std::unordered_map<ProceduralKey, std::shared_ptr<ProceduralMesh>, ProceduralKeyHash> mMeshes;
+	};
+}
\ No newline at end of file
@@ -89,22 +89,27 @@ namespace RT
 		meshData.indices32.assign(&i[0], &i[36]);
 
 		// Put a cap on the number of subdivisions.
-		numSubdivisions = std::min<UINT32>(numSubdivisions, 6U);
+		numSubdivisions = std::min<UINT32>(numSubdivisions, MAX_SUBDIVISIONS);
 
-		for(UINT32 i = 0; i < numSubdivisions; ++i)
-			subdivide(meshData);
+		subdivide(meshData, numSubdivisions);
 
 		return meshData;
 	}
 
-	void GeometryGenerator::subdivide(MeshData& meshData)
+	void GeometryGenerator::subdivide(MeshData& meshData, UINT32 levels)
 	{
-		// Save a copy of the input geometry.
-		MeshData inputCopy = meshData;
+		// Index buffers ping-pong between levels, vertices are appended in place.
+		std::vector<UINT32> scratch;
 
-		meshData.vertices.resize(0);
-		meshData.indices32.resize(0);
+		for(UINT32 level = 0; level < levels; ++level)
+		{
+			subdivideLevel(meshData, scratch);
+			meshData.indices32.swap(scratch);
+		}
+	}
 
+	UINT32 GeometryGenerator::subdivideLevel(MeshData& meshData, std::vector<UINT32>& indicesOut)
+	{
 		//       v1
 		//       *
 		//      / \
@@ -115,48 +120,62 @@ namespace RT
 		// *-----*-----*
 		// v0    m2     v2
 
-		UINT32 numTris = (UINT32) inputCopy.indices32.size() / 3;
+		UINT32 numTris = (UINT32) meshData.indices32.size() / 3;
+
+		// Each edge gets one midpoint, shared by the two triangles on its sides.
+		// A closed mesh has 3/2 edges per triangle.
+		struct EdgeMidPoint
+		{
+			UINT32 index;
+			UINT32 uses;
+		};
+		std::unordered_map<UINT64, EdgeMidPoint> edges;
+		edges.reserve(numTris * 3 / 2 + 1);
+		meshData.vertices.reserve(meshData.vertices.size() + numTris * 3 / 2 + 1);
+		indicesOut.resize((size_t) numTris * 12);
+
+		auto edgeMidPoint = [&](UINT32 a, UINT32 b)
+		{
+			UINT64 key = a < b ? ((UINT64) a << 32) | b : ((UINT64) b << 32) | a;
+			auto [it, inserted] = edges.try_emplace(key, EdgeMidPoint{ (UINT32) meshData.vertices.size(), 0 });
+			if(inserted)
+				meshData.vertices.push_back(midPoint(meshData.vertices[a], meshData.vertices[b]));
+			it->second.uses++;
+			return it->second.index;
+		};
+
 		for(UINT32 i = 0; i < numTris; ++i)
 		{
-			Vertex v0 = inputCopy.vertices[inputCopy.indices32[i * 3 + 0]];
-			Vertex v1 = inputCopy.vertices[inputCopy.indices32[i * 3 + 1]];
-			Vertex v2 = inputCopy.vertices[inputCopy.indices32[i * 3 + 2]];
+			UINT32 v0 = meshData.indices32[i * 3 + 0];
+			UINT32 v1 = meshData.indices32[i * 3 + 1];
+			UINT32 v2 = meshData.indices32[i * 3 + 2];
 
 			//
 			// Generate the midpoints.
 			//
 
-			Vertex m0 = midPoint(v0, v1);
-			Vertex m1 = midPoint(v1, v2);
-			Vertex m2 = midPoint(v0, v2);
+			UINT32 m0 = edgeMidPoint(v0, v1);
+			UINT32 m1 = edgeMidPoint(v1, v2);
+			UINT32 m2 = edgeMidPoint(v0, v2);
 
 			//
 			// Add new geometry.
 			//
 
-			meshData.vertices.push_back(v0); // 0
-			meshData.vertices.push_back(v1); // 1
-			meshData.vertices.push_back(v2); // 2
-			meshData.vertices.push_back(m0); // 3
-			meshData.vertices.push_back(m1); // 4
-			meshData.vertices.push_back(m2); // 5
-
-			meshData.indices32.push_back(i * 6 + 0);
-			meshData.indices32.push_back(i * 6 + 3);
-			meshData.indices32.push_back(i * 6 + 5);
-
-			meshData.indices32.push_back(i * 6 + 3);
-			meshData.indices32.push_back(i * 6 + 4);
-			meshData.indices32.push_back(i * 6 + 5);
+			UINT32* out = &indicesOut[(size_t) i * 12];
+			out[0] = v0; out[1] = m0; out[2] = m2;
+			out[3] = m0; out[4] = m1; out[5] = m2;
+			out[6] = m2; out[7] = m1; out[8] = v2;
+			out[9] = m0; out[10] = v1; out[11] = m1;
+		}
 
-			meshData.indices32.push_back(i * 6 + 5);
-			meshData.indices32.push_back(i * 6 + 4);
-			meshData.indices32.push_back(i * 6 + 2);
+		// An edge not shared by exactly two triangles is a border or a crack.
+		UINT32 openEdges = 0;
+		for(auto& [key, edge]:edges)
+			if(edge.uses != 2)
+				openEdges++;
 
-			meshData.indices32.push_back(i * 6 + 3);
-			meshData.indices32.push_back(i * 6 + 1);
-			meshData.indices32.push_back(i * 6 + 4);
-		}
+		return openEdges;
 	}
 	
 	GeometryGenerator::Vertex GeometryGenerator::midPoint(const Vertex& v0, const Vertex& v1)
@@ -423,7 +442,7 @@ namespace RT
 	{
 		MeshData meshData;
 
-		subdivisions = std::min<UINT32>(subdivisions, 6U);
+		subdivisions = std::min<UINT32>(subdivisions, MAX_SUBDIVISIONS);
 
 		const float x = 0.525731F;
 		const float z = 0.850651F;
@@ -449,8 +468,7 @@ namespace RT
 
 		for(UINT32 i = 0; i < 12; ++i)
 			meshData.vertices[i].position = pos[i];
-		for(UINT32 i = 0; i < subdivisions; ++i)
-			subdivide(meshData);
+		subdivide(meshData, subdivisions);
 
 		for(UINT32 i = 0; i < meshData.vertices.size(); ++i)
 		{
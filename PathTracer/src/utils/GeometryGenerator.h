@@ -1,5 +1,7 @@
 #pragma once
-#include "header.h"
+#include "core.h"
+
+#define MAX_SUBDIVISIONS 10
 
 namespace RT
 {
@@ -76,7 +78,8 @@ namespace RT
 		///</summary>
 		MeshData createQuad(float x, float y, float w, float h, float depth);
 	private:
-		void subdivide(MeshData& meshData);
+		void subdivide(MeshData& meshData, UINT32 levels);
+		UINT32 subdivideLevel(MeshData& meshData, std::vector<UINT32>& indicesOut);
 		Vertex midPoint(const Vertex& v0, const Vertex& v1);
 		void buildCylinderTopCap(float bottomRadius, float topRadius, float height, UINT32 sliceCount, UINT32 stackCount, MeshData& meshData);
 		void buildCylinderBottomCap(float bottomRadius, float topRadius, float height, UINT32 sliceCount, UINT32 stackCount, MeshData& meshData);
@@ -6,6 +6,7 @@
 #include <tiny_gltf.h>
 
 #include <queue>
+#include <cmath>
 
 using namespace DirectX;
 
@@ -13,38 +14,145 @@ namespace RT
 {
 	void ModelLoader::calcTangents(const std::vector<UINT32>& indices, std::vector<Vertex>& vertices)
 	{
-		for(int i = 0; i < indices.size() - 3; i += 3)
-		{
-			int i0 = indices[i];
-			int i1 = indices[i + 1];
-			int i2 = indices[i + 2];
-
-			XMVECTOR v0 = XMLoadFloat3(&vertices[i0].position);
-			XMVECTOR v1 = XMLoadFloat3(&vertices[i1].position);
-			XMVECTOR v2 = XMLoadFloat3(&vertices[i2].position);
-
-			XMVECTOR uv0 = XMLoadFloat2(&vertices[i0].uvs);
-			XMVECTOR uv1 = XMLoadFloat2(&vertices[i1].uvs);
-			XMVECTOR uv2 = XMLoadFloat2(&vertices[i2].uvs);
-
-			XMVECTOR deltaPos1 = v1 - v0;
-			XMVECTOR deltaPos2 = v2 - v0;
-			XMVECTOR deltaUV1 = uv1 - uv0;
-			XMVECTOR deltaUV2 = uv2 - uv0;
-
-			float r = 1.0F / (XMVectorGetX(deltaUV1) * XMVectorGetY(deltaUV2) - XMVectorGetY(deltaUV1) * XMVectorGetX(deltaUV2));
-			XMVECTOR tangent = XMVector3Normalize((deltaPos1 * XMVectorGetY(deltaUV2) - deltaPos2 * XMVectorGetY(deltaUV1)) * r);
-			XMStoreFloat3(&vertices[i0].tangent, tangent);
-			XMStoreFloat3(&vertices[i1].tangent, tangent);
-			XMStoreFloat3(&vertices[i2].tangent, tangent);
-		}
+		const size_t triCount = indices.size() / 3;
+		const size_t vertexCount = vertices.size();
+		if(triCount == 0 || vertexCount == 0)
+			return;
+
+		//per face tangent frame and per corner angle, 4 triangles per batch
+		std::vector<XMFLOAT3> faceTangents(triCount);
+		std::vector<XMFLOAT3> faceBitangents(triCount);
+		std::vector<float> cornerAngles(triCount * 3);
+
+		const size_t batchCount = (triCount + 3) / 4;
+		parallelFor(size_t(0), batchCount, [&](size_t batch)
+		{
+			float px[3][4], py[3][4], pz[3][4], u[3][4], v[3][4];
+			for(int lane = 0; lane < 4; ++lane)
+			{
+				//tail batches repeat the last triangle, the extra lanes are never stored
+				size_t tri = std::min<size_t>(batch * 4 + lane, triCount - 1);
+				for(int c = 0; c < 3; ++c)
+				{
+					const Vertex& vert = vertices[indices[tri * 3 + c]];
+					px[c][lane] = vert.position.x;
+					py[c][lane] = vert.position.y;
+					pz[c][lane] = vert.position.z;
+					u[c][lane] = vert.uvs.x;
+					v[c][lane] = vert.uvs.y;
+				}
+			}
+
+			XMVECTOR x[3], y[3], z[3];
+			for(int c = 0; c < 3; ++c)
+			{
+				x[c] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(px[c]));
+				y[c] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(py[c]));
+				z[c] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pz[c]));
+			}
+
+			XMVECTOR e1x = x[1] - x[0], e1y = y[1] - y[0], e1z = z[1] - z[0];
+			XMVECTOR e2x = x[2] - x[0], e2y = y[2] - y[0], e2z = z[2] - z[0];
+			XMVECTOR du1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(u[1])) - XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(u[0]));
+			XMVECTOR dv1 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(v[1])) - XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(v[0]));
+			XMVECTOR du2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(u[2])) - XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(u[0]));
+			XMVECTOR dv2 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(v[2])) - XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(v[0]));
+
+			//degenerate uv mappings contribute nothing instead of infinities
+			XMVECTOR det = du1 * dv2 - du2 * dv1;
+			XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), XMVectorReplicate(1e-12F));
+			XMVECTOR r = XMVectorSelect(XMVectorZero(), XMVectorReciprocal(det), valid);
+
+			XMVECTOR tx = (e1x * dv2 - e2x * dv1) * r, ty = (e1y * dv2 - e2y * dv1) * r, tz = (e1z * dv2 - e2z * dv1) * r;
+			XMVECTOR bx = (e2x * du1 - e1x * du2) * r, by = (e2y * du1 - e1y * du2) * r, bz = (e2z * du1 - e1z * du2) * r;
+
+			//corner angles, used as accumulation weights
+			XMVECTOR angles[3];
+			for(int c = 0; c < 3; ++c)
+			{
+				int n = (c + 1) % 3;
+				int p = (c + 2) % 3;
+				XMVECTOR ax = x[n] - x[c], ay = y[n] - y[c], az = z[n] - z[c];
+				XMVECTOR bx2 = x[p] - x[c], by2 = y[p] - y[c], bz2 = z[p] - z[c];
+
+				XMVECTOR dotAB = ax * bx2 + ay * by2 + az * bz2;
+				XMVECTOR lenSq = (ax * ax + ay * ay + az * az) * (bx2 * bx2 + by2 * by2 + bz2 * bz2);
+				XMVECTOR cosA = XMVectorSelect(XMVectorZero(), dotAB * XMVectorReciprocalSqrt(lenSq), XMVectorGreater(lenSq, XMVectorZero()));
+				angles[c] = XMVectorACos(XMVectorClamp(cosA, XMVectorReplicate(-1.0F), XMVectorReplicate(1.0F)));
+			}
+
+			XMFLOAT4 ftx, fty, ftz, fbx, fby, fbz, fa[3];
+			XMStoreFloat4(&ftx, tx); XMStoreFloat4(&fty, ty); XMStoreFloat4(&ftz, tz);
+			XMStoreFloat4(&fbx, bx); XMStoreFloat4(&fby, by); XMStoreFloat4(&fbz, bz);
+			for(int c = 0; c < 3; ++c)
+				XMStoreFloat4(&fa[c], angles[c]);
+
+			size_t lanes = std::min<size_t>(4, triCount - batch * 4);
+			for(size_t lane = 0; lane < lanes; ++lane)
+			{
+				size_t tri = batch * 4 + lane;
+				faceTangents[tri] = { (&ftx.x)[lane], (&fty.x)[lane], (&ftz.x)[lane] };
+				faceBitangents[tri] = { (&fbx.x)[lane], (&fby.x)[lane], (&fbz.x)[lane] };
+				for(int c = 0; c < 3; ++c)
+					cornerAngles[tri * 3 + c] = (&fa[c].x)[lane];
+			}
+		});
+
+		//vertex to corner adjacency, so each vertex gathers its own corners without atomics
+		std::vector<UINT32> cornerOffsets(vertexCount + 1, 0);
+		for(size_t i = 0; i < triCount * 3; ++i)
+			cornerOffsets[indices[i] + 1]++;
+		for(size_t i = 0; i < vertexCount; ++i)
+			cornerOffsets[i + 1] += cornerOffsets[i];
+
+		std::vector<UINT32> corners(triCount * 3);
+		std::vector<UINT32> cursor(cornerOffsets.begin(), cornerOffsets.end() - 1);
+		for(size_t i = 0; i < triCount * 3; ++i)
+			corners[cursor[indices[i]]++] = (UINT32) i;
+
+		//each partition owns a contiguous range of vertices
+		const size_t partitionSize = 4096;
+		const size_t partitionCount = (vertexCount + partitionSize - 1) / partitionSize;
+		parallelFor(size_t(0), partitionCount, [&](size_t partition)
+		{
+			size_t first = partition * partitionSize;
+			size_t last = std::min<size_t>(first + partitionSize, vertexCount);
+			for(size_t i = first; i < last; ++i)
+			{
+				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&vertices[i].normal));
+				XMVECTOR tSum = XMVectorZero();
+				XMVECTOR bSum = XMVectorZero();
+
+				for(UINT32 k = cornerOffsets[i]; k < cornerOffsets[i + 1]; ++k)
+				{
+					UINT32 corner = corners[k];
+					XMVECTOR w = XMVectorReplicate(cornerAngles[corner]);
+					XMVECTOR t = XMLoadFloat3(&faceTangents[corner / 3]);
+					XMVECTOR b = XMLoadFloat3(&faceBitangents[corner / 3]);
+
+					//project onto the vertex tangent plane before weighting
+					t = XMVector3Normalize(t - n * XMVector3Dot(n, t));
+					b = XMVector3Normalize(b - n * XMVector3Dot(n, b));
+					tSum += t * w;
+					bSum += b * w;
+				}
+
+				//gram-schmidt
+				XMVECTOR t = tSum - n * XMVector3Dot(n, tSum);
+				if(XMVectorGetX(XMVector3LengthSq(t)) < 1e-12F)
+				{
+					XMVECTOR axis = fabsf(XMVectorGetX(n)) < 0.9F ? XMVectorSet(1.0F, 0.0F, 0.0F, 0.0F) : XMVectorSet(0.0F, 1.0F, 0.0F, 0.0F);
+					t = XMVector3Cross(axis, n);
+				}
+				t = XMVector3Normalize(t);
+				float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(n, t), bSum)) < 0.0F ? -1.0F : 1.0F;
+				XMStoreFloat4(&vertices[i].tangent, XMVectorSetW(t, handedness));
+			}
+		});
 	}
 
-	ModelLoader::MeshData ModelLoader::loadOBJ(std::string filePath)
+	static void loadModel(const std::string& filePath, tinygltf::Model& model)
 	{
-		MeshData meshData;
-
-		tinygltf::Model model;
 		tinygltf::TinyGLTF loader;
 		std::string err, warn;
 
@@ -53,90 +161,421 @@ namespace RT
 			throw Win32Exception("Failed to load gltf file " + filePath);
 		if(!warn.empty())
 			Logger::WARN.log(warn);
+	}
 
-		for(const auto& mesh:model.meshes)
+	static XMFLOAT4 readVec4(const tinygltf::Model& model, const tinygltf::Accessor& accessor, size_t i, bool normalized)
+	{
+		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+		const unsigned char* data = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset + i * accessor.ByteStride(view);
+
+		float v[4] = { 0.0F, 0.0F, 0.0F, 0.0F };
+		int components = std::min<int>(tinygltf::GetNumComponentsInType(accessor.type), 4);
+		for(int c = 0; c < components; ++c)
+		{
+			if(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+				v[c] = reinterpret_cast<const float*>(data)[c];
+			else if(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+				v[c] = reinterpret_cast<const uint8_t*>(data)[c] / (normalized ? 255.0F : 1.0F);
+			else if(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+				v[c] = reinterpret_cast<const uint16_t*>(data)[c] / (normalized ? 65535.0F : 1.0F);
+		}
+
+		return { v[0], v[1], v[2], v[3] };
+	}
+
+	static BoneWeights packBoneWeights(const XMFLOAT4& joints, const XMFLOAT4& weights)
+	{
+		const float* j = &joints.x;
+		const float* w = &weights.x;
+
+		//influences past the palette size are dropped and the rest renormalized
+		float kept[4];
+		float sum = 0.0F;
+		for(int k = 0; k < 4; ++k)
+		{
+			kept[k] = j[k] < MAX_BONE_MATRICES ? std::max<float>(w[k], 0.0F) : 0.0F;
+			sum += kept[k];
+		}
+
+		BoneWeights bone;
+		if(sum <= 0.0F)
+			return bone;
+
+		int largest = 0;
+		UINT32 total = 0;
+		for(int k = 0; k < 4; ++k)
+		{
+			bone.joints[k] = kept[k] > 0.0F ? (UINT8) j[k] : 0;
+			bone.weights[k] = (UINT16) (kept[k] / sum * 65535.0F + 0.5F);
+			total += bone.weights[k];
+			if(kept[k] > kept[largest])
+				largest = k;
+		}
+
+		//rounding leftovers go to the strongest influence so weights sum to one exactly
+		bone.weights[largest] = (UINT16) ((INT32) bone.weights[largest] + 65535 - (INT32) total);
+		return bone;
+	}
+
+	//all primitives of the mesh, or only the one given
+	static void appendMesh(const tinygltf::Model& model, const tinygltf::Mesh& mesh, ModelLoader::MeshData& meshData, int only = -1)
+	{
+		for(int p = 0; p < (int) mesh.primitives.size(); ++p)
 		{
-			for(const auto& primitive:mesh.primitives)
+			if(only >= 0 && p != only)
+				continue;
+			const tinygltf::Primitive& primitive = mesh.primitives[p];
+
+			//extract data
+			const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
+			const tinygltf::BufferView& posView = model.bufferViews[posAccessor.bufferView];
+			const tinygltf::Buffer& posBuffer = model.buffers[posView.buffer];
+
+			const tinygltf::Accessor& normAccessor = model.accessors[primitive.attributes.at("NORMAL")];
+			const tinygltf::BufferView& normView = model.bufferViews[normAccessor.bufferView];
+			const tinygltf::Buffer& normBuffer = model.buffers[normView.buffer];
+
+			const tinygltf::Accessor& uvAccessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
+			const tinygltf::BufferView& uvView = model.bufferViews[uvAccessor.bufferView];
+			const tinygltf::Buffer& uvBuffer = model.buffers[uvView.buffer];
+
+			bool hasTangents = primitive.attributes.find("TANGENT") != primitive.attributes.end();
+			const tinygltf::Accessor* tanAccessor = hasTangents ? &model.accessors[primitive.attributes.at("TANGENT")] : nullptr;
+			const tinygltf::BufferView* tanView = hasTangents ? &model.bufferViews[tanAccessor->bufferView] : nullptr;
+			const tinygltf::Buffer* tanBuffer = hasTangents ? &model.buffers[tanView->buffer] : nullptr;
+
+			bool hasBoneWeights = primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end();
+			bool hasBoneIndices = primitive.attributes.find("JOINTS_0") != primitive.attributes.end();
+			const tinygltf::Accessor* boneWeightsAccessor = hasBoneWeights ? &model.accessors[primitive.attributes.at("WEIGHTS_0")] : nullptr;
+			const tinygltf::Accessor* boneIndicesAccessor = hasBoneIndices ? &model.accessors[primitive.attributes.at("JOINTS_0")] : nullptr;
+
+
+			std::vector<Vertex> vertices;
+			std::vector<UINT32> indices;
+
+			size_t vertexCount = posAccessor.count;
+			vertices.reserve(vertexCount);
+			for(size_t i = 0; i < vertexCount; ++i)
 			{
-				//extract data
-				const tinygltf::Accessor& posAccessor = model.accessors[primitive.attributes.at("POSITION")];
-				const tinygltf::BufferView& posView = model.bufferViews[posAccessor.bufferView];
-				const tinygltf::Buffer& posBuffer = model.buffers[posView.buffer];
-
-				const tinygltf::Accessor& normAccessor = model.accessors[primitive.attributes.at("NORMAL")];
-				const tinygltf::BufferView& normView = model.bufferViews[normAccessor.bufferView];
-				const tinygltf::Buffer& normBuffer = model.buffers[normView.buffer];
-
-				const tinygltf::Accessor& uvAccessor = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-				const tinygltf::BufferView& uvView = model.bufferViews[uvAccessor.bufferView];
-				const tinygltf::Buffer& uvBuffer = model.buffers[uvView.buffer];
-
-				const tinygltf::Accessor& tanAccessor = model.accessors[primitive.attributes.at("TANGENT")];
-				const tinygltf::BufferView& tanView = model.bufferViews[tanAccessor.bufferView];
-				const tinygltf::Buffer& tanBuffer = model.buffers[tanView.buffer];
-
-				bool hasBoneWeights = primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end();
-				bool hasBoneIndices = primitive.attributes.find("JOINTS_0") != primitive.attributes.end();
-				const tinygltf::Accessor* boneWeightsAccessor = hasBoneWeights ? &model.accessors[primitive.attributes.at("WEIGHTS_0")] : nullptr;
-				const tinygltf::Accessor* boneIndicesAccessor = hasBoneIndices ? &model.accessors[primitive.attributes.at("JOINTS_0")] : nullptr;
-
-				const tinygltf::BufferView* boneWeightView = hasBoneWeights ? &model.bufferViews[boneWeightsAccessor->bufferView] : nullptr;
-				const tinygltf::BufferView* boneIndicesView = hasBoneIndices ? &model.bufferViews[boneIndicesAccessor->bufferView] : nullptr;
-				const tinygltf::Buffer* boneWeightBuffer = hasBoneWeights ? &model.buffers[boneWeightView->buffer] : nullptr;
-				const tinygltf::Buffer* boneIndicesBuffer = hasBoneIndices ? &model.buffers[boneIndicesView->buffer] : nullptr;
-
-				size_t vertexCount = posAccessor.count;
-				for(size_t i = 0; i < vertexCount; ++i)
+				Vertex v = {};
+
+				//positions
+				const float* pos = reinterpret_cast<const float*>(posBuffer.data.data() + posView.byteOffset + posAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT3));
+				v.position = { pos[0], pos[1], pos[2] };
+
+				//normals
+				const float* normal = reinterpret_cast<const float*>(normBuffer.data.data() + normView.byteOffset + normAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT3));
+				v.normal = { normal[0], normal[1], normal[2] };
+
+				//uvs
+				const float* uv = reinterpret_cast<const float*>(uvBuffer.data.data() + uvView.byteOffset + uvAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT2));
+				v.uvs = { uv[0], uv[1] };
+
+				//tangents (vec4, w is the handedness)
+				if(hasTangents)
 				{
-					Vertex v = {};
+					const float* tangent = reinterpret_cast<const float*>(tanBuffer->data.data() + tanView->byteOffset + tanAccessor->byteOffset + i * tanAccessor->ByteStride(*tanView));
+					v.tangent = { tangent[0], tangent[1], tangent[2], tangent[3] };
+				}
+
+				vertices.push_back(v);
+			}
 
-					//positions
-					const float* pos = reinterpret_cast<const float*>(posBuffer.data.data() + posView.byteOffset + posAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT3));
-					v.position = { pos[0], pos[1], pos[2] };
+			//indices
+			const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+			const tinygltf::BufferView& indexView = model.bufferViews[indexAccessor.bufferView];
+			const tinygltf::Buffer& indexBuffer = model.buffers[indexView.buffer];
 
-					//normals
-					const float* normal = reinterpret_cast<const float*>(normBuffer.data.data() + normView.byteOffset + normAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT3));
-					v.normal = { normal[0], normal[1], normal[2] };
+			size_t indexCount = indexAccessor.count;
+			for(size_t i = 0; i < indexCount; ++i)
+			{
+				uint32_t index;
+				if(indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+					index = *(reinterpret_cast<const uint16_t*>(indexBuffer.data.data() + indexView.byteOffset + indexAccessor.byteOffset + i * sizeof(uint16_t)));
+				else if(indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+					index = *(reinterpret_cast<const uint32_t*>(indexBuffer.data.data() + indexView.byteOffset + indexAccessor.byteOffset + i * sizeof(uint32_t)));
+				indices.push_back(index);
+			}
 
-					//uvs
-					const float* uv = reinterpret_cast<const float*>(uvBuffer.data.data() + uvView.byteOffset + uvAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT2));
-					v.uvs = { uv[0], uv[1] };
+			if(!hasTangents)
+				ModelLoader::calcTangents(indices, vertices);
 
-					//tangents
-					const float* tangent = reinterpret_cast<const float*>(tanBuffer.data.data() + tanView.byteOffset + tanAccessor.byteOffset + i * sizeof(DirectX::XMFLOAT3));
-					v.tangent = { tangent[0], tangent[1], tangent[2] };
+			//primitives share one vertex buffer, so rebase their indices
+			UINT32 baseVertex = (UINT32) meshData.vertices.size();
+			for(auto& index:indices)
+				index += baseVertex;
 
-					meshData.vertices.push_back(v);
+			//bone stream, unskinned primitives of a skinned mesh keep empty weights
+			if(hasBoneWeights && hasBoneIndices)
+			{
+				meshData.bones.resize(baseVertex);
+				for(size_t i = 0; i < vertexCount; ++i)
+				{
+					XMFLOAT4 joints = readVec4(model, *boneIndicesAccessor, i, false);
+					XMFLOAT4 weights = readVec4(model, *boneWeightsAccessor, i, true);
+					meshData.bones.push_back(packBoneWeights(joints, weights));
 				}
+			}
+			else if(!meshData.bones.empty())
+				meshData.bones.resize(baseVertex + vertexCount);
+
+			meshData.vertices.insert(meshData.vertices.end(), vertices.begin(), vertices.end());
+			meshData.indices32.insert(meshData.indices32.end(), indices.begin(), indices.end());
+		}
+	}
+
+	//the factors of the metallic roughness model, texture maps are left to the scene's own lists
+	static Material toMaterial(const tinygltf::Material& material)
+	{
+		const auto& pbr = material.pbrMetallicRoughness;
+		Material mat;
+		mat.name = material.name;
+		mat.DiffuseAlbedo = { (float) pbr.baseColorFactor[0], (float) pbr.baseColorFactor[1], (float) pbr.baseColorFactor[2],
+							  material.alphaMode == "BLEND" ? (float) pbr.baseColorFactor[3] : 1.0F };
+		mat.Roughness = (float) pbr.roughnessFactor;
+		mat.metallic = (float) pbr.metallicFactor;
+
+		//dielectrics reflect 4% head on, metals their base color
+		XMVECTOR base = XMVectorSet(mat.DiffuseAlbedo.x, mat.DiffuseAlbedo.y, mat.DiffuseAlbedo.z, 0.0F);
+		XMStoreFloat3(&mat.FresnelR0, XMVectorLerp(XMVectorReplicate(0.04F), base, mat.metallic));
+		if(material.emissiveFactor.size() == 3)
+			mat.emission = { (float) material.emissiveFactor[0], (float) material.emissiveFactor[1], (float) material.emissiveFactor[2] };
+		return mat;
+	}
+
+	static XMMATRIX nodeLocalMatrix(const tinygltf::Node& node)
+	{
+		//gltf stores column major matrices for column vectors, which is the row major layout directx expects
+		if(node.matrix.size() == 16)
+		{
+			XMFLOAT4X4 m;
+			for(int i = 0; i < 16; ++i)
+				m.m[i / 4][i % 4] = (float) node.matrix[i];
+			return XMLoadFloat4x4(&m);
+		}
+
+		XMMATRIX S = XMMatrixIdentity();
+		XMMATRIX R = XMMatrixIdentity();
+		XMMATRIX T = XMMatrixIdentity();
+		if(node.scale.size() == 3)
+			S = XMMatrixScaling((float) node.scale[0], (float) node.scale[1], (float) node.scale[2]);
+		if(node.rotation.size() == 4)
+			R = XMMatrixRotationQuaternion(XMVectorSet((float) node.rotation[0], (float) node.rotation[1], (float) node.rotation[2], (float) node.rotation[3]));
+		if(node.translation.size() == 3)
+			T = XMMatrixTranslation((float) node.translation[0], (float) node.translation[1], (float) node.translation[2]);
+		return S * R * T;
+	}
+
+	static std::shared_ptr<Skeleton> loadSkeleton(const tinygltf::Model& model, const tinygltf::Skin& skin, const std::string& filePath)
+	{
+		auto skeleton = std::make_shared<Skeleton>();
+
+		//rest pose of every node, joints may be parented to plain nodes
+		skeleton->nodes.resize(model.nodes.size());
+		for(size_t i = 0; i < model.nodes.size(); ++i)
+		{
+			const tinygltf::Node& node = model.nodes[i];
+			SkeletonNode& joint = skeleton->nodes[i];
+
+			if(node.matrix.size() == 16)
+			{
+				XMVECTOR scale, rotation, translation;
+				XMMatrixDecompose(&scale, &rotation, &translation, nodeLocalMatrix(node));
+				XMStoreFloat3(&joint.scale, scale);
+				XMStoreFloat4(&joint.rotation, rotation);
+				XMStoreFloat3(&joint.translation, translation);
+			}
+			else
+			{
+				if(node.translation.size() == 3)
+					joint.translation = { (float) node.translation[0], (float) node.translation[1], (float) node.translation[2] };
+				if(node.rotation.size() == 4)
+					joint.rotation = { (float) node.rotation[0], (float) node.rotation[1], (float) node.rotation[2], (float) node.rotation[3] };
+				if(node.scale.size() == 3)
+					joint.scale = { (float) node.scale[0], (float) node.scale[1], (float) node.scale[2] };
+			}
+
+			for(int child:node.children)
+				skeleton->nodes[child].parent = (INT32) i;
+		}
+
+		std::queue<UINT32> queue;
+		for(UINT32 i = 0; i < (UINT32) skeleton->nodes.size(); ++i)
+			if(skeleton->nodes[i].parent < 0)
+				queue.push(i);
+		while(!queue.empty())
+		{
+			UINT32 n = queue.front();
+			queue.pop();
+			skeleton->order.push_back(n);
+			for(int child:model.nodes[n].children)
+				queue.push((UINT32) child);
+		}
+
+		size_t jointCount = skin.joints.size();
+		if(jointCount > MAX_BONE_MATRICES)
+		{
+			Logger::WARN.log("Skin of " + filePath + " has " + std::to_string(jointCount) + " joints, only the first " + std::to_string(MAX_BONE_MATRICES) + " are used");
+			jointCount = MAX_BONE_MATRICES;
+		}
+
+		for(size_t j = 0; j < jointCount; ++j)
+		{
+			skeleton->joints.push_back((UINT32) skin.joints[j]);
+
+			//column major for column vectors reads directly as row major for row vectors
+			XMFLOAT4X4 inverseBind = Identity4x4();
+			if(skin.inverseBindMatrices >= 0)
+			{
+				const tinygltf::Accessor& accessor = model.accessors[skin.inverseBindMatrices];
+				const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+				const float* m = reinterpret_cast<const float*>(model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset + j * sizeof(XMFLOAT4X4));
+				memcpy(inverseBind.m, m, sizeof(XMFLOAT4X4));
+			}
+			skeleton->inverseBind.push_back(inverseBind);
+		}
 
-				//indices
-				const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
-				const tinygltf::BufferView& indexView = model.bufferViews[indexAccessor.bufferView];
-				const tinygltf::Buffer& indexBuffer = model.buffers[indexView.buffer];
+		//clips, morph target weights are not supported
+		for(const auto& animation:model.animations)
+		{
+			AnimationClip clip;
+			clip.name = animation.name;
 
-				size_t indexCount = indexAccessor.count;
-				for(size_t i = 0; i < indexCount; ++i)
+			for(const auto& channel:animation.channels)
+			{
+				AnimationChannel c;
+				if(channel.target_node < 0)
+					continue;
+				else if(channel.target_path == "translation")
+					c.path = ANIMATION_PATH_TRANSLATION;
+				else if(channel.target_path == "rotation")
+					c.path = ANIMATION_PATH_ROTATION;
+				else if(channel.target_path == "scale")
+					c.path = ANIMATION_PATH_SCALE;
+				else
+					continue;
+
+				const tinygltf::AnimationSampler& sampler = animation.samplers[channel.sampler];
+				c.node = (UINT32) channel.target_node;
+				c.step = sampler.interpolation == "STEP";
+
+				const tinygltf::Accessor& input = model.accessors[sampler.input];
+				for(size_t i = 0; i < input.count; ++i)
+					c.times.push_back(readVec4(model, input, i, true).x);
+
+				//cubic spline keys are (in tangent, value, out tangent), only the values are kept
+				const tinygltf::Accessor& output = model.accessors[sampler.output];
+				bool cubic = sampler.interpolation == "CUBICSPLINE";
+				for(size_t i = 0; i < input.count; ++i)
 				{
-					uint32_t index;
-					if(indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-						index = *(reinterpret_cast<const uint16_t*>(indexBuffer.data.data() + indexView.byteOffset + indexAccessor.byteOffset + i * sizeof(uint16_t)));
-					else if(indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-						index = *(reinterpret_cast<const uint32_t*>(indexBuffer.data.data() + indexView.byteOffset + indexAccessor.byteOffset + i * sizeof(uint32_t)));
-					meshData.indices32.push_back(index);
+					XMFLOAT4 value = readVec4(model, output, cubic ? i * 3 + 1 : i, true);
+					if(c.path != ANIMATION_PATH_ROTATION)
+						value.w = 0.0F;
+					c.values.push_back(value);
 				}
+
+				if(!c.times.empty())
+					clip.duration = std::max<float>(clip.duration, c.times.back());
+				clip.channels.push_back(std::move(c));
 			}
+
+			skeleton->clips.push_back(std::move(clip));
 		}
 
-		int skinIndex = -1;
-		for(const auto& node:model.nodes)
+		return skeleton;
+	}
+
+	ModelLoader::MeshData ModelLoader::loadOBJ(std::string filePath)
+	{
+		MeshData meshData;
+
+		tinygltf::Model model;
+		loadModel(filePath, model);
+
+		for(const auto& mesh:model.meshes)
+			appendMesh(model, mesh, meshData);
+
+		if(!meshData.bones.empty())
 		{
-			if(node.skin >= 0)
+			meshData.bones.resize(meshData.vertices.size());
+			if(!model.skins.empty())
+				meshData.skeleton = loadSkeleton(model, model.skins[0], filePath);
+			else
+				meshData.bones.clear();
+		}
+
+		return meshData;
+	}
+
+	ModelLoader::SceneData ModelLoader::loadScene(std::string filePath)
+	{
+		SceneData sceneData;
+
+		tinygltf::Model model;
+		loadModel(filePath, model);
+
+		for(size_t i = 0; i < model.materials.size(); ++i)
+		{
+			sceneData.materials.push_back(toMaterial(model.materials[i]));
+			if(sceneData.materials.back().name.empty())
+				sceneData.materials.back().name = std::to_string(i);
+		}
+
+		//one geometry per primitive of every unique mesh
+		std::vector<UINT32> firstPart(model.meshes.size() + 1, 0);
+		for(size_t i = 0; i < model.meshes.size(); ++i)
+		{
+			const tinygltf::Mesh& mesh = model.meshes[i];
+			std::string name = mesh.name.empty() ? std::to_string(i) : mesh.name;
+			firstPart[i] = (UINT32) sceneData.meshes.size();
+			for(size_t p = 0; p < mesh.primitives.size(); ++p)
 			{
-				skinIndex = node.skin;
-				break;
+				sceneData.meshes.emplace_back();
+				appendMesh(model, mesh, sceneData.meshes.back(), (int) p);
+				sceneData.meshNames.push_back(mesh.primitives.size() > 1 ? name + "." + std::to_string(p) : name);
+				int material = mesh.primitives[p].material;
+				sceneData.meshMaterials.push_back(material >= 0 && material < (int) sceneData.materials.size() ? material : -1);
 			}
 		}
+		firstPart[model.meshes.size()] = (UINT32) sceneData.meshes.size();
 
-		return meshData;
+		std::vector<int> roots;
+		if(!model.scenes.empty())
+			roots = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0].nodes;
+		else
+		{
+			//no scene, every node that is nobody's child is a root
+			std::vector<bool> isChild(model.nodes.size(), false);
+			for(const auto& node:model.nodes)
+				for(int child:node.children)
+					isChild[child] = true;
+			for(int i = 0; i < (int) model.nodes.size(); ++i)
+				if(!isChild[i])
+					roots.push_back(i);
+		}
+
+		//one instance per part of the mesh a node references, with the world transform of the hierarchy
+		std::vector<std::pair<int, XMFLOAT4X4>> stack;
+		for(int root:roots)
+			stack.push_back({ root, Identity4x4() });
+
+		while(!stack.empty())
+		{
+			auto [nodeIndex, parent] = stack.back();
+			stack.pop_back();
+
+			const tinygltf::Node& node = model.nodes[nodeIndex];
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, nodeLocalMatrix(node) * XMLoadFloat4x4(&parent));
+
+			if(node.mesh >= 0)
+				for(UINT32 part = firstPart[node.mesh]; part < firstPart[node.mesh + 1]; ++part)
+					sceneData.instances.push_back({ part, world });
+
+			for(int child:node.children)
+				stack.push_back({ child, world });
+		}
+
+		return sceneData;
 	}
 };
\ No newline at end of file
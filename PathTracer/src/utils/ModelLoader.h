@@ -1,6 +1,7 @@
 #pragma once
 
-#include "header.h"
+#include "core.h"
+#include "Skinning.h"
 
 namespace RT
 {
@@ -11,6 +12,8 @@ namespace RT
 		{
 			std::vector<Vertex> vertices;
 			std::vector<UINT32> indices32;
+			std::vector<BoneWeights> bones;
+			std::shared_ptr<Skeleton> skeleton = nullptr;
 
 			std::vector<UINT16>& getIndices16()
 			{
@@ -27,7 +30,25 @@ namespace RT
 			std::vector<UINT16> mIndices16;
 		};
 
+		struct NodeInstance
+		{
+			UINT32 mesh;
+			DirectX::XMFLOAT4X4 world;
+		};
+
+		//meshes are split per primitive so every part keeps its own material, instances reference the parts
+		struct SceneData
+		{
+			std::vector<std::string> meshNames;
+			std::vector<MeshData> meshes;
+			std::vector<INT32> meshMaterials; //-1 for parts without a material
+			std::vector<Material> materials;
+			std::vector<NodeInstance> instances;
+		};
+
 		static MeshData loadOBJ(std::string);
+		static SceneData loadScene(std::string);
+		//angle weighted per vertex tangents with the handedness in w
 		static void calcTangents(const std::vector<UINT32>& indices, std::vector<Vertex>& vertices);
 	private:
 		ModelLoader() = default;
@@ -0,0 +1,120 @@
+#include "Parallel.h"
+
+namespace RT
+{
+	ThreadPool& ThreadPool::get()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	ThreadPool::ThreadPool()
+	{
+		//the caller of run is the last worker
+		unsigned threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+		for(unsigned i = 1; i < threads; ++i)
+			mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+		}
+		mWake.notify_all();
+		for(auto& w:mWorkers)
+			w.join();
+	}
+
+	void ThreadPool::run(size_t count, const std::function<void(size_t)>& fn)
+	{
+		if(count == 0)
+			return;
+
+		//a single item or no workers, nothing to hand out
+		if(count == 1 || mWorkers.empty())
+		{
+			for(size_t i = 0; i < count; ++i)
+				fn(i);
+			return;
+		}
+
+		auto job = std::make_shared<Job>();
+		job->fn = &fn;
+		job->count = count;
+		job->grain = std::max<size_t>(count / (getThreadCount() * 4), 1);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mJobs.push_back(job);
+		}
+		mWake.notify_all();
+
+		work(*job);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mJobs.erase(std::remove(mJobs.begin(), mJobs.end(), job), mJobs.end());
+		mFinished.wait(lock, [&] { return job->done == job->count; });
+		if(job->error)
+			std::rethrow_exception(job->error);
+	}
+
+	void ThreadPool::work(Job& job)
+	{
+		while(true)
+		{
+			size_t first = job.next.fetch_add(job.grain);
+			if(first >= job.count)
+				return;
+
+			size_t last = std::min<size_t>(first + job.grain, job.count);
+			for(size_t i = first; i < last; ++i)
+			{
+				try
+				{
+					(*job.fn)(i);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+					if(!job.error)
+						job.error = std::current_exception();
+				}
+			}
+
+			if(job.done.fetch_add(last - first) + (last - first) == job.count)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mFinished.notify_all();
+			}
+		}
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		while(true)
+		{
+			//newest job first, nested calls finish before the work that is waiting on them
+			std::shared_ptr<Job> job;
+			mWake.wait(lock, [&]
+			{
+				for(auto it = mJobs.rbegin(); it != mJobs.rend(); ++it)
+				{
+					if((*it)->next < (*it)->count)
+					{
+						job = *it;
+						return true;
+					}
+				}
+				return mStop;
+			});
+			if(!job)
+				return;
+
+			lock.unlock();
+			work(*job);
+			lock.lock();
+		}
+	}
+}
\ No newline at end of file
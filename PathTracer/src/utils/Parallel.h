@@ -0,0 +1,143 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+#define RADIX_SORT_BITS			8
+#define RADIX_SORT_CHUNK_SIZE	16384
+
+namespace RT
+{
+	//persistent workers behind parallelFor, the thread that submits a job works on it too so nested calls cannot deadlock
+	class ThreadPool
+	{
+	public:
+		static ThreadPool& get();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//calls fn(i) for every i in [0, count) and returns once all of them finished, the first exception is rethrown here
+		void run(size_t count, const std::function<void(size_t)>& fn);
+
+		inline size_t getThreadCount() const { return mWorkers.size() + 1; }
+	private:
+		struct Job
+		{
+			const std::function<void(size_t)>* fn = nullptr;
+			size_t count = 0;
+			size_t grain = 1;
+			std::atomic<size_t> next = 0;
+			std::atomic<size_t> done = 0;
+			std::exception_ptr error = nullptr;
+		};
+
+		ThreadPool();
+		~ThreadPool();
+
+		void work(Job& job);
+		void workerLoop();
+
+		std::vector<std::thread> mWorkers;
+		std::vector<std::shared_ptr<Job>> mJobs;
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::condition_variable mFinished;
+		bool mStop = false;
+	};
+
+	template<typename T, typename F>
+	inline void parallelFor(T first, T last, F&& fn)
+	{
+		if(!(first < last))
+			return;
+
+		std::function<void(size_t)> body = [&](size_t i) { fn((T) (first + (T) i)); };
+		ThreadPool::get().run((size_t) (last - first), body);
+	}
+
+	template<typename A, typename B>
+	inline void parallelInvoke(A&& a, B&& b)
+	{
+		std::function<void(size_t)> body = [&](size_t i) { if(i == 0) a(); else b(); };
+		ThreadPool::get().run(2, body);
+	}
+
+	//stable lsd sort on the integer key of every element, only the digits the largest key uses get a pass.
+	//chunks count their digits and scatter in parallel, a digit major prefix sum in between gives every chunk its own offsets
+	template<typename It, typename Key>
+	inline void radixSort(It begin, It end, Key&& key)
+	{
+		using Value = typename std::iterator_traits<It>::value_type;
+		const size_t buckets = 1 << RADIX_SORT_BITS;
+		size_t n = (size_t) std::distance(begin, end);
+		if(n < 2)
+			return;
+
+		size_t chunkCount = (n + RADIX_SORT_CHUNK_SIZE - 1) / RADIX_SORT_CHUNK_SIZE;
+		std::vector<Value> values(begin, end);
+		std::vector<Value> scratch(n);
+		std::vector<size_t> keys(n);
+		std::vector<size_t> scratchKeys(n);
+		std::vector<size_t> offsets(chunkCount * buckets);
+		parallelFor(size_t(0), n, [&](size_t i) { keys[i] = (size_t) key(values[i]); });
+		size_t maxKey = *std::max_element(keys.begin(), keys.end());
+
+		for(size_t shift = 0; shift < sizeof(size_t) * 8 && (maxKey >> shift) > 0; shift += RADIX_SORT_BITS)
+		{
+			std::fill(offsets.begin(), offsets.end(), 0);
+			parallelFor(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				size_t* histogram = &offsets[chunk * buckets];
+				size_t last = std::min<size_t>((chunk + 1) * RADIX_SORT_CHUNK_SIZE, n);
+				for(size_t i = chunk * RADIX_SORT_CHUNK_SIZE; i < last; ++i)
+					histogram[(keys[i] >> shift) & (buckets - 1)]++;
+			});
+
+			//chunks scatter in order so the sort stays stable
+			size_t sum = 0;
+			bool sameDigit = false;
+			for(size_t d = 0; d < buckets; ++d)
+			{
+				size_t digitStart = sum;
+				for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					size_t& offset = offsets[chunk * buckets + d];
+					size_t count = offset;
+					offset = sum;
+					sum += count;
+				}
+				if(sum - digitStart == n)
+					sameDigit = true;
+			}
+
+			//nothing would move
+			if(sameDigit)
+				continue;
+
+			parallelFor(size_t(0), chunkCount, [&](size_t chunk)
+			{
+				size_t* offset = &offsets[chunk * buckets];
+				size_t last = std::min<size_t>((chunk + 1) * RADIX_SORT_CHUNK_SIZE, n);
+				for(size_t i = chunk * RADIX_SORT_CHUNK_SIZE; i < last; ++i)
+				{
+					size_t o = offset[(keys[i] >> shift) & (buckets - 1)]++;
+					scratch[o] = values[i];
+					scratchKeys[o] = keys[i];
+				}
+			});
+			values.swap(scratch);
+			keys.swap(scratchKeys);
+		}
+
+		std::copy(values.begin(), values.end(), begin);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "Skinning.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace RT
+{
+	void Skinning::evaluate(const Skeleton& skeleton, UINT clip, float time, std::vector<XMFLOAT4X4>& palette)
+	{
+		std::vector<SkeletonNode> pose = skeleton.nodes;
+
+		//sample the clip on top of the rest pose
+		if(clip < skeleton.clips.size())
+		{
+			const AnimationClip& anim = skeleton.clips[clip];
+			float t = anim.duration > 0.0F ? fmodf(time, anim.duration) : 0.0F;
+
+			for(const auto& channel:anim.channels)
+			{
+				if(channel.times.empty())
+					continue;
+
+				size_t k1 = std::upper_bound(channel.times.begin(), channel.times.end(), t) - channel.times.begin();
+				XMVECTOR value;
+				if(k1 == 0)
+					value = XMLoadFloat4(&channel.values.front());
+				else if(k1 == channel.times.size())
+					value = XMLoadFloat4(&channel.values.back());
+				else
+				{
+					size_t k0 = k1 - 1;
+					XMVECTOR v0 = XMLoadFloat4(&channel.values[k0]);
+					XMVECTOR v1 = XMLoadFloat4(&channel.values[k1]);
+					float s = (t - channel.times[k0]) / (channel.times[k1] - channel.times[k0]);
+
+					if(channel.step)
+						value = v0;
+					else if(channel.path == ANIMATION_PATH_ROTATION)
+						value = XMQuaternionSlerp(v0, v1, s);
+					else
+						value = XMVectorLerp(v0, v1, s);
+				}
+
+				SkeletonNode& node = pose[channel.node];
+				if(channel.path == ANIMATION_PATH_TRANSLATION)
+					XMStoreFloat3(&node.translation, value);
+				else if(channel.path == ANIMATION_PATH_ROTATION)
+					XMStoreFloat4(&node.rotation, XMQuaternionNormalize(value));
+				else
+					XMStoreFloat3(&node.scale, value);
+			}
+		}
+
+		//global transforms, parents are always resolved first
+		std::vector<XMFLOAT4X4> global(pose.size());
+		for(UINT32 n:skeleton.order)
+		{
+			const SkeletonNode& node = pose[n];
+			XMMATRIX local = XMMatrixScaling(node.scale.x, node.scale.y, node.scale.z) * XMMatrixRotationQuaternion(XMLoadFloat4(&node.rotation)) *
+							 XMMatrixTranslation(node.translation.x, node.translation.y, node.translation.z);
+			if(node.parent >= 0)
+				local = local * XMLoadFloat4x4(&global[node.parent]);
+			XMStoreFloat4x4(&global[n], local);
+		}
+
+		palette.resize(skeleton.joints.size());
+		for(size_t j = 0; j < skeleton.joints.size(); ++j)
+			XMStoreFloat4x4(&palette[j], XMLoadFloat4x4(&skeleton.inverseBind[j]) * XMLoadFloat4x4(&global[skeleton.joints[j]]));
+	}
+
+	void Skinning::skin(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<XMFLOAT4X4>& palette, Vertex* out)
+	{
+		const size_t vertexCount = bindPose.size();
+		const size_t batchSize = 1024;
+		const XMVECTOR unorm = XMVectorReplicate(1.0F / 65535.0F);
+
+		parallelFor(size_t(0), (vertexCount + batchSize - 1) / batchSize, [&](size_t batch)
+		{
+			size_t first = batch * batchSize;
+			size_t last = std::min<size_t>(first + batchSize, vertexCount);
+			for(size_t i = first; i < last; ++i)
+			{
+				const Vertex& v = bindPose[i];
+				const BoneWeights& b = bones[i];
+
+				//vertices without influences keep the bind pose
+				if((b.weights[0] | b.weights[1] | b.weights[2] | b.weights[3]) == 0)
+				{
+					out[i] = v;
+					continue;
+				}
+
+				//blend the palette rows, one multiply-add per row and influence
+				XMVECTOR r0 = XMVectorZero();
+				XMVECTOR r1 = XMVectorZero();
+				XMVECTOR r2 = XMVectorZero();
+				XMVECTOR r3 = XMVectorZero();
+				for(int k = 0; k < 4; ++k)
+				{
+					if(b.weights[k] == 0)
+						continue;
+
+					XMVECTOR w = XMVectorMultiply(XMVectorReplicate((float) b.weights[k]), unorm);
+					const XMFLOAT4X4& m = palette[b.joints[k]];
+					r0 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m._11)), w, r0);
+					r1 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m._21)), w, r1);
+					r2 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m._31)), w, r2);
+					r3 = XMVectorMultiplyAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m._41)), w, r3);
+				}
+				XMMATRIX M(r0, r1, r2, r3);
+
+				//build the vertex locally, out may be write combined memory
+				Vertex o;
+				XMStoreFloat3(&o.position, XMVector3Transform(XMLoadFloat3(&v.position), M));
+				XMStoreFloat3(&o.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.normal), M)));
+				XMStoreFloat4(&o.tangent, XMVectorSetW(XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat4(&v.tangent), M)), v.tangent.w));
+				o.uvs = v.uvs;
+				out[i] = o;
+			}
+		});
+	}
+
+	void Skinning::skinReference(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<XMFLOAT4X4>& palette, Vertex* out)
+	{
+		auto normalize = [](auto& v)
+		{
+			float len = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+			if(len > 0.0F)
+			{
+				v.x /= len;
+				v.y /= len;
+				v.z /= len;
+			}
+		};
+
+		for(size_t i = 0; i < bindPose.size(); ++i)
+		{
+			const Vertex& v = bindPose[i];
+			const BoneWeights& b = bones[i];
+
+			if((b.weights[0] | b.weights[1] | b.weights[2] | b.weights[3]) == 0)
+			{
+				out[i] = v;
+				continue;
+			}
+
+			//transform by every influence, then blend the results
+			Vertex o = {};
+			o.uvs = v.uvs;
+			o.tangent.w = v.tangent.w;
+			for(int k = 0; k < 4; ++k)
+			{
+				if(b.weights[k] == 0)
+					continue;
+
+				float w = b.weights[k] / 65535.0F;
+				const XMFLOAT4X4& m = palette[b.joints[k]];
+
+				o.position.x += w * (v.position.x * m._11 + v.position.y * m._21 + v.position.z * m._31 + m._41);
+				o.position.y += w * (v.position.x * m._12 + v.position.y * m._22 + v.position.z * m._32 + m._42);
+				o.position.z += w * (v.position.x * m._13 + v.position.y * m._23 + v.position.z * m._33 + m._43);
+
+				o.normal.x += w * (v.normal.x * m._11 + v.normal.y * m._21 + v.normal.z * m._31);
+				o.normal.y += w * (v.normal.x * m._12 + v.normal.y * m._22 + v.normal.z * m._32);
+				o.normal.z += w * (v.normal.x * m._13 + v.normal.y * m._23 + v.normal.z * m._33);
+
+				o.tangent.x += w * (v.tangent.x * m._11 + v.tangent.y * m._21 + v.tangent.z * m._31);
+				o.tangent.y += w * (v.tangent.x * m._12 + v.tangent.y * m._22 + v.tangent.z * m._32);
+				o.tangent.z += w * (v.tangent.x * m._13 + v.tangent.y * m._23 + v.tangent.z * m._33);
+			}
+
+			normalize(o.normal);
+			normalize(o.tangent);
+			out[i] = o;
+		}
+	}
+
+	float Skinning::validate(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<XMFLOAT4X4>& palette)
+	{
+		std::vector<Vertex> fast(bindPose.size());
+		std::vector<Vertex> reference(bindPose.size());
+		skin(bindPose, bones, palette, fast.data());
+		skinReference(bindPose, bones, palette, reference.data());
+
+		float maxError = 0.0F;
+		for(size_t i = 0; i < bindPose.size(); ++i)
+		{
+			maxError = std::max<float>(maxError, fabsf(fast[i].position.x - reference[i].position.x));
+			maxError = std::max<float>(maxError, fabsf(fast[i].position.y - reference[i].position.y));
+			maxError = std::max<float>(maxError, fabsf(fast[i].position.z - reference[i].position.z));
+		}
+
+		return maxError;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core.h"
+
+namespace RT
+{
+	//compact per vertex skinning stream, kept out of the vertex layout the shaders read
+	struct BoneWeights
+	{
+		UINT8 joints[4] = { 0, 0, 0, 0 };
+		UINT16 weights[4] = { 0, 0, 0, 0 }; //unorm16, normalized to sum 65535
+	};
+
+	enum AnimationPath
+	{
+		ANIMATION_PATH_TRANSLATION = 0,
+		ANIMATION_PATH_ROTATION,
+		ANIMATION_PATH_SCALE
+	};
+
+	struct AnimationChannel
+	{
+		UINT32 node = 0;
+		AnimationPath path = ANIMATION_PATH_TRANSLATION;
+		bool step = false;
+		std::vector<float> times;
+		std::vector<DirectX::XMFLOAT4> values;
+	};
+
+	struct AnimationClip
+	{
+		std::string name;
+		float duration = 0.0F;
+		std::vector<AnimationChannel> channels;
+	};
+
+	struct SkeletonNode
+	{
+		INT32 parent = -1;
+		DirectX::XMFLOAT3 translation = { 0.0F, 0.0F, 0.0F };
+		DirectX::XMFLOAT4 rotation = { 0.0F, 0.0F, 0.0F, 1.0F };
+		DirectX::XMFLOAT3 scale = { 1.0F, 1.0F, 1.0F };
+	};
+
+	struct Skeleton
+	{
+		std::vector<SkeletonNode> nodes;
+		std::vector<UINT32> order; //node indices, parents before children
+		std::vector<UINT32> joints; //node index of each joint
+		std::vector<DirectX::XMFLOAT4X4> inverseBind;
+		std::vector<AnimationClip> clips;
+	};
+
+	class Skinning
+	{
+	public:
+		static void evaluate(const Skeleton& skeleton, UINT clip, float time, std::vector<DirectX::XMFLOAT4X4>& palette);
+		static void skin(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<DirectX::XMFLOAT4X4>& palette, Vertex* out);
+		static void skinReference(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<DirectX::XMFLOAT4X4>& palette, Vertex* out);
+		static float validate(const std::vector<Vertex>& bindPose, const std::vector<BoneWeights>& bones, const std::vector<DirectX::XMFLOAT4X4>& palette);
+	private:
+		Skinning() = default;
+	};
+}
\ No newline at end of file
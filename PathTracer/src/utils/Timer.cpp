@@ -4,17 +4,19 @@ namespace RT
 {
 	Timer::Timer(): mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 	{
-		__int64 countsPerSec;
-		QueryPerformanceFrequency((LARGE_INTEGER*) &countsPerSec);
-		mSecondsPerCount = 1.0 / (double) countsPerSec;
+		mSecondsPerCount = (double) Clock::period::num / (double) Clock::period::den;
+	}
+
+	INT64 Timer::now()
+	{
+		return (INT64) Clock::now().time_since_epoch().count();
 	}
 
 	void Timer::stop()
 	{
 		if(!mStopped)
 		{
-			__int64 currTime;
-			QueryPerformanceCounter((LARGE_INTEGER*) &currTime);
+			INT64 currTime = now();
 
 			mStopTime = currTime;
 			mStopped = true;
@@ -23,8 +25,7 @@ namespace RT
 
 	void Timer::start()
 	{
-		__int64 startTime;
-		QueryPerformanceCounter((LARGE_INTEGER*) &startTime);
+		INT64 startTime = now();
 
 		if(mStopped)
 		{
@@ -51,8 +52,7 @@ namespace RT
 			return;
 		}
 
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*) &currTime);
+		INT64 currTime = now();
 		mCurrTime = currTime;
 
 		mDeltaTime = (mCurrTime - mPrevTime) * mSecondsPerCount;
@@ -66,8 +66,7 @@ namespace RT
 
 	void Timer::reset()
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*) &currTime);
+		INT64 currTime = now();
 
 		mBaseTime = currTime;
 		mPrevTime = currTime;
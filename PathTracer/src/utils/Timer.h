@@ -1,5 +1,7 @@
 #pragma once
-#include "header.h"
+#include "core.h"
+
+#include <chrono>
 
 namespace RT
 {
@@ -16,14 +18,18 @@ namespace RT
 		void stop();
 		void tick();
 	private:
+		using Clock = std::chrono::steady_clock;
+
+		static INT64 now();
+
 		double mSecondsPerCount;
 		double mDeltaTime;
 
-		__int64 mBaseTime;
-		__int64 mPausedTime;
-		__int64 mStopTime;
-		__int64 mPrevTime;
-		__int64 mCurrTime;
+		INT64 mBaseTime;
+		INT64 mPausedTime;
+		INT64 mStopTime;
+		INT64 mPrevTime;
+		INT64 mCurrTime;
 
 		bool mStopped;
 	};
@@ -36,6 +36,12 @@ namespace RT
 			memcpy(&mMappedData[elementIndex * mElementByteSize], &data, sizeof(T));
 		}
 
+		//tightly packed buffers only, constant buffer elements are padded
+		inline void copyData(int firstElement, const T* data, UINT count)
+		{
+			memcpy(&mMappedData[firstElement * mElementByteSize], data, sizeof(T) * count);
+		}
+
 		UINT elementCount = -1;
 	private:
 		Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
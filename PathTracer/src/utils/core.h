@@ -0,0 +1,49 @@
+#pragma once
+
+//everything the scene, the CPU backend and the tests build on, header.h adds D3D12, DLSS and NRD on top
+
+//platform
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <cstdint>
+
+	typedef uint8_t BYTE;
+	typedef int32_t INT;
+	typedef int32_t INT32;
+	typedef int64_t INT64;
+	typedef uint32_t UINT;
+	typedef uint8_t UINT8;
+	typedef uint16_t UINT16;
+	typedef uint32_t UINT32;
+	typedef uint64_t UINT64;
+#endif
+
+//directx math, also on linux through the DirectXMath and DirectX-Headers packages
+#include <dxgiformat.h>
+#include <DirectXPackedVector.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+//standard libraries
+#include <unordered_map>
+#include <stdexcept>
+#include <iostream>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <array>
+#include <list>
+
+//engine libraries
+#include "../logging/Logger.h"
+#include "exceptions.h"
+#include "Parallel.h"
+#include "settings.h"
+#include "utils.h"
+#include "shader_data.h"
\ No newline at end of file
@@ -1,7 +1,12 @@
 #pragma once
 
+#ifdef _WIN32
+	#include <comdef.h>
+#endif
+
 namespace RT
 {
+#ifdef _WIN32
 	class DxException
 	{
 	public:
@@ -22,6 +27,7 @@ namespace RT
 		std::wstring Filename;
 		int LineNumber = -1;
 	};
+#endif
 
 	class Win32Exception: public std::exception
 	{
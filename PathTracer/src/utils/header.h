@@ -4,11 +4,11 @@
 #include <WindowsX.h>
 #include <wrl.h>
 
+//portable part, scene, math and the CPU backend
+#include "core.h"
+
 //directx 12
-#include <DirectXPackedVector.h>
-#include <DirectXCollision.h>
 #include <DirectXColors.h>
-#include <DirectXMath.h>
 #include <initguid.h>
 #include "d3dx12.h"
 
@@ -33,20 +33,9 @@
 #include <NRDDescs.h>
 
 //standard libraries
-#include <unordered_map>
-#include <stdexcept>
-#include <iostream>
 #include <comdef.h>
-#include <cassert>
-#include <fstream>
-#include <sstream>
 #include <codecvt>
-#include <vector>
-#include <memory>
-#include <string>
 #include <locale>
-#include <array>
-#include <ppl.h>
 
 //macros
 #ifndef ThrowIfFailed
@@ -61,9 +50,6 @@
 //engine libraries
 #pragma warning(disable : 4251)
 
-#include "../logging/Logger.h"
 #include "exceptions.h"
-#include "settings.h"
-#include "utils.h"
-#include "shader_data.h"
+#include "d3d_utils.h"
 #include "keys.h"
\ No newline at end of file
@@ -1,6 +1,5 @@
 #pragma once
 
-#define MAX_LIGHTS					128
 #define MAX_BONE_MATRICES			96
 
 #define SUPPORTED_KEYBOARD_KEYS		256
@@ -31,7 +30,16 @@ namespace RT
 	{
 		LIGHT_TYPE_DIRECTIONAL = 0,
 		LIGHT_TYPE_SPOTLIGHT,
-		LIGHT_TYPE_POINTLIGHT
+		LIGHT_TYPE_POINTLIGHT,
+		LIGHT_TYPE_TRIANGLE
+	};
+
+	enum LightSampling
+	{
+		LIGHT_SAMPLING_UNIFORM = 0,
+		LIGHT_SAMPLING_ALIAS,
+		LIGHT_SAMPLING_TREE,
+		LIGHT_SAMPLING_CLUSTERED
 	};
 
 	enum ShadowOptions
@@ -101,6 +109,7 @@ namespace RT
 	{
 		friend class Window;
 		friend class Renderer;
+		friend class CpuPathTracer;
 	public:
 		//video settings
 		UINT32 width = 1280;
@@ -112,6 +121,7 @@ namespace RT
 		TexResolution texResolution = TEX_RESOLUTION_2048_X_2048;
 		UINT8 anisotropic = 16;
 		DLSSMode dlss = DLSS_OFF;
+		LightSampling lightSampling = LIGHT_SAMPLING_TREE;
 
 		//sensitivity
 		float mouseSensitivity = 5.0F;
@@ -126,6 +136,7 @@ namespace RT
 		bool rtRefractions = true;
 		bool rtShadows = true;
 		bool indirect = true;
+		bool geometryDiskCache = false;
 
 		bool texturing = true;
 		bool normalMapping = true;
@@ -134,6 +145,10 @@ namespace RT
 		bool aoMapping = true;
 		bool metallicMapping = true;
 		bool rayReconstruction = false;
+		bool progressive = false; //accumulates while the view is static
+		bool emissiveLights = true; //emissive instances become triangle lights when the scene loads
+		bool environmentSampling = true; //one importance sampled direction towards the cubemap per pixel
+		bool prefilteredReflections = true; //the prefiltered cubemap stands in for reflection rays that are not traced
 
 		//effects
 		bool fxaa = true;
@@ -15,12 +15,21 @@ namespace RT
 		DirectX::XMFLOAT2 pad;
 	};
 
+	//mirrored by Reservoir in raytracing/common.hlsli and restir_spatial.hlsl, one per pixel in the candidate buffers
+	struct Reservoir
+	{
+		UINT32 sampleIndex;
+		float weightSum;
+		float W;
+		UINT32 M;
+	};
+
 	struct Vertex
 	{
 		DirectX::XMFLOAT3 position;
 		DirectX::XMFLOAT3 normal;
 		DirectX::XMFLOAT2 uvs;
-		DirectX::XMFLOAT3 tangent;
+		DirectX::XMFLOAT4 tangent; //w is the handedness, the bitangent is cross(normal, tangent) * w
 	};
 
 	struct PassConstants
@@ -55,7 +64,16 @@ namespace RT
 		DirectX::XMFLOAT2 jitter = { 0, 0 };
 		float fov = 0.0F;
 		float aspectRatio = 1.0F;
-		Light lights[MAX_LIGHTS];
+		UINT lightTreeNodes = 0;
+		UINT directionalLights = 0;
+		UINT lightSampling = 0;
+		float lightsPad = 0.0F;
+		DirectX::XMFLOAT4 clusterDepth = { 0.0F, 0.0F, 0.0F, 0.0F }; //near, far, slices per unit of log depth
+		DirectX::XMFLOAT2 clusterScale = { 0.0F, 0.0F };
+		UINT emissiveLights = 0; //triangle lights at the end of the light list
+		UINT environmentSize = 0; //texels per face side of the sampling tables, 0 without them
+		DirectX::XMFLOAT4 ambientSH[9] = {}; //SphericalHarmonics::ambient of the cubemap
+		UINT prefilteredMips = 0; //mips of the GGX prefiltered cubemap, 0 without it
 	};
 
 	struct ObjectCB
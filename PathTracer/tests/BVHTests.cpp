@@ -0,0 +1,199 @@
+#include "Test.h"
+
+#include "rendering/cpu/BVH.h"
+#include "rendering/cpu/CpuPathTracer.h"
+#include "utils/GeometryGenerator.h"
+#include "utils/Timer.h"
+
+using namespace DirectX;
+using namespace RT;
+
+//every triangle in exactly one leaf, every node bounding its children and the leaves their triangles
+static bool validateTree(const BVH& bvh, const Vertex* vertices, const UINT32* indices, UINT32 triangleCount, std::string& details)
+{
+	const auto& nodes = bvh.getNodes();
+	const auto& primitiveIndices = bvh.getPrimitiveIndices();
+	if(nodes.empty() || primitiveIndices.size() != triangleCount)
+	{
+		details = "wrong primitive count";
+		return false;
+	}
+
+	auto contains = [](const BVHNode& node, const XMFLOAT3& p)
+	{
+		const float e = 1e-4F;
+		return p.x >= node.boundsMin.x - e && p.y >= node.boundsMin.y - e && p.z >= node.boundsMin.z - e &&
+			   p.x <= node.boundsMax.x + e && p.y <= node.boundsMax.y + e && p.z <= node.boundsMax.z + e;
+	};
+
+	std::vector<UINT32> references(triangleCount, 0);
+	UINT32 loose = 0;
+	std::vector<UINT32> stack = { 0 };
+	while(!stack.empty())
+	{
+		UINT32 index = stack.back();
+		stack.pop_back();
+		const BVHNode& node = nodes[index];
+		if(node.count > 0)
+		{
+			for(UINT32 i = node.offset; i < node.offset + node.count; ++i)
+			{
+				UINT32 t = primitiveIndices[i];
+				references[t]++;
+				for(int k = 0; k < 3; ++k)
+					loose += contains(node, vertices[indices[3 * t + k]].position) ? 0 : 1;
+			}
+		}
+		else
+		{
+			for(UINT32 child:{ index + 1, node.offset })
+			{
+				loose += contains(node, nodes[child].boundsMin) && contains(node, nodes[child].boundsMax) ? 0 : 1;
+				stack.push_back(child);
+			}
+		}
+	}
+
+	UINT32 wrongReferences = 0;
+	for(UINT32 r:references)
+		wrongReferences += r == 1 ? 0 : 1;
+	details = std::to_string(wrongReferences) + " triangles not referenced once, " + std::to_string(loose) + " loose bounds";
+	return wrongReferences == 0 && loose == 0;
+}
+
+//all three builders on one mesh, logs what the faster rebuild costs in traversal
+static void checkBuilders(const std::string& name, const Vertex* vertices, const UINT32* indices, UINT32 triangleCount)
+{
+	const char* names[] = { "median", "binned SAH", "LBVH" };
+	BVHStats stats[3];
+	for(int builder = BVH_BUILDER_MEDIAN; builder <= BVH_BUILDER_LBVH; ++builder)
+	{
+		BVH bvh;
+		bvh.build(vertices, indices, triangleCount, (BVHBuilder) builder);
+		stats[builder] = bvh.computeStats();
+
+		std::string details;
+		CHECK_MSG(validateTree(bvh, vertices, indices, triangleCount, details), name + " (" + names[builder] + "): " + details);
+		CHECK_LT(stats[builder].maxDepth, (UINT32) BVH_MAX_DEPTH);
+
+		const BVHStats& s = stats[builder];
+		Logger::INFO.log("BVH \"" + name + "\" (" + names[builder] + "): " + std::to_string(triangleCount) + " triangles in " + std::to_string(s.buildMs) + "ms (" +
+						 std::to_string((UINT64) (triangleCount / std::max<float>(s.buildMs * 1e-3F, 1e-9F))) + " triangles/s), SAH cost " + std::to_string(s.sahCost) +
+						 ", " + std::to_string(s.nodeCount) + " nodes, depth " + std::to_string(s.maxDepth) + ", " + std::to_string(s.leafCount) + " leaves (avg " +
+						 std::to_string(s.avgLeafSize) + ", max " + std::to_string(s.maxLeafSize) + " triangles, avg depth " + std::to_string(s.avgLeafDepth) + ")");
+	}
+
+	const BVHStats& sah = stats[BVH_BUILDER_BINNED_SAH];
+	const BVHStats& lbvh = stats[BVH_BUILDER_LBVH];
+	Logger::INFO.log("BVH \"" + name + "\" LBVH vs binned SAH: " + std::to_string(lbvh.buildMs / std::max<float>(sah.buildMs, 1e-6F)) + "x build time, " +
+					 std::to_string(lbvh.sahCost / std::max<float>(sah.sahCost, 1e-6F)) + "x SAH cost");
+}
+
+//a finely tessellated sphere, above the parallel and wide morton code thresholds
+TEST_CASE(BVHBuildGeosphere)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData sphere = geoGen.createGeosphere(1.0F, 8);
+	std::vector<Vertex> vertices(sphere.vertices.size());
+	for(size_t i = 0; i < vertices.size(); ++i)
+		vertices[i].position = sphere.vertices[i].position;
+	checkBuilders("geosphere", vertices.data(), sphere.indices32.data(), (UINT32) sphere.indices32.size() / 3);
+}
+
+//every resident geometry of the box scene
+TEST_CASE(BVHBuildScene)
+{
+	CpuPathTracer tracer(1280, 720);
+	REQUIRE(tracer.initContext("box"));
+
+	for(auto& geo:tracer.getScene()->getResidentGeometries())
+	{
+		const SubmeshGeometry& submesh = geo->DrawArgs.at("0");
+		UINT32 triangleCount = submesh.IndexCount / 3;
+		if(triangleCount == 0)
+			continue;
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data()) + submesh.BaseVertexLocation;
+		const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data()) + submesh.StartIndexLocation;
+		checkBuilders(geo->name, vertices, indices, triangleCount);
+	}
+}
+
+//waves over whole grids, then a splash in one corner refitted with dirty flags
+TEST_CASE(BVHRefit)
+{
+	const int frames = 8;
+	GeometryGenerator geoGen;
+	for(UINT32 size:{ 64u, 256u, 512u })
+	{
+		GeometryGenerator::MeshData grid = geoGen.createGrid(100.0F, 100.0F, size, size);
+		std::vector<Vertex> vertices(grid.vertices.size());
+		for(size_t i = 0; i < vertices.size(); ++i)
+			vertices[i].position = grid.vertices[i].position;
+		const UINT32* indices = grid.indices32.data();
+		UINT32 triangleCount = (UINT32) grid.indices32.size() / 3;
+
+		BVH bvh;
+		bvh.build(vertices.data(), indices, triangleCount);
+		float buildMs = bvh.getBuildTime();
+
+		BVH lbvh;
+		lbvh.build(vertices.data(), indices, triangleCount, BVH_BUILDER_LBVH);
+
+		Timer timer;
+
+		//the first refit also sorts the nodes by level
+		bvh.refit(vertices.data(), indices);
+
+		float refitMs = 0.0F;
+		bool rebuild = false;
+		for(int frame = 1; frame <= frames; ++frame)
+		{
+			float time = frame * 0.1F;
+			for(size_t i = 0; i < vertices.size(); ++i)
+			{
+				const XMFLOAT3& p = grid.vertices[i].position;
+				vertices[i].position.y = 0.5F * sinf(0.3F * p.x + time) * cosf(0.2F * p.z + 1.3F * time);
+			}
+
+			timer.reset();
+			rebuild |= bvh.refit(vertices.data(), indices);
+			timer.tick();
+			refitMs += timer.deltaTime() * 1000.0F / frames;
+		}
+		float growth = bvh.getSAHGrowth();
+
+		//vertices are shared, so every triangle touching a moved one is dirty, not only the ones inside the corner
+		std::vector<UINT8> moved(vertices.size(), 0);
+		for(size_t i = 0; i < vertices.size(); ++i)
+		{
+			const XMFLOAT3& p = grid.vertices[i].position;
+			if(p.x < -40.0F && p.z < -40.0F)
+			{
+				moved[i] = 1;
+				vertices[i].position.y += 1.0F;
+			}
+		}
+		std::vector<UINT8> dirty(triangleCount, 0);
+		for(UINT32 t = 0; t < triangleCount; ++t)
+			dirty[t] = moved[indices[3 * t]] | moved[indices[3 * t + 1]] | moved[indices[3 * t + 2]];
+
+		timer.reset();
+		bvh.refit(vertices.data(), indices, dirty.data());
+		timer.tick();
+		float localMs = timer.deltaTime() * 1000.0F;
+
+		UINT32 changedNodes = 0;
+		for(UINT8 changed:bvh.getChangeMask())
+			changedNodes += changed;
+
+		//the refitted bounds have to hold the moved triangles, and the splash must not touch the far side of the tree
+		std::string details;
+		CHECK_MSG(validateTree(bvh, vertices.data(), indices, triangleCount, details), std::to_string(size) + "x" + std::to_string(size) + " grid: " + details);
+		CHECK_LT(changedNodes, (UINT32) bvh.getNodes().size() / 2);
+
+		Logger::INFO.log("BVH refit " + std::to_string(size) + "x" + std::to_string(size) + " grid: " + std::to_string(triangleCount) + " triangles, refit " + std::to_string(refitMs) + "ms (" +
+						 std::to_string((UINT64) (triangleCount / std::max<float>(refitMs * 1e-3F, 1e-9F))) + " triangles/s), local refit " + std::to_string(localMs) + "ms (" +
+						 std::to_string(changedNodes) + "/" + std::to_string(bvh.getNodes().size()) + " nodes changed), SAH growth " + std::to_string(growth) +
+						 (rebuild ? " (rebuild)" : "") + ", SAH build " + std::to_string(buildMs) + "ms, LBVH build " + std::to_string(lbvh.getBuildTime()) + "ms");
+	}
+}
\ No newline at end of file
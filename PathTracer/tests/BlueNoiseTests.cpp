@@ -0,0 +1,82 @@
+#include "Test.h"
+
+#include "rendering/BlueNoise.h"
+#include "rendering/Sampling.h"
+#include "utils/Timer.h"
+
+using namespace RT;
+
+static const UINT32 size = 64;
+static const UINT32 slices = 16;
+
+static std::vector<float> toValues(const std::vector<UINT32>& ranks)
+{
+	std::vector<float> values(ranks.size());
+	for(size_t i = 0; i < ranks.size(); ++i)
+		values[i] = (ranks[i] + 0.5F) / ranks.size();
+	return values;
+}
+
+static bool isPermutation(const std::vector<UINT32>& ranks)
+{
+	std::vector<BYTE> seen(ranks.size(), 0);
+	for(UINT32 r:ranks)
+	{
+		if(r >= ranks.size() || seen[r])
+			return false;
+		seen[r] = 1;
+	}
+	return true;
+}
+
+//white noise gives the baseline of both ratios
+static std::vector<float> whiteNoise()
+{
+	uint seed = initRand(29, 0);
+	std::vector<float> white((size_t) size * size * slices);
+	for(auto& v:white)
+		v = nextRand(seed);
+	return white;
+}
+
+//a single slice
+TEST_CASE(BlueNoise2D)
+{
+	Timer timer;
+	timer.reset();
+	std::vector<UINT32> flat = BlueNoise::generate(size, 1, 7);
+	timer.tick();
+	float flatSpatial = BlueNoise::spatialLowFrequencyRatio(toValues(flat), size, 1);
+	float whiteSpatial = BlueNoise::spatialLowFrequencyRatio(whiteNoise(), size, slices);
+	Logger::INFO.log(std::to_string(size) + "^2 in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms, low over high frequency power " + std::to_string(flatSpatial) + ", white noise " +
+					 std::to_string(whiteSpatial));
+
+	CHECK(isPermutation(flat));
+	CHECK_LT(flatSpatial, 0.2F);
+	CHECK_GT(whiteSpatial, 0.5F);
+}
+
+//slices blue on their own and over time
+TEST_CASE(BlueNoiseSpatiotemporal)
+{
+	Timer timer;
+	timer.reset();
+	std::vector<UINT32> volume = BlueNoise::generate(size, slices, 11);
+	timer.tick();
+	float seconds = timer.deltaTime();
+	std::vector<float> values = toValues(volume);
+	float spatial = BlueNoise::spatialLowFrequencyRatio(values, size, slices);
+	float temporal = BlueNoise::temporalLowFrequencyRatio(values, size, slices);
+	float whiteTemporal = BlueNoise::temporalLowFrequencyRatio(whiteNoise(), size, slices);
+	Logger::INFO.log(std::to_string(size) + "^2 x " + std::to_string(slices) + " in " + std::to_string(seconds * 1000.0F) + "ms, spatial ratio " + std::to_string(spatial) + ", temporal ratio " +
+					 std::to_string(temporal) + ", white noise " + std::to_string(whiteTemporal));
+
+	CHECK(isPermutation(volume));
+	CHECK_LT(spatial, 0.3F);
+	CHECK_LT(temporal, 0.5F);
+	CHECK_GT(whiteTemporal, 0.5F);
+
+	//a splat costs the same at any size, so the time per texel gives the time of the big textures
+	float perTexel = seconds / (size * size * slices);
+	Logger::INFO.log("Estimate for one channel: 256^2 x 64 in " + std::to_string(perTexel * 256 * 256 * 64) + "s, 512^2 x 64 in " + std::to_string(perTexel * 512 * 512 * 64) + "s");
+}
\ No newline at end of file
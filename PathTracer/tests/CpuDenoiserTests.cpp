@@ -0,0 +1,140 @@
+#include "Test.h"
+
+#include "rendering/cpu/CpuDenoiser.h"
+
+using namespace DirectX;
+using namespace RT;
+
+//a floor and two walls lit by a gradient, with new per pixel noise every frame like a 1 spp render
+struct NoisyRoom
+{
+	UINT32 width, height;
+	std::vector<XMFLOAT4> color;
+	std::vector<XMFLOAT4> normalRoughness;
+	std::vector<float> viewZ;
+	std::vector<XMFLOAT4> albedo;
+	std::vector<XMFLOAT2> motion;
+	CpuDenoiserGuides guides;
+
+	NoisyRoom(UINT32 width, UINT32 height) : width(width), height(height)
+	{
+		size_t size = (size_t) width * height;
+		color.resize(size);
+		normalRoughness.resize(size);
+		viewZ.resize(size);
+		albedo.resize(size);
+		motion.assign(size, { 0.0F, 0.0F });
+
+		parallelFor(UINT32(0), height, [&](UINT32 y)
+		{
+			for(UINT32 x = 0; x < width; ++x)
+			{
+				size_t i = (size_t) y * width + x;
+				float u = (float) x / width;
+				float v = (float) y / height;
+				bool floor = v > 0.6F;
+				bool left = u < 0.3F;
+				normalRoughness[i] = floor ? XMFLOAT4(0.0F, 1.0F, 0.0F, 0.6F) : (left ? XMFLOAT4(1.0F, 0.0F, 0.0F, 0.3F) : XMFLOAT4(0.0F, 0.0F, -1.0F, 0.8F));
+				viewZ[i] = v < 0.05F ? -1.0F : (floor ? 2.0F + (1.0F - v) * 10.0F : 6.0F + u);
+				albedo[i] = ((x / 32 + y / 32) & 1) ? XMFLOAT4(0.8F, 0.8F, 0.8F, 1.0F) : XMFLOAT4(0.6F, 0.2F, 0.1F, 1.0F);
+			}
+		});
+
+		guides.normalRoughness = reinterpret_cast<const float*>(normalRoughness.data());
+		guides.viewZ = viewZ.data();
+		guides.albedo = reinterpret_cast<const float*>(albedo.data());
+		guides.motion = reinterpret_cast<const float*>(motion.data());
+	}
+
+	void render(UINT32 frame)
+	{
+		parallelFor(UINT32(0), height, [&](UINT32 y)
+		{
+			UINT32 seed = (y * 9781 + 1) ^ (frame * 0x9E3779B9u);
+			for(UINT32 x = 0; x < width; ++x)
+			{
+				size_t i = (size_t) y * width + x;
+				seed = seed * 1664525 + 1013904223;
+				float noise = (seed >> 8) * (2.0F / 16777216.0F);
+				float light = (0.2F + (float) x / width * 0.8F) * noise;
+				color[i] = { albedo[i].x * light, albedo[i].y * light, albedo[i].z * light, 1.0F };
+			}
+		});
+	}
+
+	//on a patch of the back wall the lighting over the albedo should be the noise free gradient
+	double relativeDeviation(const std::vector<XMFLOAT4>& image) const
+	{
+		double sum = 0.0, sumSq = 0.0;
+		UINT32 n = 0;
+		for(UINT32 y = height / 5; y < height * 2 / 5; ++y)
+		{
+			for(UINT32 x = width / 2; x < width * 7 / 10; ++x)
+			{
+				size_t i = (size_t) y * width + x;
+				double r = image[i].x / (albedo[i].x * (0.2 + 0.8 * x / width));
+				if(!std::isfinite(r))
+					return DBL_MAX;
+				sum += r;
+				sumSq += r * r;
+				n++;
+			}
+		}
+		double mean = sum / std::max<UINT32>(n, 1);
+		return sqrt(std::max<double>(sumSq / std::max<UINT32>(n, 1) - mean * mean, 0.0)) / std::max<double>(mean, 1e-6);
+	}
+};
+
+static const int frames = 8;
+
+//a single frame has to lose at least half of its noise
+TEST_CASE(CpuDenoiserSpatial)
+{
+	NoisyRoom room(640, 360);
+	CpuDenoiser denoiser;
+	denoiser.resize(room.width, room.height);
+	std::vector<XMFLOAT4> output(room.color.size());
+
+	float ms = 0.0F;
+	double before = 0.0, after = 0.0;
+	for(int frame = 0; frame < frames; ++frame)
+	{
+		room.render(frame);
+		denoiser.denoise(reinterpret_cast<const float*>(room.color.data()), room.guides, reinterpret_cast<float*>(output.data()));
+		ms += denoiser.getDenoiseTime() / frames;
+
+		before = std::max<double>(before, room.relativeDeviation(room.color));
+		after = std::max<double>(after, room.relativeDeviation(output));
+	}
+	CHECK_LT(after, before * 0.5);
+
+	Logger::INFO.log("CPU denoiser spatial (" + std::to_string(room.width) + "x" + std::to_string(room.height) + ", " + std::to_string(denoiser.settings.iterations) + " iterations): " +
+					 std::to_string(ms) + "ms, relative noise " + std::to_string(before) + " -> " + std::to_string(after));
+}
+
+//with fresh noise every frame the history has to end up below what one frame filters to
+TEST_CASE(CpuDenoiserTemporal)
+{
+	NoisyRoom room(640, 360);
+	CpuDenoiser denoiser;
+	denoiser.resize(room.width, room.height);
+	std::vector<XMFLOAT4> output(room.color.size());
+
+	room.render(0);
+	denoiser.denoise(reinterpret_cast<const float*>(room.color.data()), room.guides, reinterpret_cast<float*>(output.data()));
+	double spatial = room.relativeDeviation(output);
+
+	denoiser.settings.temporal = true;
+	float ms = 0.0F;
+	for(int frame = 1; frame <= frames; ++frame)
+	{
+		room.render(frame);
+		denoiser.denoise(reinterpret_cast<const float*>(room.color.data()), room.guides, reinterpret_cast<float*>(output.data()));
+		ms += denoiser.getDenoiseTime() / frames;
+	}
+	double temporal = room.relativeDeviation(output);
+	CHECK_LT(temporal, spatial);
+
+	Logger::INFO.log("CPU denoiser temporal (" + std::to_string(room.width) + "x" + std::to_string(room.height) + "): " + std::to_string(ms) + "ms, relative noise after " +
+					 std::to_string(frames) + " frames " + std::to_string(temporal) + ", single frame " + std::to_string(spatial));
+}
\ No newline at end of file
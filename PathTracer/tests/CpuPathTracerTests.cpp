@@ -0,0 +1,70 @@
+#include "Test.h"
+
+#include "rendering/cpu/CpuPathTracer.h"
+
+using namespace DirectX;
+using namespace RT;
+
+namespace RT
+{
+	struct CpuPathTracerTests
+	{
+		//a camera ray aimed at an emitter has to return at least its emission, the rest of the shading only adds to it
+		static void emission(CpuPathTracer& tracer)
+		{
+			tracer.updateFrameData();
+			tracer.updateCameraRays();
+
+			const auto& materials = tracer.mScene->getMaterials();
+			UINT32 emitters = 0, tested = 0, below = 0;
+			float worst = FLT_MAX;
+			for(auto& tri:tracer.mTriangles)
+			{
+				if(!tracer.mInstances[tri.instance].emissive)
+					continue;
+				emitters++;
+
+				CpuRay ray;
+				ray.origin = tracer.mEyePos;
+				XMVECTOR centroid = XMLoadFloat3(&tri.v0) + (XMLoadFloat3(&tri.e1) + XMLoadFloat3(&tri.e2)) / 3.0F;
+				XMStoreFloat3(&ray.direction, XMVector3Normalize(centroid - XMLoadFloat3(&tracer.mEyePos)));
+				ray.tMin = 0.1F;
+				ray.tMax = 1000.0F;
+
+				CpuHit hit;
+				if(!tracer.intersect(ray, hit))
+					continue;
+				const CpuInstance& instance = tracer.mInstances[tracer.mTriangles[hit.triangle].instance];
+				if(!instance.emissive || instance.materialIndex >= materials.size())
+					continue;
+
+				//metals and glass split the emission with a random lobe
+				const Material& material = *materials[instance.materialIndex];
+				CpuSurface surf = tracer.surface(hit, material, -XMLoadFloat3(&ray.direction), 1);
+				if(surf.metallic > 0.0F || material.DiffuseAlbedo.w < 1.0F)
+					continue;
+
+				UINT seed = tested + 1;
+				XMVECTOR excess = tracer.radiance(ray, 1, seed) - surf.emission;
+				float margin = std::min<float>(std::min<float>(XMVectorGetX(excess), XMVectorGetY(excess)), XMVectorGetZ(excess));
+				worst = std::min<float>(worst, margin);
+				below += margin < -1e-4F ? 1 : 0;
+				tested++;
+			}
+
+			CHECK_GT(emitters, 0u);
+			CHECK_GT(tested, 0u);
+			CHECK_EQ(below, 0u);
+			Logger::INFO.log("Emission: " + std::to_string(tested) + " camera rays on " + std::to_string(emitters) + " emissive triangles, smallest margin " + std::to_string(worst));
+		}
+	};
+}
+
+//primary hits on the emitters of the box scene against their material emission
+TEST_CASE(CpuEmission)
+{
+	CpuPathTracer tracer(1280, 720);
+	REQUIRE(tracer.initContext("box"));
+	tracer.getCamera()->updateViewMatrix();
+	CpuPathTracerTests::emission(tracer);
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "Test.h"
+
+#include "rendering/EmissiveTriangles.h"
+#include "utils/Timer.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+//Pearson's test of a sampler against the flux pdfs, bins expecting less than 5 samples are pooled
+template<typename Sampler>
+static bool chiSquareTest(const EmissiveTriangles& emissive, UINT32 samples, Sampler sampler, float& statistic, float& critical)
+{
+	std::vector<UINT32> histogram(emissive.getCount(), 0);
+	for(UINT32 s = 0; s < samples; ++s)
+	{
+		UINT32 index = sampler();
+		if(index < histogram.size())
+			histogram[index]++;
+	}
+
+	double x2 = 0.0;
+	double pooledExpected = 0.0;
+	double pooledObserved = 0.0;
+	int bins = 0;
+	for(UINT32 i = 0; i < emissive.getCount(); ++i)
+	{
+		double expected = (double) emissive.pdf(i) * samples;
+		if(expected < 5.0)
+		{
+			pooledExpected += expected;
+			pooledObserved += histogram[i];
+			continue;
+		}
+		x2 += (histogram[i] - expected) * (histogram[i] - expected) / expected;
+		bins++;
+	}
+	if(pooledExpected > 0.0)
+	{
+		x2 += (pooledObserved - pooledExpected) * (pooledObserved - pooledExpected) / pooledExpected;
+		bins++;
+	}
+
+	//Wilson-Hilferty approximation of the 0.999 quantile
+	float dof = (float) std::max<int>(bins - 1, 1);
+	float h = 2.0F / (9.0F * dof);
+	critical = dof * powf(1.0F - h + 3.09F * sqrtf(h), 3.0F);
+	statistic = (float) x2;
+	return statistic <= critical;
+}
+
+//64x64 texels, the value grows along u from texel center to texel center
+static EmissiveMap rampMap()
+{
+	EmissiveMap ramp;
+	ramp.widths = { 64 };
+	ramp.heights = { 64 };
+	ramp.levels = { std::vector<float>(64 * 64) };
+	for(UINT32 y = 0; y < 64; ++y)
+		for(UINT32 x = 0; x < 64; ++x)
+			ramp.levels[0][y * 64 + x] = (x + 0.5F) / 64.0F;
+	EmissiveTriangles::buildLevels(ramp);
+	return ramp;
+}
+
+//flux integration against a map with known means
+TEST_CASE(EmissiveChecker)
+{
+	EmissiveMap checker;
+	checker.widths = { 2 };
+	checker.heights = { 2 };
+	checker.levels = { { 1.0F, 0.0F, 0.0F, 1.0F } };
+	EmissiveTriangles::buildLevels(checker);
+	CHECK_EQ(checker.levels.size(), (size_t) 2);
+
+	CHECK_NEAR(EmissiveTriangles::integrate(checker, { 0.0F, 0.0F }, { 1.0F, 0.0F }, { 0.0F, 1.0F }), 0.5F, 1e-5F);
+	CHECK_NEAR(EmissiveTriangles::integrate(checker, { 0.0F, 0.0F }, { 0.5F, 0.0F }, { 0.0F, 0.5F }), 1.0F, 1e-5F);
+	//inside one texel
+	CHECK_NEAR(EmissiveTriangles::integrate(checker, { 0.6F, 0.6F }, { 0.61F, 0.6F }, { 0.6F, 0.61F }), 1.0F, 1e-5F);
+}
+
+//a ramp along u averages to the centroid's u up to half a texel, whole tiles away is the same footprint
+TEST_CASE(EmissiveRamp)
+{
+	UINT seed = 13;
+	EmissiveMap ramp = rampMap();
+	float worstRamp = 0.0F;
+	float worstWrap = 0.0F;
+	for(int i = 0; i < 256; ++i)
+	{
+		XMFLOAT2 uv[3];
+		for(auto& p:uv)
+			p = { nextRand(seed), nextRand(seed) };
+		float mean = EmissiveTriangles::integrate(ramp, uv[0], uv[1], uv[2]);
+		worstRamp = std::max<float>(worstRamp, fabsf(mean - (uv[0].x + uv[1].x + uv[2].x) / 3.0F));
+
+		float shifted = EmissiveTriangles::integrate(ramp, { uv[0].x + 3.0F, uv[0].y - 2.0F }, { uv[1].x + 3.0F, uv[1].y - 2.0F }, { uv[2].x + 3.0F, uv[2].y - 2.0F });
+		worstWrap = std::max<float>(worstWrap, fabsf(shifted - mean));
+	}
+	CHECK_LT(worstRamp, 1.0F / 64.0F);
+	CHECK_LT(worstWrap, 1e-3F);
+
+	//tiled far past EMISSIVE_MAX_TEXELS, a coarser level has to give the same mean
+	CHECK_NEAR(EmissiveTriangles::integrate(ramp, { 0.0F, 0.0F }, { 40.0F, 0.0F }, { 0.0F, 40.0F }), 0.5F, 0.02F);
+}
+
+//a unit square with a constant map emits pi times its radiance
+TEST_CASE(EmissiveFlux)
+{
+	Vertex quad[4] = {};
+	quad[0].position = { 0.0F, 0.0F, 0.0F };
+	quad[1].position = { 0.0F, 1.0F, 0.0F };
+	quad[2].position = { 1.0F, 1.0F, 0.0F };
+	quad[3].position = { 1.0F, 0.0F, 0.0F };
+	quad[1].uvs = { 0.0F, 1.0F };
+	quad[2].uvs = { 1.0F, 1.0F };
+	quad[3].uvs = { 1.0F, 0.0F };
+	UINT32 quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	EmissiveTriangles square;
+	square.add(quad, quadIndices, 2, Identity4x4(), Identity4x4(), { 2.0F, 2.0F, 2.0F }, nullptr);
+	square.build();
+	CHECK_EQ(square.getCount(), 2u);
+	CHECK_NEAR(square.getTotalFlux(), 2.0F * XM_PI, 1e-4F);
+}
+
+//points are uniform over a triangle, a ray that hits it finds it again and its solid angle pdf follows distance and cosine
+TEST_CASE(EmissivePointSampling)
+{
+	UINT seed = 7;
+	Vertex quad[4] = {};
+	quad[0].position = { 0.0F, 0.0F, 0.0F };
+	quad[1].position = { 0.0F, 1.0F, 0.0F };
+	quad[2].position = { 1.0F, 1.0F, 0.0F };
+	quad[3].position = { 1.0F, 0.0F, 0.0F };
+	UINT32 quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	EmissiveTriangles square;
+	square.add(quad, quadIndices, 2, Identity4x4(), Identity4x4(), { 1.0F, 1.0F, 1.0F }, nullptr, 5);
+	square.build();
+	REQUIRE(square.getCount() == 2u);
+	REQUIRE(square.find(5, 1) < square.getCount());
+	CHECK_EQ(square.getTriangles()[square.find(5, 1)].primitive, 1u);
+	CHECK_EQ(square.find(4, 1), UINT32_MAX);
+	CHECK_EQ(square.find(5, 2), UINT32_MAX);
+
+	//the triangle between the edge midpoints holds a quarter of the area
+	const EmissiveTriangle& tri = square.getTriangles()[square.find(5, 0)];
+	const UINT32 samples = 1 << 16;
+	UINT32 outside = 0, middle = 0;
+	XMVECTOR mean = XMVectorZero();
+	for(UINT32 s = 0; s < samples; ++s)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, EmissiveTriangles::samplePoint(tri, nextRand(seed), nextRand(seed)));
+		outside += p.x < -1e-6F || p.y > 1.0F + 1e-6F || p.x > p.y + 1e-6F || fabsf(p.z) > 1e-6F ? 1 : 0;
+		middle += p.y > 0.5F && p.x < 0.5F && p.x > p.y - 0.5F ? 1 : 0;
+		mean += XMLoadFloat3(&p);
+	}
+	mean /= (float) samples;
+	CHECK_EQ(outside, 0u);
+	CHECK_NEAR(middle / (float) samples, 0.25F, 0.01F);
+	CHECK_NEAR(XMVectorGetX(XMVector3Length(mean - XMVectorSet(1.0F / 3.0F, 2.0F / 3.0F, 0.0F, 0.0F))), 0.0F, 0.01F);
+
+	//straight above at distance 2 and from the back
+	UINT32 index = square.find(5, 0);
+	XMVECTOR point = XMVectorSet(0.25F, 0.75F, 0.0F, 0.0F);
+	float sign = tri.normal.z > 0.0F ? 1.0F : -1.0F;
+	CHECK_NEAR(square.pdf(index, point + XMVectorSet(0.0F, 0.0F, 2.0F * sign, 0.0F), point), 0.5F * 4.0F / 0.5F, 1e-4F);
+	CHECK_EQ(square.pdf(index, point - XMVectorSet(0.0F, 0.0F, 2.0F * sign, 0.0F), point), 0.0F);
+}
+
+//a grid under the ramp gets a flux growing along u, the CDF and the alias table have to follow it
+TEST_CASE(EmissiveSampling)
+{
+	UINT seed = 13;
+	EmissiveMap ramp = rampMap();
+	const UINT32 cells = 48;
+	std::vector<Vertex> grid((cells + 1) * (cells + 1));
+	std::vector<UINT32> gridIndices;
+	for(UINT32 y = 0; y <= cells; ++y)
+	{
+		for(UINT32 x = 0; x <= cells; ++x)
+		{
+			Vertex& v = grid[y * (cells + 1) + x];
+			v.position = { (float) x / cells, 0.0F, (float) y / cells };
+			v.uvs = { (float) x / cells, (float) y / cells };
+		}
+	}
+	for(UINT32 y = 0; y < cells; ++y)
+	{
+		for(UINT32 x = 0; x < cells; ++x)
+		{
+			UINT32 i = y * (cells + 1) + x;
+			gridIndices.insert(gridIndices.end(), { i, i + cells + 1, i + cells + 2, i, i + cells + 2, i + 1 });
+		}
+	}
+
+	Timer timer;
+	timer.reset();
+	EmissiveTriangles panel;
+	panel.add(grid.data(), gridIndices.data(), (UINT32) gridIndices.size() / 3, Identity4x4(), Identity4x4(), { 1.0F, 1.0F, 1.0F }, &ramp);
+	panel.build();
+	timer.tick();
+	REQUIRE(panel.getCount() > 0);
+
+	double pdfSum = 0.0;
+	for(UINT32 i = 0; i < panel.getCount(); ++i)
+		pdfSum += panel.pdf(i);
+	CHECK_NEAR(pdfSum, 1.0, 1e-4);
+
+	//CDF inversion keeps the order of u, and both samplers report the pdf of what they picked
+	UINT32 unordered = 0, wrongPdfs = 0, previous = 0;
+	for(UINT32 k = 0; k < 4096; ++k)
+	{
+		float pdf, aliasPdf;
+		UINT32 index = panel.sample((k + 0.5F) / 4096.0F, pdf);
+		UINT32 aliasIndex = panel.sampleAlias(nextRand(seed), nextRand(seed), aliasPdf);
+		unordered += index < previous ? 1 : 0;
+		wrongPdfs += fabsf(pdf - panel.pdf(index)) > 1e-6F || fabsf(aliasPdf - panel.pdf(aliasIndex)) > 1e-6F ? 1 : 0;
+		previous = index;
+	}
+	CHECK_EQ(unordered, 0u);
+	CHECK_EQ(wrongPdfs, 0u);
+
+	const UINT32 samples = 1 << 20;
+	float statistic, critical;
+	CHECK(chiSquareTest(panel, samples, [&]() { float pdf; return panel.sample(nextRand(seed), pdf); }, statistic, critical));
+	Logger::INFO.log("Emissive CDF sampling: " + std::to_string(panel.getCount()) + " triangles in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms, chi-square " + std::to_string(statistic) +
+					 " / " + std::to_string(critical));
+	CHECK(chiSquareTest(panel, samples, [&]() { float pdf; return panel.sampleAlias(nextRand(seed), nextRand(seed), pdf); }, statistic, critical));
+	Logger::INFO.log("Emissive alias sampling: chi-square " + std::to_string(statistic) + " / " + std::to_string(critical));
+}
+
+//the map the scenes actually use, box filtered down to 1x1
+TEST_CASE(EmissiveBulbMap)
+{
+	EmissiveMap bulb;
+	REQUIRE(EmissiveTriangles::loadMap(L"res/emissive/bulb_emissive.dds", bulb));
+	REQUIRE(!bulb.levels.empty());
+	CHECK_LE(bulb.widths[0], (UINT32) EMISSIVE_MAP_MAX_SIZE);
+	CHECK_LE(bulb.heights[0], (UINT32) EMISSIVE_MAP_MAX_SIZE);
+	CHECK_EQ(bulb.widths.back(), 1u);
+	CHECK_EQ(bulb.heights.back(), 1u);
+
+	double mean = 0.0;
+	for(float t:bulb.levels[0])
+		mean += t;
+	mean /= bulb.levels[0].size();
+	CHECK_NEAR(bulb.levels.back()[0], mean, 1e-3);
+
+	Logger::INFO.log("Emissive bulb map " + std::to_string(bulb.widths[0]) + "x" + std::to_string(bulb.heights[0]) + ", mean " + std::to_string(mean) + ", " + std::to_string(bulb.levels.size()) + " levels");
+}
\ No newline at end of file
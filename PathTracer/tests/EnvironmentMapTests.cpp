@@ -0,0 +1,185 @@
+#include "Test.h"
+
+#include "rendering/EnvironmentMap.h"
+
+#include <filesystem>
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+static float luminance(const XMFLOAT3& c)
+{
+	return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+}
+
+static const UINT32 size = ENV_MAP_SAMPLING_SIZE;
+
+//a sky brightening towards the zenith with a small sun
+static std::vector<XMFLOAT3> skyTexels()
+{
+	XMVECTOR sunDir = XMVector3Normalize(XMVectorSet(0.4F, 0.6F, -0.7F, 0.0F));
+	std::vector<XMFLOAT3> texels((size_t) 6 * size * size);
+	for(UINT32 face = 0; face < 6; ++face)
+	{
+		for(UINT32 y = 0; y < size; ++y)
+		{
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				XMVECTOR dir = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size));
+				float up = std::max<float>(XMVectorGetY(dir), 0.0F);
+				float sun = XMVectorGetX(XMVector3Dot(dir, sunDir)) > 0.97F ? 50.0F : 0.0F;
+				texels[((size_t) face * size + y) * size + x] = { 0.2F + 0.5F * up + sun, 0.3F + 0.6F * up + sun, 0.4F + 0.9F * up + sun };
+			}
+		}
+	}
+	return texels;
+}
+
+namespace RT
+{
+	struct EnvironmentMapTests
+	{
+		//the cache gives back the same tables, and a different source stamp is refused
+		static void cache()
+		{
+			EnvironmentMap env;
+			env.build(skyTexels(), size);
+
+			std::string cache = std::string(ENV_MAP_CACHE_DIR) + "test.bin";
+			env.saveCache(cache, 42);
+			EnvironmentMap cached, stale;
+			bool loaded = cached.loadCache(cache, 42);
+			bool staleLoaded = stale.loadCache(cache, 43);
+			std::error_code ec;
+			std::filesystem::remove(cache, ec);
+
+			REQUIRE(loaded);
+			CHECK(!staleLoaded);
+			CHECK_EQ(cached.getSize(), env.getSize());
+			CHECK_EQ(cached.getTotal(), env.getTotal());
+			CHECK(cached.getMarginal() == env.getMarginal());
+			CHECK(cached.getConditional() == env.getConditional());
+		}
+	};
+}
+
+//texel centers map back to their own texel and the texels cover the sphere once
+TEST_CASE(EnvironmentTexels)
+{
+	double solidAngle = 0.0;
+	UINT32 wrongTexels = 0;
+	for(UINT32 face = 0; face < 6; ++face)
+	{
+		for(UINT32 y = 0; y < size; ++y)
+		{
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				XMVECTOR dir = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size));
+				solidAngle += EnvironmentMap::texelSolidAngle(x, y, size);
+
+				float u, v;
+				UINT32 f = EnvironmentMap::directionFace(dir, u, v);
+				wrongTexels += f != face || (UINT32) (u * size) != x || (UINT32) (v * size) != y;
+			}
+		}
+	}
+	CHECK_NEAR(solidAngle, 4.0 * XM_PI, 1e-3);
+	CHECK_EQ(wrongTexels, 0u);
+}
+
+//the pdf integrates to one over the sphere
+TEST_CASE(EnvironmentPdfIntegral)
+{
+	UINT seed = 17;
+	EnvironmentMap env;
+	env.build(skyTexels(), size);
+
+	const UINT32 samples = 1 << 20;
+	double integral = 0.0;
+	for(UINT32 i = 0; i < samples; ++i)
+	{
+		float z = 1.0F - 2.0F * nextRand(seed);
+		float r = sqrtf(std::max<float>(1.0F - z * z, 0.0F));
+		float phi = XM_2PI * nextRand(seed);
+		integral += env.pdf(XMVectorSet(r * cosf(phi), r * sinf(phi), z, 0.0F));
+	}
+	integral *= 4.0 * XM_PI / samples;
+	CHECK_NEAR(integral, 1.0, 0.02);
+	Logger::INFO.log("Environment pdf integral " + std::to_string(integral) + ", tables built in " + std::to_string(env.getBuildTime()) + "ms");
+}
+
+//sampled directions report the pdf the lookup gives, estimate the luminance integral and follow the texel probabilities
+TEST_CASE(EnvironmentSampling)
+{
+	UINT seed = 17;
+	std::vector<XMFLOAT3> texels = skyTexels();
+	EnvironmentMap env;
+	env.build(texels, size);
+
+	const UINT32 samples = 1 << 20;
+	UINT32 rows = 6 * size;
+	std::vector<UINT32> histogram((size_t) rows * size, 0);
+	UINT32 mismatches = 0;
+	double estimate = 0.0;
+	for(UINT32 i = 0; i < samples; ++i)
+	{
+		float pdf;
+		XMFLOAT3 d = env.sample(nextRand(seed), nextRand(seed), pdf);
+		XMVECTOR dir = XMLoadFloat3(&d);
+		float lookup = env.pdf(dir);
+		if(pdf <= 0.0F || fabsf(lookup - pdf) > 1e-3F * pdf)
+			mismatches++;
+
+		float u, v;
+		UINT32 face = EnvironmentMap::directionFace(dir, u, v);
+		UINT32 x = std::min<UINT32>((UINT32) (u * size), size - 1);
+		UINT32 y = std::min<UINT32>((UINT32) (v * size), size - 1);
+		histogram[((size_t) face * size + y) * size + x]++;
+		if(pdf > 0.0F)
+			estimate += luminance(texels[((size_t) face * size + y) * size + x]) / pdf;
+	}
+	estimate /= samples;
+	CHECK_LE(mismatches, samples / 1000);
+	CHECK_NEAR(estimate, env.getTotal(), 0.01 * env.getTotal());
+
+	//Pearson's test of the drawn texels, bins expecting less than 5 samples are pooled
+	double x2 = 0.0, pooledExpected = 0.0, pooledObserved = 0.0;
+	int bins = 0;
+	for(UINT32 r = 0; r < rows; ++r)
+	{
+		for(UINT32 c = 0; c < size; ++c)
+		{
+			double expected = (double) env.texelProbability(r, c) * samples;
+			UINT32 observed = histogram[(size_t) r * size + c];
+			if(expected < 5.0)
+			{
+				pooledExpected += expected;
+				pooledObserved += observed;
+				continue;
+			}
+			x2 += (observed - expected) * (observed - expected) / expected;
+			bins++;
+		}
+	}
+	if(pooledExpected > 0.0)
+	{
+		x2 += (pooledObserved - pooledExpected) * (pooledObserved - pooledExpected) / pooledExpected;
+		bins++;
+	}
+	float dof = (float) std::max<int>(bins - 1, 1);
+	float h = 2.0F / (9.0F * dof);
+	float critical = dof * powf(1.0F - h + 3.09F * sqrtf(h), 3.0F);
+	CHECK_LE(x2, (double) critical);
+	Logger::INFO.log("Environment chi-square " + std::to_string(x2) + " / " + std::to_string(critical) + " over " + std::to_string(bins) + " bins");
+}
+
+TEST_CASE(EnvironmentCache)
+{
+	EnvironmentMapTests::cache();
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "Test.h"
+
+#include "utils/GeometryCache.h"
+#include "utils/GeometryGenerator.h"
+#include "utils/Timer.h"
+
+#include <filesystem>
+
+using namespace RT;
+
+//edges used by a single triangle
+static UINT32 openEdges(const std::vector<UINT32>& indices)
+{
+	std::unordered_map<UINT64, UINT32> uses;
+	for(size_t i = 0; i < indices.size(); i += 3)
+	{
+		for(int e = 0; e < 3; ++e)
+		{
+			UINT32 a = indices[i + e];
+			UINT32 b = indices[i + (e + 1) % 3];
+			uses[a < b ? ((UINT64) a << 32) | b : ((UINT64) b << 32) | a]++;
+		}
+	}
+
+	UINT32 open = 0;
+	for(auto& [edge, count]:uses)
+		open += count == 1 ? 1 : 0;
+	return open;
+}
+
+//a geosphere is closed, every level has V = 10 * 4^n + 2 vertices and no open edge
+TEST_CASE(SubdivisionGeosphere)
+{
+	GeometryGenerator geoGen;
+	for(UINT32 level = 0; level <= 8; ++level)
+	{
+		Timer timer;
+		timer.reset();
+		GeometryGenerator::MeshData sphere = geoGen.createGeosphere(1.0F, level);
+		timer.tick();
+
+		UINT64 faces = 20ull << (2 * level);
+		Logger::INFO.log("Level " + std::to_string(level) + ": " + std::to_string(sphere.vertices.size()) + " vertices, " + std::to_string(sphere.indices32.size() / 3) + " triangles, " +
+						 std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+		CHECK_EQ(sphere.vertices.size(), faces / 2 + 2);
+		CHECK_EQ(sphere.indices32.size(), faces * 3);
+		CHECK_EQ(openEdges(sphere.indices32), 0u);
+	}
+}
+
+//box faces keep their own vertices for hard normals, only the 4 * 2^n edges around each face are open
+TEST_CASE(SubdivisionBox)
+{
+	GeometryGenerator geoGen;
+	for(UINT32 level = 0; level < 4; ++level)
+	{
+		GeometryGenerator::MeshData box = geoGen.createBox(1.0F, 1.0F, 1.0F, level);
+		CHECK_EQ(openEdges(box.indices32), 24u << level);
+	}
+}
+
+//a cache file that lands under another key's name, like on a hash collision, has to be regenerated instead of loaded
+TEST_CASE(GeometryCacheKey)
+{
+	ProceduralKey box = { PROCEDURAL_SHAPE_BOX, { 0.5F, 0.5F, 0.5F, 0.0F } };
+	ProceduralKey sphere = { PROCEDURAL_SHAPE_SPHERE, { 0.5F, 8.0F, 8.0F } };
+	auto fileName = [](const ProceduralKey& key) { std::stringstream name; name << "res/cache/geometry/" << std::hex << ProceduralKeyHash()(key) << ".bin"; return name.str(); };
+
+	GeometryCache::clear();
+	size_t boxVertices = GeometryCache::get(box, true)->vertices.size();
+	size_t sphereVertices = GeometryCache::get(sphere, false)->vertices.size();
+	REQUIRE(boxVertices != sphereVertices);
+
+	std::error_code ec;
+	std::filesystem::copy_file(fileName(box), fileName(sphere), std::filesystem::copy_options::overwrite_existing, ec);
+	REQUIRE(!ec);
+
+	GeometryCache::clear();
+	CHECK_EQ(GeometryCache::get(box, true)->vertices.size(), boxVertices);
+	CHECK_EQ(GeometryCache::get(sphere, true)->vertices.size(), sphereVertices);
+	GeometryCache::clear();
+}
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "Test.h"
+
+#include "rendering/LightAliasTable.h"
+#include "rendering/LightTree.h"
+#include "rendering/cpu/CpuPathTracer.h"
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+static float luminance(const XMFLOAT3& c)
+{
+	return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+}
+
+//Pearson's test against the table's own pdfs, bins expecting less than 5 samples are pooled
+static bool chiSquareTest(const LightAliasTable& table, UINT32 samples, UINT& seed, float& statistic, float& critical)
+{
+	const auto& entries = table.getEntries();
+	std::vector<UINT32> histogram(entries.size(), 0);
+	for(UINT32 s = 0; s < samples; ++s)
+	{
+		float pdf;
+		histogram[table.sample(nextRand(seed), nextRand(seed), pdf)]++;
+	}
+
+	double x2 = 0.0;
+	double pooledExpected = 0.0;
+	double pooledObserved = 0.0;
+	int bins = 0;
+	bool impossible = false;
+	for(size_t i = 0; i < entries.size(); ++i)
+	{
+		double expected = (double) entries[i].pdf * samples;
+		if(expected == 0.0)
+		{
+			impossible |= histogram[i] > 0;
+			continue;
+		}
+		if(expected < 5.0)
+		{
+			pooledExpected += expected;
+			pooledObserved += histogram[i];
+			continue;
+		}
+		x2 += (histogram[i] - expected) * (histogram[i] - expected) / expected;
+		bins++;
+	}
+	if(pooledExpected > 0.0)
+	{
+		x2 += (pooledObserved - pooledExpected) * (pooledObserved - pooledExpected) / pooledExpected;
+		bins++;
+	}
+
+	//Wilson-Hilferty approximation of the 0.999 quantile
+	float dof = (float) std::max<int>(bins - 1, 1);
+	float h = 2.0F / (9.0F * dof);
+	critical = dof * powf(1.0F - h + 3.09F * sqrtf(h), 3.0F);
+	statistic = (float) x2;
+	return !impossible && statistic <= critical;
+}
+
+//the pdfs have to add up to one, match what the table actually encodes and what sampling it produces
+static void checkTable(const std::string& name, const std::vector<float>& weights, UINT seed)
+{
+	LightAliasTable table;
+	table.build(weights);
+
+	const auto& entries = table.getEntries();
+	UINT32 n = (UINT32) entries.size();
+	std::vector<double> encoded(n, 0.0);
+	double pdfSum = 0.0;
+	for(UINT32 i = 0; i < n; ++i)
+	{
+		encoded[i] += entries[i].probability / (double) n;
+		encoded[entries[i].alias] += (1.0 - entries[i].probability) / (double) n;
+		pdfSum += entries[i].pdf;
+	}
+	double worstError = 0.0;
+	for(UINT32 i = 0; i < n; ++i)
+		worstError = std::max<double>(worstError, fabs(encoded[i] - entries[i].pdf));
+
+	float statistic, critical;
+	CHECK(chiSquareTest(table, 1 << 20, seed, statistic, critical));
+	CHECK_NEAR(pdfSum, 1.0, 1e-4);
+	CHECK_LT(worstError, 1e-6);
+
+	Logger::INFO.log("Alias table " + name + " (" + std::to_string(n) + " lights, " + std::to_string(table.getBuildTime()) + "ms): chi-square " + std::to_string(statistic) + " / " +
+					 std::to_string(critical) + ", pdf sum " + std::to_string(pdfSum) + ", encoding error " + std::to_string(worstError));
+}
+
+TEST_CASE(AliasTableUniform)
+{
+	checkTable("uniform", std::vector<float>(16, 1.0F), 11);
+}
+
+TEST_CASE(AliasTableSingle)
+{
+	checkTable("single", { 3.0F }, 11);
+}
+
+//the weights of the lights in box.uge
+TEST_CASE(AliasTableBox)
+{
+	Light box[3] = {};
+	box[0].Strength = { 1.0F, 1.0F, 1.0F };
+	box[0].lightType = LIGHT_TYPE_SPOTLIGHT;
+	box[0].SpotPower = 1.0F;
+	box[1].Strength = { 1.0F, 0.0F, 1.0F };
+	box[1].lightType = LIGHT_TYPE_SPOTLIGHT;
+	box[1].SpotPower = 1.0F;
+	box[2].Strength = { 0.1F, 1.0F, 0.0F };
+	box[2].lightType = LIGHT_TYPE_POINTLIGHT;
+	for(auto& l:box)
+	{
+		l.FalloffStart = 0.01F;
+		l.FalloffEnd = 10.0F;
+	}
+	checkTable("box.uge", { LightAliasTable::weight(box[0]), LightAliasTable::weight(box[1]), LightAliasTable::weight(box[2]) }, 11);
+}
+
+TEST_CASE(AliasTablePowerLaw)
+{
+	std::vector<float> powerLaw(4096);
+	for(size_t i = 0; i < powerLaw.size(); ++i)
+		powerLaw[i] = 1.0F / powf((float) i + 1.0F, 1.5F);
+	checkTable("power law", powerLaw, 11);
+}
+
+//lights with zero weight must never be picked
+TEST_CASE(AliasTableSparse)
+{
+	UINT seed = 11;
+	std::vector<float> sparse(1024, 0.0F);
+	for(size_t i = 0; i < sparse.size(); i += 3)
+		sparse[i] = 0.1F + nextRand(seed) * 10.0F;
+	checkTable("sparse", sparse, seed);
+}
+
+TEST_CASE(AliasTableRandom)
+{
+	UINT seed = 11;
+	std::vector<float> many(65536);
+	for(auto& w:many)
+		w = nextRand(seed) * nextRand(seed) * 100.0F;
+	checkTable("65536 random", many, seed);
+}
+
+//unshadowed diffuse contribution, what the light selection tries to be proportional to
+static float contribution(const Light& light, FXMVECTOR pos, FXMVECTOR norm)
+{
+	float radiance = luminance(light.Strength);
+	XMVECTOR lightDir;
+	if(light.lightType == LIGHT_TYPE_DIRECTIONAL)
+		lightDir = -XMVector3Normalize(XMLoadFloat3(&light.Direction));
+	else
+	{
+		lightDir = XMLoadFloat3(&light.Position) - pos;
+		float distance = XMVectorGetX(XMVector3Length(lightDir));
+		lightDir /= std::max<float>(distance, 1e-6F);
+
+		if(light.lightType == LIGHT_TYPE_TRIANGLE)
+		{
+			radiance *= distance < light.FalloffEnd ? std::max<float>(-XMVectorGetX(XMVector3Dot(lightDir, XMLoadFloat3(&light.Direction))), 0.0F) : 0.0F;
+			radiance /= std::max<float>(distance * distance, light.FalloffStart * light.FalloffStart);
+		}
+		else
+		{
+			radiance *= std::clamp<float>((light.FalloffEnd - distance) / (light.FalloffEnd - light.FalloffStart), 0.0F, 1.0F);
+			if(light.lightType == LIGHT_TYPE_SPOTLIGHT)
+				radiance *= powf(std::max<float>(-XMVectorGetX(XMVector3Dot(lightDir, XMVector3Normalize(XMLoadFloat3(&light.Direction)))), 0.0F), light.SpotPower);
+			radiance /= distance * distance + 1e-4F;
+		}
+	}
+	return radiance * std::max<float>(XMVectorGetX(XMVector3Dot(norm, lightDir)), 0.0F);
+}
+
+//exact variance of the one light estimator f(i) / p(i) over shading points around the lights of the box scene, emissive triangles included
+TEST_CASE(LightSelectionVariance)
+{
+	CpuPathTracer tracer(1280, 720);
+	REQUIRE(tracer.initContext("box"));
+	Scene* scene = tracer.getScene();
+	std::vector<Light> lights(scene->getLightCount());
+	for(UINT i = 0; i < (UINT) lights.size(); ++i)
+		lights[i] = scene->getLight(i);
+	UINT32 count = (UINT32) lights.size();
+	REQUIRE(count >= 2);
+
+	LightAliasTable table;
+	table.update(lights.data(), count);
+	LightTree tree;
+	tree.update(lights.data(), count);
+
+	XMVECTOR boundsMin = XMVectorReplicate(-1.0F);
+	XMVECTOR boundsMax = XMVectorReplicate(1.0F);
+	bool first = true;
+	for(auto& l:lights)
+	{
+		if(l.lightType == LIGHT_TYPE_DIRECTIONAL)
+			continue;
+		XMVECTOR p = XMLoadFloat3(&l.Position);
+		boundsMin = first ? p : XMVectorMin(boundsMin, p);
+		boundsMax = first ? p : XMVectorMax(boundsMax, p);
+		first = false;
+	}
+	boundsMin -= XMVectorReplicate(1.0F);
+	boundsMax += XMVectorReplicate(1.0F);
+
+	const int points = 1024;
+	UINT seed = 5;
+	double variance[3] = {};
+	double missed[3] = {};
+	double contributed = 0.0;
+	for(int p = 0; p < points; ++p)
+	{
+		XMVECTOR t = XMVectorSet(nextRand(seed), nextRand(seed), nextRand(seed), 0.0F);
+		XMVECTOR pos = XMVectorSetW(boundsMin + t * (boundsMax - boundsMin), 1.0F);
+		XMVECTOR norm = XMVector3Normalize(XMVectorSet(nextRand(seed) - 0.5F, nextRand(seed) - 0.5F, nextRand(seed) - 0.5F, 0.0F));
+
+		double total = 0.0;
+		double second[3] = {};
+		for(UINT32 i = 0; i < count; ++i)
+		{
+			double f = contribution(lights[i], pos, norm);
+			if(f <= 0.0)
+				continue;
+
+			total += f;
+			float pdfs[3] = { 1.0F / count, table.pdf(i), tree.pdf(pos, norm, i) };
+			for(int s = 0; s < 3; ++s)
+			{
+				second[s] += pdfs[s] > 0.0F ? f * f / pdfs[s] : 0.0;
+				missed[s] += pdfs[s] > 0.0F ? 0.0 : f;
+			}
+		}
+		for(int s = 0; s < 3; ++s)
+			variance[s] += (second[s] - total * total) / points;
+		contributed += total;
+	}
+
+	//lights a pdf never picks are bias, the tree may cull triangles seen at grazing angles but nothing that matters
+	//an estimator over pdfs that cover every contributing light can't have a negative variance
+	for(int s = 0; s < 3; ++s)
+	{
+		CHECK_LE(missed[s], 1e-4 * contributed);
+		CHECK(std::isfinite(variance[s]));
+		CHECK_GE(variance[s], -1e-6 * std::max<double>(variance[0], 1.0));
+	}
+
+	//both importance estimates have to beat picking uniformly
+	CHECK_LT(variance[1], variance[0]);
+	CHECK_LT(variance[2], variance[0]);
+
+	Logger::INFO.log("Light selection variance (" + std::to_string(count) + " lights): uniform " + std::to_string(variance[0]) + ", alias table " + std::to_string(variance[1]) +
+					 " (" + std::to_string(variance[0] / std::max<double>(variance[1], 1e-20)) + "x less), light tree " + std::to_string(variance[2]) +
+					 " (" + std::to_string(variance[0] / std::max<double>(variance[2], 1e-20)) + "x less), light tree misses " + std::to_string(missed[2] / std::max<double>(contributed, 1e-20)) + " of the contribution");
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "Test.h"
+
+#include "rendering/LightClusterGrid.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+//the light tree's city block seen from one end of the street
+struct CityStreet
+{
+	std::vector<Light> lights;
+	XMMATRIX view;
+	XMMATRIX invView;
+	LightClusterGrid grid;
+	float buildMs = 0.0F;
+
+	CityStreet(UINT32 lightCount, UINT& seed) : lights(lightCount)
+	{
+		for(UINT32 i = 0; i < lightCount; ++i)
+		{
+			Light& l = lights[i];
+			l.lightType = i == 0 ? LIGHT_TYPE_DIRECTIONAL : (i % 4 == 0 ? LIGHT_TYPE_SPOTLIGHT : LIGHT_TYPE_POINTLIGHT);
+			l.Strength = { 0.5F + nextRand(seed), 0.5F + nextRand(seed), 0.5F + nextRand(seed) };
+			l.Position = { nextRand(seed) * 400.0F - 200.0F, nextRand(seed) * 20.0F, nextRand(seed) * 400.0F - 200.0F };
+			l.Direction = { 0.0F, -1.0F, 0.0F };
+			l.FalloffStart = 1.0F;
+			l.FalloffEnd = 10.0F + nextRand(seed) * 30.0F;
+			l.SpotPower = 8.0F;
+			l.radius = 0.1F;
+		}
+
+		view = XMMatrixLookAtLH(XMVectorSet(0.0F, 5.0F, -220.0F, 1.0F), XMVectorSet(0.0F, 5.0F, 0.0F, 1.0F), XMVectorSet(0.0F, 1.0F, 0.0F, 0.0F));
+		invView = XMMatrixInverse(nullptr, view);
+
+		//the first build allocates the scratch lists
+		grid.build(lights.data(), lightCount, view, 0.25F * XM_PI, 16.0F / 9.0F, 0.1F);
+		const int builds = 16;
+		for(int b = 0; b < builds; ++b)
+		{
+			grid.build(lights.data(), lightCount, view, 0.25F * XM_PI, 16.0F / 9.0F, 0.1F);
+			buildMs += grid.getBuildTime() / builds;
+		}
+	}
+};
+
+//every light in a froxel list has to reach the froxel's view space box, rebuilt here from the depth and projection parameters
+//the grid may leave lights out only by overflowing, which the point test covers
+TEST_CASE(LightGridListedLightsTouch)
+{
+	UINT seed = 7;
+	CityStreet street(10000, seed);
+	const LightClusterGrid& grid = street.grid;
+	XMFLOAT4 depth = grid.getDepthParams();
+	XMFLOAT2 projScale = grid.getProjScale();
+
+	UINT32 wrong = 0, unsorted = 0, overflows = 0, listed = 0;
+	for(UINT32 c = 0; c < CLUSTER_GRID_COUNT; ++c)
+	{
+		const LightCluster& cluster = grid.getClusters()[c];
+		if(cluster.count == CLUSTER_OVERFLOW)
+		{
+			overflows++;
+			continue;
+		}
+
+		UINT32 x = c % CLUSTER_GRID_X;
+		UINT32 y = (c / CLUSTER_GRID_X) % CLUSTER_GRID_Y;
+		UINT32 z = c / (CLUSTER_GRID_X * CLUSTER_GRID_Y);
+		float zNear = depth.x * expf(z / depth.z);
+		float zFar = depth.x * expf((z + 1) / depth.z);
+		float x0 = (2.0F * x / CLUSTER_GRID_X - 1.0F) / projScale.x;
+		float x1 = (2.0F * (x + 1) / CLUSTER_GRID_X - 1.0F) / projScale.x;
+		float y0 = (2.0F * y / CLUSTER_GRID_Y - 1.0F) / projScale.y;
+		float y1 = (2.0F * (y + 1) / CLUSTER_GRID_Y - 1.0F) / projScale.y;
+		XMVECTOR boxMin = XMVectorSet(std::min<float>(x0 * zNear, x0 * zFar), std::min<float>(y0 * zNear, y0 * zFar), zNear, 0.0F);
+		XMVECTOR boxMax = XMVectorSet(std::max<float>(x1 * zNear, x1 * zFar), std::max<float>(y1 * zNear, y1 * zFar), zFar, 0.0F);
+
+		const UINT32* first = grid.getIndices().data() + cluster.offset;
+		const UINT32* last = first + cluster.count;
+		unsorted += std::is_sorted(first, last) ? 0 : 1;
+		for(const UINT32* i = first; i < last; ++i, ++listed)
+		{
+			const Light& l = street.lights[*i];
+			XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&l.Position), street.view);
+			float distance = XMVectorGetX(XMVector3Length(center - XMVectorClamp(center, boxMin, boxMax)));
+			if(l.lightType == LIGHT_TYPE_DIRECTIONAL || distance > (l.FalloffEnd + l.radius) * 1.001F)
+				wrong++;
+		}
+	}
+	CHECK_EQ(wrong, 0u);
+	CHECK_EQ(unsorted, 0u);
+	CHECK_EQ(overflows, grid.getOverflowCount());
+	CHECK_GT(listed, 0u);
+
+	Logger::INFO.log("Light grid (" + std::to_string(street.lights.size()) + " lights, " + std::to_string(CLUSTER_GRID_X) + "x" + std::to_string(CLUSTER_GRID_Y) + "x" + std::to_string(CLUSTER_GRID_Z) +
+					 "): build " + std::to_string(street.buildMs) + "ms, " + std::to_string(listed) + " indices, " + std::to_string(overflows) + " overflowing clusters");
+}
+
+//points in the frustum have to find every light reaching them in their froxel
+TEST_CASE(LightGridPointsFindLights)
+{
+	UINT seed = 7;
+	CityStreet street(10000, seed);
+	const LightClusterGrid& grid = street.grid;
+	XMFLOAT4 depth = grid.getDepthParams();
+	XMFLOAT2 projScale = grid.getProjScale();
+
+	UINT32 missed = 0, tested = 0;
+	for(int p = 0; p < 1024; ++p)
+	{
+		float z = depth.x * expf(nextRand(seed) * logf(depth.y / depth.x));
+		XMVECTOR viewPos = XMVectorSet((nextRand(seed) * 2.0F - 1.0F) * z / projScale.x, (nextRand(seed) * 2.0F - 1.0F) * z / projScale.y, z, 1.0F);
+		UINT32 c = grid.clusterIndex(viewPos);
+		if(c == UINT32_MAX || grid.getClusters()[c].count == CLUSTER_OVERFLOW)
+			continue;
+		tested++;
+
+		const UINT32* first = grid.getIndices().data() + grid.getClusters()[c].offset;
+		const UINT32* last = first + grid.getClusters()[c].count;
+		XMVECTOR pos = XMVector3TransformCoord(viewPos, street.invView);
+		for(UINT32 i = 0; i < (UINT32) street.lights.size(); ++i)
+		{
+			const Light& l = street.lights[i];
+			if(l.lightType == LIGHT_TYPE_DIRECTIONAL)
+				continue;
+			float d = XMVectorGetX(XMVector3Length(XMLoadFloat3(&l.Position) - pos));
+			if(d < l.FalloffEnd && !std::binary_search(first, last, i))
+				missed++;
+		}
+	}
+	CHECK_EQ(missed, 0u);
+	CHECK_GT(tested, 512u);
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "Test.h"
+
+#include "rendering/LightTree.h"
+#include "utils/Timer.h"
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+//a city block of point and spot lights under one sun
+static std::vector<Light> cityBlock(UINT32 lightCount, UINT& seed)
+{
+	std::vector<Light> lights(lightCount);
+	for(UINT32 i = 0; i < lightCount; ++i)
+	{
+		Light& l = lights[i];
+		l.lightType = i == 0 ? LIGHT_TYPE_DIRECTIONAL : (i % 4 == 0 ? LIGHT_TYPE_SPOTLIGHT : LIGHT_TYPE_POINTLIGHT);
+		l.Strength = { 0.5F + nextRand(seed), 0.5F + nextRand(seed), 0.5F + nextRand(seed) };
+		l.Position = { nextRand(seed) * 400.0F - 200.0F, nextRand(seed) * 20.0F, nextRand(seed) * 400.0F - 200.0F };
+		l.Direction = { 0.0F, -1.0F, 0.0F };
+		l.FalloffStart = 1.0F;
+		l.FalloffEnd = 10.0F + nextRand(seed) * 30.0F;
+		l.SpotPower = 8.0F;
+		l.radius = 0.1F;
+	}
+	return lights;
+}
+
+//every light in a corner moves, the tree is refitted instead of rebuilt
+static void moveCorner(std::vector<Light>& lights)
+{
+	for(auto& l:lights)
+	{
+		if(l.lightType != LIGHT_TYPE_DIRECTIONAL && l.Position.x < -180.0F && l.Position.z < -180.0F)
+			l.Position.y += 1.0F;
+	}
+}
+
+TEST_CASE(LightTreeRefit)
+{
+	UINT seed = 7;
+	std::vector<Light> lights = cityBlock(32768, seed);
+	LightTree tree;
+	CHECK(tree.update(lights.data(), (UINT32) lights.size()));
+	float buildMs = tree.getStats().buildMs;
+
+	CHECK(!tree.update(lights.data(), (UINT32) lights.size()));
+	moveCorner(lights);
+	CHECK(tree.update(lights.data(), (UINT32) lights.size()));
+
+	const LightTreeStats& stats = tree.getStats();
+	CHECK_EQ(stats.rebuilds, 1u);
+	CHECK_EQ(stats.refits, 1u);
+	CHECK_EQ(stats.localLights + stats.directionalLights, (UINT32) lights.size());
+	CHECK_LT(stats.maxDepth, (UINT32) LIGHT_TREE_MAX_DEPTH);
+
+	Logger::INFO.log("Light tree (" + std::to_string(stats.localLights) + " local, " + std::to_string(stats.directionalLights) + " directional): " + std::to_string(stats.nodeCount) + " nodes, depth " +
+					 std::to_string(stats.maxDepth) + ", build " + std::to_string(buildMs) + "ms, refit " + std::to_string(stats.refitMs) + "ms");
+}
+
+//the discrete pdfs have to add up to one everywhere, and sampling has to agree with them
+TEST_CASE(LightTreePdfs)
+{
+	UINT seed = 7;
+	std::vector<Light> lights = cityBlock(32768, seed);
+	LightTree tree;
+	tree.update(lights.data(), (UINT32) lights.size());
+	moveCorner(lights);
+	tree.update(lights.data(), (UINT32) lights.size());
+
+	double worstSum = 0.0;
+	float worstMismatch = 0.0F;
+	for(int p = 0; p < 16; ++p)
+	{
+		XMVECTOR pos = XMVectorSet(nextRand(seed) * 400.0F - 200.0F, 0.0F, nextRand(seed) * 400.0F - 200.0F, 1.0F);
+		XMVECTOR norm = XMVector3Normalize(XMVectorSet(nextRand(seed) - 0.5F, 1.0F, nextRand(seed) - 0.5F, 0.0F));
+
+		double sum = 0.0;
+		for(UINT32 i = 0; i < (UINT32) lights.size(); ++i)
+			sum += tree.pdf(pos, norm, i);
+		worstSum = std::max<double>(worstSum, fabs(sum - 1.0));
+
+		for(int s = 0; s < 64; ++s)
+		{
+			float samplePdf;
+			UINT32 light = tree.sample(pos, norm, nextRand(seed), samplePdf);
+			float expected = tree.pdf(pos, norm, light);
+			worstMismatch = std::max<float>(worstMismatch, fabsf(samplePdf - expected) / std::max<float>(expected, 1e-20F));
+		}
+	}
+	CHECK_LT(worstSum, 1e-3);
+	CHECK_LT(worstMismatch, 1e-3F);
+
+	Timer timer;
+	timer.reset();
+	const int samples = 1 << 16;
+	float pdfSum = 0.0F;
+	for(int s = 0; s < samples; ++s)
+	{
+		float samplePdf;
+		tree.sample(XMVectorSet(0.0F, 0.0F, 0.0F, 1.0F), XMVectorSet(0.0F, 1.0F, 0.0F, 0.0F), nextRand(seed), samplePdf);
+		pdfSum += samplePdf;
+	}
+	timer.tick();
+	Logger::INFO.log("Light tree: " + std::to_string(timer.deltaTime() * 1e9F / samples) + "ns per sample, mean pdf " + std::to_string(pdfSum / samples) + ", pdfs sum to 1 within " + std::to_string(worstSum));
+}
\ No newline at end of file
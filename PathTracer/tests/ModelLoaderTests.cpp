@@ -0,0 +1,249 @@
+#include "Test.h"
+
+#include "utils/GeometryGenerator.h"
+#include "utils/ModelLoader.h"
+#include "utils/Timer.h"
+
+#include <filesystem>
+
+using namespace DirectX;
+using namespace RT;
+
+static std::vector<Vertex> fromGenerator(const GeometryGenerator::MeshData& mesh)
+{
+	std::vector<Vertex> vertices(mesh.vertices.size());
+	for(size_t i = 0; i < vertices.size(); ++i)
+		vertices[i] = { mesh.vertices[i].position, mesh.vertices[i].normal, mesh.vertices[i].texC, { 0.0F, 0.0F, 0.0F, 1.0F } };
+	return vertices;
+}
+
+//worst unit length and orthogonality error, these have to hold for every vertex whatever its uvs
+static float frameError(const std::vector<Vertex>& vertices)
+{
+	float worst = 0.0F;
+	for(auto& v:vertices)
+	{
+		XMVECTOR t = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&v.tangent));
+		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.normal));
+		float error = std::max<float>(fabsf(XMVectorGetX(XMVector3Length(t)) - 1.0F), fabsf(XMVectorGetX(XMVector3Dot(t, n))));
+		error = fabsf(v.tangent.w) == 1.0F ? error : FLT_MAX;
+		worst = error == error ? std::max<float>(worst, error) : FLT_MAX;
+	}
+	return worst;
+}
+
+//every face of a cube keeps its own vertices and its generator tangent is the reference
+TEST_CASE(TangentsCube)
+{
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData box = geoGen.createBox(1.0F, 1.0F, 1.0F, 0);
+	std::vector<Vertex> cube = fromGenerator(box);
+	ModelLoader::calcTangents(box.indices32, cube);
+
+	float worstDot = 1.0F;
+	UINT32 flipped = 0;
+	for(size_t i = 0; i < cube.size(); ++i)
+	{
+		worstDot = std::min<float>(worstDot, XMVectorGetX(XMVector3Dot(XMLoadFloat4(&cube[i].tangent), XMLoadFloat3(&box.vertices[i].tangentU))));
+		flipped += cube[i].tangent.w < 0.0F ? 1 : 0;
+	}
+	CHECK_GT(worstDot, 0.9999F);
+	CHECK_EQ(flipped, 0u);
+}
+
+//a strip mirrored at x = 0, u runs towards the seam from both sides and the seam vertices are shared
+TEST_CASE(TangentsMirroredSeam)
+{
+	std::vector<Vertex> strip;
+	std::vector<UINT32> indices;
+	for(int y = 0; y <= 1; ++y)
+		for(int x = -2; x <= 2; ++x)
+			strip.push_back({ { (float) x, (float) y, 0.0F }, { 0.0F, 0.0F, 1.0F }, { 1.0F - abs(x) * 0.5F, (float) y }, { 0.0F, 0.0F, 0.0F, 1.0F } });
+	for(UINT32 x = 0; x < 4; ++x)
+		indices.insert(indices.end(), { x, x + 5, x + 6, x, x + 6, x + 1 });
+
+	ModelLoader::calcTangents(indices, strip);
+
+	UINT32 wrong = 0;
+	for(size_t i = 0; i < strip.size(); ++i)
+	{
+		float side = strip[i].position.x < 0.0F ? 1.0F : (strip[i].position.x > 0.0F ? -1.0F : 0.0F);
+		if(side != 0.0F && (fabsf(strip[i].tangent.x - side) > 1e-4F || strip[i].tangent.w != side))
+			wrong++;
+	}
+	CHECK_EQ(wrong, 0u);
+	CHECK_LT(frameError(strip), 1e-4F);
+}
+
+//a triangle with its uvs on a line next to a valid one, and one with all uvs equal on its own, must not spread infinities
+TEST_CASE(TangentsDegenerateUVs)
+{
+	std::vector<Vertex> vertices = {
+		{ { 0.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.0F, 0.0F }, {} },
+		{ { 0.0F, 0.0F, 1.0F }, { 0.0F, 1.0F, 0.0F }, { 0.0F, 1.0F }, {} },
+		{ { 1.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 1.0F, 0.0F }, {} },
+		{ { 1.0F, 0.0F, 1.0F }, { 0.0F, 1.0F, 0.0F }, { 0.5F, 0.5F }, {} },
+		{ { 5.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.5F, 0.5F }, {} },
+		{ { 5.0F, 0.0F, 1.0F }, { 0.0F, 1.0F, 0.0F }, { 0.5F, 0.5F }, {} },
+		{ { 6.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.5F, 0.5F }, {} }
+	};
+	std::vector<UINT32> indices = { 0, 1, 2, 2, 1, 3, 4, 5, 6 };
+	ModelLoader::calcTangents(indices, vertices);
+
+	CHECK_LT(frameError(vertices), 1e-4F);
+	for(int i = 0; i < 3; ++i)
+		CHECK_GT(vertices[i].tangent.x, 0.9999F);
+}
+
+//throughput on a large grid, its tangents all run along +x
+TEST_CASE(TangentsGrid)
+{
+	const UINT32 gridSize = 1024;
+	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData grid = geoGen.createGrid(100.0F, 100.0F, gridSize, gridSize);
+	std::vector<Vertex> vertices = fromGenerator(grid);
+
+	Timer timer;
+	timer.reset();
+	ModelLoader::calcTangents(grid.indices32, vertices);
+	timer.tick();
+	float ms = timer.deltaTime() * 1000.0F;
+	Logger::INFO.log(std::to_string(vertices.size()) + " vertices, " + std::to_string(grid.indices32.size() / 3) + " triangles in " + std::to_string(ms) + "ms (" +
+					 std::to_string(vertices.size() / std::max<float>(ms * 1e-3F, 1e-9F) * 1e-6F) + " Mvertices/s)");
+
+	float worst = 1.0F;
+	for(auto& v:vertices)
+		worst = std::min<float>(worst, v.tangent.x);
+	CHECK_GT(worst, 0.9999F);
+}
+
+//loadScene and loadOBJ append every mesh of the same file once in the same order, so they have to agree vertex by vertex
+TEST_CASE(ImportAgainstFlatLoader)
+{
+	ModelLoader::MeshData flat = ModelLoader::loadOBJ("res/models/bulb.glb");
+	ModelLoader::SceneData sceneData = ModelLoader::loadScene("res/models/bulb.glb");
+	REQUIRE(!sceneData.meshes.empty());
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	UINT32 mismatches = 0;
+	for(auto& mesh:sceneData.meshes)
+	{
+		for(size_t i = 0; i < mesh.vertices.size() && vertexCount + i < flat.vertices.size(); ++i)
+		{
+			const Vertex& a = mesh.vertices[i];
+			const Vertex& b = flat.vertices[vertexCount + i];
+			if(a.position.x != b.position.x || a.position.y != b.position.y || a.position.z != b.position.z)
+				mismatches++;
+		}
+		vertexCount += mesh.vertices.size();
+		indexCount += mesh.indices32.size();
+	}
+	CHECK_EQ(vertexCount, flat.vertices.size());
+	CHECK_EQ(indexCount, flat.indices32.size());
+	CHECK_EQ(mismatches, 0u);
+
+	UINT32 badInstances = 0;
+	for(auto& node:sceneData.instances)
+		if(node.mesh >= sceneData.meshes.size() || !std::isfinite(node.world._11 + node.world._22 + node.world._33 + node.world._41 + node.world._42 + node.world._43))
+			badInstances++;
+	CHECK(!sceneData.instances.empty());
+	CHECK_EQ(badInstances, 0u);
+}
+
+//copies of every node as instances of the shared meshes take less memory than baking them into one buffer
+TEST_CASE(ImportInstancing)
+{
+	const UINT32 copies = 256;
+	ModelLoader::SceneData sceneData = ModelLoader::loadScene("res/models/bulb.glb");
+	REQUIRE(!sceneData.instances.empty());
+
+	UINT64 sharedBytes = copies * sceneData.instances.size() * sizeof(XMFLOAT4X4);
+	for(auto& mesh:sceneData.meshes)
+		sharedBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices32.size() * sizeof(UINT32);
+
+	std::vector<Vertex> baked;
+	UINT64 bakedBytes = 0;
+	for(UINT32 c = 0; c < copies; ++c)
+	{
+		XMMATRIX offset = XMMatrixTranslation((float) c, 0.0F, 0.0F);
+		for(auto& node:sceneData.instances)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&node.world) * offset;
+			for(auto v:sceneData.meshes[node.mesh].vertices)
+			{
+				XMStoreFloat3(&v.position, XMVector3TransformCoord(XMLoadFloat3(&v.position), world));
+				baked.push_back(v);
+			}
+			bakedBytes += sceneData.meshes[node.mesh].indices32.size() * sizeof(UINT32);
+		}
+	}
+	bakedBytes += baked.size() * sizeof(Vertex);
+
+	Logger::INFO.log(std::to_string(copies * sceneData.instances.size()) + " instances, flattened " + std::to_string(bakedBytes / 1024) + "KB, instanced " + std::to_string(sharedBytes / 1024) + "KB");
+	CHECK_LT(sharedBytes, bakedBytes);
+}
+
+//a triangle drawn three times by one mesh, the parts use the first material, the second and none
+static void writePartsGLB(const std::string& fileName)
+{
+	float attributes[] = { 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F,
+						   0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 1.0F,
+						   0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 1.0F };
+	UINT32 indices[] = { 0, 1, 2 };
+	std::string bin(reinterpret_cast<const char*>(attributes), sizeof(attributes));
+	bin.append(reinterpret_cast<const char*>(indices), sizeof(indices));
+
+	std::string primitive = R"("attributes":{"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3)";
+	std::string json = R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],"nodes":[{"mesh":0}],)"
+		R"("meshes":[{"name":"parts","primitives":[{)" + primitive + R"(,"material":0},{)" + primitive + R"(,"material":1},{)" + primitive + R"(}]}],)"
+		R"("materials":[{"name":"red","pbrMetallicRoughness":{"baseColorFactor":[1,0,0,0.5],"metallicFactor":0,"roughnessFactor":0.5}},)"
+		R"({"alphaMode":"BLEND","emissiveFactor":[0,0,1],"pbrMetallicRoughness":{"baseColorFactor":[0.5,0.5,0.5,0.5],"metallicFactor":1,"roughnessFactor":0.2}}],)"
+		R"("buffers":[{"byteLength":)" + std::to_string(bin.size()) + R"(}],)"
+		R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":36},{"buffer":0,"byteOffset":36,"byteLength":36},{"buffer":0,"byteOffset":72,"byteLength":24},{"buffer":0,"byteOffset":96,"byteLength":12}],)"
+		R"("accessors":[{"bufferView":0,"componentType":5126,"count":3,"type":"VEC3","min":[0,0,0],"max":[1,1,0]},{"bufferView":1,"componentType":5126,"count":3,"type":"VEC3"},)"
+		R"({"bufferView":2,"componentType":5126,"count":3,"type":"VEC2"},{"bufferView":3,"componentType":5125,"count":3,"type":"SCALAR"}]})";
+	json.append((4 - json.size() % 4) % 4, ' ');
+
+	std::ofstream file(fileName, std::ios::binary);
+	auto u32 = [&](UINT32 v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+	u32(0x46546C67);
+	u32(2);
+	u32((UINT32) (12 + 8 + json.size() + 8 + bin.size()));
+	u32((UINT32) json.size());
+	u32(0x4E4F534A);
+	file << json;
+	u32((UINT32) bin.size());
+	u32(0x004E4942);
+	file << bin;
+}
+
+//every primitive becomes its own part with its own material, the factors are taken over
+TEST_CASE(ImportMaterials)
+{
+	std::string fileName = (std::filesystem::temp_directory_path() / "ImportMaterials.glb").string();
+	writePartsGLB(fileName);
+	ModelLoader::SceneData sceneData = ModelLoader::loadScene(fileName);
+	std::error_code ec;
+	std::filesystem::remove(fileName, ec);
+
+	REQUIRE(sceneData.meshes.size() == 3);
+	REQUIRE(sceneData.materials.size() == 2);
+	CHECK(sceneData.meshMaterials == std::vector<INT32>({ 0, 1, -1 }));
+	CHECK_EQ(sceneData.meshNames[1], std::string("parts.1"));
+	CHECK_EQ(sceneData.instances.size(), 3u);
+	CHECK_EQ(sceneData.meshes[2].indices32.size(), 3u);
+
+	const Material& red = sceneData.materials[0];
+	CHECK_EQ(red.name, std::string("red"));
+	CHECK_EQ(red.DiffuseAlbedo.w, 1.0F);
+	CHECK_NEAR(red.FresnelR0.y, 0.04F, 1e-6);
+	CHECK_NEAR(red.Roughness, 0.5F, 1e-6);
+
+	const Material& metal = sceneData.materials[1];
+	CHECK_EQ(metal.name, std::string("1"));
+	CHECK_NEAR(metal.DiffuseAlbedo.w, 0.5F, 1e-6);
+	CHECK_NEAR(metal.FresnelR0.x, 0.5F, 1e-6);
+	CHECK_NEAR(metal.metallic, 1.0F, 1e-6);
+	CHECK_NEAR(metal.emission.z, 1.0F, 1e-6);
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "Test.h"
+
+#include "rendering/EnvironmentMap.h"
+#include "rendering/PrefilteredEnvironment.h"
+#include "utils/Timer.h"
+
+#include <filesystem>
+
+using namespace DirectX;
+using namespace RT;
+
+static const UINT32 size = 64;
+static const UINT32 mips = 6;
+
+static float luminance(const XMFLOAT3& c)
+{
+	return 0.2126F * c.x + 0.7152F * c.y + 0.0722F * c.z;
+}
+
+//a smooth sky with a sun
+static std::vector<XMFLOAT3> sunSky()
+{
+	XMVECTOR sunDir = XMVector3Normalize(XMVectorSet(0.4F, 0.6F, -0.7F, 0.0F));
+	std::vector<XMFLOAT3> texels((size_t) 6 * size * size);
+	for(UINT32 face = 0; face < 6; ++face)
+	{
+		for(UINT32 y = 0; y < size; ++y)
+		{
+			for(UINT32 x = 0; x < size; ++x)
+			{
+				XMVECTOR dir = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size));
+				float up = std::max<float>(XMVectorGetY(dir), 0.0F);
+				float sun = XMVectorGetX(XMVector3Dot(dir, sunDir)) > 0.97F ? 20.0F : 0.0F;
+				texels[((size_t) face * size + y) * size + x] = XMFLOAT3(0.2F + 0.5F * up + sun, 0.3F + 0.6F * up + sun, 0.4F + 0.9F * up + sun);
+			}
+		}
+	}
+	return texels;
+}
+
+//solid angle weighted average luminance of one mip
+static double average(const std::vector<XMFLOAT3>& mip, UINT32 s)
+{
+	double sum = 0.0;
+	for(UINT32 face = 0; face < 6; ++face)
+		for(UINT32 y = 0; y < s; ++y)
+			for(UINT32 x = 0; x < s; ++x)
+				sum += luminance(mip[((size_t) face * s + y) * s + x]) * EnvironmentMap::texelSolidAngle(x, y, s);
+	return sum / (4.0 * XM_PI);
+}
+
+namespace RT
+{
+	struct PrefilteredEnvironmentTests
+	{
+		//what the renderer loads reads back the same, and is only reused for the same source
+		static void cache()
+		{
+			std::vector<std::vector<XMFLOAT3>> baked = PrefilteredEnvironment::prefilter(sunSky(), size, mips, PREFILTER_SAMPLES);
+			std::wstring fileName = PrefilteredEnvironment::cubemapFile("benchmark");
+			REQUIRE(PrefilteredEnvironment::writeDDS(fileName, baked, size, 42));
+
+			std::vector<XMFLOAT3> decoded;
+			UINT32 decodedSize = 0;
+			bool decodedOk = EnvironmentMap::decodeCubemap(fileName, decoded, decodedSize, size);
+			CHECK(decodedOk);
+			CHECK_EQ(decodedSize, size);
+			float worstHalf = 0.0F;
+			for(size_t i = 0; decodedOk && i < decoded.size(); ++i)
+				worstHalf = std::max<float>(worstHalf, fabsf(decoded[i].x - baked[0][i].x) / std::max<float>(baked[0][i].x, 1e-3F));
+			CHECK_LT(worstHalf, 1e-3F);
+
+			CHECK(PrefilteredEnvironment::isCached(fileName, 42));
+			CHECK(!PrefilteredEnvironment::isCached(fileName, 43));
+
+			std::error_code ec;
+			std::filesystem::remove(fileName, ec);
+		}
+	};
+}
+
+//a mirror reflects everything, rough surfaces lose energy to masking but never gain any
+TEST_CASE(PrefilterBrdfTable)
+{
+	float worstMirror = 0.0F;
+	for(UINT32 i = 1; i <= 16; ++i)
+	{
+		XMFLOAT2 mirror = PrefilteredEnvironment::integrateBrdf(i / 16.0F, 0.0F, 64);
+		worstMirror = std::max<float>(worstMirror, fabsf(mirror.x + mirror.y - 1.0F));
+	}
+	CHECK_LT(worstMirror, 1e-3F);
+
+	Timer timer;
+	timer.reset();
+	std::vector<XMFLOAT2> table = PrefilteredEnvironment::integrateBrdf(BRDF_LUT_SIZE, BRDF_LUT_SAMPLES);
+	timer.tick();
+	Logger::INFO.log("BRDF table " + std::to_string(BRDF_LUT_SIZE) + "^2 in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+
+	REQUIRE(table.size() == (size_t) BRDF_LUT_SIZE * BRDF_LUT_SIZE);
+	float maxSum = 0.0F;
+	for(auto& t:table)
+		maxSum = std::max<float>(maxSum, t.x + t.y);
+	CHECK_LE(maxSum, 1.001F);
+}
+
+//a constant environment stays constant at every roughness
+TEST_CASE(PrefilterConstant)
+{
+	std::vector<XMFLOAT3> flat((size_t) 6 * size * size, XMFLOAT3(0.5F, 0.5F, 0.5F));
+	float worstFlat = 0.0F;
+	for(auto& mip:PrefilteredEnvironment::prefilter(flat, size, mips, 64))
+		for(auto& c:mip)
+			worstFlat = std::max<float>(worstFlat, fabsf(c.x - 0.5F));
+	CHECK_LT(worstFlat, 1e-3F);
+}
+
+//the bake is the same on every run and the lobe moves energy around without creating any
+TEST_CASE(PrefilterSky)
+{
+	std::vector<XMFLOAT3> texels = sunSky();
+	Timer timer;
+	timer.reset();
+	auto first = PrefilteredEnvironment::prefilter(texels, size, mips, PREFILTER_SAMPLES);
+	timer.tick();
+	Logger::INFO.log("Prefiltered " + std::to_string(size) + "^2 x " + std::to_string(mips) + " mips in " + std::to_string(timer.deltaTime() * 1000.0F) + "ms");
+	auto second = PrefilteredEnvironment::prefilter(texels, size, mips, PREFILTER_SAMPLES);
+
+	REQUIRE(first.size() == mips && second.size() == mips);
+	UINT32 different = 0;
+	for(UINT32 m = 0; m < mips; ++m)
+		different += memcmp(first[m].data(), second[m].data(), sizeof(XMFLOAT3) * first[m].size()) == 0 ? 0 : 1;
+	CHECK_EQ(different, 0u);
+
+	double reference = average(first[0], size);
+	double worstEnergy = 0.0;
+	for(UINT32 m = 1; m < mips; ++m)
+		worstEnergy = std::max<double>(worstEnergy, fabs(average(first[m], size >> m) / reference - 1.0));
+	CHECK_LT(worstEnergy, 0.05);
+}
+
+TEST_CASE(PrefilterCache)
+{
+	PrefilteredEnvironmentTests::cache();
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "Test.h"
+
+#include "rendering/ProgressiveAccumulation.h"
+#include "rendering/cpu/CpuPathTracer.h"
+
+#include <functional>
+
+using namespace DirectX;
+using namespace RT;
+
+//the box scene driven through detectChanges like a renderer would, the tracer is only there for its scene and settings
+struct ProgressiveScene
+{
+	CpuPathTracer tracer { 1280, 720 };
+	Scene* scene = nullptr;
+	Camera* cam = nullptr;
+	ProgressiveAccumulation progressive;
+
+	ProgressiveScene()
+	{
+		REQUIRE(tracer.initContext("box"));
+		scene = tracer.getScene();
+		cam = tracer.getCamera();
+
+		//the first frame always starts over, then a static view keeps accumulating
+		settle();
+		settle();
+		REQUIRE(frame());
+	}
+
+	//what the renderer does to the dirty flags once a frame is uploaded, and at the end of the frame
+	void settle()
+	{
+		cam->updateViewMatrix();
+		cam->cleanView();
+		for(auto& e:scene->getAllEntities())
+		{
+			while(e->isDirty())
+				e->cleanOne();
+			e->refitted();
+		}
+		for(auto& geo:scene->getResidentGeometries())
+			geo->needsRefit = false;
+		for(auto& m:scene->getMaterials())
+			m->NumFramesDirty = 0;
+
+		cam->saveState();
+		for(auto& e:scene->getAllEntities())
+			e->saveState();
+	}
+
+	bool frame()
+	{
+		bool reset = progressive.update(ProgressiveAccumulation::detectChanges(scene, cam, tracer.settings));
+		settle();
+		return reset;
+	}
+
+	//has to reset once, and then accumulate again
+	void trigger(const std::function<void()>& change)
+	{
+		change();
+		//transforms are picked up by the frame after the one they were set in, like their constant buffers
+		bool reset = frame() || frame();
+		bool settled = !frame();
+		CHECK(reset);
+		CHECK(settled);
+		CHECK_EQ(progressive.getFrameCount(), 2u);
+	}
+};
+
+TEST_CASE(ProgressiveStaticView)
+{
+	ProgressiveScene s;
+	for(int i = 0; i < 3; ++i)
+		CHECK(!s.frame());
+	CHECK_EQ(s.progressive.getFrameCount(), 4u);
+}
+
+TEST_CASE(ProgressiveCameraMove)
+{
+	ProgressiveScene s;
+	s.trigger([&]() { s.cam->walk(0.1F); });
+}
+
+TEST_CASE(ProgressiveEntityTransform)
+{
+	ProgressiveScene s;
+	Entity* entity = nullptr;
+	for(auto& e:s.scene->getAllEntities())
+		if(!entity && e->getInstanceCount() > 0)
+			entity = e.get();
+	REQUIRE(entity);
+
+	s.trigger([&]()
+	{
+		XMFLOAT3 pos = entity->getPos(0);
+		entity->setPos(0, { pos.x, pos.y + 0.1F, pos.z });
+	});
+}
+
+TEST_CASE(ProgressiveMaterialEdit)
+{
+	ProgressiveScene s;
+	REQUIRE(!s.scene->getMaterials().empty());
+	s.trigger([&]()
+	{
+		Material* m = s.scene->getMaterials()[0].get();
+		m->Roughness = std::min<float>(m->Roughness + 0.1F, 1.0F);
+		m->NumFramesDirty = NUM_FRAME_RESOURCES;
+	});
+}
+
+TEST_CASE(ProgressiveLightHash)
+{
+	ProgressiveScene s;
+	REQUIRE(s.scene->getLightCount() > 0);
+	s.trigger([&]() { s.scene->getLightPtr(0)->Strength.x += 0.1F; });
+}
+
+TEST_CASE(ProgressiveSettingsHash)
+{
+	ProgressiveScene s;
+	s.trigger([&]() { s.tracer.settings.indirect = !s.tracer.settings.indirect; });
+}
\ No newline at end of file
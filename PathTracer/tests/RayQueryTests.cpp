@@ -0,0 +1,156 @@
+#include "Test.h"
+
+#include "rendering/cpu/CpuPathTracer.h"
+#include "rendering/cpu/RayQuery.h"
+#include "utils/Timer.h"
+
+#include <atomic>
+
+using namespace DirectX;
+using namespace RT;
+
+//closest t over every triangle of every instance in double precision, FLT_MAX on a miss
+static float bruteForce(Scene* scene, const CpuRay& ray)
+{
+	double closest = ray.tMax;
+	bool hit = false;
+	for(auto& e:scene->getAllEntities())
+	{
+		const MeshGeometry* geo = e->getGeo();
+		if(!geo)
+			continue;
+		const SubmeshGeometry& submesh = geo->DrawArgs.at("0");
+		const Vertex* vertices = reinterpret_cast<const Vertex*>(geo->VertexBufferCPU.data()) + submesh.BaseVertexLocation;
+		const UINT32* indices = reinterpret_cast<const UINT32*>(geo->IndexBufferCPU.data()) + submesh.StartIndexLocation;
+
+		for(auto& inst:e->getInstances())
+		{
+			XMMATRIX world = XMLoadFloat4x4(&inst.world);
+			XMVECTOR det = XMMatrixDeterminant(world);
+			XMMATRIX invWorld = XMMatrixInverse(&det, world);
+			XMFLOAT3 o, d;
+			XMStoreFloat3(&o, XMVector3TransformCoord(XMLoadFloat3(&ray.origin), invWorld));
+			XMStoreFloat3(&d, XMVector3TransformNormal(XMLoadFloat3(&ray.direction), invWorld));
+
+			//Möller-Trumbore, object space t is world space t since the direction is transformed unnormalized
+			for(UINT32 t = 0; t < submesh.IndexCount / 3; ++t)
+			{
+				const XMFLOAT3& a = vertices[indices[3 * t]].position;
+				const XMFLOAT3& b = vertices[indices[3 * t + 1]].position;
+				const XMFLOAT3& c = vertices[indices[3 * t + 2]].position;
+				double e1[3] = { (double) b.x - a.x, (double) b.y - a.y, (double) b.z - a.z };
+				double e2[3] = { (double) c.x - a.x, (double) c.y - a.y, (double) c.z - a.z };
+				double p[3] = { d.y * e2[2] - d.z * e2[1], d.z * e2[0] - d.x * e2[2], d.x * e2[1] - d.y * e2[0] };
+				double determinant = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+				if(determinant == 0.0)
+					continue;
+				double s[3] = { (double) o.x - a.x, (double) o.y - a.y, (double) o.z - a.z };
+				double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) / determinant;
+				double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+				double v = (d.x * q[0] + d.y * q[1] + d.z * q[2]) / determinant;
+				double hitT = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) / determinant;
+				if(u >= 0.0 && v >= 0.0 && u + v <= 1.0 && hitT > ray.tMin && hitT < closest)
+				{
+					closest = hitT;
+					hit = true;
+				}
+			}
+		}
+	}
+	return hit ? (float) closest : FLT_MAX;
+}
+
+//camera rays and incoherent visibility rays from their hits, a sparse subset against every triangle
+TEST_CASE(RayQueryScene)
+{
+	CpuPathTracer tracer(1280, 720);
+	REQUIRE(tracer.initContext("box"));
+	Scene* scene = tracer.getScene();
+	Camera* cam = tracer.getCamera();
+	cam->updateViewMatrix();
+	UINT32 width = tracer.settings.width;
+	UINT32 height = tracer.settings.height;
+
+	Timer timer;
+	RayQuery query;
+
+	timer.reset();
+	query.build(scene);
+	timer.tick();
+	float buildMs = timer.deltaTime() * 1000.0F;
+
+	std::vector<CpuRay> rays((size_t) width * height);
+	parallelFor(UINT32(0), height, [&](UINT32 y)
+	{
+		for(UINT32 x = 0; x < width; ++x)
+			rays[(size_t) y * width + x] = RayQuery::cameraRay(cam, (x + 0.5F) / width, (y + 0.5F) / height);
+	});
+
+	std::vector<RayQueryHit> hits;
+	timer.reset();
+	query.closestHit(rays, hits);
+	timer.tick();
+	float closestMs = timer.deltaTime() * 1000.0F;
+
+	//like probe or shadow tests
+	std::vector<CpuRay> secondary;
+	for(size_t i = 0; i < hits.size(); ++i)
+	{
+		if(hits[i].instanceID == UINT32_MAX)
+			continue;
+
+		UINT32 h = (UINT32) i * 0x9E3779B9u;
+		h = (h ^ 61u) ^ (h >> 16);
+		h *= 9u;
+		h ^= h >> 4;
+		h *= 0x27D4EB2Du;
+		h ^= h >> 15;
+		float z = (h & 0xFFFF) / 32767.5F - 1.0F;
+		float phi = (h >> 16) / 65536.0F * XM_2PI;
+		float r = sqrtf(std::max<float>(0.0F, 1.0F - z * z));
+
+		CpuRay ray;
+		XMStoreFloat3(&ray.origin, XMLoadFloat3(&rays[i].origin) + XMLoadFloat3(&rays[i].direction) * hits[i].t);
+		ray.direction = { r * cosf(phi), z, r * sinf(phi) };
+		ray.tMin = 0.01F;
+		ray.tMax = 1000.0F;
+		secondary.push_back(ray);
+	}
+	REQUIRE(!secondary.empty());
+
+	std::vector<UINT8> occluded;
+	timer.reset();
+	query.anyHit(secondary, occluded);
+	timer.tick();
+	float anyMs = timer.deltaTime() * 1000.0F;
+
+	UINT64 occludedCount = 0;
+	for(UINT8 o:occluded)
+		occludedCount += o;
+
+	//the traversal must not lose or invent hits
+	const UINT32 stride = 61;
+	UINT32 tested = (UINT32) ((rays.size() + stride - 1) / stride);
+	std::atomic<UINT32> wrongClosest = 0, wrongAny = 0;
+	parallelFor(UINT32(0), tested, [&](UINT32 k)
+	{
+		size_t i = (size_t) k * stride;
+		float t = bruteForce(scene, rays[i]);
+		bool hit = hits[i].instanceID != UINT32_MAX;
+		if(hit != (t != FLT_MAX) || (hit && fabsf(hits[i].t - t) > 1e-4F * std::max<float>(t, 1.0F)))
+			wrongClosest++;
+	});
+	parallelFor(UINT32(0), (UINT32) ((secondary.size() + stride - 1) / stride), [&](UINT32 k)
+	{
+		size_t i = (size_t) k * stride;
+		if((occluded[i] != 0) != (bruteForce(scene, secondary[i]) != FLT_MAX))
+			wrongAny++;
+	});
+	CHECK_EQ(wrongClosest.load(), 0u);
+	CHECK_EQ(wrongAny.load(), 0u);
+
+	Logger::INFO.log("Ray query: " + std::to_string(query.getInstanceCount()) + " instances over " + std::to_string(query.getBottomLevelCount()) + " geometries built in " + std::to_string(buildMs) +
+					 "ms, closest hit " + std::to_string(rays.size() / std::max<float>(closestMs * 1e-3F, 1e-9F) * 1e-6F) + " Mrays/s (" + std::to_string(secondary.size()) + "/" +
+					 std::to_string(rays.size()) + " hits), any hit " + std::to_string(secondary.size() / std::max<float>(anyMs * 1e-3F, 1e-9F) * 1e-6F) + " Mrays/s (" +
+					 std::to_string(occludedCount) + " occluded), " + std::to_string(tested) + " camera rays checked against brute force");
+}
\ No newline at end of file
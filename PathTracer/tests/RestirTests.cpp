@@ -0,0 +1,218 @@
+#include "Test.h"
+
+#include "rendering/LightAliasTable.h"
+#include "rendering/Restir.h"
+#include "rendering/Sampling.h"
+#include "utils/Timer.h"
+
+#include <functional>
+
+using namespace DirectX;
+using namespace RT;
+
+//synthetic light sets above a floor, 64 point lights and 256 mixed ones with a sun
+struct LightSets
+{
+	std::vector<Light> points = std::vector<Light>(64);
+	std::vector<Light> mixed = std::vector<Light>(256);
+
+	LightSets()
+	{
+		uint seed = initRand(3, 0);
+		auto randomColor = [&](float scale) { return XMFLOAT3(scale * (0.2F + nextRand(seed)), scale * (0.2F + nextRand(seed)), scale * (0.2F + nextRand(seed))); };
+		auto randomPosition = [&]() { return XMFLOAT3(20.0F * nextRand(seed) - 10.0F, 0.5F + 8.0F * nextRand(seed), 20.0F * nextRand(seed) - 10.0F); };
+
+		for(auto& l:points)
+		{
+			l = {};
+			l.lightType = LIGHT_TYPE_POINTLIGHT;
+			l.Strength = randomColor(nextRand(seed) * nextRand(seed) * 50.0F);
+			l.Position = randomPosition();
+			l.FalloffStart = 1.0F;
+			l.FalloffEnd = 25.0F;
+		}
+
+		for(size_t i = 0; i < mixed.size(); ++i)
+		{
+			Light& l = mixed[i];
+			l = {};
+			l.lightType = i == 0 ? LIGHT_TYPE_DIRECTIONAL : (int) (i % 3) + 1;
+			l.Strength = randomColor(i == 0 ? 1.0F : nextRand(seed) * nextRand(seed) * 50.0F);
+			l.Position = randomPosition();
+			l.FalloffStart = l.lightType == LIGHT_TYPE_TRIANGLE ? 0.3F : 1.0F;
+			l.FalloffEnd = 25.0F;
+			l.SpotPower = 8.0F;
+			XMVECTOR toFloor = XMVectorSet(nextRand(seed) - 0.5F, -1.0F, nextRand(seed) - 0.5F, 0.0F);
+			XMStoreFloat3(&l.Direction, XMVector3Normalize(toFloor));
+		}
+	}
+};
+
+//a rough dielectric and a glossy metal
+static std::vector<RestirSurface> surfaces()
+{
+	std::vector<RestirSurface> result = {
+		{ { 0.0F, 0.0F, 0.0F }, { 0.0F, 1.0F, 0.0F }, { 0.04F, 0.04F, 0.04F }, { 0.0F, 0.0F, 0.0F }, 0.8F },
+		{ { 1.0F, 0.0F, -2.0F }, { 0.0F, 1.0F, 0.0F }, { 0.9F, 0.6F, 0.3F }, { 0.0F, 0.0F, 0.0F }, 0.2F }
+	};
+	XMStoreFloat3(&result[0].toEye, XMVector3Normalize(XMVectorSet(0.3F, 1.0F, 0.2F, 0.0F)));
+	XMStoreFloat3(&result[1].toEye, XMVector3Normalize(XMVectorSet(-0.6F, 0.5F, 0.4F, 0.0F)));
+	return result;
+}
+
+static float luma(FXMVECTOR c)
+{
+	return XMVectorGetX(XMVector3Dot(c, XMVectorSet(0.2126F, 0.7152F, 0.0722F, 0.0F)));
+}
+
+struct Estimate
+{
+	double mean;
+	double variance;
+};
+
+static const UINT32 trials = 1 << 16;
+
+//the estimator shades the picked light with W, its expectation is the sum over all the lights
+static Estimate estimate(const std::vector<Light>& lights, const RestirSurface& surface, const std::function<Reservoir(UINT32)>& reservoir)
+{
+	double sum = 0.0, squared = 0.0;
+	for(UINT32 i = 0; i < trials; ++i)
+	{
+		Reservoir r = reservoir(i);
+		double f = r.M > 0 && r.weightSum > 0.0F ? luma(Restir::contribution(lights[r.sampleIndex], surface)) * r.W : 0.0;
+		sum += f;
+		squared += f * f;
+	}
+	double mean = sum / trials;
+	return Estimate{ mean, std::max<double>(squared / trials - mean * mean, 0.0) };
+}
+
+//candidates alone and merged like hit.hlsl merges the history and restir_spatial.hlsl the neighbours, none of them may be biased
+//and merging more candidates has to lower the variance
+static void checkEstimators(const std::vector<Light>& lights)
+{
+	LightAliasTable table;
+	table.update(lights.data(), (UINT32) lights.size());
+
+	for(auto& surface:surfaces())
+	{
+		double truth = 0.0;
+		for(auto& l:lights)
+			truth += luma(Restir::contribution(l, surface));
+
+		auto candidates = [&](UINT32 count, const LightAliasTable* source)
+		{
+			return [&, count, source](UINT32 i)
+			{
+				UINT32 rng = initRand(i, 0);
+				return Restir::sampleCandidates(lights, surface, count, rng, source);
+			};
+		};
+		auto temporal = [&](UINT32 i)
+		{
+			UINT32 history = initRand(i, 1);
+			Reservoir previous = Restir::sampleCandidates(lights, surface, RESTIR_CANDIDATES, history);
+			UINT32 rng = initRand(i, 0);
+			Reservoir current = Restir::sampleCandidates(lights, surface, RESTIR_CANDIDATES, rng);
+			return Restir::mergeReservoir(current, previous, lights, surface, rng);
+		};
+		auto spatial = [&](UINT32 i)
+		{
+			Reservoir neighbours[RESTIR_SPATIAL_NEIGHBOURS];
+			for(UINT32 n = 0; n < RESTIR_SPATIAL_NEIGHBOURS; ++n)
+			{
+				UINT32 rng = initRand(i * RESTIR_SPATIAL_NEIGHBOURS + n, 2);
+				neighbours[n] = Restir::sampleCandidates(lights, surface, RESTIR_CANDIDATES, rng);
+			}
+			return Restir::mergeReservoirSpatial(neighbours, lights, surface, initRand(i, 3));
+		};
+		//every light once in order with one seed, like the small scene loop of indirect.hlsl
+		auto everyLight = [&](UINT32 i)
+		{
+			Reservoir reservoir = {};
+			UINT32 rng = initRand(i, 4);
+			for(UINT32 l = 0; l < (UINT32) lights.size(); ++l)
+				Restir::computeLightSample(reservoir, lights, l, surface, rng, 1.0F / lights.size());
+			return reservoir;
+		};
+
+		std::pair<std::string, Estimate> results[] = {
+			{ "1 candidate", estimate(lights, surface, candidates(1, nullptr)) },
+			{ std::to_string(RESTIR_CANDIDATES) + " candidates", estimate(lights, surface, candidates(RESTIR_CANDIDATES, nullptr)) },
+			{ std::to_string(4 * RESTIR_CANDIDATES) + " candidates", estimate(lights, surface, candidates(4 * RESTIR_CANDIDATES, nullptr)) },
+			{ std::to_string(RESTIR_CANDIDATES) + " alias table candidates", estimate(lights, surface, candidates(RESTIR_CANDIDATES, &table)) },
+			{ "temporal merge", estimate(lights, surface, temporal) },
+			{ "spatial merge", estimate(lights, surface, spatial) },
+			{ "every light", estimate(lights, surface, everyLight) }
+		};
+
+		//more than 4 standard errors away from the sum is bias
+		for(auto& [name, e]:results)
+		{
+			double error = (e.mean - truth) / std::max<double>(sqrt(e.variance / trials), 1e-20);
+			CHECK_MSG(fabs(error) < 4.0, name + ": mean " + std::to_string(e.mean) + " for " + std::to_string(truth) + " (" + std::to_string(error) + " standard errors)");
+		}
+		CHECK_LT(results[1].second.variance, results[0].second.variance);
+		CHECK_LT(results[2].second.variance, results[1].second.variance);
+		CHECK_LT(results[4].second.variance, results[1].second.variance);
+	}
+}
+
+//the structured buffers of the shaders read it with this stride
+TEST_CASE(RestirLayout)
+{
+	CHECK_EQ(sizeof(Reservoir), 16u);
+	CHECK_EQ(offsetof(Reservoir, weightSum), 4u);
+	CHECK_EQ(offsetof(Reservoir, W), 8u);
+	CHECK_EQ(offsetof(Reservoir, M), 12u);
+}
+
+TEST_CASE(RestirPointLights)
+{
+	checkEstimators(LightSets().points);
+}
+
+TEST_CASE(RestirMixedLights)
+{
+	checkEstimators(LightSets().mixed);
+}
+
+//cost of the candidate loop and of both merges
+TEST_CASE(RestirCost)
+{
+	std::vector<Light> mixed = LightSets().mixed;
+	RestirSurface surface = surfaces()[0];
+
+	const UINT32 timedTrials = 1 << 14;
+	float sink = 0.0F;
+	Timer timer;
+	timer.reset();
+	for(UINT32 i = 0; i < timedTrials; ++i)
+	{
+		UINT32 rng = initRand(i, 5);
+		sink += Restir::sampleCandidates(mixed, surface, RESTIR_CANDIDATES, rng).W;
+	}
+	timer.tick();
+	float candidateNs = timer.deltaTime() * 1e9F / (timedTrials * RESTIR_CANDIDATES);
+
+	Reservoir neighbours[RESTIR_SPATIAL_NEIGHBOURS];
+	for(UINT32 n = 0; n < RESTIR_SPATIAL_NEIGHBOURS; ++n)
+	{
+		UINT32 rng = initRand(n, 6);
+		neighbours[n] = Restir::sampleCandidates(mixed, surface, RESTIR_CANDIDATES, rng);
+	}
+	timer.reset();
+	for(UINT32 i = 0; i < timedTrials; ++i)
+		sink += Restir::mergeReservoir(neighbours[i % RESTIR_SPATIAL_NEIGHBOURS], neighbours[(i + 1) % RESTIR_SPATIAL_NEIGHBOURS], mixed, surface, i).W;
+	timer.tick();
+	float mergeNs = timer.deltaTime() * 1e9F / timedTrials;
+	timer.reset();
+	for(UINT32 i = 0; i < timedTrials; ++i)
+		sink += Restir::mergeReservoirSpatial(neighbours, mixed, surface, i).W;
+	timer.tick();
+	float spatialNs = timer.deltaTime() * 1e9F / timedTrials;
+	Logger::INFO.log(std::to_string(candidateNs) + "ns per candidate, " + std::to_string(mergeNs) + "ns per temporal merge, " + std::to_string(spatialNs) + "ns per spatial merge" +
+					 (sink < 0.0F ? " " : ""));
+	CHECK(std::isfinite(sink));
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include "rendering/Sampling.h"
+#include "utils/Timer.h"
+
+#include <set>
+
+using namespace DirectX;
+using namespace RT;
+
+static const UINT32 log2Count = 8;
+static const UINT32 count = 1 << log2Count;
+static const UINT32 pixels = 16;
+static const UINT32 draws = 4;
+
+//the pair a pixel gets after skipping draw earlier ones
+static std::vector<XMFLOAT2> sobolPoints(UINT32 pixel, UINT32 draw, UINT32 n)
+{
+	std::vector<XMFLOAT2> points(n);
+	for(UINT32 i = 0; i < n; ++i)
+	{
+		SobolSampler s = initSampler(pixel % 128, pixel / 128, i);
+		for(UINT32 d = 0; d < draw; ++d)
+			sampleNext2D(s);
+		points[i] = sampleNext2D(s);
+	}
+	return points;
+}
+
+static std::vector<XMFLOAT2> pcgPoints(UINT32 pixel, UINT32 n)
+{
+	std::vector<XMFLOAT2> points(n);
+	uint seed = initRand(pixel, 0);
+	for(auto& p:points)
+		p = XMFLOAT2(nextRand(seed), nextRand(seed));
+	return points;
+}
+
+//every pair drawn together is a (0, 2) net, each elementary interval of area 1 / count holds one point
+TEST_CASE(SobolStratification)
+{
+	UINT32 brokenNets = 0;
+	for(UINT32 pixel = 0; pixel < pixels; ++pixel)
+	{
+		for(UINT32 draw = 0; draw < draws; ++draw)
+		{
+			std::vector<XMFLOAT2> points = sobolPoints(pixel * 977, draw, count);
+			for(UINT32 a = 0; a <= log2Count; ++a)
+			{
+				UINT32 columns = 1 << a;
+				UINT32 rows = count / columns;
+				std::set<UINT32> cells;
+				for(auto& p:points)
+					cells.insert((UINT32) (p.x * columns) * rows + (UINT32) (p.y * rows));
+				brokenNets += cells.size() != count;
+			}
+		}
+	}
+	CHECK_EQ(brokenNets, 0u);
+}
+
+//star discrepancy against the PCG stream
+TEST_CASE(SobolDiscrepancy)
+{
+	double sobolDiscrepancy = 0.0, pcgDiscrepancy = 0.0;
+	for(UINT32 pixel = 0; pixel < pixels; ++pixel)
+	{
+		sobolDiscrepancy += Sampling::starDiscrepancy(sobolPoints(pixel * 977, pixel % draws, count)) / pixels;
+		pcgDiscrepancy += Sampling::starDiscrepancy(pcgPoints(pixel * 977, count)) / pixels;
+	}
+	CHECK_LT(sobolDiscrepancy * 4.0, pcgDiscrepancy);
+}
+
+//draws after each other are padded with different scrambles and must not be correlated
+TEST_CASE(SobolPadding)
+{
+	const UINT32 pairs = 4096;
+	double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+	for(UINT32 i = 0; i < pairs; ++i)
+	{
+		SobolSampler s = initSampler(17, 5, i);
+		double x = sampleNext1D(s);
+		double y = sampleNext1D(s);
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		syy += y * y;
+		sxy += x * y;
+	}
+	double covariance = sxy / pairs - (sx / pairs) * (sy / pairs);
+	double correlation = covariance / sqrt((sxx / pairs - (sx / pairs) * (sx / pairs)) * (syy / pairs - (sy / pairs) * (sy / pairs)));
+	CHECK_LT(fabs(correlation), 0.05);
+}
+
+//a bounce starts where the draws of the one before it end, so its first pair is a fresh padding of the sequence
+TEST_CASE(SobolBounces)
+{
+	const UINT32 pairs = 4096;
+	UINT32 mismatches = 0;
+	double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+	for(UINT32 i = 0; i < pairs; ++i)
+	{
+		SobolSampler first = initSampler(17, 5, i, 0);
+		SobolSampler second = initSampler(17, 5, i, 1);
+		double x = sampleNext1D(first);
+		for(UINT32 d = 1; d < SAMPLER_BOUNCE_DIMENSIONS; ++d)
+			sampleNext1D(first);
+		double y = sampleNext1D(second);
+		mismatches += sampleNext1D(first) != y ? 1 : 0;
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		syy += y * y;
+		sxy += x * y;
+	}
+	double covariance = sxy / pairs - (sx / pairs) * (sy / pairs);
+	double correlation = covariance / sqrt((sxx / pairs - (sx / pairs) * (sx / pairs)) * (syy / pairs - (sy / pairs) * (sy / pairs)));
+	CHECK_EQ(mismatches, 0u);
+	CHECK_LT(fabs(correlation), 0.05);
+}
+
+//convergence on a smooth integrand that integrates to 1, and the cost of a 2D sample with the seeding
+TEST_CASE(SobolConvergence)
+{
+	auto integrand = [](const XMFLOAT2& u) { return XM_PI * XM_PI / 4.0F * sinf(XM_PI * u.x) * sinf(XM_PI * u.y); };
+	double sobolError = 0.0, pcgError = 0.0;
+	for(UINT32 n = 16; n <= 1024; n *= 4)
+	{
+		double sobolSquared = 0.0, pcgSquared = 0.0;
+		for(UINT32 pixel = 0; pixel < 64; ++pixel)
+		{
+			double sobolSum = 0.0, pcgSum = 0.0;
+			for(auto& p:sobolPoints(pixel * 31, 0, n))
+				sobolSum += integrand(p);
+			for(auto& p:pcgPoints(pixel * 31, n))
+				pcgSum += integrand(p);
+			sobolSquared += (sobolSum / n - 1.0) * (sobolSum / n - 1.0);
+			pcgSquared += (pcgSum / n - 1.0) * (pcgSum / n - 1.0);
+		}
+		sobolError = sqrt(sobolSquared / 64);
+		pcgError = sqrt(pcgSquared / 64);
+		Logger::INFO.log("RMSE at " + std::to_string(n) + " spp: Sobol " + std::to_string(sobolError) + ", PCG " + std::to_string(pcgError));
+	}
+	CHECK_LT(sobolError * 10.0, pcgError);
+
+	const UINT32 timedSamples = 1 << 22;
+	float sink = 0.0F;
+	Timer timer;
+	timer.reset();
+	for(UINT32 i = 0; i < timedSamples; ++i)
+	{
+		SobolSampler s = initSampler(i & 1023, i >> 10, i);
+		sink += sampleNext2D(s).x;
+	}
+	timer.tick();
+	float sobolNs = timer.deltaTime() * 1e9F / timedSamples;
+	timer.reset();
+	for(UINT32 i = 0; i < timedSamples; ++i)
+	{
+		uint seed = initRand(i, 7);
+		sink += nextRand(seed) + nextRand(seed);
+	}
+	timer.tick();
+	float pcgNs = timer.deltaTime() * 1e9F / timedSamples;
+	Logger::INFO.log("Cost per 2D sample: Sobol " + std::to_string(sobolNs) + "ns, PCG " + std::to_string(pcgNs) + "ns" + (sink < 0.0F ? " " : ""));
+}
\ No newline at end of file
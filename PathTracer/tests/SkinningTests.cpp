@@ -0,0 +1,127 @@
+#include "Test.h"
+
+#include "utils/Skinning.h"
+#include "utils/Timer.h"
+
+using namespace DirectX;
+using namespace RT;
+
+#define TUBE_JOINTS		4
+#define TUBE_VERTICES	(1 << 20)
+#define TUBE_ROOT_RING	64 //vertices on the root joint alone
+
+//a chain of joints one unit apart along y, each bending around z by up to 30 degrees, and a tube around it
+//with every vertex blended between the two joints it sits between
+struct Tube
+{
+	Skeleton skeleton;
+	std::vector<Vertex> bindPose;
+	std::vector<BoneWeights> bones;
+
+	Tube()
+	{
+		skeleton.nodes.resize(TUBE_JOINTS);
+		AnimationClip clip;
+		clip.duration = 2.0F;
+		for(UINT32 j = 0; j < TUBE_JOINTS; ++j)
+		{
+			skeleton.nodes[j].parent = (INT32) j - 1;
+			skeleton.nodes[j].translation = { 0.0F, j == 0 ? 0.0F : 1.0F, 0.0F };
+			skeleton.order.push_back(j);
+			skeleton.joints.push_back(j);
+
+			XMFLOAT4X4 inverseBind;
+			XMStoreFloat4x4(&inverseBind, XMMatrixTranslation(0.0F, -(float) j, 0.0F));
+			skeleton.inverseBind.push_back(inverseBind);
+
+			AnimationChannel channel;
+			channel.node = j;
+			channel.path = ANIMATION_PATH_ROTATION;
+			channel.times = { 0.0F, 1.0F };
+			XMFLOAT4 bent;
+			XMStoreFloat4(&bent, XMQuaternionRotationAxis(XMVectorSet(0.0F, 0.0F, 1.0F, 0.0F), XMConvertToRadians(30.0F)));
+			channel.values = { { 0.0F, 0.0F, 0.0F, 1.0F }, bent };
+			clip.channels.push_back(channel);
+		}
+		skeleton.clips.push_back(clip);
+
+		bindPose.resize(TUBE_VERTICES);
+		bones.resize(TUBE_VERTICES);
+		UINT seed = 3;
+		auto random = [&]()
+		{
+			seed = seed * 1664525 + 1013904223;
+			return (seed >> 8) / 16777216.0F;
+		};
+		for(UINT32 i = 0; i < TUBE_VERTICES; ++i)
+		{
+			float y = i < TUBE_ROOT_RING ? 0.0F : random() * (TUBE_JOINTS - 1);
+			float phi = random() * XM_2PI;
+			bindPose[i].position = { 0.2F * cosf(phi), y, 0.2F * sinf(phi) };
+			bindPose[i].normal = { cosf(phi), 0.0F, sinf(phi) };
+			bindPose[i].tangent = { 0.0F, 1.0F, 0.0F, i % 2 == 0 ? 1.0F : -1.0F };
+
+			UINT32 j0 = std::min<UINT32>((UINT32) y, TUBE_JOINTS - 2);
+			UINT16 w1 = (UINT16) ((y - j0) * 65535.0F + 0.5F);
+			bones[i].joints[0] = (UINT8) j0;
+			bones[i].joints[1] = (UINT8) (j0 + 1);
+			bones[i].weights[0] = (UINT16) (65535 - w1);
+			bones[i].weights[1] = w1;
+		}
+	}
+};
+
+//the rest pose has to give back the bind pose
+TEST_CASE(SkinningRestPose)
+{
+	Tube tube;
+	std::vector<XMFLOAT4X4> palette;
+	std::vector<Vertex> skinned(TUBE_VERTICES);
+	Skinning::evaluate(tube.skeleton, 0, 0.0F, palette);
+	Skinning::skin(tube.bindPose, tube.bones, palette, skinned.data());
+
+	float error = 0.0F;
+	for(UINT32 i = 0; i < TUBE_VERTICES; ++i)
+		error = std::max<float>(error, XMVectorGetX(XMVector3Length(XMLoadFloat3(&skinned[i].position) - XMLoadFloat3(&tube.bindPose[i].position))));
+	CHECK_LT(error, 1e-4F);
+}
+
+//halfway through the bend the root is turned by 15 degrees, the first ring only follows it
+TEST_CASE(SkinningRigidJoint)
+{
+	Tube tube;
+	std::vector<XMFLOAT4X4> palette;
+	std::vector<Vertex> skinned(TUBE_VERTICES);
+	Skinning::evaluate(tube.skeleton, 0, 0.5F, palette);
+	Skinning::skin(tube.bindPose, tube.bones, palette, skinned.data());
+
+	XMMATRIX root = XMMatrixRotationZ(XMConvertToRadians(15.0F));
+	float error = 0.0F;
+	for(UINT32 i = 0; i < TUBE_ROOT_RING; ++i)
+		error = std::max<float>(error, XMVectorGetX(XMVector3Length(XMLoadFloat3(&skinned[i].position) - XMVector3Transform(XMLoadFloat3(&tube.bindPose[i].position), root))));
+	CHECK_LT(error, 1e-4F);
+}
+
+//the vectorized skinning against the scalar reference on blended influences
+TEST_CASE(SkinningBlend)
+{
+	Tube tube;
+	std::vector<XMFLOAT4X4> palette;
+	std::vector<Vertex> skinned(TUBE_VERTICES);
+	Skinning::evaluate(tube.skeleton, 0, 0.5F, palette);
+
+	Timer timer;
+	timer.reset();
+	Skinning::skin(tube.bindPose, tube.bones, palette, skinned.data());
+	timer.tick();
+	float ms = timer.deltaTime() * 1000.0F;
+	Logger::INFO.log(std::to_string(TUBE_VERTICES) + " vertices in " + std::to_string(ms) + "ms (" + std::to_string((int) (TUBE_VERTICES / std::max<float>(ms, 1e-3F))) + " vertices/ms)");
+
+	CHECK_LT(Skinning::validate(tube.bindPose, tube.bones, palette), 1e-4F);
+
+	//bones rotate the frame, the handedness stays with the vertex
+	UINT32 flipped = 0;
+	for(UINT32 i = 0; i < TUBE_VERTICES; ++i)
+		flipped += skinned[i].tangent.w == tube.bindPose[i].tangent.w ? 0 : 1;
+	CHECK_EQ(flipped, 0u);
+}
\ No newline at end of file
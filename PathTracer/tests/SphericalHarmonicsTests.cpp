@@ -0,0 +1,109 @@
+#include "Test.h"
+
+#include "rendering/EnvironmentMap.h"
+#include "rendering/SphericalHarmonics.h"
+#include "utils/Timer.h"
+
+#include <functional>
+
+using namespace DirectX;
+using namespace RT;
+
+static float nextRand(UINT& s)
+{
+	s = (1664525u * s + 1013904223u);
+	return float(s & 0x00FFFFFF) / float(0x01000000);
+}
+
+static const UINT32 size = 32;
+
+static std::vector<XMFLOAT3> makeCubemap(UINT32 size, const std::function<XMFLOAT3(FXMVECTOR)>& radiance)
+{
+	std::vector<XMFLOAT3> texels((size_t) 6 * size * size);
+	for(UINT32 face = 0; face < 6; ++face)
+		for(UINT32 y = 0; y < size; ++y)
+			for(UINT32 x = 0; x < size; ++x)
+				texels[((size_t) face * size + y) * size + x] = radiance(XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size)));
+	return texels;
+}
+
+static std::vector<XMVECTOR> randomNormals()
+{
+	UINT seed = 23;
+	std::vector<XMVECTOR> normals(64);
+	for(auto& n:normals)
+		n = XMVector3Normalize(XMVectorSet(nextRand(seed) - 0.5F, nextRand(seed) - 0.5F, nextRand(seed) - 0.5F, 0.0F));
+	return normals;
+}
+
+//a smooth sky with a bright horizon band
+static XMFLOAT3 sky(FXMVECTOR dir)
+{
+	float up = XMVectorGetY(dir);
+	float horizon = expf(-8.0F * up * up);
+	return XMFLOAT3(0.2F + 0.6F * std::max<float>(up, 0.0F) + 0.3F * horizon, 0.3F + 0.7F * std::max<float>(up, 0.0F) + 0.25F * horizon, 0.4F + 0.9F * std::max<float>(up, 0.0F) + 0.1F * horizon);
+}
+
+//a linear radiance 1 + w.a is exact in L1, its irradiance over pi is 1 + 2/3 n.a
+TEST_CASE(SHLinear)
+{
+	XMVECTOR a = XMVectorSet(0.3F, 0.5F, -0.2F, 0.0F);
+	SHCoefficients linear = SphericalHarmonics::ambient(SphericalHarmonics::projectCubemap(makeCubemap(size, [&](FXMVECTOR dir) { float l = 1.0F + XMVectorGetX(XMVector3Dot(dir, a)); return XMFLOAT3(l, l, l); }), size));
+	float worst = 0.0F;
+	for(auto& n:randomNormals())
+	{
+		float expected = 1.0F + 2.0F / 3.0F * XMVectorGetX(XMVector3Dot(n, a));
+		worst = std::max<float>(worst, fabsf(XMVectorGetX(SphericalHarmonics::evaluate(linear, n)) - expected));
+	}
+	CHECK_LT(worst, 2e-3F);
+}
+
+//against brute force irradiance, L2 is known to stay within a few percent on a smooth sky
+TEST_CASE(SHSky)
+{
+	std::vector<XMFLOAT3> texels = makeCubemap(size, sky);
+	SHCoefficients skyAmbient = SphericalHarmonics::ambient(SphericalHarmonics::projectCubemap(texels, size));
+
+	float worst = 0.0F;
+	for(auto& n:randomNormals())
+	{
+		XMVECTOR exact = XMVectorZero();
+		for(UINT32 face = 0; face < 6; ++face)
+		{
+			for(UINT32 y = 0; y < size; ++y)
+			{
+				for(UINT32 x = 0; x < size; ++x)
+				{
+					XMVECTOR dir = XMVector3Normalize(EnvironmentMap::faceDirection(face, (x + 0.5F) / size, (y + 0.5F) / size));
+					float w = std::max<float>(XMVectorGetX(XMVector3Dot(dir, n)), 0.0F) * EnvironmentMap::texelSolidAngle(x, y, size);
+					exact += XMLoadFloat3(&texels[((size_t) face * size + y) * size + x]) * w;
+				}
+			}
+		}
+		exact /= XM_PI;
+
+		XMVECTOR error = XMVectorAbs(SphericalHarmonics::evaluate(skyAmbient, n) - exact) / XMVectorMax(exact, XMVectorReplicate(1e-3F));
+		worst = std::max<float>(worst, std::max<float>(XMVectorGetX(error), std::max<float>(XMVectorGetY(error), XMVectorGetZ(error))));
+	}
+	CHECK_LT(worst, 0.05F);
+
+	//projection cost at the size of the usual cubemaps
+	const UINT32 fullSize = 512;
+	std::vector<XMFLOAT3> full = makeCubemap(fullSize, sky);
+	Timer timer;
+	timer.reset();
+	SphericalHarmonics::projectCubemap(full, fullSize);
+	timer.tick();
+	Logger::INFO.log("SH projection of a " + std::to_string(fullSize) + "x" + std::to_string(fullSize) + " cubemap: " + std::to_string(timer.deltaTime() * 1000.0F) + "ms, worst relative error " +
+					 std::to_string(worst) + " against brute force");
+}
+
+//a constant sky gives the old constant ambient back
+TEST_CASE(SHConstant)
+{
+	SHCoefficients flat = SphericalHarmonics::ambient(SphericalHarmonics::projectCubemap(makeCubemap(size, [](FXMVECTOR) { return XMFLOAT3(SH_DEFAULT_AMBIENT, SH_DEFAULT_AMBIENT, SH_DEFAULT_AMBIENT); }), size));
+	float worst = 0.0F;
+	for(auto& n:randomNormals())
+		worst = std::max<float>(worst, fabsf(XMVectorGetX(SphericalHarmonics::evaluate(flat, n)) - XMVectorGetX(SphericalHarmonics::evaluate(SphericalHarmonics::constant(SH_DEFAULT_AMBIENT), n))));
+	CHECK_LT(worst, 1e-4F);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "Test.h"
+
+#include <algorithm>
+
+using namespace RT;
+
+namespace RT::Test
+{
+	static std::vector<TestCase>& registry()
+	{
+		static std::vector<TestCase> cases;
+		return cases;
+	}
+
+	static UINT32 failures = 0;
+
+	Registrar::Registrar(const char* name, TestFunction function)
+	{
+		registry().push_back({ name, function });
+	}
+
+	bool report(bool passed, const char* expression, const char* file, int line, const std::string& details)
+	{
+		if(passed)
+			return true;
+
+		failures++;
+		std::string fileName = std::string(file).substr(std::string(file).find_last_of("/\\") + 1);
+		Logger::ERR.log(fileName + ":" + std::to_string(line) + ": " + expression + (details.empty() ? "" : " (" + details + ")"));
+		return false;
+	}
+}
+
+//runs the cases named on the command line, all of them without arguments. Working directory is PathTracer/ like the executables
+int main(int argc, char** argv)
+{
+	Logger::setup();
+
+	std::vector<std::string> names(argv + 1, argv + argc);
+	if(names.size() == 1 && names[0] == "-list")
+	{
+		for(auto& test:Test::registry())
+			printf("%s\n", test.name.c_str());
+		return EXIT_SUCCESS;
+	}
+
+	UINT32 run = 0, failed = 0;
+	for(auto& test:Test::registry())
+	{
+		if(!names.empty() && std::find(names.begin(), names.end(), test.name) == names.end())
+			continue;
+
+		Test::failures = 0;
+		try
+		{
+			test.function();
+		}
+		catch(Test::Abort&)
+		{
+		}
+		catch(std::exception& e)
+		{
+			Test::report(false, "unexpected exception", __FILE__, __LINE__, e.what());
+		}
+
+		run++;
+		failed += Test::failures > 0 ? 1 : 0;
+		(Test::failures == 0 ? Logger::INFO : Logger::ERR).log(test.name + (Test::failures == 0 ? " passed" : " FAILED"));
+	}
+
+	if(run == 0 || run < names.size())
+	{
+		Logger::ERR.log("Unknown test, -list prints the registered ones");
+		return EXIT_FAILURE;
+	}
+
+	Logger::INFO.log(std::to_string(run - failed) + "/" + std::to_string(run) + " tests passed");
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "utils/core.h"
+
+//every TEST_CASE registers itself, CHECK records a failure and keeps going, REQUIRE ends the case
+namespace RT::Test
+{
+	typedef void (*TestFunction)();
+
+	struct TestCase
+	{
+		std::string name;
+		TestFunction function;
+	};
+
+	struct Registrar
+	{
+		Registrar(const char* name, TestFunction function);
+	};
+
+	//thrown by REQUIRE
+	struct Abort {};
+
+	bool report(bool passed, const char* expression, const char* file, int line, const std::string& details = "");
+
+	template<typename T>
+	std::string toString(const T& value)
+	{
+		std::ostringstream stream;
+		stream << value;
+		return stream.str();
+	}
+}
+
+#define TEST_CASE(name)																\
+	static void name();																\
+	static RT::Test::Registrar name##Registrar(#name, name);						\
+	static void name()
+
+#define CHECK(expr)				RT::Test::report((expr), #expr, __FILE__, __LINE__)
+#define CHECK_MSG(expr, details)	RT::Test::report((expr), #expr, __FILE__, __LINE__, (details))
+#define REQUIRE(expr)			do { if(!RT::Test::report((expr), #expr, __FILE__, __LINE__)) throw RT::Test::Abort(); } while(0)
+
+//comparisons that report both sides
+#define CHECK_OP(a, op, b)		RT::Test::report((a) op (b), #a " " #op " " #b, __FILE__, __LINE__, RT::Test::toString(a) + " vs " + RT::Test::toString(b))
+#define CHECK_EQ(a, b)			CHECK_OP(a, ==, b)
+#define CHECK_LT(a, b)			CHECK_OP(a, <, b)
+#define CHECK_LE(a, b)			CHECK_OP(a, <=, b)
+#define CHECK_GT(a, b)			CHECK_OP(a, >, b)
+#define CHECK_GE(a, b)			CHECK_OP(a, >=, b)
+#define CHECK_NEAR(a, b, eps)	RT::Test::report(fabs((double) (a) - (double) (b)) <= (eps), #a " ~ " #b, __FILE__, __LINE__, RT::Test::toString(a) + " vs " + RT::Test::toString(b) + " within " + RT::Test::toString(eps))
\ No newline at end of file
@@ -27,6 +27,7 @@ workspace "PathTracer"
 
 		removefiles { "%{prj.name}/res/shaders/raytracing/**.hlsl" }
 		removefiles { "%{prj.name}/res/shaders/raytracing" }
+		removefiles { "%{prj.name}/src/main_headless.cpp" } -- entry point of the portable CMake build
 
 		filter "system:windows"
 			cppdialect "C++20"